@@ -97,6 +97,7 @@ namespace UTXOModel
 	const string UTXO_CONTRACT_TYPE_CASEBASED  = "CaseBased";		// The type of logical validation
 
 	const dev::u256 TokenMaxCnt = 1000;								// The maximum number of using tokens
+	const size_t ApproximateTokenMaxCnt = 1000;						// The most tokens SelectTokens searches subsets of, more are picked largest first
 	
 	static string UTXOExecuteMsg[UTXOExecuteState::StateCnt] = { 
 		"Success.",
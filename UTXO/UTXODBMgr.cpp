@@ -44,7 +44,7 @@ namespace UTXOModel
 
 	UTXODBMgr::UTXODBMgr(const UTXODBMgr& _s):
     	m_cacheWritedtoDB(_s.m_cacheWritedtoDB),
-		m_dbCacheCnt(_s.m_dbCacheCnt),
+		m_dbCacheCnt(_s.m_dbCacheCnt.load()),
 		m_dbHash(_s.m_dbHash),
 		m_cacheToken(_s.m_cacheToken),
 		m_cacheTokenBlockNum(_s.m_cacheTokenBlockNum)
@@ -57,7 +57,7 @@ namespace UTXOModel
 			return *this;
 
 		m_cacheWritedtoDB = _s.m_cacheWritedtoDB;
-		m_dbCacheCnt = _s.m_dbCacheCnt;
+		m_dbCacheCnt = _s.m_dbCacheCnt.load();
 		m_dbHash = _s.m_dbHash;
 		m_cacheToken = _s.m_cacheToken;
 		m_cacheTokenBlockNum = _s.m_cacheTokenBlockNum;
@@ -74,14 +74,8 @@ namespace UTXOModel
 	
 	void UTXODBMgr::initVaultCache()
 	{
-		h256 accountRegistered = (h256)0;	// Newly registered account
+		h256 accountRegistered = UTXOSharedData::getInstance()->getLastAccount();	// Newly registered account
 		bool bFind = false;
-
-		vector<h256> accountList = UTXOSharedData::getInstance()->getAccountList();
-		if (accountList.size() > 0)
-		{
-			accountRegistered = accountList[accountList.size() - 1];
-		}
 		
 		LOG(TRACE) << "UTXODBMgr::initVaultCache account:" << toJS(accountRegistered);
 
@@ -151,7 +145,7 @@ namespace UTXOModel
 	void UTXODBMgr::registerAccount(const string& account)
 	{
 		UTXOSharedData::getInstance()->pushAcccountToList(sha3(account));
-		LOG(TRACE) << "UTXODBMgr::registerAccount cur account(" << account << "," << toJS(sha3(account)) << "),size:" << UTXOSharedData::getInstance()->getAccountList().size();
+		LOG(TRACE) << "UTXODBMgr::registerAccount cur account(" << account << "," << toJS(sha3(account)) << "),size:" << UTXOSharedData::getInstance()->getAccountCnt();
 		initVaultCache();
 		updateHistoryAccount(account);
 		return;
@@ -212,7 +206,7 @@ namespace UTXOModel
 		for (h256 hash : hashList)
 		{
 			UTXOSharedData::getInstance()->pushAcccountToList(hash);
-			LOG(TRACE) << "UTXODBMgr::registerHistoryAccount cur account(" << toJS(hash) << "),size:" << UTXOSharedData::getInstance()->getAccountList().size();
+			LOG(TRACE) << "UTXODBMgr::registerHistoryAccount cur account(" << toJS(hash) << "),size:" << UTXOSharedData::getInstance()->getAccountCnt();
 			initVaultCache();
 		}
 		return;
@@ -240,30 +234,24 @@ namespace UTXOModel
 		string strKey = GET_TOKEN_NUM_KEY(key);
 		string strValue = toJS(tokenIdx.rlp());
 		//LOG(TRACE) << "UTXODBMgr::addTokenIdx key:" << strKey;
-		UTXODBCache tokenIdxRecord(strKey, strValue);
-		DEV_WRITE_GUARDED(m_dbCache_lock)
-		{
-			m_cacheWritedtoDB[strKey] = tokenIdxRecord;
-			m_dbCacheCnt++;
-		}
-		DEV_WRITE_GUARDED(m_tokenCache_lock)
+		cacheWrite(strKey, strValue);
+		TokenID id;
+		if (toTokenID(key, id))
 		{
-			m_cacheTokenBlockNum[key] = tokenIdx;
+			m_cacheTokenBlockNum.set(id, tokenIdx);
 		}
 	}
 
 	bool UTXODBMgr::getTokenIdx(const string& key, TokenExtOnBlockNum& tokenIdx)			// 参数key为Token原Key
 	{
 		//LOG(TRACE) << "UTXODBMgr::getTokenIdx, key:" << key;
-		DEV_READ_GUARDED(m_tokenCache_lock)
+		// A key that isn't in the canonical form can't be in the DB either, so it is not cached.
+		TokenID id;
+		bool cacheable = toTokenID(key, id);
+		if (cacheable && m_cacheTokenBlockNum.get(id, tokenIdx))
 		{
-			map<string, TokenExtOnBlockNum>::iterator it = m_cacheTokenBlockNum.find(key);
-			if (it != m_cacheTokenBlockNum.end())
-			{
-				//LOG(TRACE) << "UTXODBMgr::getTokenIdx from memory";
-				tokenIdx = it->second;
-				return true;
-			}
+			//LOG(TRACE) << "UTXODBMgr::getTokenIdx from memory";
+			return true;
 		}
 
 		string strKey = GET_TOKEN_NUM_KEY(key);
@@ -277,9 +265,9 @@ namespace UTXOModel
 
 		TokenExtOnBlockNum _tokenIdx(jsToBytes(strTokenIdx));
 		tokenIdx = _tokenIdx;
-		DEV_WRITE_GUARDED(m_tokenCache_lock)
+		if (cacheable)
 		{
-			m_cacheTokenBlockNum[key] = _tokenIdx;
+			m_cacheTokenBlockNum.set(id, _tokenIdx);
 		}
 		//LOG(TRACE) << "UTXODBMgr::getTokenIdx from db";
 
@@ -317,23 +305,13 @@ namespace UTXOModel
 		{
 			string strBaseKey = GET_TOKEN_BASE_KEY(key);
 			string strBaseValue = toJS(tokenBase.rlp());
-			UTXODBCache tokenBaseRecord(strBaseKey, strBaseValue);
-			DEV_WRITE_GUARDED(m_dbCache_lock)
-			{
-				m_cacheWritedtoDB[strBaseKey] = tokenBaseRecord;
-				m_dbCacheCnt++;
-			}
+			cacheWrite(strBaseKey, strBaseValue);
 		}
 
 		u256 blockNumber = (m_blockNumber > 0)?m_blockNumber:UTXOSharedData::getInstance()->getBlockNum();
 		string strExtKey = GET_TOKEN_EXT_KEY(key, toJS(blockNumber));
 		string strExtValue = toJS(tokenExt.rlp());
-		UTXODBCache tokenExtRecord(strExtKey, strExtValue);
-		DEV_WRITE_GUARDED(m_dbCache_lock)
-		{
-			m_cacheWritedtoDB[strExtKey] = tokenExtRecord;
-			m_dbCacheCnt++;
-		}
+		cacheWrite(strExtKey, strExtValue);
 
 		//LOG(TRACE) << "UTXODBMgr::addToken key:" << key << ",new:" << bNew << ",used:" << (tokenExt.getTokenState() == TokenStateUsed);
 
@@ -353,10 +331,10 @@ namespace UTXOModel
 		}
 		addTokenIdx(key, tokenIdx);
 
-		Token token(tokenBase, tokenExt);
-		DEV_WRITE_GUARDED(m_tokenCache_lock)
+		TokenID id;
+		if (toTokenID(key, id))
 		{
-			m_cacheToken[key] = token;
+			m_cacheToken.set(id, Token(tokenBase, tokenExt));
 		}
 	}
 
@@ -364,16 +342,13 @@ namespace UTXOModel
 	{
 		LOG(TRACE) << "UTXODBMgr::getToken, key:" << key;
 
-		DEV_READ_GUARDED(m_tokenCache_lock)
+		TokenID id;
+		bool cacheable = toTokenID(key, id);
+		if (cacheable && m_cacheToken.get(id, token))
 		{
-			map<string, Token>::iterator it = m_cacheToken.find(key);
-			if (it != m_cacheToken.end())
-			{
-				// Get token from cache
-				token = it->second;
-				LOG(TRACE) << "UTXODBMgr::getToken from memory" << ",used:" << (token.m_tokenExt.getTokenState() == TokenStateUsed);
-				return true;
-			}
+			// Get token from cache
+			LOG(TRACE) << "UTXODBMgr::getToken from memory" << ",used:" << (token.m_tokenExt.getTokenState() == TokenStateUsed);
+			return true;
 		}
 
 		// Get token from DB
@@ -403,9 +378,9 @@ namespace UTXOModel
 		TokenExt tokenExt(jsToBytes(strExtValue));
 		Token _token(tokenBase, tokenExt);
 		token = _token;
-		DEV_WRITE_GUARDED(m_tokenCache_lock)
+		if (cacheable)
 		{
-			m_cacheToken[key] = _token;
+			m_cacheToken.set(id, _token);
 		}
 
 		LOG(TRACE) << "UTXODBMgr::getToken from db" << ",used:" << (token.m_tokenExt.getTokenState() == TokenStateUsed);
@@ -413,16 +388,30 @@ namespace UTXOModel
 		return true;
 	}
 
+	void UTXODBMgr::cacheWrite(const string& strKey, const string& strValue)
+	{
+		CachedWrite write;
+		write.record = UTXODBCache(strKey, strValue);
+		// Vaults differ between nodes, so they are left out of the hash
+		if (strKey.substr(0,2) != VAULT_KEY_PERFIX)
+		{
+			// Encoded here, on the thread executing the transaction, so that getHash only has to build the trie
+			RLPStream k;
+			k << strKey;
+			k.swapOut(write.hashKey);
+			RLPStream rlp;
+			write.record.streamRLP(rlp);
+			rlp.swapOut(write.hashValue);
+			m_dbCacheCnt++;
+		}
+		m_cacheWritedtoDB.set(strKey, move(write));
+	}
+
 	void UTXODBMgr::addTx(const string& key, const UTXOTx& tx) 
 	{
 		string strKey = GET_TX_KEY(key);
 		string strValue = toJS(tx.rlp());
-		UTXODBCache txRecord(strKey, strValue);
-		DEV_WRITE_GUARDED(m_dbCache_lock)
-		{
-			m_cacheWritedtoDB[strKey] = txRecord;
-			m_dbCacheCnt++;
-		}
+		cacheWrite(strKey, strValue);
 	}
 
 	bool UTXODBMgr::getTx(const string& key, UTXOTx& tx) 
@@ -448,20 +437,12 @@ namespace UTXOModel
 			string key = vault.getTokenKey();
 			string strKey = GET_VAULT_KEY(key);
 			string strValue = toJS(vault.rlp());
-			UTXODBCache vaultRecord(strKey, strValue);
-			DEV_WRITE_GUARDED(m_dbCache_lock)
-			{
-				m_cacheWritedtoDB[strKey] = vaultRecord;
-			}
+			cacheWrite(strKey, strValue);
 			return;
 		}
 
-		bool bFind;
 		h256 owner = vault.getOwnerHash();
-		vector<h256> accountList = UTXOSharedData::getInstance()->getAccountList();
-		bFind = find(accountList.begin(), accountList.end(), owner) != accountList.end();
-
-		if (bFind)
+		if (UTXOSharedData::getInstance()->accountIsRegistered(owner))
 		{
 			try 
 			{
@@ -498,21 +479,15 @@ namespace UTXOModel
 	{
 		if (false == writeMemory)
 		{
-			DEV_WRITE_GUARDED(m_dbCache_lock)
-			{
-				string key = vault.getTokenKey();
-				string strKey = GET_VAULT_KEY(key);
-				string strValue = toJS(vault.rlp());
-				UTXODBCache vaultRecord(strKey, strValue);
-				m_cacheWritedtoDB[strKey] = vaultRecord;
-			}
+			string key = vault.getTokenKey();
+			string strKey = GET_VAULT_KEY(key);
+			string strValue = toJS(vault.rlp());
+			cacheWrite(strKey, strValue);
 			return;
 		}
 
 		h256 owner = vault.getOwnerHash();
-		vector<h256> accountList = UTXOSharedData::getInstance()->getAccountList();
-		vector<h256>::iterator it = find(accountList.begin(), accountList.end(), owner);
-		if (it != accountList.end())
+		if (UTXOSharedData::getInstance()->accountIsRegistered(owner))
 		{
 			string tokenKey = vault.getTokenKey();
 			//LOG(TRACE) << "UTXODBMgr::updateVault account is registered, tokenKey:" << tokenKey;
@@ -620,34 +595,34 @@ namespace UTXOModel
 	{
 		ldb::WriteBatch batch;
 
-		DEV_READ_GUARDED(m_dbCache_lock)
-		{
-			int writeCnt = 0;
-
-			for (map<string, UTXODBCache>::iterator it = m_cacheWritedtoDB.begin(); it != m_cacheWritedtoDB.end(); it++)
-			{	
-				string key = it->first;
-				string perfix = key.substr(0,2);
-				if (TOKEN_BASE_KEY_PERFIX == perfix || 
-					TOKEN_EXT_KEY_PERFIX == perfix || 
-					TOKEN_NUM_KEY_PERFIX == perfix || 
-					TX_KEY_PERFIX == perfix)
-				{
-					batch.Put(key, it->second.getValue());
-					writeCnt++;
-				}
-				else if (perfix == VAULT_KEY_PERFIX)
-				{
-					Vault vault(jsToBytes(it->second.getValue()));
-					addVault(vault, true);
-				}
-				else
-				{
-					LOG(ERROR) << "UTXODBMgr::commitDB Invalid perfix, key:" << key;
-				}
+		int writeCnt = 0;
+		vector<Vault> vaults;
+		m_cacheWritedtoDB.forEach([&](const string& key, const CachedWrite& write) {
+			const UTXODBCache& record = write.record;
+			string perfix = key.substr(0,2);
+			if (TOKEN_BASE_KEY_PERFIX == perfix || 
+				TOKEN_EXT_KEY_PERFIX == perfix || 
+				TOKEN_NUM_KEY_PERFIX == perfix || 
+				TX_KEY_PERFIX == perfix)
+			{
+				batch.Put(key, record.getValue());
+				writeCnt++;
 			}
-			LOG(TRACE) << "UTXODBMgr::commitDB, cnt:" << writeCnt << "=" << m_dbCacheCnt;
+			else if (perfix == VAULT_KEY_PERFIX)
+			{
+				vaults.push_back(Vault(jsToBytes(record.getValue())));
+			}
+			else
+			{
+				LOG(ERROR) << "UTXODBMgr::commitDB Invalid perfix, key:" << key;
+			}
+		});
+		// Outside of the shard locks, addVault reads tokens through the caches.
+		for (const Vault& vault : vaults)
+		{
+			addVault(vault, true);
 		}
+		LOG(TRACE) << "UTXODBMgr::commitDB, cnt:" << writeCnt << "=" << m_dbCacheCnt;
 
 		try
 		{
@@ -671,8 +646,7 @@ namespace UTXOModel
 
 	bool UTXODBMgr::accountIsRegistered(Address account)
 	{
-		vector<h256> accountList = UTXOSharedData::getInstance()->getAccountList();
-		return (find(accountList.begin(), accountList.end(), sha3(toJS(account))) != accountList.end());
+		return UTXOSharedData::getInstance()->accountIsRegistered(sha3(toJS(account)));
 	}
 
 	// BTC logic
@@ -681,55 +655,57 @@ namespace UTXOModel
 		tokenKeys.clear();
 		totalValue = 0;
 
+		// The unused tokens of the account are ordered by value, so the exact match and the
+		// lowest larger one are found in O(log n) and only tokens smaller than the target are walked.
+		bool bEnough = false;
+		bool bExact = false;
+		string tokenLowestLarger;
 		u256 nLowestLarger = 0;
-
-		map<string, Token_Record> records = UTXOSharedData::getInstance()->getCacheVaultByAccount(account);
-		for (map<string, Token_Record>::iterator it = records.begin(); it != records.end(); it++)
-		{
-			if (it->second.tokenState == TokenStateInit)
+		vector<pair<u256, string>> vValue;		// Tokens smaller than the target, largest first
+		u256 nTotalLower = 0;
+		bool bGreedy = false;
+		UTXOSharedData::getInstance()->readVault(account, [&](AccountVault const& vault) {
+			if (vault.balance < nTargetValue)
 			{
-				nLowestLarger += it->second.tokenValue;
+				return;
 			}
-		}
-		if (nLowestLarger < nTargetValue)
-		{
-			return false;
-		}
-		nLowestLarger += 1;
-
-		string tokenLowestLarger;
-		vector<pair<u256, string>> vValue;
-		u256 nTotalLower = 0;
+			bEnough = true;
 
-		{
-			//map<string, Token_Record> records = UTXOSharedData::getInstance()->getCacheVaultByAccount(account);
+			auto it = vault.unused.lower_bound(make_pair(nTargetValue, string()));
+			if (it != vault.unused.end() && it->first == nTargetValue)
+			{
+				tokenKeys.push_back(it->second);
+				totalValue = nTargetValue;
+				bExact = true;
+				return;
+			}
+			if (it != vault.unused.end())
+			{
+				nLowestLarger = it->first;
+				tokenLowestLarger = it->second;
+			}
 
-			for (map<string, Token_Record>::iterator it = records.begin(); it != records.end(); it++)
+			// With too many smaller tokens for the stochastic approximation, take the largest ones until the target is reached
+			auto lower = set<pair<u256, string>>::const_reverse_iterator(it);
+			size_t lowerCnt = 0;
+			for (auto r = lower; r != vault.unused.rend() && lowerCnt <= ApproximateTokenMaxCnt; ++r)
+			{
+				lowerCnt++;
+			}
+			bGreedy = lowerCnt > ApproximateTokenMaxCnt;
+			for (auto r = lower; r != vault.unused.rend(); ++r)
 			{
-				if (TokenStateInit != it->second.tokenState)
+				if (bGreedy && nTotalLower >= nTargetValue)
 				{
-					continue;
+					break;
 				}
-				
-				u256 value = it->second.tokenValue;
-
-				if (value < nTargetValue)
-           		{
-                	vValue.push_back(make_pair(value, it->second.tokenKey));
-                	nTotalLower += value;
-            	}
-            	else if (value == nTargetValue)
-            	{
-                	tokenKeys.push_back(it->second.tokenKey);
-					totalValue = value;
-                	return true;
-            	}
-            	else if (value < nLowestLarger)
-            	{
-                	nLowestLarger = value;
-                	tokenLowestLarger = it->second.tokenKey;
-            	}
+				vValue.push_back(*r);
+				nTotalLower += r->first;
 			}
+		});
+		if (!bEnough || bExact)
+		{
+			return bEnough;
 		}
 		
 		if (nTotalLower < nTargetValue)
@@ -743,9 +719,27 @@ namespace UTXOModel
 			totalValue = nLowestLarger;
 			return true;
 		}
+
+		if (bGreedy)
+		{
+			if (tokenLowestLarger != "" && 
+				nLowestLarger - nTargetValue <= nTotalLower - nTargetValue)
+			{
+				tokenKeys.push_back(tokenLowestLarger);
+				totalValue = nLowestLarger;
+			}
+			else
+			{
+				for (size_t i = 0; i < vValue.size(); i++)
+				{
+					tokenKeys.push_back(vValue[i].second);
+				}
+				totalValue = nTotalLower;
+			}
+			return true;
+		}
 		
 		// Solve subset sum by stochastic approximation
-		sort(vValue.rbegin(), vValue.rend());
 		vector<char> vfIncluded;
 		vector<char> vfBest(vValue.size(), true);
 		u256 nBest = nTotalLower;
@@ -877,14 +871,7 @@ namespace UTXOModel
 		balance = 0;
 		h256 account = sha3(toJS(sender));
 	
-		map<string, Token_Record> records = UTXOSharedData::getInstance()->getCacheVaultByAccount(account);
-		for (map<string, Token_Record>::iterator it = records.begin(); it != records.end(); it++)
-		{
-			if (it->second.tokenState == TokenStateInit)
-			{
-				balance += it->second.tokenValue;
-			}
-		}
+		balance = UTXOSharedData::getInstance()->getBalanceByAccount(account);
 
 		LOG(TRACE) << "UTXODBMgr::getBalanceByAccount account(" << toJS(sender) << "," << toJS(account) << "), balance:" << account;
 		return true;
@@ -893,30 +880,20 @@ namespace UTXOModel
 	h256 UTXODBMgr::getHash()
 	{
 		LOG(TRACE) << "UTXODBMgr::getHash";
-		DEV_READ_GUARDED(m_dbCache_lock)
+		Guard l(m_dbHash_lock);
+		if (!m_dbHash && m_dbCacheCnt > 0)
 		{
-			if (!m_dbHash && m_dbCacheCnt > 0)
-			{
-				BytesMap recordsMap;
-				map<string, UTXODBCache>::iterator it;
-				for (it = m_cacheWritedtoDB.begin(); it != m_cacheWritedtoDB.end(); it++)
+			// BytesMap is ordered, so the hash doesn't depend on the order of the index
+			BytesMap recordsMap;
+			m_cacheWritedtoDB.forEach([&](const string&, const CachedWrite& write) {
+				if (!write.hashKey.empty())
 				{
-					string key = it->first;
-					if (key.substr(0,2) == VAULT_KEY_PERFIX)
-					{
-						continue;
-					}
-					RLPStream k;
-        			k << key;
-					RLPStream rlp;
-       				it->second.streamRLP(rlp);
-					//LOG(TRACE) << "key:" << key << ",value:" << it->second.getValue();
-        			recordsMap.insert(make_pair(k.out(), rlp.out()));
+					recordsMap.insert(make_pair(write.hashKey, write.hashValue));
 				}
-				
-				m_dbHash = hash256(recordsMap);
-				LOG(TRACE) << "UTXODBMgr::getHash , size = " << m_cacheWritedtoDB.size() << ",dbHash = " << toJS(m_dbHash);
-			}
+			});
+			
+			m_dbHash = hash256(recordsMap);
+			LOG(TRACE) << "UTXODBMgr::getHash , size = " << m_cacheWritedtoDB.size() << ",dbHash = " << toJS(m_dbHash);
 		}
 
 		return m_dbHash;
@@ -926,17 +903,12 @@ namespace UTXOModel
 	{
 		LOG(TRACE) << "UTXODBMgr::clearDBRecord";
 
-		DEV_WRITE_GUARDED(m_dbCache_lock)
-		{
+		DEV_GUARDED(m_dbHash_lock)
 			m_dbHash = (h256)0;
-			m_dbCacheCnt = 0;
-			m_cacheWritedtoDB.clear();
-		}
-		DEV_WRITE_GUARDED(m_tokenCache_lock)
-		{
-			m_cacheToken.clear();
-			m_cacheTokenBlockNum.clear();
-		}	
+		m_dbCacheCnt = 0;
+		m_cacheWritedtoDB.clear();
+		m_cacheToken.clear();
+		m_cacheTokenBlockNum.clear();
 	}
 
 	void UTXODBMgr::setBlockNum(u256 blockNum)
@@ -24,6 +24,7 @@
 #ifndef __UTXODBMGR_H__
 #define __UTXODBMGR_H__
 
+#include <atomic>
 #include <string>
 #include <map>
 
@@ -33,6 +34,7 @@
 #include <libdevcrypto/Common.h>
 
 #include "UTXOData.h"
+#include "UTXOIndex.h"
 
 using namespace dev;
 using namespace std;
@@ -89,14 +91,24 @@ namespace UTXOModel
 		void setBlockNum(u256 blockNum);
 		
 	private:
-		mutable SharedMutex m_dbCache_lock;
-		map<string, UTXODBCache> m_cacheWritedtoDB;					// DB cache
-		u256 m_dbCacheCnt;											// The count of m_cacheWritedtoDB
+		// Transactions of different partitions run on different threads, so the caches are sharded
+		// hash indexes rather than maps under one lock; tokens are keyed by their binary TokenID.
+		// A cached DB write, with the key and value of its leaf in the hash of the block's records.
+		struct CachedWrite
+		{
+			UTXODBCache record;
+			bytes hashKey;			// Empty for vault records, which are not hashed
+			bytes hashValue;
+		};
+		void cacheWrite(const string& strKey, const string& strValue);
+
+		ShardedIndex<string, CachedWrite, std::hash<string>> m_cacheWritedtoDB;	// DB cache
+		atomic<size_t> m_dbCacheCnt{ 0 };							// The count of m_cacheWritedtoDB
+		mutable Mutex m_dbHash_lock;
 		h256 m_dbHash;												// The hash of the data used for consistency checking
 
-		mutable SharedMutex m_tokenCache_lock;
-		map<string, Token> m_cacheToken;							// Token cache
-		map<string, TokenExtOnBlockNum> m_cacheTokenBlockNum;		// Token BlockNum cache
+		ShardedIndex<TokenID, Token> m_cacheToken;					// Token cache
+		ShardedIndex<TokenID, TokenExtOnBlockNum> m_cacheTokenBlockNum;	// Token BlockNum cache
 
 		bool GetFromDB(leveldb::DB* db, const string& key, string* value);
 
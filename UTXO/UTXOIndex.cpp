@@ -0,0 +1,104 @@
+/*
+	This file is part of FISCO BCOS.
+
+	FISCO BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: UTXOIndex.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#include "UTXOIndex.h"
+
+namespace UTXOModel
+{
+	namespace
+	{
+		int hexValue(char c)
+		{
+			if (c >= '0' && c <= '9')
+				return c - '0';
+			if (c >= 'a' && c <= 'f')
+				return c - 'a' + 10;
+			return -1;
+		}
+	}
+
+	bool toTokenID(const string& tokenKey, TokenID& id)
+	{
+		// "0x" + 64 lower case hex digits + "_" + a decimal index without leading zeros
+		const size_t hashEnd = 2 + h256::size * 2;
+		if (tokenKey.size() < hashEnd + 2 || tokenKey.size() > hashEnd + 11 ||
+			tokenKey[0] != '0' || tokenKey[1] != 'x' || tokenKey[hashEnd] != '_')
+		{
+			return false;
+		}
+
+		for (unsigned i = 0; i < h256::size; i++)
+		{
+			int h = hexValue(tokenKey[2 + i * 2]);
+			int l = hexValue(tokenKey[3 + i * 2]);
+			if (h < 0 || l < 0)
+			{
+				return false;
+			}
+			id[i] = (byte)(h * 16 + l);
+		}
+
+		if (tokenKey[hashEnd + 1] == '0' && tokenKey.size() > hashEnd + 2)
+		{
+			return false;
+		}
+		uint64_t index = 0;
+		for (size_t i = hashEnd + 1; i < tokenKey.size(); i++)
+		{
+			if (tokenKey[i] < '0' || tokenKey[i] > '9')
+			{
+				return false;
+			}
+			index = index * 10 + (tokenKey[i] - '0');
+		}
+		if (index > 0xffffffff)
+		{
+			return false;
+		}
+		for (unsigned i = 0; i < 4; i++)
+		{
+			id[h256::size + i] = (byte)(index >> (24 - i * 8));
+		}
+		return true;
+	}
+
+	TokenID toTokenID(h256 const& txHash, unsigned index)
+	{
+		TokenID id(txHash);
+		for (unsigned i = 0; i < 4; i++)
+		{
+			id[h256::size + i] = (byte)(index >> (24 - i * 8));
+		}
+		return id;
+	}
+
+	string fromTokenID(TokenID const& id)
+	{
+		unsigned index = 0;
+		for (unsigned i = 0; i < 4; i++)
+		{
+			index = (index << 8) | id[h256::size + i];
+		}
+		return "0x" + toHex(id.ref().cropped(0, h256::size)) + "_" + to_string(index);
+	}
+}//namespace UTXOModel
@@ -0,0 +1,172 @@
+/*
+	This file is part of FISCO BCOS.
+
+	FISCO BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: UTXOIndex.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#ifndef __UTXOINDEX_H__
+#define __UTXOINDEX_H__
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+using namespace dev;
+using namespace std;
+
+namespace UTXOModel
+{
+	// Binary form of a token key "transactionHash_idxInUTXOTx": the transaction hash followed by
+	// the index as 4 big-endian bytes.
+	using TokenID = FixedHash<36>;
+
+	// Only the canonical form written by UTXOMgr converts, so a key that differs from it only in
+	// the case of its hex digits still misses, as it does in the DB.
+	bool toTokenID(const string& tokenKey, TokenID& id);
+	TokenID toTokenID(h256 const& txHash, unsigned index);
+	string fromTokenID(TokenID const& id);
+
+	// Hash index split in independently locked shards, so threads working on different keys
+	// rarely wait for each other.
+	template <class K, class V, class H = typename K::hash>
+	class ShardedIndex
+	{
+	public:
+		ShardedIndex() = default;
+		ShardedIndex(const ShardedIndex& _s) { *this = _s; }
+		ShardedIndex& operator=(const ShardedIndex& _s)
+		{
+			if (&_s == this)
+				return *this;
+			for (unsigned i = 0; i < c_shards; ++i)
+			{
+				unordered_map<K, V, H> items;
+				DEV_READ_GUARDED(_s.m_shards[i].lock)
+					items = _s.m_shards[i].items;
+				DEV_WRITE_GUARDED(m_shards[i].lock)
+					m_shards[i].items.swap(items);
+			}
+			return *this;
+		}
+
+		bool get(K const& key, V& value) const
+		{
+			Shard const& s = shard(key);
+			ReadGuard l(s.lock);
+			auto it = s.items.find(key);
+			if (it == s.items.end())
+				return false;
+			value = it->second;
+			return true;
+		}
+
+		bool contains(K const& key) const
+		{
+			Shard const& s = shard(key);
+			ReadGuard l(s.lock);
+			return s.items.count(key);
+		}
+
+		void set(K const& key, V const& value)
+		{
+			Shard& s = shard(key);
+			WriteGuard l(s.lock);
+			s.items[key] = value;
+		}
+
+		void set(K const& key, V&& value)
+		{
+			Shard& s = shard(key);
+			WriteGuard l(s.lock);
+			s.items[key] = move(value);
+		}
+
+		// Calls f(V&) on the value of key, default constructed if missing, under the shard lock.
+		template <class F> void modify(K const& key, F const& f)
+		{
+			Shard& s = shard(key);
+			WriteGuard l(s.lock);
+			f(s.items[key]);
+		}
+
+		// Calls f(V const&) on the value of key under the shard lock.
+		// Returns false if there is none.
+		template <class F> bool read(K const& key, F const& f) const
+		{
+			Shard const& s = shard(key);
+			ReadGuard l(s.lock);
+			auto it = s.items.find(key);
+			if (it == s.items.end())
+				return false;
+			f(it->second);
+			return true;
+		}
+
+		// Calls f(K const&, V const&) on every entry, one shard at a time.
+		template <class F> void forEach(F const& f) const
+		{
+			for (auto const& s : m_shards)
+			{
+				ReadGuard l(s.lock);
+				for (auto const& i : s.items)
+					f(i.first, i.second);
+			}
+		}
+
+		size_t size() const
+		{
+			size_t ret = 0;
+			for (auto const& s : m_shards)
+			{
+				ReadGuard l(s.lock);
+				ret += s.items.size();
+			}
+			return ret;
+		}
+
+		void clear()
+		{
+			for (auto& s : m_shards)
+			{
+				WriteGuard l(s.lock);
+				s.items.clear();
+			}
+		}
+
+	private:
+		static const unsigned c_shards = 16;
+
+		struct Shard
+		{
+			mutable SharedMutex lock;
+			unordered_map<K, V, H> items;
+		};
+
+		Shard& shard(K const& key) { return m_shards[H()(key) % c_shards]; }
+		Shard const& shard(K const& key) const { return m_shards[H()(key) % c_shards]; }
+
+		array<Shard, c_shards> m_shards;
+	};
+}//namespace UTXOModel
+
+#endif // __UTXOINDEX_H__
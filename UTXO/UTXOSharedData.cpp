@@ -108,83 +108,157 @@ namespace UTXOModel
 
 	void UTXOSharedData::pushAcccountToList(h256 account)
 	{
-		DEV_WRITE_GUARDED(m_vaultMem_lock)
-			m_accountList.push_back(account);
+		DEV_WRITE_GUARDED(m_accountList_lock)
+		{
+			if (m_accountSet.insert(account).second)
+			{
+				m_accountList.push_back(account);
+			}
+		}
 	}
 
 	vector<h256> UTXOSharedData::getAccountList()
 	{
-		DEV_READ_GUARDED(m_accountList_lock)
-		{
-			return m_accountList;
-		}
-
+		ReadGuard l(m_accountList_lock);
 		return m_accountList;
 	}
 
+	size_t UTXOSharedData::getAccountCnt()
+	{
+		ReadGuard l(m_accountList_lock);
+		return m_accountList.size();
+	}
+
+	h256 UTXOSharedData::getLastAccount()
+	{
+		ReadGuard l(m_accountList_lock);
+		return m_accountList.empty() ? h256() : m_accountList.back();
+	}
+
+	bool UTXOSharedData::accountIsRegistered(h256 account)
+	{
+		ReadGuard l(m_accountList_lock);
+		return m_accountSet.count(account);
+	}
+
 	void UTXOSharedData::setCacheVault(h256 account, const string& tokenKey, const Token_Record& tokenRecord)
 	{
-		DEV_WRITE_GUARDED(m_accountList_lock)
-			m_cacheVault[account][tokenKey] = tokenRecord;
+		TokenID id;
+		if (!toTokenID(tokenKey, id))
+		{
+			LOG(ERROR) << "UTXOSharedData::setCacheVault Invalid token key:" << tokenKey;
+			return;
+		}
+		m_cacheVault.modify(account, [&](AccountVault& vault) { vault.setRecord(id, tokenRecord); });
 	}
 
 	void UTXOSharedData::updateCacheState(h256 account, const string& tokenKey, TokenState state)
 	{
-		DEV_WRITE_GUARDED(m_accountList_lock)
-			m_cacheVault[account][tokenKey].tokenState = state;
+		TokenID id;
+		if (!toTokenID(tokenKey, id))
+		{
+			LOG(ERROR) << "UTXOSharedData::updateCacheState Invalid token key:" << tokenKey;
+			return;
+		}
+		m_cacheVault.modify(account, [&](AccountVault& vault) {
+			auto it = vault.records.find(id);
+			Token_Record record = it == vault.records.end() ? Token_Record(tokenKey, 0, state) : it->second;
+			record.tokenState = state;
+			vault.setRecord(id, record);
+		});
 	}
 
 	map<string, Token_Record> UTXOSharedData::getCacheVaultByAccount(h256 account)
 	{
-		DEV_READ_GUARDED(m_vaultMem_lock)
+		map<string, Token_Record> ret;
+		m_cacheVault.read(account, [&](AccountVault const& vault) {
+			for (auto const& record : vault.records)
+			{
+				ret.insert(make_pair(record.second.tokenKey, record.second));
+			}
+		});
+		return ret;
+	}
+
+	u256 UTXOSharedData::getBalanceByAccount(h256 account)
+	{
+		u256 balance = 0;
+		m_cacheVault.read(account, [&](AccountVault const& vault) { balance = vault.balance; });
+		return balance;
+	}
+
+	void AccountVault::setRecord(TokenID const& id, const Token_Record& record)
+	{
+		auto it = records.find(id);
+		if (it != records.end() && it->second.tokenState == TokenStateInit)
 		{
-			return m_cacheVault[account];
+			balance -= it->second.tokenValue;
+			unused.erase(make_pair(it->second.tokenValue, it->second.tokenKey));
 		}
-		
-		return m_cacheVault[account];
+		if (record.tokenState == TokenStateInit)
+		{
+			balance += record.tokenValue;
+			unused.insert(make_pair(record.tokenValue, record.tokenKey));
+		}
+		records[id] = record;
 	}
 
 	pair<vector<string>, u256> UTXOSharedData::getSelectTokensByKey(const pair<h256, u256>& key)
 	{
-		DEV_READ_GUARDED(m_selectTokens_lock)
-		{
-			return tokenMapForSelectTokens[key];
-		}
-			
-		return tokenMapForSelectTokens[key];
+		// find() rather than operator[], which would insert under a read lock
+		ReadGuard l(m_selectTokens_lock);
+		auto it = tokenMapForSelectTokens.find(key);
+		return it == tokenMapForSelectTokens.end() ? pair<vector<string>, u256>() : it->second;
 	}
 
 	void UTXOSharedData::setSelectTokensByKey(const pair<h256, u256>& key, pair<vector<string>, u256> value)
 	{
 		DEV_WRITE_GUARDED(m_selectTokens_lock)
+		{
 			tokenMapForSelectTokens[key] = value;
+			m_selectTokensCached = true;
+		}
 	}
 
 	void UTXOSharedData::clearTokenMapForSelectTokens()
 	{
+		if (!m_selectTokensCached)
+		{
+			return;
+		}
 		DEV_WRITE_GUARDED(m_selectTokens_lock)
+		{
 			tokenMapForSelectTokens.clear();
+			m_selectTokensCached = false;
+		}
 	}
 
 	vector<string> UTXOSharedData::getTokenMapForGetVault(const pair<h256, TokenState>& key)
 	{
-		DEV_READ_GUARDED(m_getVault_lock)
-		{
-			return tokenMapForGetVault[key];
-		}
-			
-		return tokenMapForGetVault[key];
+		ReadGuard l(m_getVault_lock);
+		auto it = tokenMapForGetVault.find(key);
+		return it == tokenMapForGetVault.end() ? vector<string>() : it->second;
 	}
 
 	void UTXOSharedData::setTokenMapForGetVault(const pair<h256, TokenState>& key, vector<string> value)
 	{
 		DEV_WRITE_GUARDED(m_getVault_lock)
+		{
 			tokenMapForGetVault[key] = value;
+			m_getVaultCached = true;
+		}
 	}
 
 	void UTXOSharedData::clearTokenMapForGetVault()
 	{
+		if (!m_getVaultCached)
+		{
+			return;
+		}
 		DEV_WRITE_GUARDED(m_getVault_lock)
+		{
 			tokenMapForGetVault.clear();
+			m_getVaultCached = false;
+		}
 	}
 }
\ No newline at end of file
@@ -24,6 +24,9 @@
 #ifndef __UTXOSHAREDDATA_H__
 #define __UTXOSHAREDDATA_H__
 
+#include <atomic>
+#include <set>
+
 #include <leveldb/db.h>
 #include <libdevcore/Guards.h>
 #include <libethcore/CommonJS.h>
@@ -31,6 +34,7 @@
 
 #include "Common.h"
 #include "UTXOData.h"
+#include "UTXOIndex.h"
 
 using namespace dev;
 using namespace dev::eth;
@@ -46,6 +50,16 @@ namespace dev
 
 namespace UTXOModel
 {
+	// The cached tokens of one account, with the balance and value order of its unused ones kept up to date.
+	struct AccountVault
+	{
+		unordered_map<TokenID, Token_Record, TokenID::hash> records;
+		u256 balance = 0;							// Sum of the values of the tokens in TokenStateInit
+		set<pair<u256, string>> unused;				// (value, tokenKey) of the tokens in TokenStateInit
+
+		void setRecord(TokenID const& id, const Token_Record& record);
+	};
+
 	class UTXOSharedData
 	{
 	public:
@@ -71,9 +85,15 @@ namespace UTXOModel
 		// Set and get vault related records.
 		void pushAcccountToList(h256 account);
 		vector<h256> getAccountList();
+		size_t getAccountCnt();
+		h256 getLastAccount();
+		bool accountIsRegistered(h256 account);
 		void setCacheVault(h256 account, const string& tokenKey, const Token_Record& tokenRecord);
 		void updateCacheState(h256 account, const string& tokenKey, TokenState state);
 		map<string, Token_Record> getCacheVaultByAccount(h256 account);
+		u256 getBalanceByAccount(h256 account);
+		// Calls f(AccountVault const&) under the lock of the account, if it has any tokens cached.
+		template <class F> bool readVault(h256 account, F const& f) { return m_cacheVault.read(account, f); }
 
 		// Set and get cache of SelectTokens interface.
 		pair<vector<string>, u256> getSelectTokensByKey(const pair<h256, u256>& key);
@@ -102,15 +122,18 @@ namespace UTXOModel
 
 		// vault related records
 		mutable SharedMutex m_accountList_lock;
-		vector<h256> m_accountList;							// List of registered accounts
-		mutable SharedMutex m_vaultMem_lock;
-		map<h256, map<string, Token_Record>> m_cacheVault;	// The token cache under per registered account
+		vector<h256> m_accountList;							// List of registered accounts, in the order of registration
+		h256Hash m_accountSet;								// The same accounts, for lookups
+		ShardedIndex<h256, AccountVault> m_cacheVault;		// The token cache under per registered account
 
+		// Every UTXO transaction clears the two caches below, so it only takes their lock if there is something to clear.
 		mutable SharedMutex m_selectTokens_lock;
 		map<pair<h256, u256>, pair<vector<string>, u256>> tokenMapForSelectTokens;		// The cache of SelectTokens interface
+		atomic<bool> m_selectTokensCached{ false };
 
 		mutable SharedMutex m_getVault_lock;
 		map<pair<h256, TokenState>, vector<string>> tokenMapForGetVault;				// The cache of GetVault interface
+		atomic<bool> m_getVaultCached{ false };
 	};
 }
 
@@ -59,28 +59,44 @@ namespace UTXOModel
 		m_ptrUTXOMgr = nullptr;
 	}
 
-	void UTXOTxQueue::enqueue(const Transaction& t)
+	void UTXOTxQueue::enqueue(const Transaction& t, unsigned partition)
 	{
 		{
 			Guard l(x_queue);
-			m_unexecuted.emplace_back(t);
+			deque<Transaction>& pending = m_unexecuted[partition];
+			pending.emplace_back(t);
+			// A running partition is picked up again by the thread that is on it
+			if (pending.size() == 1 && !m_running.count(partition))
+			{
+				m_ready.push_back(partition);
+			}
 		}
-		m_queueReady.notify_all();
+		m_queueReady.notify_one();
 	}
 
 	void UTXOTxQueue::executeUTXOTx()
 	{
+		unsigned partition = 0;
+		bool claimed = false;
 		while (!m_aborting)
 		{
 			Transaction work;
 
 			{
 				unique_lock<Mutex> l(x_queue);
-				m_queueReady.wait(l, [&]() { return !m_unexecuted.empty() || m_aborting; });
-				if (m_aborting)
-					return;
-				work = move(m_unexecuted.front());
-				m_unexecuted.pop_front();
+				if (!claimed)
+				{
+					m_queueReady.wait(l, [&]() { return !m_ready.empty() || m_aborting; });
+					if (m_aborting)
+						return;
+					partition = m_ready.front();
+					m_ready.pop_front();
+					m_running.insert(partition);
+					claimed = true;
+				}
+				auto it = m_unexecuted.find(partition);
+				work = move(it->second.front());
+				it->second.pop_front();
 			}
 
 			UTXOType utxoType = work.getUTXOType();
@@ -118,7 +134,14 @@ namespace UTXOModel
 			{
 				Guard l(x_queue);
 				m_executedCnt++;
-				LOG(TRACE) << "UTXOTxQueue::executeUTXOTx() getThreadName:" << getThreadName() << ",executedCnt:" << m_executedCnt << ",totalCnt:" << m_totalCnt;
+				LOG(TRACE) << "UTXOTxQueue::executeUTXOTx() getThreadName:" << getThreadName() << ",partition:" << partition << ",executedCnt:" << m_executedCnt << ",totalCnt:" << m_totalCnt;
+				auto it = m_unexecuted.find(partition);
+				if (it->second.empty())
+				{
+					m_unexecuted.erase(it);
+					m_running.erase(partition);
+					claimed = false;
+				}
 				if (m_totalCnt == m_executedCnt)
 				{
 					m_onReady();
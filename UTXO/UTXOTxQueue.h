@@ -27,6 +27,7 @@
 #include <condition_variable>
 #include <thread>
 #include <deque>
+#include <set>
 
 #include <libdevcore/Common.h>
 #include <libdevcore/Guards.h>
@@ -47,7 +48,9 @@ namespace UTXOModel
 	public:
 		UTXOTxQueue(size_t totalCnt, UTXOMgr* ptrUTXOMgr);
 		~UTXOTxQueue();
-		void enqueue(const Transaction& t);
+		// Transactions of one partition run in the order they were enqueued, one at a time;
+		// different partitions run in parallel.
+		void enqueue(const Transaction& t, unsigned partition);
 		void executeUTXOTx();
 		map<h256, UTXOExecuteState> getTxResult();
 
@@ -55,7 +58,9 @@ namespace UTXOModel
 	private:
 		condition_variable m_queueReady;
 		vector<thread> m_executer;
-		deque<Transaction> m_unexecuted;						// A list of parallel transactions to be executed
+		map<unsigned, deque<Transaction>> m_unexecuted;		// Parallel transactions to be executed, per partition
+		deque<unsigned> m_ready;								// Partitions with transactions to execute and no thread on them
+		set<unsigned> m_running;								// Partitions a thread is working on
 		mutable Mutex x_queue;
 		atomic<bool> m_aborting = {false};
 		size_t m_executedCnt = {0};								// The number of parallel transactions executed in the same block
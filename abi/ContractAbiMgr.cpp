@@ -32,6 +32,47 @@
 
 namespace libabi
 {
+	CompiledContractAbi::CompiledContractAbi(const SolidityAbi &abi) : m_abi(abi)
+	{
+		try
+		{
+			m_addr = dev::jsToAddress(m_abi.getAddr());
+			m_isAddrValid = true;
+		}
+		catch (...)
+		{
+			//地址不合法时使用的时候再转换,抛出和之前一样的异常
+		}
+	}
+
+	dev::Address CompiledContractAbi::addr() const
+	{
+		return m_isAddrValid ? m_addr : dev::jsToAddress(m_abi.getAddr());
+	}
+
+	std::shared_ptr<const SolidityFunctionEncoder> CompiledContractAbi::getEncoder(const std::string &strFunc) const
+	{
+		DEV_READ_GUARDED(m_encoders_lock)
+		{
+			auto it = m_encoders.find(strFunc);
+			if (it != m_encoders.end())
+			{
+				return it->second;
+			}
+		}
+
+		//函数不存在时抛出异常,不会缓存; 同一个函数的签名可以有多种写法,缓存的个数有上限
+		auto encoder = std::make_shared<const SolidityFunctionEncoder>(m_abi.getFunction(strFunc));
+		DEV_WRITE_GUARDED(m_encoders_lock)
+		{
+			if (m_encoders.size() < c_maxEncoders)
+			{
+				return m_encoders.emplace(strFunc, encoder).first->second;
+			}
+		}
+		return encoder;
+	}
+
 	void ContractAbiMgr::initialize(const std::string &strDBPath)
 	{
 		if (m_contractAbiDBMgr)
@@ -158,8 +199,9 @@ namespace libabi
 	void ContractAbiMgr::addContractAbi(const SolidityAbi &abi)
 	{
 		std::string strCNSName = (abi.getVersion().empty() ? abi.getContractName() : abi.getContractName() + "/" + abi.getVersion());
+		auto compiled = std::make_shared<const CompiledContractAbi>(abi);
 		//更新缓存
-		DEV_READ_GUARDED(m_abis_lock)
+		DEV_WRITE_GUARDED(m_abis_lock)
 		{
 			auto it = m_abis.find(strCNSName);
 			if (it != m_abis.end())
@@ -175,6 +217,7 @@ namespace libabi
 					;
 			}
 			m_abis[strCNSName] = abi;
+			m_compiledAbis[strCNSName] = compiled;
 
 			auto it0 = m_addrToName.find(abi.getAddr());
 			if (it0 != m_addrToName.end())
@@ -263,6 +306,35 @@ namespace libabi
 		getContractAbi(strContractName, strVersion, abi);
 	}
 
+	std::shared_ptr<const CompiledContractAbi> ContractAbiMgr::getCompiledContractAbi(const std::string &strContractName, const std::string &strVersion)
+	{
+		std::string strCNSName = (strVersion.empty() ? strContractName : strContractName + "/" + strVersion);
+
+		DEV_READ_GUARDED(m_abis_lock)
+		{
+			auto it = m_compiledAbis.find(strCNSName);
+			if (it != m_compiledAbis.end())
+			{
+				return it->second;
+			}
+		}
+
+		ABI_EXCEPTION_THROW("the contract is not exist, contract|version=" + strContractName + "|" + strVersion, libabi::EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeContractNotExist);
+		return nullptr;
+	}
+
+	Address ContractAbiMgr::getContractAddr0(const std::string &strContractName, const std::string &strVersion)
+	{
+		if (m_isSystemContractInit)
+		{
+			return getCompiledContractAbi(strContractName, strVersion)->addr();
+		}
+
+		SolidityAbi abi;
+		getContractAbiFromAbiDBMgr(strContractName, strVersion, abi);
+		return dev::jsToAddress(abi.getAddr());
+	}
+
 	std::pair<Address, bytes> ContractAbiMgr::getAddrAndDataInfo(const std::string &strContractName, const std::string &strFunc, const std::string &strVer, const Json::Value &jParams)
 	{
 		if (m_isSystemContractInit)
@@ -278,12 +350,10 @@ namespace libabi
 	//从system 合约缓存获取abi address信息
 	std::pair<Address, bytes> ContractAbiMgr::getAddrAndDataFromCache(const std::string &strContractName, const std::string &strFunc, const std::string &strVer, const Json::Value &jParams)
 	{
-		//获取abi信息
-		SolidityAbi abi;
-		getContractAbi(strContractName, strVer, abi);
-		//序列化abi
-		std::string strData = libabi::SolidityCoder::getInstance()->encode(abi.getFunction(strFunc), jParams);
-		return std::make_pair(dev::jsToAddress(abi.getAddr()), dev::jsToBytes(strData));
+		//获取编译好的abi信息并序列化
+		auto compiled = getCompiledContractAbi(strContractName, strVer);
+		auto encoder = compiled->getEncoder(strFunc);
+		return std::make_pair(compiled->addr(), encoder->encode(jParams));
 	}
 
 	//从db mgr缓存获取abi address信息
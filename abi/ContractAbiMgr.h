@@ -24,9 +24,12 @@
 #ifndef __CONTRACTABIMGR_H__
 #define __CONTRACTABIMGR_H__
 #include <atomic>
+#include <map>
+#include <memory>
 #include <libethereum/ChainParams.h>
 #include <libethereum/Transaction.h>
 #include "SolidityAbi.h"
+#include "SolidityEncoder.h"
 #include "ContractAbiDBMgr.h"
 
 using namespace dev;
@@ -34,6 +37,29 @@ using namespace dev::eth;
 
 namespace libabi
 {
+	//cns中一个合约的abi和地址, 以及按函数缓存的编译好的encoder, abi更新时整体替换
+	class CompiledContractAbi
+	{
+	public:
+		explicit CompiledContractAbi(const SolidityAbi &abi);
+
+		const SolidityAbi &abi() const { return m_abi; }
+		dev::Address addr() const;
+
+		//strFunc可以是函数名称或者是完整的函数签名, 同SolidityAbi::getFunction
+		std::shared_ptr<const SolidityFunctionEncoder> getEncoder(const std::string &strFunc) const;
+
+	private:
+		const static std::size_t c_maxEncoders = 1024;
+
+		const SolidityAbi m_abi;
+		dev::Address m_addr;
+		bool m_isAddrValid{ false };
+
+		mutable SharedMutex m_encoders_lock;
+		mutable std::map<std::string, std::shared_ptr<const SolidityFunctionEncoder> > m_encoders;
+	};
+
 	class ContractAbiMgr
 	{
 	public:
@@ -64,6 +90,8 @@ namespace libabi
 		std::map <std::string, libabi::SolidityAbi > m_abis;
 		//地址到name的映射
 		std::map <std::string, std::string> m_addrToName;
+		//name到编译好的abi的映射,与m_abis一起更新
+		std::map <std::string, std::shared_ptr<const CompiledContractAbi> > m_compiledAbis;
 
 	public:
 		std::size_t getContractC();
@@ -76,6 +104,10 @@ namespace libabi
 		void getContractAbi0(const std::string strContractName, const std::string &strVersion, SolidityAbi &abi);
 		void getContractAbiFromAbiDBMgr(const std::string strContractName, const std::string &strVersion, SolidityAbi &abi);
 		void getContractAbiFromCache(const std::string strContractName, const std::string &strVersion, SolidityAbi &abi);
+		//从缓存获取编译好的abi,不复制abi信息
+		std::shared_ptr<const CompiledContractAbi> getCompiledContractAbi(const std::string &strContractName, const std::string &strVersion);
+		//根据name获取合约地址,系统合约初始化之前从db mgr获取
+		Address getContractAddr0(const std::string &strContractName, const std::string &strVersion);
 
 		//根据name获取abi address信息
 		std::pair<Address, bytes> getAddrAndDataInfo(const std::string &strContractName, const std::string &strFunc,const std::string &strVer, const Json::Value &jParams);
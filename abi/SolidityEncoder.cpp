@@ -0,0 +1,267 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SolidityEncoder.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#include "SolidityEncoder.h"
+#include "SolidityCoder.h"
+#include "SolidityTools.h"
+#include "SolidityExp.h"
+
+#include <libdevcore/CommonData.h>
+#include <libdevcore/CommonJS.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/easylog.h>
+
+namespace libabi
+{
+	namespace
+	{
+		//追加一个32字节的大端整数
+		void appendWord(dev::bytes &out, const dev::u256 &u)
+		{
+			std::size_t nPos = out.size();
+			out.resize(nPos + ABIALIGNSIZE);
+			dev::bytesRef r(&out[nPos], ABIALIGNSIZE);
+			dev::toBigEndian(u, r);
+		}
+
+		//追加数据并在右边补0到32字节的整数倍
+		void appendPadded(dev::bytes &out, const std::string &s)
+		{
+			out.insert(out.end(), s.begin(), s.end());
+			out.resize(out.size() + (ABIALIGNSIZE - s.size() % ABIALIGNSIZE) % ABIALIGNSIZE, 0);
+		}
+	}
+
+	SolidityFunctionEncoder::SolidityFunctionEncoder(const SolidityAbi::Function &f) : m_func(f)
+	{
+		try
+		{
+			compile();
+			m_bCompiled = true;
+		}
+		catch (const AbiException &e)
+		{
+			LOG(WARNING) << "[SolidityFunctionEncoder] not compiled, func=" << m_func.getSignature() << " ,what=" << e.what();
+			m_allParams.clear();
+		}
+	}
+
+	void SolidityFunctionEncoder::compile()
+	{
+		dev::h256 h = dev::sha3(m_func.getSignature());
+		m_selector.assign(h.data(), h.data() + 4);
+
+		for (const auto &i : m_func.allInputs)
+		{
+			Param p;
+			p.enumType = getEnumTypeByName(i.strType);
+			p.isDynamic = SolidityTools::isDynamic(i.strType);
+			if (SolidityTools::isArray(i.strType))
+			{
+				SolidityTools::invalidAbiArray(i.strType);
+				if (p.enumType == solidity_type::ENUM_SOLIDITY_TYPE_STRING || p.enumType == solidity_type::ENUM_SOLIDITY_TYPE_DBYTES)
+				{
+					ABI_EXCEPTION_THROW("string or dynamic bytes cannot be the type of array, type => " + i.strType, EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidAbiType);
+				}
+			}
+
+			std::string strType = i.strType;
+			while (SolidityTools::isArray(strType))
+			{
+				p.allLevelTypes.push_back(strType);
+				p.allDims.push_back(SolidityTools::isDynamicArray(strType) ? 0 : SolidityTools::getStaticArraySize(strType));
+				strType = SolidityTools::nestName(strType);
+			}
+			p.allLevelTypes.push_back(strType);
+
+			//只有最外层可以是动态数组
+			for (std::size_t index = 1; index < p.allDims.size(); ++index)
+			{
+				if (p.allDims[index] == 0)
+				{
+					ABI_EXCEPTION_THROW("invalid abi type, the type of array must be static, type => " + p.allLevelTypes[index], EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidAbiType);
+				}
+			}
+
+			m_nHeadLen += SolidityTools::getStaticPartLen(i.strType);
+			m_allParams.push_back(std::move(p));
+		}
+	}
+
+	dev::bytes SolidityFunctionEncoder::encode(const Json::Value &jParams) const
+	{
+		if (!m_bCompiled)
+		{
+			return dev::jsToBytes(SolidityCoder::getInstance()->encode(m_func, jParams));
+		}
+
+		dev::bytes out(m_selector);
+		if (m_allParams.empty())
+		{
+			return out;
+		}
+
+		//输入参数与abi参数不相等
+		if (!jParams.isArray() || (jParams.size() != m_allParams.size()))
+		{
+			ABI_EXCEPTION_THROW("invalid input, input json element is not the same as abi", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+		}
+
+		//静态部分直接写入, 动态参数先写偏移量, 数据放到最后
+		out.reserve(out.size() + m_nHeadLen);
+		dev::bytes tail;
+		for (std::size_t index = 0; index < m_allParams.size(); ++index)
+		{
+			const Param &p = m_allParams[index];
+			const Json::Value &jParam = jParams[(Json::ArrayIndex)index];
+			if (p.isDynamic)
+			{
+				appendWord(out, dev::u256(m_nHeadLen + tail.size()));
+				encodeParam(p, 0, jParam, tail);
+			}
+			else
+			{
+				encodeParam(p, 0, jParam, out);
+			}
+		}
+		out.insert(out.end(), tail.begin(), tail.end());
+
+		LOG(TRACE) << "[SolidityFunctionEncoder::encode] end, func=" << m_func.getSignature()
+			<< " ,param=" << jParams.toStyledString()
+			<< " ,data=" << dev::toHex(out)
+			;
+
+		return out;
+	}
+
+	void SolidityFunctionEncoder::encodeParam(const Param &p, std::size_t nLevel, const Json::Value &jParam, dev::bytes &out) const
+	{
+		if (nLevel == p.allDims.size())
+		{
+			encodeValue(p.enumType, p.allLevelTypes[nLevel], jParam, out);
+			return;
+		}
+
+		//参数类型必须是数组
+		if (!jParam.isArray())
+		{
+			ABI_EXCEPTION_THROW("invalid input arguments, input is not an array but abi is, type => " + p.allLevelTypes[nLevel], EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+		}
+
+		std::size_t size = p.allDims[nLevel];
+		if (size == 0)
+		{
+			//动态数组,先序列化数组长度
+			size = jParam.size();
+			appendWord(out, dev::u256(size));
+		}
+		else if (size != jParam.size())
+		{
+			ABI_EXCEPTION_THROW("invalid input arguments, encode static array size is not the same as abi require.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+		}
+
+		for (std::size_t index = 0; index < size; ++index)
+		{
+			encodeParam(p, nLevel + 1, jParam[(Json::ArrayIndex)index], out);
+		}
+	}
+
+	//与SolidityCoder::registerEncoder中各类型的encoder一致
+	void SolidityFunctionEncoder::encodeValue(solidity_type enumType, const std::string &strType, const Json::Value &jParam, dev::bytes &out)
+	{
+		switch (enumType)
+		{
+		case solidity_type::ENUM_SOLIDITY_TYPE_BOOL:
+			if (!jParam.isConvertibleTo(Json::booleanValue))
+			{
+				ABI_EXCEPTION_THROW("bool encoder, input json node cannot convert to bool.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			appendWord(out, dev::u256(jParam.asBool() ? 1 : 0));
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_INT:
+			if (jParam.isInt64() || jParam.isDouble())
+			{
+				appendWord(out, dev::u256(dev::s256(jParam.asInt64())));
+			}
+			else if (jParam.isString())
+			{
+				appendWord(out, dev::u256(dev::s256(jParam.asString())));
+			}
+			else
+			{
+				ABI_EXCEPTION_THROW("int encoder, input json node cannot convert to int.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_UINT:
+			if (jParam.isUInt64() || jParam.isDouble())
+			{
+				appendWord(out, dev::u256(jParam.asUInt64()));
+			}
+			else if (jParam.isString())
+			{
+				appendWord(out, dev::u256(jParam.asString()));
+			}
+			else
+			{
+				ABI_EXCEPTION_THROW("int encoder, input json node cannot convert to uint.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_ADDR:
+			if (!jParam.isString())
+			{
+				ABI_EXCEPTION_THROW("address encoder, input json is not string.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			appendWord(out, dev::u256(dev::u160(jParam.asString())));
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_BYTES:
+			if (!jParam.isString())
+			{
+				ABI_EXCEPTION_THROW("bytes encoder, input json is not string.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			appendPadded(out, jParam.asString().substr(0, ABIALIGNSIZE));
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_DBYTES:
+		case solidity_type::ENUM_SOLIDITY_TYPE_STRING:
+			if (!jParam.isString())
+			{
+				ABI_EXCEPTION_THROW(enumType == solidity_type::ENUM_SOLIDITY_TYPE_STRING ? "string encoder, input json is not string." : "dynamic bytes encoder, input json is not string.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			}
+			else
+			{
+				//先存长度
+				const std::string str = jParam.asString();
+				appendWord(out, dev::u256(str.size()));
+				appendPadded(out, str);
+			}
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_REAL:
+			ABI_EXCEPTION_THROW("real encoder, this type is not support now.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			break;
+		case solidity_type::ENUM_SOLIDITY_TYPE_UREAL:
+			ABI_EXCEPTION_THROW("ureal encoder, this type is not support now.", EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidArgument);
+			break;
+		default:
+			ABI_EXCEPTION_THROW("unkown type encoder call, type =>  " + strType + " ,json => " + (jParam.isConvertibleTo(Json::stringValue) ? jParam.asString() : ""), EnumAbiExceptionErrCode::EnumAbiExceptionErrCodeInvalidAbiType);
+		}
+	}
+}//namespace libabi
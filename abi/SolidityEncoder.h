@@ -0,0 +1,76 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SolidityEncoder.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#ifndef __SOLIDITYENCODER_H__
+#define __SOLIDITYENCODER_H__
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+#include <libdevcore/Common.h>
+#include "SolidityBaseType.h"
+#include "SolidityAbi.h"
+
+namespace libabi
+{
+	//一个函数预先编译好的序列化方式: 函数选择器, 每个参数的类型、数组维度和静态部分长度
+	//类型只在构造时解析一次, encode直接从json参数写出调用数据, 结果与SolidityCoder::encode一致
+	//abi中有SolidityCoder不支持的类型时不编译, encode交给SolidityCoder, 抛出同样的异常
+	class SolidityFunctionEncoder
+	{
+	public:
+		explicit SolidityFunctionEncoder(const SolidityAbi::Function &f);
+		SolidityFunctionEncoder(const SolidityFunctionEncoder &) = delete;
+		SolidityFunctionEncoder &operator=(const SolidityFunctionEncoder &) = delete;
+
+		const SolidityAbi::Function &function() const { return m_func; }
+		bool isCompiled() const { return m_bCompiled; }
+
+		//序列化调用信息,返回调用数据
+		dev::bytes encode(const Json::Value &jParams) const;
+
+	private:
+		struct Param
+		{
+			solidity_type enumType;
+			//由外到内每一层的类型, uint[2][] => uint[2][] uint[2] uint
+			std::vector<std::string> allLevelTypes;
+			//由外到内每一层数组的大小, 0为动态数组(只能是最外层)
+			std::vector<std::size_t> allDims;
+			bool isDynamic;
+		};
+
+		void compile();
+		void encodeParam(const Param &p, std::size_t nLevel, const Json::Value &jParam, dev::bytes &out) const;
+		static void encodeValue(solidity_type enumType, const std::string &strType, const Json::Value &jParam, dev::bytes &out);
+
+		SolidityAbi::Function m_func;
+		bool m_bCompiled{ false };
+		dev::bytes m_selector;
+		std::vector<Param> m_allParams;
+		//参数静态部分的总长度,即第一个动态参数的偏移量
+		std::size_t m_nHeadLen{ 0 };
+	};//class SolidityFunctionEncoder
+}//namespace libabi
+
+#endif//__SOLIDITYENCODER_H__
@@ -0,0 +1,251 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * ABI call encoding benchmark: runs every case below through SolidityFunctionEncoder and
+ * SolidityCoder, checks that both produce the same call data or throw the same error, then
+ * prints the encodes/sec of both for the first case of each signature. Exits with 1 if any
+ * case differs.
+ *
+ * usage: abibench [rounds]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+#include <libdevcore/CommonData.h>
+#include <libdevcore/CommonJS.h>
+#include <libdevcore/easylog.h>
+#include <abi/SolidityAbi.h>
+#include <abi/SolidityCoder.h>
+#include <abi/SolidityEncoder.h>
+#include <abi/SolidityExp.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace libabi;
+
+namespace
+{
+
+/// Keeps the optimiser from dropping a result.
+size_t g_sink = 0;
+
+struct Case
+{
+	string signature;
+	/// JSON parameter arrays; the first one is the one timed.
+	vector<string> params;
+};
+
+string const c_addr = "\"0x692a70d2e424a56d2c6c27aa97d1a86395877b3a\"";
+string const c_long = "\"" + string(100, 'x') + "\"";
+
+vector<Case> const c_cases = {
+	{"transfer(address,uint256)", {
+		"[" + c_addr + ",100]",
+		"[" + c_addr + ",\"1000000000000000000000\"]",
+		"[1,2]",
+		"[" + c_addr + "]",
+		"{}",
+		"[" + c_addr + ",true]"}},
+	{"setName(string,uint256)", {
+		"[\"hello\",7]",
+		"[" + c_long + ",\"5\"]",
+		"[\"\",0]",
+		"[1,2]"}},
+	{"sum(uint256[],bytes32)", {
+		"[[1,2,3,4,5,6,7,8],\"tag\"]",
+		"[[],\"" + string(40, 'b') + "\"]",
+		"[5,\"t\"]",
+		"[[1,2],3]"}},
+	{"total(uint256[8],bytes32)", {
+		"[[1,2,3,4,5,6,7,8],\"abc\"]",
+		"[[1,2],\"abc\"]",
+		"[[1,2,3,4,5,6,7,{}],\"abc\"]"}},
+	{"sign(int256,bool)", {
+		"[-5,true]",
+		"[\"-123456789012345678901234567890\",false]",
+		"[{},true]",
+		"[1,{}]"}},
+	{"small(uint8,int8,bytes4)", {
+		"[255,-1,\"abcd\"]",
+		"[\"12\",\"-3\",\"\"]",
+		"[-1,1,\"a\"]"}},
+	{"blob(bytes,string,uint256[])", {
+		"[\"abc\",\"def\",[1]]",
+		"[" + c_long + "," + c_long + ",[]]",
+		"[1,\"def\",[]]",
+		"[\"abc\",\"def\",{}]"}},
+	{"grid(uint256[2][],address[3])", {
+		"[[[1,2],[3,4],[5,6]],[" + c_addr + "," + c_addr + "," + c_addr + "]]",
+		"[[],[" + c_addr + "," + c_addr + "," + c_addr + "]]",
+		"[[[1,2],3],[" + c_addr + "," + c_addr + "," + c_addr + "]]",
+		"[[[1,2,3]],[" + c_addr + "," + c_addr + "," + c_addr + "]]"}},
+	{"cube(bool[2][2][2])", {
+		"[[[[true,false],[false,true]],[[true,true],[false,false]]]]",
+		"[[[[true,false]],[[true,true],[false,false]]]]"}},
+	{"ping()", {
+		"[]",
+		"[1,2]"}},
+	{"owner(address)", {
+		"[" + c_addr + "]",
+		"[[" + c_addr + "]]"}},
+	{"set(uint256)", {
+		"[1]",
+		"[\"0x10\"]",
+		"[null]"}},
+	// not compiled, encode falls back to SolidityCoder
+	{"names(string[])", {
+		"[[\"a\"]]"}},
+	{"blobs(bytes[2])", {
+		"[[\"a\",\"b\"]]"}},
+	{"nested(uint256[][2])", {
+		"[[[1],[2]]]"}},
+	{"price(real)", {
+		"[1]"}},
+	{"unknown(foo)", {
+		"[1]"}},
+};
+
+/// Call data or error of one encode, as compared between the two encoders.
+struct Result
+{
+	bool ok = false;
+	bytes data;
+	string error;
+	int code = 0;
+};
+
+template <class F> Result run(F _f)
+{
+	Result r;
+	try
+	{
+		r.data = _f();
+		r.ok = true;
+	}
+	catch (AbiException const& _e)
+	{
+		r.error = _e.what();
+		r.code = (int)_e.error_code();
+	}
+	catch (std::exception const& _e)
+	{
+		r.error = _e.what();
+		r.code = -1;
+	}
+	return r;
+}
+
+string describe(Result const& _r)
+{
+	return _r.ok ? "0x" + toHex(_r.data) : "error " + toString(_r.code) + " \"" + _r.error + "\"";
+}
+
+/// constructFromFuncSig reads "f()" as one input of empty type; a JSON abi gives no inputs.
+SolidityAbi::Function functionOf(string const& _signature)
+{
+	SolidityAbi::Function f = SolidityAbi().constructFromFuncSig(_signature);
+	if (f.allInputs.size() == 1 && f.allInputs[0].strType.empty())
+		f.allInputs.clear();
+	return f;
+}
+
+/// Runs @a _f @a _rounds times and @returns encodes/sec.
+template <class F> double bench(unsigned _rounds, F _f)
+{
+	_f();	// warm up
+	auto start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < _rounds; ++i)
+		_f();
+	double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return _rounds / s;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	unsigned rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+
+	// both encoders log every call at TRACE
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	unsigned checked = 0;
+	unsigned mismatches = 0;
+	cout << left << setw(36) << "signature" << right << setw(14) << "SolidityCoder" << setw(14) << "compiled" << "  encodes/s" << endl;
+	for (auto const& c: c_cases)
+	{
+		SolidityAbi::Function f = functionOf(c.signature);
+		SolidityFunctionEncoder encoder(f);
+
+		vector<Json::Value> params;
+		for (auto const& p: c.params)
+		{
+			Json::Value j;
+			if (!Json::Reader().parse(p, j))
+			{
+				cerr << c.signature << ": bad test parameters " << p << endl;
+				return 1;
+			}
+			params.push_back(j);
+
+			Result expected = run([&]() { return jsToBytes(SolidityCoder::getInstance()->encode(f, j)); });
+			Result actual = run([&]() { return encoder.encode(j); });
+			++checked;
+			if (expected.ok != actual.ok || expected.data != actual.data || expected.error != actual.error || expected.code != actual.code)
+			{
+				++mismatches;
+				cerr << "MISMATCH " << c.signature << " " << p << endl
+					<< "  SolidityCoder: " << describe(expected) << endl
+					<< "  compiled:      " << describe(actual) << endl;
+			}
+		}
+
+		cout << left << setw(36) << c.signature + (encoder.isCompiled() ? "" : " *") << right;
+		Json::Value const& j = params.front();
+		Result first = run([&]() { return encoder.encode(j); });
+		if (!first.ok)
+		{
+			cout << "  " << first.error << endl;
+			continue;
+		}
+		double coder = bench(rounds, [&]() { g_sink += SolidityCoder::getInstance()->encode(f, j).size(); });
+		double compiled = bench(rounds, [&]() { g_sink += encoder.encode(j).size(); });
+		cout << fixed << setprecision(0) << setw(14) << coder << setw(14) << compiled << endl;
+	}
+	cout << "* not compiled, encoded by SolidityCoder" << endl;
+	cout << checked << " cases checked, " << mismatches << " mismatches" << endl;
+	return mismatches || g_sink == 42 ? 1 : 0;
+}
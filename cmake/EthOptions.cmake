@@ -16,6 +16,7 @@ macro(configure_project)
 	eth_default_option(ROCKSDB OFF)
 	eth_default_option(PARANOID OFF)
 	eth_default_option(MINIUPNPC ON)
+	eth_default_option(DEBUG_LOGS ON)
 	
 	#ARCH TYPE
 	eth_default_option(STATIC_BUILD OFF)
@@ -81,6 +82,11 @@ macro(configure_project)
 		add_definitions(-DETH_VMTRACE)
 	endif ()
 
+	# Without DEBUG_LOGS, LOG(TRACE) and LOG(DEBUG) statements are compiled out
+	if (NOT DEBUG_LOGS)
+		add_definitions(-DELPP_DISABLE_TRACE_LOGS -DELPP_DISABLE_DEBUG_LOGS)
+	endif ()
+
 	if (GROUPSIG)
 		add_definitions(-DETH_GROUPSIG)
 	endif()
@@ -129,6 +135,7 @@ if (SUPPORT_VMTRACE)
 	message("-- VMTRACE          VM execution tracing                     ${VMTRACE}")
 endif()
 	message("-- PROFILING        Profiling support                        ${PROFILING}")
+	message("-- DEBUG_LOGS       Build TRACE and DEBUG log statements     ${DEBUG_LOGS}")
 if (SUPPORT_FATDB)
 	message("-- FATDB            Full database exploring                  ${FATDB}")
 endif()
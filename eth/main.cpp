@@ -78,6 +78,7 @@
 #include <libdiskencryption/EncryptFile.h>
 #include <libweb3jsonrpc/ChannelRPCServer.h>
 #include <libweb3jsonrpc/RPCallback.h>
+#include <libstatistics/MetricsHttpServer.h>
 #if ETH_ENCRYPTTYPE
 #include <libdevcrypto/sm2/sm2.h>
 #endif
@@ -128,6 +129,7 @@ void help()
 	        << "    -K,--kill  Kill the blockchain first." << "\n"
 	        << "    -R,--rebuild  Rebuild the blockchain from the existing database." << "\n"
 	        << "    --rescue  Attempt to rescue a corrupt database." << "\n"
+	        << "    --rebuild-logindex  Index the logs of all blocks already in the chain (implies logindex ON)." << "\n"
 	        << "\n"
 	        << "    --import-presale <file>  Import a pre-sale key; you'll need to specify the password to this key." << "\n"
 	        << "    -s,--import-secret <secret>  Import a secret key into the key store." << "\n"
@@ -464,6 +466,8 @@ void initEasylogging(const ChainParams& chainParams)
 
 		el::Loggers::reconfigureLogger("statLogger", statConf);
 	}
+	dev::updateLogLevels();
+	dev::startAsyncLog();
 	el::Helpers::installPreRollOutCallback(rolloutHandler);
 }
 
@@ -562,6 +566,7 @@ int main(int argc, char** argv)
 	bool testingMode = false;
 
 	bool singlepoint = false;
+	bool rebuildLogIndex = false;
 
 	strings passwordsToNote;
 	Secrets toImport;
@@ -600,6 +605,7 @@ int main(int argc, char** argv)
 	string strNodeId;
 	string strGroupId;
 	string strStoragePath;
+	unsigned dfsBlockSize = 256;
 	Address fileContractAddr;
 	Address fileServerContractAddr;
 	for (int i = 1; i < argc; ++i)
@@ -740,6 +746,8 @@ int main(int argc, char** argv)
 			withExisting = WithExisting::Verify;
 		else if (arg == "-R" || arg == "--rescue")
 			withExisting = WithExisting::Rescue;
+		else if (arg == "--rebuild-logindex")
+			rebuildLogIndex = true;
 		else if (arg == "--client-name" && i + 1 < argc)
 			clientName = argv[++i];
 		else if ((arg == "-a" || arg == "--address" || arg == "--author") && i + 1 < argc)
@@ -1235,6 +1243,11 @@ int main(int argc, char** argv)
 	cout << EthGrayBold "---------------FISCO BCOS--------------" EthReset << "\n";
 
 	chainParams.otherParams["allowFutureBlocks"] = "1";//默认打开
+	if (rebuildLogIndex)
+	{
+		chainParams.logIndex = true;
+		chainParams.otherParams["rebuildLogIndex"] = "1";
+	}
 	if (testingMode)
 	{
 		chainParams.sealEngineName = "NoProof";
@@ -1268,6 +1281,7 @@ int main(int argc, char** argv)
 	cout << "LOGVERBOSITY:" << chainParams.logVerbosity << "\n";
 	cout << "EVENTLOG:" << (chainParams.evmEventLog ? "ON" : "OFF") << "\n";
 	cout << "COVERLOG:" << (chainParams.evmCoverLog ? "ON" : "OFF") << "\n";
+	cout << "LOGINDEX:" << (chainParams.logIndex ? "ON" : "OFF") << "\n";
 
 	jsonRPCURL = chainParams.rpcPort;
 	jsonRPCSSLURL = chainParams.rpcSSLPort;
@@ -1286,6 +1300,7 @@ int main(int argc, char** argv)
 	strNodeId = chainParams.nodeId;
 	strGroupId = chainParams.groupId;
 	strStoragePath = chainParams.storagePath;
+	dfsBlockSize = chainParams.dfsBlockSize;
 
 
 	if (chainParams.vmKind == "interpreter")
@@ -1678,6 +1693,7 @@ int main(int argc, char** argv)
 	unique_ptr<ModularServer<>> jsonrpcHttpServer;
 	unique_ptr<ModularServer<>> jsonrpcHttpsServer;
 	unique_ptr<ModularServer<>> jsonrpcIpcServer;
+	unique_ptr<MetricsHttpServer> metricsServer;
 	unique_ptr<rpc::SessionManager> sessionManager;
 	unique_ptr<SimpleAccountHolder> accountHolder;
 
@@ -1752,8 +1768,10 @@ int main(int argc, char** argv)
 			httpConnector->setNode(strNodeId);
 			httpConnector->setGroup(strGroupId);
 			httpConnector->setStoragePath(strStoragePath);
+			httpConnector->setBlockSize(dfsBlockSize * 1024);
 			httpConnector->setEth(web3.ethereum());
 			httpConnector->setAllowedOrigin(rpcCorsDomain);
+			httpConnector->setMethods(jsonrpcHttpServer->procedureNames());
 			jsonrpcHttpServer->addConnector(httpConnector);
 			jsonrpcHttpServer->setStatistics(new InterfaceStatistics(getDataDir() + "RPC", chainParams.statsInterval));
 			if ( false == jsonrpcHttpServer->StartListening() )
@@ -1814,6 +1832,7 @@ int main(int argc, char** argv)
 
 			channelServer->setListenAddr(chainParams.listenIp);
 			channelServer->setListenPort(chainParams.channelPort);
+			channelServer->setClient(web3.ethereum());
 			channelModularServer->addConnector(channelServer.get());
 
 			LOG(TRACE) << "channelServer started IP:" << chainParams.listenIp << " Port:" << chainParams.channelPort;
@@ -1823,6 +1842,12 @@ int main(int argc, char** argv)
             RPCallback::getInstance().setAccountHolder(accountHolder.get());
 		}
 
+		if (chainParams.metricsPort > 0)
+		{
+			metricsServer.reset(new MetricsHttpServer(chainParams.metricsPort));
+			metricsServer->StartListening();
+		}
+
 		if (jsonAdmin.empty())
 			jsonAdmin = sessionManager->newSession(rpc::SessionPermissions{{rpc::Privilege::Admin}});
 		else
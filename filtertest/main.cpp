@@ -0,0 +1,156 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Filter check cache invalidation test. Drives FilterCheckCache the way SystemContract does over
+ * a run of blocks, with the storage roots of each block's contracts in a map: results survive
+ * blocks that write only unrelated contracts, and go once the filter chain, a filter or a group
+ * they were read from is written, or when they were read on a block that is no longer the head.
+ * Exits with 1 on any failure.
+ *
+ * usage: filtertest
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <libdevcore/easylog.h>
+#include <libdevcore/SHA3.h>
+#include <libethereum/FilterCheckCache.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+unsigned g_failures = 0;
+
+void check(bool _ok, string const& _what)
+{
+	if (!_ok)
+	{
+		++g_failures;
+		cerr << "FAILED: " << _what << endl;
+	}
+}
+
+Address const c_chain = Address(sha3("TransactionFilterChain"));
+Address const c_filter = Address(sha3("AuthorityFilter"));
+Address const c_group = Address(sha3("Group"));
+Address const c_token = Address(sha3("Token"));
+
+/// Storage roots of the head block's contracts; a transaction writing a contract changes its root.
+class Chain
+{
+public:
+	h256 storageRoot(Address const& _contract) const { auto it = m_roots.find(_contract); return it == m_roots.end() ? h256() : it->second; }
+	void write(Address const& _contract) { m_roots[_contract] = sha3(m_roots[_contract].asBytes() + _contract.asBytes()); }
+
+	/// A new head, as updateSystemContract sees it: @returns true if the cache was cleared.
+	bool seal(FilterCheckCache& _cache) const { return _cache.refresh([&](Address const& _a) { return storageRoot(_a); }); }
+
+private:
+	map<Address, h256> m_roots;
+};
+
+h256 keyOf(string const& _sender) { return sha3(_sender); }
+
+/// A filter check missing the cache: watches what the filters read and puts the result.
+void miss(FilterCheckCache& _cache, Chain const& _chain, string const& _sender, uint64_t _generation)
+{
+	for (auto const& c: {c_chain, c_filter, c_group})
+		_cache.watch(c, _chain.storageRoot(c), _generation);
+	_cache.put(keyOf(_sender), 0, _generation);
+}
+
+bool cached(FilterCheckCache& _cache, string const& _sender)
+{
+	u256 r;
+	return _cache.get(keyOf(_sender), r);
+}
+
+}
+
+int main()
+{
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	FilterCheckCache cache;
+	Chain chain;
+	chain.write(c_chain);
+	chain.write(c_filter);
+	chain.write(c_group);
+
+	check(!chain.seal(cache), "an empty cache was cleared");
+	miss(cache, chain, "alice", cache.generation());
+	miss(cache, chain, "bob", cache.generation());
+	check(cached(cache, "alice") && cached(cache, "bob"), "results were not cached");
+	check(cache.watches(c_chain) && cache.watches(c_group), "read contracts are not watched");
+
+	// transfers on an unrelated contract, and an empty block
+	chain.write(c_token);
+	check(!chain.seal(cache), "a block writing an unrelated contract cleared the cache");
+	check(!chain.seal(cache), "an empty block cleared the cache");
+	check(cached(cache, "alice") && cached(cache, "bob"), "results did not survive unrelated blocks");
+
+	// a permission change on the group, by a direct or an internal call
+	chain.write(c_group);
+	check(chain.seal(cache), "a block writing the group kept the cache");
+	check(!cached(cache, "alice") && !cached(cache, "bob"), "results survived a group change");
+	check(!cache.watches(c_chain), "contracts still watched after a clear");
+
+	// the same for the filter and the chain
+	miss(cache, chain, "alice", cache.generation());
+	chain.write(c_filter);
+	check(chain.seal(cache) && !cached(cache, "alice"), "results survived a filter change");
+	miss(cache, chain, "alice", cache.generation());
+	chain.write(c_chain);
+	check(chain.seal(cache) && !cached(cache, "alice"), "results survived a filter chain change");
+
+	// a result read on the block before the head is not cached, whatever the block changed
+	uint64_t generation = cache.generation();
+	chain.seal(cache);
+	miss(cache, chain, "carol", generation);
+	check(!cached(cache, "carol"), "a result read before the last block was cached");
+
+	// two readers that saw the group at different roots: the next block clears
+	miss(cache, chain, "dave", cache.generation());
+	cache.watch(c_group, sha3("another block"), cache.generation());
+	check(chain.seal(cache) && !cached(cache, "dave"), "results read on different blocks survived");
+
+	// a route change or reload clears outright
+	miss(cache, chain, "erin", cache.generation());
+	cache.clear();
+	check(!cached(cache, "erin") && !cache.watches(c_filter), "clear left results or watches");
+
+	cout << (g_failures ? "FAILED" : "OK") << endl;
+	return g_failures ? 1 : 0;
+}
@@ -124,6 +124,30 @@ void ChannelSession::asyncSendMessage(Message::Ptr request, std::function<void(d
 	}
 }
 
+bool ChannelSession::tryPushMessage(Message::Ptr message, size_t limit) {
+	try {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		if (!_actived || _sendBufferList.size() >= limit) {
+			return false;
+		}
+
+		std::shared_ptr<bytes> buffer = std::make_shared<bytes>();
+		message->encode(*buffer);
+
+		_sendBufferList.push(buffer);
+
+		startWrite();
+
+		return true;
+	}
+	catch (std::exception &e) {
+		LOG(ERROR) << "ERROR:" << e.what();
+	}
+
+	return false;
+}
+
 #if 0
 void ChannelSession::handshake(bool enableSSL, bool isServer) {
 	if (enableSSL) {
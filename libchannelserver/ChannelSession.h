@@ -57,6 +57,10 @@ public:
 	virtual Message::Ptr sendMessage(Message::Ptr request, size_t timeout = 0) throw(ChannelException);
 	virtual void asyncSendMessage(Message::Ptr request, std::function<void(dev::channel::ChannelException, Message::Ptr)> callback, uint32_t timeout = 0);
 
+	/// Queues an unsolicited message unless @a limit buffers already wait to be written, so a slow
+	/// reader can't make the node buffer without bound. @returns false if the message was dropped.
+	virtual bool tryPushMessage(Message::Ptr message, size_t limit);
+
 	virtual void run();
 
 	virtual bool actived() { return _actived; };
@@ -0,0 +1,180 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Compression.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#include "Compression.h"
+
+#include <cstring>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+static const unsigned c_hashLog = 12;
+static const size_t c_minMatch = 4;
+static const size_t c_lastLiterals = 5;
+static const size_t c_matchSearchLimit = 12;
+static const size_t c_maxOffset = 0xffff;
+
+inline uint32_t read32(byte const* _p)
+{
+	uint32_t ret;
+	memcpy(&ret, _p, sizeof(ret));
+	return ret;
+}
+
+inline uint32_t hashSequence(uint32_t _seq)
+{
+	return (_seq * 2654435761u) >> (32 - c_hashLog);
+}
+
+void appendLength(bytes& _out, size_t _len)
+{
+	for (; _len >= 255; _len -= 255)
+		_out.push_back(255);
+	_out.push_back((byte)_len);
+}
+
+bool readLength(bytesConstRef _in, size_t& io_pos, size_t& io_len)
+{
+	byte b;
+	do
+	{
+		if (io_pos >= _in.size())
+			return false;
+		b = _in[io_pos++];
+		io_len += b;
+	}
+	while (b == 255);
+	return true;
+}
+
+void appendSequence(bytes& _out, bytesConstRef _literals, size_t _offset, size_t _matchLength)
+{
+	size_t const lit = _literals.size();
+	byte token = (byte)(min<size_t>(lit, 15) << 4);
+	if (_matchLength)
+		token |= (byte)min<size_t>(_matchLength - c_minMatch, 15);
+	_out.push_back(token);
+	if (lit >= 15)
+		appendLength(_out, lit - 15);
+	_out.insert(_out.end(), _literals.begin(), _literals.end());
+	if (!_matchLength)
+		return;
+	_out.push_back((byte)(_offset & 0xff));
+	_out.push_back((byte)(_offset >> 8));
+	if (_matchLength - c_minMatch >= 15)
+		appendLength(_out, _matchLength - c_minMatch - 15);
+}
+
+}
+
+bytes dev::compressBlock(bytesConstRef _in)
+{
+	size_t const n = _in.size();
+	byte const* data = _in.data();
+
+	bytes ret;
+	ret.reserve(4 + n + n / 255 + 16);
+	ret.push_back((byte)(n >> 24));
+	ret.push_back((byte)(n >> 16));
+	ret.push_back((byte)(n >> 8));
+	ret.push_back((byte)n);
+
+	size_t anchor = 0;
+	if (n > c_matchSearchLimit)
+	{
+		vector<uint32_t> table(1 << c_hashLog, 0);
+		size_t const matchLimit = n - c_lastLiterals;
+		size_t i = 0;
+		while (i < n - c_matchSearchLimit)
+		{
+			uint32_t seq = read32(data + i);
+			uint32_t& slot = table[hashSequence(seq)];
+			size_t candidate = slot;
+			slot = (uint32_t)i;
+			if (candidate < i && i - candidate <= c_maxOffset && read32(data + candidate) == seq)
+			{
+				size_t len = c_minMatch;
+				while (i + len < matchLimit && data[candidate + len] == data[i + len])
+					++len;
+				appendSequence(ret, _in.cropped(anchor, i - anchor), i - candidate, len);
+				i += len;
+				anchor = i;
+			}
+			else
+				++i;
+		}
+	}
+	appendSequence(ret, _in.cropped(anchor), 0, 0);
+	return ret;
+}
+
+bool dev::decompressBlock(bytesConstRef _in, bytes& o_out, size_t _maxSize)
+{
+	o_out.clear();
+	if (_in.size() < 4)
+		return false;
+	size_t const n = ((size_t)_in[0] << 24) | ((size_t)_in[1] << 16) | ((size_t)_in[2] << 8) | (size_t)_in[3];
+	if (n > _maxSize)
+		return false;
+	o_out.reserve(n);
+
+	size_t p = 4;
+	while (p < _in.size())
+	{
+		byte token = _in[p++];
+		size_t lit = token >> 4;
+		if (lit == 15 && !readLength(_in, p, lit))
+			return false;
+		if (lit > _in.size() - p || lit > n - o_out.size())
+			return false;
+		o_out.insert(o_out.end(), _in.data() + p, _in.data() + p + lit);
+		p += lit;
+
+		// the final sequence carries literals only
+		if (p == _in.size())
+			break;
+
+		if (_in.size() - p < 2)
+			return false;
+		size_t offset = (size_t)_in[p] | ((size_t)_in[p + 1] << 8);
+		p += 2;
+		if (offset == 0 || offset > o_out.size())
+			return false;
+
+		size_t len = token & 15;
+		if (len == 15 && !readLength(_in, p, len))
+			return false;
+		len += c_minMatch;
+		if (len > n - o_out.size())
+			return false;
+
+		// byte-wise copy, as the match may overlap the bytes it produces
+		size_t from = o_out.size() - offset;
+		for (size_t k = 0; k < len; ++k)
+			o_out.push_back(o_out[from + k]);
+	}
+	return o_out.size() == n;
+}
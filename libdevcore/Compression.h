@@ -0,0 +1,42 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Compression.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#pragma once
+
+#include "Common.h"
+
+namespace dev
+{
+
+/// Upper bound on the decompressed size accepted by decompressBlock() by default.
+static const size_t c_maxDecompressedSize = 128 * 1024 * 1024;
+
+/// Compress @a _in with a fast LZ77 codec using the LZ4 block sequence layout.
+/// The output is prefixed by the 4-byte big-endian uncompressed size.
+bytes compressBlock(bytesConstRef _in);
+
+/// Decompress the output of compressBlock() into @a o_out.
+/// @returns false if @a _in is malformed or would expand beyond @a _maxSize.
+bool decompressBlock(bytesConstRef _in, bytes& o_out, size_t _maxSize = c_maxDecompressedSize);
+
+}
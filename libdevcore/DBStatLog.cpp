@@ -38,13 +38,36 @@ uint64_t DBInterval::DB_get_size_interval(60);
 
 uint64_t DBInterval::DB_set_size_interval(60);
 
+metrics::Histogram& DBGetLogGuard::histogram()
+{
+    static auto& h = metrics::histogram("db_op_duration_us", "Time spent in a state db operation, in microseconds", {{"op", "get"}});
+    return h;
+}
+
+metrics::Histogram& DBSetLogGuard::histogram()
+{
+    static auto& h = metrics::histogram("db_op_duration_us", "Time spent in a state db operation, in microseconds", {{"op", "set"}});
+    return h;
+}
+
+metrics::Counter& DBMemHitGuard::lookups(bool _hit)
+{
+    static auto& hits = metrics::counter("db_mem_lookups_total", "State db lookups answered from memory or not", {{"result", "hit"}});
+    static auto& misses = metrics::counter("db_mem_lookups_total", "State db lookups answered from memory or not", {{"result", "miss"}});
+    return _hit ? hits : misses;
+}
+
 void statGetDBSizeLog(uint64_t s)
 {
+    static auto& h = metrics::histogram("db_value_bytes", "Size of values read from and written to the state db", {{"op", "get"}});
+    h.observe(s);
     recordStateByTimeOnce(StatCode::DB_GET_SIZE, DBInterval::DB_get_size_interval, (double)s, STAT_DB_GET_SIZE, "");
 }
 
 void statSetDBSizeLog(uint64_t s)
 {
+    static auto& h = metrics::histogram("db_value_bytes", "Size of values read from and written to the state db", {{"op", "set"}});
+    h.observe(s);
     recordStateByTimeOnce(StatCode::DB_SET_SIZE, DBInterval::DB_set_size_interval, (double)s, STAT_DB_SET_SIZE, "");
 }
 
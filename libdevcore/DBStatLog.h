@@ -24,6 +24,7 @@
 #pragma once
 
 #include "LogGuard.h"
+#include "Metrics.h"
 
 namespace dev 
 {
@@ -31,15 +32,21 @@ namespace dev
 class DBGetLogGuard : public TimeIntervalLogGuard
 {
 public:
-    DBGetLogGuard() : TimeIntervalLogGuard(StatCode::DB_GET, STAT_DB_GET, report_interval) {}
+    DBGetLogGuard() : TimeIntervalLogGuard(StatCode::DB_GET, STAT_DB_GET, report_interval), m_timer(histogram()) {}
     static uint64_t report_interval;
+    static metrics::Histogram& histogram();
+private:
+    metrics::ScopedTimer m_timer;
 };
 
 class DBSetLogGuard : public TimeIntervalLogGuard
 {
 public:
-    DBSetLogGuard() : TimeIntervalLogGuard(StatCode::DB_SET, STAT_DB_SET, report_interval) {}
+    DBSetLogGuard() : TimeIntervalLogGuard(StatCode::DB_SET, STAT_DB_SET, report_interval), m_timer(histogram()) {}
     static uint64_t report_interval;
+    static metrics::Histogram& histogram();
+private:
+    metrics::ScopedTimer m_timer;
 };
 
 class DBMemHitGuard : public TimeIntervalLogGuard
@@ -49,8 +56,10 @@ public:
     {
         m_success = 0;
     }
+    ~DBMemHitGuard() { lookups(m_success).inc(); }
     void hit() { m_success = 1; }
     static uint64_t report_interval;
+    static metrics::Counter& lookups(bool _hit);
 };
 
 class DBInterval 
@@ -0,0 +1,256 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Metrics.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#include "Metrics.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace dev;
+using namespace dev::metrics;
+
+namespace
+{
+
+static const uint64_t c_maxValue = (uint64_t(1) << 40) - 1;
+
+string labelKey(Labels const& _labels)
+{
+	string ret;
+	for (auto const& l: _labels)
+	{
+		if (!ret.empty())
+			ret += ',';
+		ret += l.first + "=\"";
+		for (char c: l.second)
+		{
+			if (c == '\\' || c == '"')
+				ret += '\\';
+			if (c == '\n')
+				ret += "\\n";
+			else
+				ret += c;
+		}
+		ret += '"';
+	}
+	return ret;
+}
+
+string withLabels(string const& _name, string const& _key, string const& _extra = string())
+{
+	if (_key.empty() && _extra.empty())
+		return _name;
+	return _name + "{" + _key + (!_key.empty() && !_extra.empty() ? "," : "") + _extra + "}";
+}
+
+}
+
+unsigned dev::metrics::threadStripe()
+{
+	static atomic<unsigned> s_next{0};
+	thread_local unsigned t_stripe = s_next.fetch_add(1, memory_order_relaxed) % c_stripes;
+	return t_stripe;
+}
+
+uint64_t Counter::value() const
+{
+	uint64_t ret = 0;
+	for (auto const& s: m_stripes)
+		ret += s.value.load(memory_order_relaxed);
+	return ret;
+}
+
+Histogram::Stripe::Stripe(): sum(0)
+{
+	for (auto& b: buckets)
+		b.store(0, memory_order_relaxed);
+}
+
+unsigned Histogram::bucketOf(uint64_t _value)
+{
+	if (_value < 8)
+		return (unsigned)_value;
+	if (_value > c_maxValue)
+		_value = c_maxValue;
+	unsigned exp = 63 - __builtin_clzll(_value);
+	return (exp - 2) * 8 + (unsigned)((_value >> (exp - 3)) & 7);
+}
+
+uint64_t Histogram::upperBound(unsigned _i)
+{
+	if (_i < 8)
+		return _i;
+	unsigned exp = _i / 8 + 2;
+	uint64_t sub = _i % 8;
+	return (uint64_t(8 + sub + 1) << (exp - 3)) - 1;
+}
+
+void Histogram::observe(uint64_t _value)
+{
+	Stripe& s = m_stripes[threadStripe()];
+	s.buckets[bucketOf(_value)].fetch_add(1, memory_order_relaxed);
+	s.sum.fetch_add(_value, memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+	Snapshot ret;
+	ret.buckets.fill(0);
+	for (auto const& s: m_stripes)
+	{
+		for (unsigned i = 0; i < c_buckets; ++i)
+			ret.buckets[i] += s.buckets[i].load(memory_order_relaxed);
+		ret.sum += s.sum.load(memory_order_relaxed);
+	}
+	for (auto b: ret.buckets)
+		ret.count += b;
+	return ret;
+}
+
+uint64_t Histogram::Snapshot::quantile(double _q) const
+{
+	if (!count)
+		return 0;
+	uint64_t rank = (uint64_t)(_q * count);
+	if (rank >= count)
+		rank = count - 1;
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < c_buckets; ++i)
+	{
+		seen += buckets[i];
+		if (seen > rank)
+			return upperBound(i);
+	}
+	return upperBound(c_buckets - 1);
+}
+
+uint64_t Histogram::Snapshot::max() const
+{
+	for (unsigned i = c_buckets; i > 0; --i)
+		if (buckets[i - 1])
+			return upperBound(i - 1);
+	return 0;
+}
+
+Histogram::Snapshot& Histogram::Snapshot::operator-=(Snapshot const& _s)
+{
+	for (unsigned i = 0; i < c_buckets; ++i)
+		buckets[i] -= _s.buckets[i];
+	count -= _s.count;
+	sum -= _s.sum;
+	return *this;
+}
+
+Registry& Registry::instance()
+{
+	static Registry s_instance;
+	return s_instance;
+}
+
+Registry::Family& Registry::family(string const& _name, string const& _help, Type _type)
+{
+	auto it = m_families.find(_name);
+	if (it == m_families.end())
+	{
+		it = m_families.emplace(_name, Family()).first;
+		it->second.type = _type;
+		it->second.help = _help;
+	}
+	else if (it->second.type != _type)
+		throw std::logic_error("metric " + _name + " registered with another type");
+	return it->second;
+}
+
+Counter& Registry::counter(string const& _name, string const& _help, Labels const& _labels)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Counter).counters[labelKey(_labels)];
+	if (!m)
+		m.reset(new Counter);
+	return *m;
+}
+
+Gauge& Registry::gauge(string const& _name, string const& _help, Labels const& _labels)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Gauge).gauges[labelKey(_labels)];
+	if (!m)
+		m.reset(new Gauge);
+	return *m;
+}
+
+Histogram& Registry::histogram(string const& _name, string const& _help, Labels const& _labels)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Histogram).histograms[labelKey(_labels)];
+	if (!m)
+		m.reset(new Histogram);
+	return *m;
+}
+
+string Registry::exposition() const
+{
+	ostringstream out;
+	Guard l(x_families);
+	for (auto const& f: m_families)
+	{
+		string const& name = f.first;
+		out << "# HELP " << name << " " << f.second.help << "\n";
+		switch (f.second.type)
+		{
+		case Type::Counter:
+			out << "# TYPE " << name << " counter\n";
+			for (auto const& m: f.second.counters)
+				out << withLabels(name, m.first) << " " << m.second->value() << "\n";
+			break;
+		case Type::Gauge:
+			out << "# TYPE " << name << " gauge\n";
+			for (auto const& m: f.second.gauges)
+				out << withLabels(name, m.first) << " " << m.second->value() << "\n";
+			break;
+		case Type::Histogram:
+			out << "# TYPE " << name << " histogram\n";
+			for (auto const& m: f.second.histograms)
+			{
+				// cumulative buckets at the end of every power of two keep the output short
+				auto s = m.second->snapshot();
+				uint64_t cumulative = 0;
+				unsigned last = Histogram::bucketOf(s.max());
+				for (unsigned i = 0; i < Histogram::c_buckets; ++i)
+				{
+					cumulative += s.buckets[i];
+					if (i > last)
+						break;
+					if (i < 7 || i % 8 == 7)
+						out << withLabels(name + "_bucket", m.first, "le=\"" + to_string(Histogram::upperBound(i)) + "\"") << " " << cumulative << "\n";
+				}
+				out << withLabels(name + "_bucket", m.first, "le=\"+Inf\"") << " " << s.count << "\n";
+				out << withLabels(name + "_sum", m.first) << " " << s.sum << "\n";
+				out << withLabels(name + "_count", m.first) << " " << s.count << "\n";
+			}
+			break;
+		}
+	}
+	return out.str();
+}
@@ -0,0 +1,176 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: Metrics.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Guards.h"
+
+namespace dev
+{
+namespace metrics
+{
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/// Number of slots each metric spreads its writers over.
+static const unsigned c_stripes = 8;
+/// Metrics come from plain operator new, which before C++17 aligns to 16 bytes whatever alignas
+/// asks, so a stripe cannot start a cache line. It has a line of padding on both sides of its
+/// data instead: no two stripes, nor the heap around them, write the same line wherever it lands.
+static const unsigned c_cacheLine = 64;
+
+/// @returns the slot of the calling thread, assigned round robin on first use.
+unsigned threadStripe();
+
+/// Monotonic counter. Writers add to their own stripe; readers sum the stripes.
+class Counter
+{
+public:
+	void inc(uint64_t _n = 1) { m_stripes[threadStripe()].value.fetch_add(_n, std::memory_order_relaxed); }
+	uint64_t value() const;
+
+private:
+	struct Stripe
+	{
+		char before[c_cacheLine];
+		std::atomic<uint64_t> value{0};
+		char after[c_cacheLine];
+	};
+	std::array<Stripe, c_stripes> m_stripes;
+};
+
+class Gauge
+{
+public:
+	void set(int64_t _v) { m_value.store(_v, std::memory_order_relaxed); }
+	void add(int64_t _v) { m_value.fetch_add(_v, std::memory_order_relaxed); }
+	int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> m_value{0};
+};
+
+/**
+ * Log-linear histogram in the manner of HdrHistogram: values below 8 have their own bucket,
+ * above that every power of two is split in 8 buckets, so any recorded value is known to
+ * within 12.5%. Values are clamped to 2^40. Recording is one relaxed add on the bucket and
+ * one on the sum of the caller's stripe.
+ */
+class Histogram
+{
+public:
+	static const unsigned c_buckets = 8 * 39;
+
+	struct Snapshot
+	{
+		std::array<uint64_t, c_buckets> buckets;
+		uint64_t count = 0;
+		uint64_t sum = 0;
+
+		/// @returns an upper bound of the @a _q quantile, 0 <= _q <= 1.
+		uint64_t quantile(double _q) const;
+		/// @returns the upper bound of the highest non-empty bucket.
+		uint64_t max() const;
+		Snapshot& operator-=(Snapshot const& _s);
+	};
+
+	void observe(uint64_t _value);
+	Snapshot snapshot() const;
+
+	static unsigned bucketOf(uint64_t _value);
+	/// @returns the largest value recorded in bucket @a _i.
+	static uint64_t upperBound(unsigned _i);
+
+private:
+	struct Stripe
+	{
+		char before[c_cacheLine];
+		std::array<std::atomic<uint64_t>, c_buckets> buckets;
+		std::atomic<uint64_t> sum;
+		char after[c_cacheLine];
+		Stripe();
+	};
+	std::array<Stripe, c_stripes> m_stripes;
+};
+
+/// Records the microseconds between construction and destruction into a histogram.
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(Histogram& _h): m_histogram(_h), m_start(std::chrono::steady_clock::now()) {}
+	~ScopedTimer() { m_histogram.observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count()); }
+
+private:
+	Histogram& m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Process wide set of named metrics. Looking a metric up takes a lock, so callers keep the
+ * returned reference, which stays valid for the lifetime of the process; recording into it
+ * does not lock.
+ */
+class Registry
+{
+public:
+	static Registry& instance();
+
+	Counter& counter(std::string const& _name, std::string const& _help, Labels const& _labels = Labels());
+	Gauge& gauge(std::string const& _name, std::string const& _help, Labels const& _labels = Labels());
+	Histogram& histogram(std::string const& _name, std::string const& _help, Labels const& _labels = Labels());
+
+	/// @returns all metrics in the Prometheus text exposition format, version 0.0.4.
+	std::string exposition() const;
+
+private:
+	enum class Type { Counter, Gauge, Histogram };
+
+	struct Family
+	{
+		Type type;
+		std::string help;
+		std::map<std::string, std::unique_ptr<Counter>> counters;
+		std::map<std::string, std::unique_ptr<Gauge>> gauges;
+		std::map<std::string, std::unique_ptr<Histogram>> histograms;
+	};
+
+	Family& family(std::string const& _name, std::string const& _help, Type _type);
+
+	mutable Mutex x_families;
+	std::map<std::string, Family> m_families;
+};
+
+inline Counter& counter(std::string const& _name, std::string const& _help, Labels const& _labels = Labels()) { return Registry::instance().counter(_name, _help, _labels); }
+inline Gauge& gauge(std::string const& _name, std::string const& _help, Labels const& _labels = Labels()) { return Registry::instance().gauge(_name, _help, _labels); }
+inline Histogram& histogram(std::string const& _name, std::string const& _help, Labels const& _labels = Labels()) { return Registry::instance().histogram(_name, _help, _labels); }
+
+}
+}
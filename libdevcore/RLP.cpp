@@ -90,6 +90,25 @@ RLP RLP::operator[](size_t _i) const
 	return RLP(m_lastItem, ThrowOnFail | FailIfTooSmall);
 }
 
+RLPView::RLPView(RLP const& _list)
+{
+	if (_list.isNull())
+		return;
+	// walk the payload as RLP::operator[] does, which also indexes the items inside a byte string
+	for (bytesConstRef pl = _list.payload(); !pl.empty();)
+	{
+		bytesConstRef i = pl.cropped(0, RLP(pl, RLP::ThrowOnFail | RLP::FailIfTooSmall).actualSize());
+		if (i.empty())
+			break;
+		if (m_size < c_inlineItems)
+			m_inline[m_size] = i;
+		else
+			m_spill.push_back(i);
+		++m_size;
+		pl = pl.cropped(i.size());
+	}
+}
+
 RLPs RLP::toList(int _flags) const
 {
 	RLPs ret;
@@ -241,22 +260,32 @@ void RLPStream::noteAppended(size_t _itemCount)
 //	LOG(DEBUG) << "noteAppended(" << _itemCount << ")";
 	while (m_listStack.size())
 	{
-		if (m_listStack.back().first < _itemCount)
-			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().first, (bigint)_itemCount));
-		m_listStack.back().first -= _itemCount;
-		if (m_listStack.back().first)
+		if (m_listStack.back().items < _itemCount)
+			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().items, (bigint)_itemCount));
+		m_listStack.back().items -= _itemCount;
+		if (m_listStack.back().items)
 			break;
 		else
 		{
-			auto p = m_listStack.back().second;
+			auto p = m_listStack.back().position;
+			auto reserved = m_listStack.back().header;
 			m_listStack.pop_back();
-			size_t s = m_out.size() - p;		// list size
+			size_t s = m_out.size() - p - reserved;		// list size
 			auto brs = bytesRequired(s);
 			unsigned encodeSize = s < c_rlpListImmLenCount ? 1 : (1 + brs);
 //			LOG(DEBUG) << "s: " << s << ", p: " << p << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
-			auto os = m_out.size();
-			m_out.resize(os + encodeSize);
-			memmove(m_out.data() + p + encodeSize, m_out.data() + p, os - p);
+			// the items only move if the room left for the header doesn't fit it
+			if (encodeSize > reserved)
+			{
+				auto os = m_out.size();
+				m_out.resize(os + encodeSize - reserved);
+				memmove(m_out.data() + p + encodeSize, m_out.data() + p + reserved, os - p - reserved);
+			}
+			else if (encodeSize < reserved)
+			{
+				memmove(m_out.data() + p + encodeSize, m_out.data() + p + reserved, s);
+				m_out.resize(m_out.size() - (reserved - encodeSize));
+			}
 			if (s < c_rlpListImmLenCount)
 				m_out[p] = (byte)(c_rlpListStart + s);
 			else if (c_rlpListIndLenZero + brs <= 0xff)
@@ -277,12 +306,22 @@ RLPStream& RLPStream::appendList(size_t _items)
 {
 //	LOG(DEBUG) << "appendList(" << _items << ")";
 	if (_items)
-		m_listStack.push_back(std::make_pair(_items, m_out.size()));
+		m_listStack.push_back(OpenList{_items, m_out.size(), 0});
 	else
 		appendList(bytes());
 	return *this;
 }
 
+RLPStream& RLPStream::appendList(size_t _items, size_t _payloadSize)
+{
+	if (!_items)
+		return appendList(bytes());
+	size_t header = _payloadSize < c_rlpListImmLenCount ? 1 : (1 + bytesRequired(_payloadSize));
+	m_listStack.push_back(OpenList{_items, m_out.size(), header});
+	m_out.resize(m_out.size() + header);
+	return *this;
+}
+
 RLPStream& RLPStream::appendList(bytesConstRef _rlp)
 {
 	if (_rlp.size() < c_rlpListImmLenCount)
@@ -316,27 +355,7 @@ RLPStream& RLPStream::append(bytesConstRef _s, bool _compact)
 
 RLPStream& RLPStream::append(bigint _i)
 {
-	if (!_i)
-		m_out.push_back(c_rlpDataImmLenStart);
-	else if (_i < c_rlpDataImmLenStart)
-		m_out.push_back((byte)_i);
-	else
-	{
-		unsigned br = bytesRequired(_i);
-		if (br < c_rlpDataImmLenCount)
-			m_out.push_back((byte)(br + c_rlpDataImmLenStart));
-		else
-		{
-			auto brbr = bytesRequired(br);
-			if (c_rlpDataIndLenZero + brbr > 0xff)
-				BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("Number too large for RLP"));
-			m_out.push_back((byte)(c_rlpDataIndLenZero + brbr));
-			pushInt(br, brbr);
-		}
-		pushInt(_i, br);
-	}
-	noteAppended();
-	return *this;
+	return appendInt(_i);
 }
 
 void RLPStream::pushCount(size_t _count, byte _base)
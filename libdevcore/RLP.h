@@ -377,6 +377,34 @@ template <class T, size_t N> struct Converter<std::array<T, N>> { static std::ar
 
 template <class T> inline T RLP::convert(int _flags) const { return Converter<T>::convert(*this, _flags); }
 
+/**
+ * Random access to the items of an RLP list. The list is walked once on construction and the
+ * item bounds are kept in a table, inline for short lists, so any item is then found in O(1)
+ * whatever the order of access, where RLP::operator[] rescans on backwards access.
+ */
+class RLPView
+{
+public:
+	static const size_t c_inlineItems = 16;
+
+	/// Indexes the items of @a _list. Like RLP::operator[], it also indexes the items in the
+	/// payload of a byte string, which is how PBFT and other capabilities wrap their messages.
+	explicit RLPView(RLP const& _list);
+
+	/// @returns the number of items in the list.
+	size_t size() const { return m_size; }
+
+	/// @returns item @a _i, or RLP() if @a _i is out of range.
+	RLP operator[](size_t _i) const { return _i < m_size ? RLP(item(_i), RLP::ThrowOnFail | RLP::FailIfTooSmall) : RLP(); }
+
+private:
+	bytesConstRef item(size_t _i) const { return _i < c_inlineItems ? m_inline[_i] : m_spill[_i - c_inlineItems]; }
+
+	size_t m_size = 0;
+	std::array<bytesConstRef, c_inlineItems> m_inline;
+	std::vector<bytesConstRef> m_spill;
+};
+
 /**
  * @brief Class for writing to an RLP bytestream.
  */
@@ -392,9 +420,9 @@ public:
 	~RLPStream() {}
 
 	/// Append given datum to the byte stream.
-	RLPStream& append(unsigned _s) { return append(bigint(_s)); }
-	RLPStream& append(u160 _s) { return append(bigint(_s)); }
-	RLPStream& append(u256 _s) { return append(bigint(_s)); }
+	RLPStream& append(unsigned _s) { return appendInt(_s); }
+	RLPStream& append(u160 _s) { return appendInt(_s); }
+	RLPStream& append(u256 _s) { return appendInt(_s); }
 	RLPStream& append(bigint _s);
 	RLPStream& append(bytesConstRef _s, bool _compact = false);
 	RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
@@ -415,6 +443,9 @@ public:
 
 	/// Appends a list.
 	RLPStream& appendList(size_t _items);
+	/// Appends a list of about @a _payloadSize bytes of items. Room for its header is left up
+	/// front, so closing the list doesn't have to move the items if the estimate was close.
+	RLPStream& appendList(size_t _items, size_t _payloadSize);
 	RLPStream& appendList(bytesConstRef _rlp);
 	RLPStream& appendList(bytes const& _rlp) { return appendList(&_rlp); }
 	RLPStream& appendList(RLPStream const& _s) { return appendList(&_s.out()); }
@@ -429,6 +460,9 @@ public:
 	/// Clear the output stream so far.
 	void clear() { m_out.clear(); m_listStack.clear(); }
 
+	/// Preallocates @a _size bytes of output, so encoding a stream of known size doesn't reallocate.
+	void reserve(size_t _size) { m_out.reserve(_size); }
+
 	/// Read the byte stream.
 	bytes const& out() const { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); return m_out; }
 
@@ -439,6 +473,40 @@ public:
 	void swapOut(bytes& _dest) { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); swap(m_out, _dest); }
 
 private:
+	/// A list still being appended to.
+	struct OpenList
+	{
+		size_t items;		///< Items still to come.
+		size_t position;	///< Offset of the list in the output.
+		size_t header;		///< Bytes left for the header at position.
+	};
+
+	/// Appends an unsigned integer of fixed width without going through bigint.
+	template <class _T> RLPStream& appendInt(_T _i)
+	{
+		if (!_i)
+			m_out.push_back(c_rlpDataImmLenStart);
+		else if (_i < c_rlpDataImmLenStart)
+			m_out.push_back((byte)_i);
+		else
+		{
+			unsigned br = bytesRequired(_i);
+			if (br < c_rlpDataImmLenCount)
+				m_out.push_back((byte)(br + c_rlpDataImmLenStart));
+			else
+			{
+				auto brbr = bytesRequired(br);
+				if (c_rlpDataIndLenZero + brbr > 0xff)
+					BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("Number too large for RLP"));
+				m_out.push_back((byte)(c_rlpDataIndLenZero + brbr));
+				pushInt(br, brbr);
+			}
+			pushInt(_i, br);
+		}
+		noteAppended();
+		return *this;
+	}
+
 	void noteAppended(size_t _itemCount = 1);
 
 	/// Push the node-type byte (using @a _base) along with the item count @a _count.
@@ -457,7 +525,7 @@ private:
 	/// Our output byte stream.
 	bytes m_out;
 
-	std::vector<std::pair<size_t, size_t>> m_listStack;
+	std::vector<OpenList> m_listStack;
 };
 
 template <class _T> void rlpListAux(RLPStream& _out, _T _t) { _out << _t; }
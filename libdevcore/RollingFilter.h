@@ -0,0 +1,106 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: RollingFilter.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "FixedHash.h"
+
+namespace dev
+{
+
+/**
+ * @brief Approximate set of the most recently inserted hashes, in fixed memory.
+ *
+ * Two bloom filter generations of _capacity / 2 items each; when the current one
+ * is full the older one is wiped and reused, so at least the last _capacity / 2
+ * and at most the last _capacity hashes are remembered. exist() may return false
+ * positives (about 0.1% with the default 16 bits per item) but never false negatives
+ * for remembered hashes. Not thread safe.
+ */
+class RollingHashFilter
+{
+public:
+	RollingHashFilter(size_t _capacity, unsigned _bitsPerItem = 16):
+		m_generationCapacity(std::max<size_t>(_capacity / 2, 1)),
+		m_bits(std::max<size_t>(m_generationCapacity * _bitsPerItem, 64))
+	{
+		for (auto& g: m_generations)
+			g.assign((m_bits + 63) / 64, 0);
+	}
+
+	void insert(h256 const& _h)
+	{
+		if (m_count == m_generationCapacity)
+		{
+			m_current ^= 1;
+			std::fill(m_generations[m_current].begin(), m_generations[m_current].end(), 0);
+			m_count = 0;
+		}
+		auto& g = m_generations[m_current];
+		forEachBit(_h, [&](size_t _bit) { g[_bit / 64] |= uint64_t(1) << (_bit % 64); });
+		++m_count;
+	}
+
+	bool exist(h256 const& _h) const { return existIn(m_generations[m_current], _h) || existIn(m_generations[m_current ^ 1], _h); }
+	size_t count(h256 const& _h) const { return exist(_h) ? 1 : 0; }
+
+	void clear()
+	{
+		for (auto& g: m_generations)
+			std::fill(g.begin(), g.end(), 0);
+		m_count = 0;
+	}
+
+private:
+	static const unsigned c_hashes = 10;
+
+	/// Derive c_hashes bit positions from the (already uniformly distributed) hash by double hashing.
+	template <class F> void forEachBit(h256 const& _h, F const& _f) const
+	{
+		uint64_t h1;
+		uint64_t h2;
+		memcpy(&h1, _h.data(), sizeof(h1));
+		memcpy(&h2, _h.data() + sizeof(h1), sizeof(h2));
+		h2 |= 1;
+		for (unsigned i = 0; i < c_hashes; ++i)
+			_f((size_t)((h1 + i * h2) % m_bits));
+	}
+
+	bool existIn(std::vector<uint64_t> const& _g, h256 const& _h) const
+	{
+		bool ret = true;
+		forEachBit(_h, [&](size_t _bit) { ret = ret && (_g[_bit / 64] & (uint64_t(1) << (_bit % 64))); });
+		return ret;
+	}
+
+	size_t m_generationCapacity;
+	size_t m_bits;
+	std::vector<uint64_t> m_generations[2];
+	unsigned m_current = 0;
+	size_t m_count = 0;
+};
+
+}
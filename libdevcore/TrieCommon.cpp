@@ -110,7 +110,9 @@ std::string hexPrefixEncode(bytesConstRef _d1, unsigned _o1, bytesConstRef _d2,
 	return ret;
 }
 
-byte uniqueInUse(RLP const& _orig, byte except)
+namespace
+{
+template <class T> byte uniqueInUseAux(T const& _orig, byte except)
 {
 	byte used = 255;
 	for (unsigned i = 0; i < 17; ++i)
@@ -123,5 +125,16 @@ byte uniqueInUse(RLP const& _orig, byte except)
 		}
 	return used;
 }
+}
+
+byte uniqueInUse(RLP const& _orig, byte except)
+{
+	return uniqueInUseAux(_orig, except);
+}
+
+byte uniqueInUse(RLPView const& _orig, byte except)
+{
+	return uniqueInUseAux(_orig, except);
+}
 
 }
@@ -116,6 +116,7 @@ inline NibbleSlice keyOf(RLP const& _twoItem)
 }
 
 byte uniqueInUse(RLP const& _orig, byte except);
+byte uniqueInUse(RLPView const& _orig, byte except);
 std::string hexPrefixEncode(bytes const& _hexVector, bool _leaf = false, int _begin = 0, int _end = -1);
 std::string hexPrefixEncode(bytesConstRef _data, bool _leaf, int _beginNibble, int _endNibble, unsigned _offset);
 std::string hexPrefixEncode(bytesConstRef _d1, unsigned _o1, bytesConstRef _d2, unsigned _o2, bool _leaf);
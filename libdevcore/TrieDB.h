@@ -1064,8 +1064,10 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, h256 cons
 			killNode(_orig, _origHash);
 
 		// not exactly our node - delve to next level at the correct index.
+		// the new child usually takes the room of the old one, so the node keeps its size
 		byte n = _k[0];
-		RLPStream r(17);
+		RLPStream r;
+		r.appendList(17, _orig.payload().size());
 		for (byte i = 0; i < 17; ++i)
 			if (i == n)
 				mergeAtAux(r, _orig[i], _k.mid(1), _v);
@@ -1171,16 +1173,18 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 	else
 	{
 		// branch...
+		// the children are read out of order below, index them once
+		RLPView items(_orig);
 
 		// exactly our node - remove and rejig.
-		if (_k.size() == 0 && !_orig[16].isEmpty())
+		if (_k.size() == 0 && !items[16].isEmpty())
 		{
 			// Kill the node.
 			killNode(_orig);
 
-			byte used = uniqueInUse(_orig, 16);
+			byte used = uniqueInUse(items, 16);
 			if (used != 255)
-				if (isTwoItemNode(_orig[used]))
+				if (isTwoItemNode(items[used]))
 				{
 					auto merged = merge(_orig, used);
 					return graft(RLP(merged));
@@ -1189,9 +1193,10 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 					return merge(_orig, used);
 			else
 			{
-				RLPStream r(17);
+				RLPStream r;
+				r.appendList(17, _orig.payload().size());
 				for (byte i = 0; i < 16; ++i)
-					r << _orig[i];
+					r << items[i];
 				r << "";
 				return r.out();
 			}
@@ -1199,27 +1204,29 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 		else
 		{
 			// not exactly our node - delve to next level at the correct index.
-			RLPStream r(17);
+			RLPStream r;
+			r.appendList(17, _orig.payload().size());
 			byte n = _k[0];
 			for (byte i = 0; i < 17; ++i)
 				if (i == n)
-					if (!deleteAtAux(r, _orig[i], _k.mid(1)))	// bomb out if the key didn't turn up.
+					if (!deleteAtAux(r, items[i], _k.mid(1)))	// bomb out if the key didn't turn up.
 						return bytes();
 					else {}
 				else
-					r << _orig[i];
+					r << items[i];
 
 			// Kill the node.
 			killNode(_orig);
 
 			// check if we ended up leaving the node invalid.
 			RLP rlp(r.out());
-			byte used = uniqueInUse(rlp, 255);
+			RLPView children(rlp);
+			byte used = uniqueInUse(children, 255);
 			if (used == 255)	// no - all ok.
 				return r.out();
 
 			// yes; merge
-			if (isTwoItemNode(rlp[used]))
+			if (isTwoItemNode(children[used]))
 			{
 				auto merged = merge(rlp, used);
 				return graft(RLP(merged));
@@ -2,6 +2,10 @@
 #include <string>
 #include <iostream>
 #include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <vector>
 #ifdef __APPLE__
 #include <pthread.h>
 #endif
@@ -89,3 +93,250 @@ using namespace dev;
         return g_logThreadName.m_name.get() ? *g_logThreadName.m_name.get() : "<unknown>";
       #endif
     }
+
+std::atomic<unsigned> dev::g_logLevels(~0u);
+
+void dev::updateLogLevels()
+{
+  static const el::Level c_levels[] = {el::Level::Trace, el::Level::Debug, el::Level::Fatal, el::Level::Error, el::Level::Warning, el::Level::Verbose, el::Level::Info};
+  unsigned levels = 0;
+  for (char const* id : {"default", "fileLogger"})
+  {
+    el::Logger* logger = el::Loggers::getLogger(id, false);
+    if (!logger)
+      continue;
+    for (el::Level level : c_levels)
+      if (logger->enabled(level))
+        levels |= static_cast<unsigned>(level);
+  }
+  g_logLevels.store(levels, std::memory_order_relaxed);
+}
+
+namespace
+{
+
+/// Set while the background writer runs.
+std::atomic<bool> g_logAsync(false);
+
+/// Bytes of each thread's ring; a record over a quarter of it is written at once.
+static const size_t c_logRingSize = 64 * 1024;
+/// How often the writer drains the rings when no producer wakes it up.
+static const std::chrono::milliseconds c_logDrainInterval(5);
+
+/// One producer thread, one consumer at a time under x_drain. Records never wrap: one that doesn't
+/// fit before the end of the buffer leaves a zero size there and starts at the beginning.
+struct LogRing
+{
+  LogRing(): buf(c_logRingSize) {}
+
+  std::vector<char> buf;
+  std::atomic<uint64_t> head{0};	///< Written by the producer.
+  std::atomic<uint64_t> tail{0};	///< Written by the consumer.
+};
+
+std::mutex x_rings;
+std::vector<std::shared_ptr<LogRing>> g_rings;
+std::mutex x_drain;
+std::mutex x_wake;
+std::condition_variable g_wake;
+bool g_stop = false;
+std::thread g_writer;
+
+thread_local std::shared_ptr<LogRing> t_ring;
+thread_local std::vector<char> t_scratch;
+/// Set while this thread drains, so that whatever logs from inside easylogging doesn't drain again.
+thread_local bool t_draining = false;
+
+LogRing& threadRing()
+{
+  if (!t_ring)
+  {
+    t_ring = std::make_shared<LogRing>();
+    std::lock_guard<std::mutex> l(x_rings);
+    g_rings.push_back(t_ring);
+  }
+  return *t_ring;
+}
+
+void writeRecord(char const* _record)
+{
+  dev::logdetail::RecordHeader h;
+  memcpy(&h, _record, sizeof(h));
+  std::ostringstream out;
+  dev::logdetail::format(out, _record + sizeof(h), _record + h.size);
+  el::base::Writer(static_cast<el::Level>(h.level), h.file, h.line, h.func).construct(2, "default", "fileLogger") << out.str();
+}
+
+struct Pending
+{
+  int64_t time;
+  char const* record;
+};
+
+/// Writes every record committed so far, oldest first.
+void drain()
+{
+  if (t_draining)
+    return;
+  std::lock_guard<std::mutex> d(x_drain);
+  t_draining = true;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  {
+    std::lock_guard<std::mutex> l(x_rings);
+    // a ring whose thread is gone and which holds nothing more can go
+    g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [](std::shared_ptr<LogRing> const& r) {
+      return r.use_count() == 1 && r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_relaxed);
+    }), g_rings.end());
+    rings = g_rings;
+  }
+
+  std::vector<uint64_t> heads;
+  std::vector<Pending> pending;
+  for (auto const& r: rings)
+  {
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    heads.push_back(head);
+    for (uint64_t at = r->tail.load(std::memory_order_relaxed); at != head;)
+    {
+      char const* p = &r->buf[at % c_logRingSize];
+      uint32_t size;
+      memcpy(&size, p, sizeof(size));
+      if (!size)
+      {
+        at += c_logRingSize - at % c_logRingSize;
+        continue;
+      }
+      dev::logdetail::RecordHeader h;
+      memcpy(&h, p, sizeof(h));
+      pending.push_back(Pending{h.time, p});
+      at += size;
+    }
+  }
+  std::stable_sort(pending.begin(), pending.end(), [](Pending const& a, Pending const& b) { return a.time < b.time; });
+  for (auto const& p: pending)
+    writeRecord(p.record);
+  for (size_t i = 0; i < rings.size(); ++i)
+    rings[i]->tail.store(heads[i], std::memory_order_release);
+  t_draining = false;
+}
+
+void stopAsyncLog()
+{
+  if (!g_logAsync.exchange(false))
+    return;
+  {
+    std::lock_guard<std::mutex> l(x_wake);
+    g_stop = true;
+  }
+  g_wake.notify_one();
+  g_writer.join();
+  drain();
+}
+
+}
+
+std::vector<char>& dev::logdetail::scratch()
+{
+  return t_scratch;
+}
+
+void dev::logdetail::format(std::ostream& _out, char const* _begin, char const* _end)
+{
+  while (_begin < _end)
+  {
+    ArgHeader a;
+    memcpy(&a, _begin, sizeof(a));
+    _begin += sizeof(a);
+    a.format(_out, _begin, a.size);
+    _begin += (a.size + 7) & ~7u;
+  }
+}
+
+void dev::logdetail::commit(size_t _begin)
+{
+  std::vector<char>& buf = t_scratch;
+  size_t size = buf.size() - _begin;
+  RecordHeader h;
+  memcpy(&h, &buf[_begin], sizeof(h));
+  bool urgent = h.level == static_cast<unsigned>(el::Level::Error) || h.level == static_cast<unsigned>(el::Level::Fatal);
+  if (!urgent && size <= c_logRingSize / 4 && g_logAsync.load(std::memory_order_relaxed))
+  {
+    LogRing& r = threadRing();
+    uint64_t head = r.head.load(std::memory_order_relaxed);
+    size_t at = head % c_logRingSize;
+    size_t skip = at + size > c_logRingSize ? c_logRingSize - at : 0;
+    uint64_t used = head - r.tail.load(std::memory_order_acquire);
+    if (used + skip + size <= c_logRingSize)
+    {
+      if (skip)
+      {
+        memset(&r.buf[at], 0, sizeof(uint32_t));
+        at = 0;
+      }
+      memcpy(&r.buf[at], &buf[_begin], size);
+      r.head.store(head + skip + size, std::memory_order_release);
+      buf.resize(_begin);
+      if ((used + skip + size) * 2 > c_logRingSize && used * 2 <= c_logRingSize)
+        g_wake.notify_one();
+      return;
+    }
+  }
+  // an error, too big, ring full or no writer: everything before it first, then the record itself
+  drain();
+  writeRecord(&buf[_begin]);
+  buf.resize(_begin);
+}
+
+dev::LogRecord::LogRecord(el::Level _level, char const* _file, unsigned _line, char const* _func)
+{
+  std::vector<char>& buf = t_scratch;
+  m_begin = buf.size();
+  logdetail::RecordHeader h{0, _line, static_cast<unsigned>(_level), std::chrono::steady_clock::now().time_since_epoch().count(), _file, _func};
+  buf.resize(m_begin + sizeof(h));
+  memcpy(&buf[m_begin], &h, sizeof(h));
+}
+
+dev::LogRecord::~LogRecord()
+{
+  std::vector<char>& buf = t_scratch;
+  if (m_formatted)
+  {
+    std::string text = m_formatted->str();
+    logdetail::storeString(buf, text.data(), text.size());
+  }
+  uint32_t size = buf.size() - m_begin;
+  memcpy(&buf[m_begin], &size, sizeof(size));
+  logdetail::commit(m_begin);
+}
+
+void dev::LogRecord::formatNow()
+{
+  std::vector<char>& buf = t_scratch;
+  size_t args = m_begin + sizeof(logdetail::RecordHeader);
+  m_formatted.reset(new std::ostringstream);
+  logdetail::format(*m_formatted, buf.data() + args, buf.data() + buf.size());
+  buf.resize(args);
+}
+
+void dev::flushLog()
+{
+  drain();
+}
+
+void dev::startAsyncLog()
+{
+  if (g_logAsync.exchange(true))
+    return;
+  g_writer = std::thread([]() {
+    pthread_setThreadName("logwriter");
+    std::unique_lock<std::mutex> l(x_wake);
+    while (!g_stop)
+    {
+      g_wake.wait_for(l, c_logDrainInterval);
+      l.unlock();
+      drain();
+      l.lock();
+    }
+  });
+  atexit(stopAsyncLog);
+}
@@ -33,8 +33,14 @@
 #include "CommonData.h"
 #include "FixedHash.h"
 #include "Terminal.h"
+#include <atomic>
+#include <cstring>
+#include <iomanip>
 #include <map>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <type_traits>
 namespace dev{
   class ThreadContext
   {
@@ -74,9 +80,217 @@ const int CGasUsedLimit = 90; //gas 超过阈值的90%告警
 const int CConvergenceLimit = 1000; //共识耗时超过1000ms告警
 const int CPackageTimeLimit = 2000; //打包耗时超过2000ms告警
 
-#define MY_CUSTOM_LOGGER(LEVEL) CLOG(LEVEL, "default", "fileLogger")
+namespace dev
+{
+/// Levels enabled on "default" or "fileLogger", as a mask of el::Level bits. All are set until the
+/// loggers are configured, then updateLogLevels() narrows it down.
+extern std::atomic<unsigned> g_logLevels;
+
+/// Read the levels enabled in the logger configuration into g_logLevels; call after reconfiguring.
+void updateLogLevels();
+
+inline bool logEnabled(el::Level _level)
+{
+	return g_logLevels.load(std::memory_order_relaxed) & static_cast<unsigned>(_level);
+}
+
+/// Turns the log statement into a void expression, so it can be the arm of the ternary in LOG.
+struct LogVoidify
+{
+	template <class T> void operator&(T const&) {}
+};
+
+/// Starts the background writer; call once the loggers are configured. Until then, and for ERROR
+/// and FATAL, LOG writes at once, after every record logged before.
+void startAsyncLog();
+
+/// Writes out every record logged so far. Runs at exit too.
+void flushLog();
+
+namespace logdetail
+{
+
+/// Writes an argument stored by Deferred<T>::store to the stream.
+using Format = void (*)(std::ostream&, char const*, uint32_t);
+
+struct RecordHeader
+{
+	uint32_t size;				///< Of the whole record, a multiple of 8; 0 marks the end of the ring.
+	uint32_t line;
+	unsigned level;
+	int64_t time;				///< steady_clock ticks, to merge the threads' records in order.
+	char const* file;
+	char const* func;
+};
+
+struct ArgHeader
+{
+	Format format;
+	uint32_t size;
+	uint32_t pad;
+};
+
+/// The buffer this thread builds records in; one logged while building another goes after it.
+std::vector<char>& scratch();
+
+/// Moves the record at @a _begin of scratch() to this thread's ring, or writes it at once if it
+/// can't wait or the ring is full, and drops it from scratch().
+void commit(size_t _begin);
+
+/// Writes the arguments in [_begin, _end) to @a _out.
+void format(std::ostream& _out, char const* _begin, char const* _end);
+
+/// Room for an argument of @a _size bytes at the end of @a _buf; @returns where its bytes go.
+inline size_t argSpace(std::vector<char>& _buf, Format _format, uint32_t _size)
+{
+	size_t at = _buf.size();
+	_buf.resize(at + sizeof(ArgHeader) + ((_size + 7) & ~7u));
+	ArgHeader h{_format, _size, 0};
+	memcpy(&_buf[at], &h, sizeof(h));
+	return at + sizeof(ArgHeader);
+}
+
+template <class T> void formatCopy(std::ostream& _out, char const* _p, uint32_t)
+{
+	T t;
+	memcpy(&t, _p, sizeof(T));
+	_out << t;
+}
+
+inline void formatString(std::ostream& _out, char const* _p, uint32_t _size)
+{
+	_out << std::string(_p, _size);
+}
+
+template <class T> void formatBigEndian(std::ostream& _out, char const* _p, uint32_t _size)
+{
+	_out << fromBigEndian<T>(bytesConstRef((byte const*)_p, _size));
+}
+
+inline void storeString(std::vector<char>& _buf, char const* _s, size_t _size)
+{
+	size_t at = argSpace(_buf, &formatString, (uint32_t)_size);
+	if (_size)
+		memcpy(&_buf[at], _s, _size);
+}
+
+/// The argument types whose formatting waits for the writer thread: numbers and manipulators
+/// copied as bytes, hashes, u256 and strings. Anything else, and everything after it, is formatted
+/// when logged.
+template <class T, class = void> struct Deferred: std::false_type {};
+
+template <class T> struct CopyDeferred: std::true_type
+{
+	static void store(std::vector<char>& _buf, T const& _t)
+	{
+		size_t at = argSpace(_buf, &formatCopy<T>, sizeof(T));
+		memcpy(&_buf[at], &_t, sizeof(T));
+	}
+};
+
+template <class T> struct Deferred<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>: CopyDeferred<T> {};
+template <unsigned N> struct Deferred<FixedHash<N>>: CopyDeferred<FixedHash<N>> {};
+template <> struct Deferred<decltype(std::setw(0))>: CopyDeferred<decltype(std::setw(0))> {};
+template <> struct Deferred<decltype(std::setfill('0'))>: CopyDeferred<decltype(std::setfill('0'))> {};
+template <> struct Deferred<decltype(std::setprecision(0))>: CopyDeferred<decltype(std::setprecision(0))> {};
+template <> struct Deferred<std::ostream& (*)(std::ostream&)>: CopyDeferred<std::ostream& (*)(std::ostream&)> {};
+template <> struct Deferred<std::ios_base& (*)(std::ios_base&)>: CopyDeferred<std::ios_base& (*)(std::ios_base&)> {};
+
+template <class T, unsigned N> struct BigEndianDeferred: std::true_type
+{
+	static void store(std::vector<char>& _buf, T const& _t)
+	{
+		size_t at = argSpace(_buf, &formatBigEndian<T>, N);
+		bytesRef out((byte*)&_buf[at], N);
+		toBigEndian(_t, out);
+	}
+};
+template <> struct Deferred<u256>: BigEndianDeferred<u256, 32> {};
+template <> struct Deferred<u160>: BigEndianDeferred<u160, 20> {};
+
+template <> struct Deferred<std::string>: std::true_type
+{
+	static void store(std::vector<char>& _buf, std::string const& _t) { storeString(_buf, _t.data(), _t.size()); }
+};
+template <> struct Deferred<char const*>: std::true_type
+{
+	static void store(std::vector<char>& _buf, char const* _t) { storeString(_buf, _t ? _t : "", _t ? strlen(_t) : 0); }
+};
+template <> struct Deferred<char*>: Deferred<char const*> {};
+
+}
+
+/**
+ * A LOG statement. The record is built in a per-thread buffer, its arguments stored as bytes for
+ * the writer to format, and on destruction moved to the thread's ring buffer; the writer thread
+ * drains the rings, formats the records in time order and hands them to easylogging, so the
+ * logging thread never takes the logger lock.
+ */
+class LogRecord
+{
+public:
+	LogRecord(el::Level _level, char const* _file, unsigned _line, char const* _func);
+	~LogRecord();
+	LogRecord(LogRecord const&) = delete;
+	LogRecord& operator=(LogRecord const&) = delete;
+
+	template <class T> LogRecord& operator<<(T const& _t)
+	{
+		put(_t, logdetail::Deferred<typename std::decay<T>::type>());
+		return *this;
+	}
+	LogRecord& operator<<(std::ostream& (*_f)(std::ostream&)) { put(_f, std::true_type()); return *this; }
+	LogRecord& operator<<(std::ios_base& (*_f)(std::ios_base&)) { put(_f, std::true_type()); return *this; }
+
+private:
+	template <class T> void put(T const& _t, std::true_type)
+	{
+		if (m_formatted)
+			*m_formatted << _t;
+		else
+			logdetail::Deferred<typename std::decay<T>::type>::store(logdetail::scratch(), _t);
+	}
+	template <class T> void put(T const& _t, std::false_type)
+	{
+		if (!m_formatted)
+			formatNow();
+		*m_formatted << _t;
+	}
+
+	/// Formats what's stored so far and the rest as it comes, for an argument that can't wait.
+	void formatNow();
+
+	size_t m_begin;
+	std::unique_ptr<std::ostringstream> m_formatted;
+};
+}
+
+#define DEV_LOG_LEVEL_TRACE el::Level::Trace
+#define DEV_LOG_LEVEL_DEBUG el::Level::Debug
+#define DEV_LOG_LEVEL_INFO el::Level::Info
+#define DEV_LOG_LEVEL_WARNING el::Level::Warning
+#define DEV_LOG_LEVEL_ERROR el::Level::Error
+#define DEV_LOG_LEVEL_FATAL el::Level::Fatal
+
+// ELPP_DISABLE_TRACE_LOGS / ELPP_DISABLE_DEBUG_LOGS (cmake -DDEBUG_LOGS=OFF) make these 0 and the
+// statements dead code
+#define DEV_LOG_BUILT_TRACE ELPP_TRACE_LOG
+#define DEV_LOG_BUILT_DEBUG ELPP_DEBUG_LOG
+#define DEV_LOG_BUILT_INFO ELPP_INFO_LOG
+#define DEV_LOG_BUILT_WARNING ELPP_WARNING_LOG
+#define DEV_LOG_BUILT_ERROR ELPP_ERROR_LOG
+#define DEV_LOG_BUILT_FATAL ELPP_FATAL_LOG
+
+/// Log writer of the level, without the level check; for passing the stream on as in LOG_STREAM(INFO) << ...
+#define LOG_STREAM(LEVEL) CLOG(LEVEL, "default", "fileLogger")
+
+#define MY_CUSTOM_LOGGER(LEVEL) LOG(LEVEL)
 #undef LOG
-#define LOG(LEVEL) CLOG(LEVEL, "default", "fileLogger")
+// A disabled level costs one load: neither the writer, which takes the logger lock, nor the
+// arguments are evaluated. Enabled ones go to the background writer once it's started.
+#define LOG(LEVEL) \
+	!(DEV_LOG_BUILT_##LEVEL && dev::logEnabled(DEV_LOG_LEVEL_##LEVEL)) ? (void)0 : \
+	dev::LogVoidify() & dev::LogRecord(DEV_LOG_LEVEL_##LEVEL, __FILE__, __LINE__, ELPP_FUNC)
 #undef VLOG
 #define VLOG(LEVEL) CVLOG(LEVEL, "default", "fileLogger")
 #define LOGCOMWARNING LOG(WARNING)<<"common|"
@@ -145,35 +145,37 @@ void BlockHeader::populate(RLP const& _header)
 	int field = 0;
 	try
 	{
-		m_parentHash = _header[field = 0].toHash<h256>(RLP::VeryStrict);
-		m_sha3Uncles = _header[field = 1].toHash<h256>(RLP::VeryStrict);
-		m_author = _header[field = 2].toHash<Address>(RLP::VeryStrict);
-		m_stateRoot = _header[field = 3].toHash<h256>(RLP::VeryStrict);
-		m_transactionsRoot = _header[field = 4].toHash<h256>(RLP::VeryStrict);
-		m_receiptsRoot = _header[field = 5].toHash<h256>(RLP::VeryStrict);
-		m_logBloom = _header[field = 6].toHash<LogBloom>(RLP::VeryStrict);
-		m_difficulty = _header[field = 7].toInt<u256>();
-		m_number = _header[field = 8].toInt<u256>();
+		// one walk over the header, however many fields it has
+		RLPView fields(_header);
+		m_parentHash = fields[field = 0].toHash<h256>(RLP::VeryStrict);
+		m_sha3Uncles = fields[field = 1].toHash<h256>(RLP::VeryStrict);
+		m_author = fields[field = 2].toHash<Address>(RLP::VeryStrict);
+		m_stateRoot = fields[field = 3].toHash<h256>(RLP::VeryStrict);
+		m_transactionsRoot = fields[field = 4].toHash<h256>(RLP::VeryStrict);
+		m_receiptsRoot = fields[field = 5].toHash<h256>(RLP::VeryStrict);
+		m_logBloom = fields[field = 6].toHash<LogBloom>(RLP::VeryStrict);
+		m_difficulty = fields[field = 7].toInt<u256>();
+		m_number = fields[field = 8].toInt<u256>();
 		//LOG(TRACE) << "Read-blockNum:" << m_number << ",updateHeight:" << BlockHeader::updateHeight;
-		m_gasLimit = _header[field = 9].toInt<u256>();
-		m_gasUsed = _header[field = 10].toInt<u256>();
-		m_timestamp = _header[field = 11].toInt<u256>();
-		m_extraData = _header[field = 12].toBytes();
+		m_gasLimit = fields[field = 9].toInt<u256>();
+		m_gasUsed = fields[field = 10].toInt<u256>();
+		m_timestamp = fields[field = 11].toInt<u256>();
+		m_extraData = fields[field = 12].toBytes();
 
-		m_gen_idx = _header[field = 13].toInt<u256>();
-		m_node_list = _header[field = 14].toVector<h512>();
+		m_gen_idx = fields[field = 13].toInt<u256>();
+		m_node_list = fields[field = 14].toVector<h512>();
 
 		unsigned basicFieldsCnt = BasicFields;
 		if (IsBlockAfterUpdate())
 		{
-			m_hash_list = _header[field = 15].toVector<h256>();
-			m_str_list = _header[field = 16].toVector<std::string>();
+			m_hash_list = fields[field = 15].toVector<h256>();
+			m_str_list = fields[field = 16].toVector<std::string>();
 			basicFieldsCnt = BasicFieldsUpdate;
 		}
 
 		m_seal.clear();
-		for (unsigned i = basicFieldsCnt; i < _header.itemCount(); ++i)
-			m_seal.push_back(_header[i].data().toBytes());
+		for (unsigned i = basicFieldsCnt; i < fields.size(); ++i)
+			m_seal.push_back(fields[i].data().toBytes());
 	}
 	catch (Exception const& _e)
 	{
@@ -217,8 +219,8 @@ void BlockHeader::verify(Strictness _s, BlockHeader const& _parent, bytesConstRe
 	{
 		RLP root(_block);
 
-		auto txList = root[1];
-		auto expectedRoot = trieRootOver(txList.itemCount(), [&](unsigned i) { return rlp(i); }, [&](unsigned i) { return txList[i].data().toBytes(); });
+		RLPView txList(root[1]);
+		auto expectedRoot = trieRootOver(txList.size(), [&](unsigned i) { return rlp(i); }, [&](unsigned i) { return txList[i].data().toBytes(); });
 
 		LOG(TRACE) << "Expected trie root:" << toString(expectedRoot);
 		if (m_transactionsRoot != expectedRoot)
@@ -229,7 +231,7 @@ void BlockHeader::verify(Strictness _s, BlockHeader const& _parent, bytesConstRe
 
 			vector<bytesConstRef> txs;
 
-			for (unsigned i = 0; i < txList.itemCount(); ++i)
+			for (unsigned i = 0; i < txList.size(); ++i)
 			{
 				RLPStream k;
 				k << i;
@@ -89,6 +89,18 @@ struct ChainOperationParams
 	bool evmEventLog = false; 
 	bool evmCoverLog = false; 
 	bool statLog = false; 
+	/// Maintain the address/topic index of logs used by eth_getLogs.
+	bool logIndex = false;
+	/// Most log entries eth_getLogs may return and eth_getLogsPage may page, 0 for no limit.
+	unsigned logsLimit = 0;
+	/// Post-states of the newest blocks kept for eth_call, 0 to run every call on a copy of the block.
+	unsigned callSnapshots = 4;
+	/// Most eth_calls executing at once on those snapshots, 0 for half the hardware threads.
+	unsigned callConcurrency = 0;
+	/// Serve a state snapshot of every this many blocks to syncing nodes, 0 not to serve any.
+	unsigned snapshotInterval = 1000;
+	/// Peers that must offer the same snapshot before a node far behind jumps to it, 0 to always sync block by block.
+	unsigned snapshotSync = 0;
 	Address sysytemProxyAddress;
 	Address god;
 
@@ -108,9 +120,13 @@ struct ChainOperationParams
 	std::string nodeId;
 	std::string groupId;
 	std::string storagePath;
+	/// read size in KB for downloads that can't be sent with sendfile, e.g. over TLS
+	unsigned dfsBlockSize = 256;
 	
 	std::string rateLimitConfig;
 	int statsInterval;
+	/// local port serving GET /metrics, 0 to disable
+	int metricsPort = 0;
 	int channelPort = 0;
 
 	std::string vmKind;
@@ -121,6 +137,9 @@ struct ChainOperationParams
 
 	bool broadcastToNormalNode = false; 
 
+	/// Send PBFT prepare requests as block header plus transaction hashes; all sealers must support it.
+	bool compactPrepare = false;
+
 
 	u256 godMinerStart = 0;
 	u256 godMinerEnd = 0;
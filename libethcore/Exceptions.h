@@ -79,6 +79,7 @@ DEV_SIMPLE_EXCEPTION(UnknownParent);
 DEV_SIMPLE_EXCEPTION(NonceCheckFail);
 DEV_SIMPLE_EXCEPTION(BlockLimitCheckFail);
 DEV_SIMPLE_EXCEPTION(FilterCheckFail);
+DEV_SIMPLE_EXCEPTION(InvalidSnapshotData);
 DEV_SIMPLE_EXCEPTION(NoDeployPermission);
 DEV_SIMPLE_EXCEPTION(NoCallPermission);
 DEV_SIMPLE_EXCEPTION(NoTxPermission);
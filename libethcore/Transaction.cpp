@@ -19,6 +19,8 @@
  * @date 2014
  */
 
+#include <algorithm>
+
 #include <abi/ContractAbiMgr.h>
 #include <abi/SolidityTools.h>
 #include <abi/SolidityCoder.h>
@@ -54,13 +56,53 @@ TransactionBase::TransactionBase(TransactionSkeleton const& _ts, Secret const& _
 		sign(_s);
 }
 
+namespace
+{
+
+/// @returns true if @a _data may be a JSON object, i.e. starts with '{' after any whitespace
+/// and comments, skipped the way Json::Reader skips them. ABI encoded calldata starts with a
+/// function selector, so this spares it the JSON parse.
+bool maybeJsonObject(bytesConstRef _data)
+{
+	auto it = _data.begin();
+	auto end = _data.end();
+	while (it != end)
+	{
+		byte c = *it++;
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			continue;
+		if (c != '/')
+			return c == '{';
+		if (it == end)
+			return false;
+		c = *it++;
+		if (c == '*')
+		{
+			// an unterminated /* comment fails the parse
+			static char const c_close[] = "*/";
+			it = std::search(it, end, c_close, c_close + 2);
+			if (it == end)
+				return false;
+			it += 2;
+		}
+		else if (c == '/')
+			// a // comment runs to the end of the line or of the data
+			while (it != end && *it != '\n' && *it != '\r')
+				++it;
+		else
+			return false;
+	}
+	return false;
+}
+
+}
+
 TransactionBase::TransactionBase(bytesConstRef _rlpData, CheckTransaction _checkSig)
 {
-	int field = 0;
 	RLP rlp(_rlpData);
 	try
 	{
-		transactionRLPDecode(_rlpData);
+		transactionRLPDecode(rlp);
 		if (_checkSig >= CheckTransaction::Cheap && !m_vrs.isValid()) 
 		{
 			BOOST_THROW_EXCEPTION(InvalidSignature());
@@ -79,18 +121,24 @@ TransactionBase::TransactionBase(bytesConstRef _rlpData, CheckTransaction _check
 
 void TransactionBase::transactionRLPDecode(bytesConstRef _rlp)
 {
-	RLP rlp(_rlp);
-	if (!rlp.isList())
+	transactionRLPDecode(RLP(_rlp));
+}
+
+void TransactionBase::transactionRLPDecode(RLP const& _rlp)
+{
+	if (!_rlp.isList())
 		BOOST_THROW_EXCEPTION(InvalidTransactionFormat() << errinfo_comment("transaction RLP must be a list"));
 
-	size_t rlpItemCount = rlp.itemCount();
+	// the fields are indexed in one walk over the list
+	RLPView fields(_rlp);
+	size_t rlpItemCount = fields.size();
 	if (rlpItemCount == 10)
 	{
-		transactionRLPDecode10Ele(rlp);
+		transactionRLPDecode10Ele(fields);
 	}
 	else if (rlpItemCount == 13)
 	{
-		transactionRLPDecode13Ele(rlp);
+		transactionRLPDecode13Ele(fields);
 	}
 	else
 	{
@@ -98,7 +146,7 @@ void TransactionBase::transactionRLPDecode(bytesConstRef _rlp)
 	}
 }
 
-void TransactionBase::transactionRLPDecode10Ele(const RLP &rlp)
+void TransactionBase::transactionRLPDecode10Ele(RLPView const& rlp)
 {
 	int index = 0;
 	m_randomid       = rlp[index++].toInt<u256>(); // 0 
@@ -108,8 +156,8 @@ void TransactionBase::transactionRLPDecode10Ele(const RLP &rlp)
 	m_receiveAddress = rlp[index].isEmpty() ? Address() : rlp[index].toHash<Address>(RLP::VeryStrict); // 4
 	index++;  
 	m_value          = rlp[index++].toInt<u256>(); // 5
-	auto dataRLP     = rlp[index++];               // 6
-	m_data           = dataRLP.toBytes();    
+	auto data        = rlp[index++].toBytesConstRef(); // 6
+	m_data           = data.toBytes();    
 
 #if ETH_ENCRYPTTYPE
 	h512 pub         = rlp[index++].toInt<u512>(); // 7
@@ -131,40 +179,49 @@ void TransactionBase::transactionRLPDecode10Ele(const RLP &rlp)
 	v = v - (m_chainId * 2 + 35);
 	m_vrs = SignatureStruct{ r, s, v };
 #endif
+	m_type            = (m_receiveAddress == Address() ? ContractCreation : MessageCall);
+	m_transactionType = DefaultTransaction;
+
+	// UTXO and old CNS transactions carry a JSON object; anything else is plain calldata
+	if (!maybeJsonObject(data))
+		return;
+
 	Json::Value _json;
-	if (isUTXOTx(dataRLP.toString(), _json))
+	try
+	{
+		if (!Json::Reader().parse(data.toString(), _json, false) || !_json.isObject())
+			return;
+	}
+	catch (...)
+	{
+		return;
+	}
+
+	if (_json.isMember("utxotype") && _json["utxotype"].isInt())
 	{
 		// is UTXO transcation or not
 		parseUTXOJson(_json);
-		m_type = (m_receiveAddress == Address() ? ContractCreation : MessageCall);
 	}
-	else 
+	else
 	{
 		//判断是否是CNS调用
-		auto isOldCNS = fromJsonGetParams(dataRLP.toString(), m_cnsParams);
-		if (isOldCNS)
-		{
-			m_type            = MessageCall;
-			m_transactionType = CNSOldTransaction;
-
-			LOG(TRACE) << "[CNSOldTransaction] cncName|method|cnsVer|params=" 
-				<< m_cnsParams.strContractName << "|"
-				<< m_cnsParams.strFunc << "|"
-				<< m_cnsParams.strVersion << "|"
-				<< m_cnsParams.jParams.toStyledString();
-		}
-		else
-		{
-			m_type            = (m_receiveAddress == Address() ? ContractCreation : MessageCall);
-			m_transactionType = DefaultTransaction;
-
-			LOG(TRACE) << "[CNSDefaultTransaction] to address = " << m_receiveAddress;
-		}
+		fromJsonGetParams(_json, m_cnsParams);
+		m_type            = MessageCall;
+		m_transactionType = CNSOldTransaction;
+
+		LOG(TRACE) << "[CNSOldTransaction] cncName|method|cnsVer|params=" 
+			<< m_cnsParams.strContractName << "|"
+			<< m_cnsParams.strFunc << "|"
+			<< m_cnsParams.strVersion << "|"
+			<< m_cnsParams.jParams.toStyledString();
 	}
 }
 
 bool TransactionBase::isUTXOTx(const std::string& strJson, Json::Value& _json)
 {
+	if (!maybeJsonObject(bytesConstRef(&strJson)))
+		return false;
+
 	try 
 	{
 		Json::Reader reader;
@@ -183,7 +240,7 @@ bool TransactionBase::isUTXOTx(const std::string& strJson, Json::Value& _json)
 	return false;
 }
 
-void TransactionBase::transactionRLPDecode13Ele(const RLP &rlp)
+void TransactionBase::transactionRLPDecode13Ele(RLPView const& rlp)
 {
 	int index = 0;
 	
@@ -282,9 +339,7 @@ void TransactionBase::doGetCNSparams() const
 		std::string contract = (!rVectorString.empty() ? rVectorString[0] : "");
 		std::string version = (rVectorString.size() > 1 ? rVectorString[1] : "");
 
-		libabi::SolidityAbi abi;
-		libabi::ContractAbiMgr::getInstance()->getContractAbi0(contract, version, abi);
-		m_addressGetByCNS = dev::jsToAddress(abi.getAddr());
+		m_addressGetByCNS = libabi::ContractAbiMgr::getInstance()->getContractAddr0(contract, version);
 		LOG(TRACE) << "CNSNewTransaction # constract = " << m_strCNSName
 			<< " ,version = " << m_strCNSVer
 			<< " ,address = " << m_addressGetByCNS
@@ -352,7 +407,9 @@ void TransactionBase::streamRLP(RLPStream& _s, IncludeSignature _sig, bool _forE
 	if (m_type == NullTransaction)
 		return;
 
-	_s.appendList((_sig || _forEip155hash ? 3 : 0) + (isCNSNewTransaction() ? 10 : 7));
+	// the fields besides data and the CNS names take about 128 bytes
+	size_t payloadSize = m_data.size() + 128 + (isCNSNewTransaction() ? m_strCNSName.size() + m_strCNSVer.size() : 0);
+	_s.appendList((_sig || _forEip155hash ? 3 : 0) + (isCNSNewTransaction() ? 10 : 7), payloadSize);
 	_s << m_randomid << m_gasPrice << m_gas << m_blockLimit ; 
 	if (m_receiveAddress==Address())
 	{
@@ -463,6 +520,7 @@ h256 TransactionBase::sha3(IncludeSignature _sig) const
 
 	RLPStream s;
 	//std::stringstream s;
+	s.reserve(m_data.size() + 256);
 	streamRLP(s, _sig, m_chainId > 0 && _sig == WithoutSignature);
 
 	auto ret = dev::sha3(s.out());
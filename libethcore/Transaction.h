@@ -229,8 +229,9 @@ protected:
 public:
 	
 	void transactionRLPDecode(bytesConstRef _rlp);
-	void transactionRLPDecode10Ele(const RLP &rlp);
-	void transactionRLPDecode13Ele(const RLP &rlp);
+	void transactionRLPDecode(RLP const& _rlp);
+	void transactionRLPDecode10Ele(RLPView const& rlp);
+	void transactionRLPDecode13Ele(RLPView const& rlp);
 
 	
 	bool isDefaultTransaction() const { return m_transactionType == DefaultTransaction; }
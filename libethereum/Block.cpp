@@ -28,10 +28,12 @@
 #include <libdevcore/CommonIO.h>
 #include <libdevcore/Assertions.h>
 #include <libdevcore/TrieHash.h>
+#include <libdevcore/Metrics.h>
 #include <libevmcore/Instruction.h>
 #include <libethcore/Exceptions.h>
 #include <libethcore/SealEngine.h>
 #include <libevm/VMFactory.h>
+#include <UTXO/UTXOIndex.h>
 #include <UTXO/UTXOSharedData.h>
 #include <UTXO/UTXOTxQueue.h>
 
@@ -185,7 +187,12 @@ PopulationStatistics Block::populateFromChain(BlockChain const& _bc, h256 const&
     auto b = _bc.block(_h);
     BlockHeader bi(b);      // No need to check - it's already in the DB.
 
-    if (bi.number())
+    if (bi.number() && !_bc.isKnown(bi.parentHash()))
+    {
+        // Snapshot the chain starts at: its state was downloaded, there is no parent to enact it on.
+        sync(_bc, _h, bi);
+    }
+    else if (bi.number())
     {
         // Non-genesis:
 
@@ -345,12 +352,13 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
     unsigned goodTxs = 0;
     std::map<h256, bool> parallelUTXOTx;
     size_t parallelUTXOTxCnt = 0;
+    std::map<h256, unsigned> utxoPartitions;
 
     if (lh.empty()) { lh = _bc.lastHashes(); }
     m_utxoMgr.setCurBlockInfo(this, lh);
     if (_exec)
     {
-        getParallelUTXOTx(ts, parallelUTXOTx, parallelUTXOTxCnt);
+        getParallelUTXOTx(ts, parallelUTXOTx, parallelUTXOTxCnt, utxoPartitions);
         m_state.setParallelUTXOTx(parallelUTXOTx);
         LOG(TRACE) << "Block::sync parallelUTXOTxCnt:" << parallelUTXOTxCnt;
     }
@@ -389,7 +397,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                             lh = _bc.lastHashes();
                         if (parallelUTXOTx[t.sha3()])
                         {
-                            utxoTxQueue.enqueue(t);
+                            utxoTxQueue.enqueue(t, utxoPartitions[t.sha3()]);
                         }
                         execute(lh, t, Permanence::Committed, OnOpFunc(), &_bc);
                         ret.first.push_back(m_receipts.back());
@@ -513,11 +521,12 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
 
     std::map<h256, bool> parallelUTXOTx;
     size_t parallelUTXOTxCnt = 0;
-    getParallelUTXOTx(m_transactions, parallelUTXOTx, parallelUTXOTxCnt);
+    std::map<h256, unsigned> utxoPartitions;
+    getParallelUTXOTx(m_transactions, parallelUTXOTx, parallelUTXOTxCnt, utxoPartitions);
 
     if (parallelUTXOTxCnt > 0)
     {
-        return execUTXOInBlock(_bc, _tq, lh, parallelUTXOTx, parallelUTXOTxCnt);
+        return execUTXOInBlock(_bc, _tq, lh, parallelUTXOTx, parallelUTXOTxCnt, utxoPartitions);
     }
 
     unsigned i = 0;
@@ -570,7 +579,7 @@ void Block::StartWaitingForResult(size_t parallelUTXOTxCnt)
     }
 }
 
-TransactionReceipts Block::execUTXOInBlock(BlockChain const& _bc, TransactionQueue& _tq, const LastHashes& lh, std::map<h256, bool>& parallelUTXOTx, size_t parallelUTXOTxCnt)
+TransactionReceipts Block::execUTXOInBlock(BlockChain const& _bc, TransactionQueue& _tq, const LastHashes& lh, std::map<h256, bool>& parallelUTXOTx, size_t parallelUTXOTxCnt, std::map<h256, unsigned>& partitions)
 {
     // TRANSACTIONS
     TransactionReceipts ret;
@@ -590,7 +599,7 @@ TransactionReceipts Block::execUTXOInBlock(BlockChain const& _bc, TransactionQue
             LOG(TRACE) << "Block::exec transaction: " << tr.randomid() << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
             if (parallelUTXOTx[tr.sha3()])
             {
-                utxoTxQueue.enqueue(tr);
+                utxoTxQueue.enqueue(tr, partitions[tr.sha3()]);
             }
             execute(lh, tr, Permanence::OnlyReceipt, OnOpFunc(), &_bc);
         }
@@ -685,6 +694,8 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
     noteChain(_bc);
 
     DEV_TIMED_FUNCTION_ABOVE(500);
+    static auto& enactTime = metrics::histogram("block_enact_duration_us", "Time spent executing the transactions of an imported block, in microseconds");
+    metrics::ScopedTimer timer(enactTime);
 
     // m_currentBlock is assumed to be prepopulated and reset.
 #if !ETH_RELEASE
@@ -714,7 +725,8 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
     
     std::map<h256, bool> parallelUTXOTx;
     size_t parallelUTXOTxCnt = 0;
-    getParallelUTXOTx(_block.transactions, parallelUTXOTx, parallelUTXOTxCnt);
+    std::map<h256, unsigned> utxoPartitions;
+    getParallelUTXOTx(_block.transactions, parallelUTXOTx, parallelUTXOTxCnt, utxoPartitions);
     if (parallelUTXOTxCnt > 0)
     {
         m_state.setParallelUTXOTx(parallelUTXOTx);
@@ -731,7 +743,7 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc, bool _f
                 LOG(TRACE) << "Enacting transaction: " << tr.randomid() << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
                 if (parallelUTXOTx[tr.sha3()])
                 {
-                    utxoTxQueue.enqueue(tr);
+                    utxoTxQueue.enqueue(tr, utxoPartitions[tr.sha3()]);
                 }
                 // 区分从enactOn和populateFromChain
                 execute(lh, tr, Permanence::Committed, OnOpFunc(), (_filtercheck ? (&_bc) : nullptr));
@@ -1074,8 +1086,10 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
     BytesMap transactionsMap;
     BytesMap receiptsMap;
 
-    RLPStream txs;
-    txs.appendList(m_transactions.size());
+    // encoded first, so the list is written at its final size in one buffer
+    std::vector<bytes> txrlps;
+    txrlps.reserve(m_transactions.size());
+    size_t txsSize = 0;
 
     for (unsigned i = 0; i < m_transactions.size(); ++i)
     {
@@ -1092,7 +1106,8 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
         m_transactions[i].streamRLP(txrlp);
         transactionsMap.insert(std::make_pair(k.out(), txrlp.out()));
 
-        txs.appendRaw(txrlp.out());
+        txsSize += txrlp.out().size();
+        txrlps.push_back(txrlp.invalidate());
 
 //#if ETH_PARANOIA
         /*      if (fromPending(i).transactionsFrom(m_transactions[i].from()) != m_transactions[i].nonce())
@@ -1102,6 +1117,11 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
 //#endif
     }
 
+    RLPStream txs;
+    txs.reserve(txsSize + 9);
+    txs.appendList(txrlps.size(), txsSize);
+    for (auto const& t: txrlps)
+        txs.appendRaw(t);
     txs.swapOut(m_currentTxs);
 
     RLPStream(unclesCount).appendRaw(unclesData.out(), unclesCount).swapOut(m_currentUncles);
@@ -1218,7 +1238,9 @@ bool Block::sealBlock(bytesConstRef _header, bytes & _out)
 
     // Compile block:
     RLPStream ret;
-    ret.appendList(5);
+    size_t blockSize = _header.size() + m_currentTxs.size() + m_currentUncles.size() + 34;
+    ret.reserve(blockSize + 9);
+    ret.appendList(5, blockSize);
     ret.appendRaw(_header);
     ret.appendRaw(m_currentTxs);
     ret.appendRaw(m_currentUncles);
@@ -1349,7 +1371,7 @@ string Block::vmTrace(bytesConstRef _block, BlockChain const& _bc, ImportRequire
     return ret.empty() ? "[]" : (ret + "]");
 }
 
-void Block::getParallelUTXOTx(const Transactions& transactions, std::map<h256, bool>& ret, size_t& cnt)
+void Block::getParallelUTXOTx(const Transactions& transactions, std::map<h256, bool>& ret, size_t& cnt, std::map<h256, unsigned>& partitions)
 {
     std::vector<bool> artificialTx;
     isArtificialTx(transactions, artificialTx);
@@ -1360,6 +1382,53 @@ void Block::getParallelUTXOTx(const Transactions& transactions, std::map<h256, b
         ret[tr.sha3()] = temp;
         if (temp) { cnt++; }
     }
+    if (cnt > 0)
+    {
+        partitionUTXOTx(transactions, ret, partitions);
+    }
+}
+
+void Block::partitionUTXOTx(const Transactions& txList, std::map<h256, bool>& parallel, std::map<h256, unsigned>& partitions)
+{
+    // Union-find over the parallel transactions, joined by the tokens they create and consume.
+    // Two of them never consume the same token here, isArtificialTx keeps those serial.
+    std::vector<unsigned> parent(txList.size());
+    for (unsigned i = 0; i < parent.size(); i++)
+        parent[i] = i;
+    auto root = [&](unsigned i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    std::unordered_map<UTXOModel::TokenID, unsigned, UTXOModel::TokenID::hash> tokenTx;
+    auto join = [&](UTXOModel::TokenID const& id, unsigned txIdx) {
+        auto it = tokenTx.find(id);
+        if (it == tokenTx.end())
+            tokenTx.insert(std::make_pair(id, txIdx));
+        else
+            parent[root(txIdx)] = root(it->second);
+    };
+    for (unsigned txIdx = 0; txIdx < txList.size(); txIdx++)
+    {
+        const Transaction& tr = txList[txIdx];
+        if (!parallel[tr.sha3()])
+            continue;
+        for (const UTXOModel::UTXOTxIn& in : tr.getUTXOTxIn())
+        {
+            UTXOModel::TokenID id;
+            // A key that doesn't convert can't name a token created in this block
+            if (UTXOModel::toTokenID(in.tokenKey, id))
+                join(id, txIdx);
+        }
+        size_t outCnt = tr.getUTXOTxOut().size();
+        for (unsigned outIdx = 0; outIdx < outCnt; outIdx++)
+            join(UTXOModel::toTokenID(tr.sha3(), outIdx), txIdx);
+    }
+
+    for (unsigned txIdx = 0; txIdx < txList.size(); txIdx++)
+        if (parallel[txList[txIdx].sha3()])
+            partitions[txList[txIdx].sha3()] = root(txIdx);
 }
 
 void Block::isArtificialTx(const Transactions& txList, std::vector<bool>& flag)
@@ -73,6 +73,7 @@ class Block
 	friend class dev::test::StateLoader;
 	friend class Executive;
 	friend class BlockChain;
+	friend class CallSnapshot;
 
 public:
 	// TODO: pass in ChainOperationParams rather than u256
@@ -287,8 +288,8 @@ public:
 	void setEvmEventLog(bool _el) { m_evmEventLog = _el;}
 	void setEvmCoverLog(bool _cl) { m_evmCoverLog = _cl;}
 
-	bool evmEventLog() { return m_evmEventLog;}
-	bool evmCoverLog() { return m_evmCoverLog;}
+	bool evmEventLog() const { return m_evmEventLog;}
+	bool evmCoverLog() const { return m_evmCoverLog;}
 
 	void resetCurrentTime(u256 const& _timestamp = u256(utcTime()));
 	void setIndex(u256 _idx);
@@ -296,6 +297,13 @@ public:
 
 	void clearCurrentBytes();
 
+	// Obtaining UTXO transactions that can be processed parallelly, and the partition each of them runs in.
+	static void getParallelUTXOTx(const Transactions& transactions, std::map<h256, bool>& ret, size_t &cnt, std::map<h256, unsigned>& partitions);
+	// Determines whether a transaction uses a token that has already been used.
+	static void isArtificialTx(const Transactions& txList, std::vector<bool>& flag);
+	// Groups parallel transactions that consume a token another one of them creates, so they run in block order.
+	static void partitionUTXOTx(const Transactions& txList, std::map<h256, bool>& parallel, std::map<h256, unsigned>& partitions);
+
 private:
 	SealEngineFace* sealEngine() const;
 
@@ -327,12 +335,8 @@ private:
 	/// Provide a standard VM trace for debugging purposes.
 	std::string vmTrace(bytesConstRef _block, BlockChain const& _bc, ImportRequirements::value _ir);
 
-	// Obtaining UTXO transactions that can be processed parallelly.
-	void getParallelUTXOTx(const Transactions& transactions, std::map<h256, bool>& ret, size_t &cnt);
-	// Determines whether a transaction uses a token that has already been used.
-	void isArtificialTx(const Transactions& txList, std::vector<bool>& flag);
 	// The logic of parallel transactions
-	TransactionReceipts execUTXOInBlock(BlockChain const& _bc, TransactionQueue& _tq, const LastHashes& lh, std::map<h256, bool>& parallelUTXOTx, size_t parallelUTXOTxCnt);
+	TransactionReceipts execUTXOInBlock(BlockChain const& _bc, TransactionQueue& _tq, const LastHashes& lh, std::map<h256, bool>& parallelUTXOTx, size_t parallelUTXOTxCnt, std::map<h256, unsigned>& partitions);
 
 	// Operations for parallel transactions-begin
 	void onUTXOTxQueueReady();									// Notification of completion of parallel transactions.
@@ -353,6 +353,18 @@ unsigned BlockChain::open(std::string const& _path, WithExisting _we)
 	m_lastBlockHash = l.empty() ? m_genesisHash : *(h256*)l.data();
 	m_lastBlockNumber = number(m_lastBlockHash);
 
+	std::string a;
+	m_extrasDB->Get(m_readOptions, ldb::Slice("snapshot"), &a);
+	if (dev::getCryptoMod() != CRYPTO_DEFAULT && !a.empty())
+	{
+		bytes deData = decryptodata(a);
+		a = asString(deData);
+	}
+	m_snapshotNumber = a.empty() ? 0 : RLP(a)[0].toInt<unsigned>();
+	m_snapshotAncestors = a.empty() ? h256s() : RLP(a)[1].toVector<h256>();
+
+	openLogIndex();
+
 	LOG(TRACE) << "Opened blockchain DB. Latest: " << currentHash() << (lastMinor == c_minorProtocolVersion ? "(rebuild not needed)" : "*** REBUILD NEEDED ***");
 	return lastMinor;
 }
@@ -361,6 +373,20 @@ void BlockChain::open(std::string const& _path, WithExisting _we, ProgressCallba
 {
 	if (open(_path, _we) != c_minorProtocolVersion || _we == WithExisting::Verify)
 		rebuild(_path, _pc);
+	if (m_logIndex && m_params.otherParams.count("rebuildLogIndex"))
+		m_logIndex->rebuild(m_lastBlockNumber, [&](unsigned n) { return receipts(numberHash(n)).receipts; }, _pc);
+}
+
+void BlockChain::openLogIndex()
+{
+	m_logIndex.reset();
+	if (!m_params.logIndex)
+		return;
+	std::function<string(string const&)> decrypt;
+	if (dev::getCryptoMod() != CRYPTO_DEFAULT)
+		decrypt = [this](string const& _s) { return asString(decryptodata(_s)); };
+	m_logIndex.reset(new LogIndex(m_extrasDB, decrypt));
+	m_logIndex->open(m_lastBlockNumber);
 }
 
 void BlockChain::reopen(ChainParams const& _p, WithExisting _we, ProgressCallback const& _pc)
@@ -374,6 +400,7 @@ void BlockChain::close()
 {
 	LOG(TRACE) << "Closing blockchain DB";
 	// Not thread safe...
+	m_logIndex.reset();
 	delete m_extrasDB;
 	delete m_blocksDB;
 	m_lastBlockHash = m_genesisHash;
@@ -388,6 +415,8 @@ void BlockChain::close()
 	m_cacheUsage.clear();
 	m_inUse.clear();
 	m_lastLastHashes.clear();
+	m_snapshotAncestors.clear();
+	m_snapshotNumber = 0;
 }
 
 void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned, unsigned)> const& _progress)
@@ -435,6 +464,7 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 	m_lastLastHashes.clear();
 	m_lastBlockHash = genesisHash();
 	m_lastBlockNumber = 0;
+	openLogIndex();
 
 	m_details[m_lastBlockHash].totalDifficulty = s.info().difficulty();
 
@@ -508,7 +538,16 @@ LastHashes BlockChain::lastHashes(h256 const& _parent) const
 		m_lastLastHashes.resize(256);
 		m_lastLastHashes[0] = _parent;
 		for (unsigned i = 0; i < 255; ++i)
+		{
+			if (!m_snapshotAncestors.empty() && m_lastLastHashes[i] == m_snapshotAncestors.front())
+			{
+				// the blocks before the snapshot the chain starts at aren't in the database
+				for (unsigned j = 1; i + j < 256; ++j)
+					m_lastLastHashes[i + j] = j < m_snapshotAncestors.size() ? m_snapshotAncestors[j] : h256();
+				break;
+			}
 			m_lastLastHashes[i + 1] = m_lastLastHashes[i] ? info(m_lastLastHashes[i]).parentHash() : h256();
+		}
 	}
 	return m_lastLastHashes;
 }
@@ -801,6 +840,75 @@ void BlockChain::insert(VerifiedBlockRef _block, bytesConstRef _receipts, bool _
 	}
 }
 
+void BlockChain::insertSnapshot(bytes const& _block, u256 const& _totalDifficulty, h256s const& _ancestors)
+{
+	BlockHeader header(_block);
+	h256 hash = header.hash();
+	unsigned number = static_cast<unsigned>(header.number());
+
+	BatchEncrypto blocksBatch;
+	BatchEncrypto extrasBatch;
+
+	blocksBatch.Put(toSlice(hash), (ldb::Slice)dev::ref(_block));
+
+	BlockDetails bd(number, _totalDifficulty, header.parentHash(), {});
+	extrasBatch.Put(toSlice(hash, ExtraDetails), (ldb::Slice)dev::ref(bd.rlp()));
+	extrasBatch.Put(toSlice(h256(header.number()), ExtraBlockHash), (ldb::Slice)dev::ref(BlockHash(hash).rlp()));
+
+	// no transaction addresses: the snapshot carries no receipts for them to point at
+
+	ldb::Status o = m_blocksDB->Write(m_writeOptions, &blocksBatch);
+	if (o.ok())
+		o = m_extrasDB->Write(m_writeOptions, &extrasBatch);
+	if (!o.ok())
+	{
+		LOG(ERROR) << "Error writing snapshot block to the database: " << o.ToString();
+		LOG(ERROR) << "Fail writing to blockchain database. Bombing out.";
+		exit(-1);
+	}
+
+	RLPStream ancestors(2);
+	ancestors << number;
+	ancestors.appendVector(_ancestors);
+	DEV_WRITE_GUARDED(x_lastBlockHash)
+	{
+		m_lastBlockHash = hash;
+		m_lastBlockNumber = number;
+
+		if (dev::getCryptoMod() != CRYPTO_DEFAULT)
+		{
+			bytes enData = encryptodata(ancestors.out());
+			o = m_extrasDB->Put(m_writeOptions, ldb::Slice("snapshot"), (ldb::Slice)dev::ref(enData));
+			enData = encryptodata(ldb::Slice((const char*)m_lastBlockHash.data(), 32));
+			if (o.ok())
+				o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), (ldb::Slice)dev::ref(enData));
+		}
+		else
+		{
+			o = m_extrasDB->Put(m_writeOptions, ldb::Slice("snapshot"), (ldb::Slice)dev::ref(ancestors.out()));
+			if (o.ok())
+				o = m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&m_lastBlockHash, 32));
+		}
+
+		if (!o.ok())
+		{
+			LOG(ERROR) << "Error writing to extras database: " << o.ToString();
+			LOG(ERROR) << "Fail writing to extras database. Bombing out.";
+			exit(-1);
+		}
+	}
+
+	{
+		Guard l(x_lastLastHashes);
+		m_snapshotAncestors = _ancestors;
+		m_lastLastHashes.clear();
+	}
+	m_snapshotNumber = number;
+	m_pnoncecheck->updateCache(*this, true);
+
+	LOG(INFO) << "Chain starts over at snapshot #" << number << " " << hash << ", TD:" << _totalDifficulty;
+}
+
 void BlockChain::checkBlockValid(h256 const& _hash, bytes const& _block, Block & _outBlock) const {
 	VerifiedBlockRef block = verifyBlock(&_block, m_onBad, ImportRequirements::Everything);
 
@@ -1171,17 +1279,27 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 				RLP blockRLP(*i == _block.info.hash() ? _block.block : & (blockBytes = block(*i)));
 				TransactionAddress ta;
 				ta.blockHash = tbi.hash();
-				for (ta.index = 0; ta.index < blockRLP[1].itemCount(); ++ta.index)
-					extrasBatch.Put(toSlice(sha3(blockRLP[1][ta.index].data()), ExtraTransactionAddress), (ldb::Slice)dev::ref(ta.rlp()));
+				// one walk over the transactions; indexing a fresh blockRLP[1] each time rescans the list
+				ta.index = 0;
+				for (auto const& tx : blockRLP[1])
+				{
+					extrasBatch.Put(toSlice(sha3(tx.data()), ExtraTransactionAddress), (ldb::Slice)dev::ref(ta.rlp()));
+					++ta.index;
+				}
 				
 			}
 
+			if (m_logIndex)
+				m_logIndex->add((unsigned)tbi.number(), *i == _block.info.hash() ? br.receipts : receipts(*i).receipts);
+
 			// Update database with them.
 			ReadGuard l1(x_blocksBlooms);
 			for (auto const& h : alteredBlooms)
 				extrasBatch.Put(toSlice(h, ExtraBlocksBlooms), (ldb::Slice)dev::ref(m_blocksBlooms[h].rlp()));
 			extrasBatch.Put(toSlice(h256(tbi.number()), ExtraBlockHash), (ldb::Slice)dev::ref(BlockHash(tbi.hash()).rlp()));
 		}
+		if (m_logIndex)
+			m_logIndex->commit((unsigned)_block.info.number(), extrasBatch);
 
 		// FINALLY! change our best hash.
 		{
@@ -1244,8 +1362,6 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 	}
 #endif // ETH_PARANOIA
 
-	m_pnoncecheck->delCache(goodTransactions);
-
 	if (m_lastBlockHash != newLastBlockHash)
 
 	{
@@ -1273,7 +1389,10 @@ ImportRoute BlockChain::import(VerifiedBlockRef const& _block, OverlayDB const&
 		}
 
 
-		m_pnoncecheck->updateCache(*this, isunclechain); 
+		if (isunclechain)
+			m_pnoncecheck->updateCache(*this, true);
+		else
+			m_pnoncecheck->addBlock(newLastBlockNumber, goodTransactions);
 		
 		//this->updateSystemContract(goodTransactions);
 		this->updateSystemContract(tempBlock);
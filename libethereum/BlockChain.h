@@ -42,6 +42,7 @@
 #include "State.h"
 #include <libethereum/NonceCheck.h>
 #include "Interface.h"
+#include "LogIndex.h"
 #include <libdevcrypto/AES.h>
 #include <libdevcore/FileSystem.h>
 
@@ -96,7 +97,8 @@ enum {
 	ExtraTransactionAddress,
 	ExtraLogBlooms,
 	ExtraReceipts,
-	ExtraBlocksBlooms
+	ExtraBlocksBlooms,
+	ExtraLogIndex
 };
 
 using ProgressCallback = std::function<void(unsigned, unsigned)>;
@@ -147,6 +149,13 @@ public:
 	void insert(bytes const& _block, bytesConstRef _receipts, bool _mustBeNew = true);
 	void insert(VerifiedBlockRef _block, bytesConstRef _receipts, bool _mustBeNew = true);
 
+	/// Make @a _block the head of the chain without executing it, its post-state having been downloaded
+	/// into the state DB. The blocks before it stay unknown; @a _ancestors are their hashes, parent first,
+	/// which lastHashes() continues with.
+	void insertSnapshot(bytes const& _block, u256 const& _totalDifficulty, h256s const& _ancestors);
+	/// The snapshot the chain starts at, 0 if it starts at genesis.
+	unsigned snapshotNumber() const { return m_snapshotNumber; }
+
 	/// Returns true if the given block is known (though not necessarily a part of the canon chain).
 	bool isKnown(h256 const& _hash, bool _isCurrent = true) const;
 
@@ -216,6 +225,9 @@ public:
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest) const;
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest, unsigned _topLevel, unsigned _index) const;
 
+	/// @returns the address and topic index of the logs, or nullptr unless enabled by the logindex option.
+	LogIndex const* logIndex() const { return m_logIndex.get(); }
+
 	/// Returns true if transaction is known. Thread-safe
 	bool isKnownTransaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); return !!ta; }
 
@@ -405,6 +417,9 @@ private:
 	void clearCachesDuringChainReversion(unsigned _firstInvalid);
 	void clearBlockBlooms(unsigned _begin, unsigned _end);
 
+	/// (Re)creates m_logIndex over the current m_extrasDB if the logindex option is on.
+	void openLogIndex();
+
 	/// The caches of the disk DB and their locks.
 	mutable SharedMutex x_blocks;
 	mutable BlocksHash m_blocks;
@@ -432,6 +447,8 @@ private:
 	void noteCanonChanged() const { Guard l(x_lastLastHashes); m_lastLastHashes.clear(); }
 	mutable Mutex x_lastLastHashes;
 	mutable LastHashes m_lastLastHashes;
+	h256s m_snapshotAncestors;	///< Hashes before the snapshot the chain starts at, parent first; empty if it starts at genesis.
+	unsigned m_snapshotNumber = 0;
 
 	void updateStats() const;
 	mutable Statistics m_lastStats;
@@ -439,6 +456,8 @@ private:
 	/// The disk DBs. Thread-safe, so no need for locks.
 	ldb::DB* m_blocksDB;
 	ldb::DB* m_extrasDB;
+	/// Secondary index of m_extrasDB, null when disabled.
+	std::unique_ptr<LogIndex> m_logIndex;
 
 	/// Hash of the last (valid) block on the longest chain.
 	mutable boost::shared_mutex x_lastBlockHash;
@@ -0,0 +1,183 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: CallPool.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "CallPool.h"
+
+#include <libdevcore/Metrics.h>
+#include "Executive.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+CallPool::CallPool(u256 const& _accountStartNonce, unsigned _snapshots, unsigned _concurrency):
+	m_accountStartNonce(_accountStartNonce),
+	m_snapshots(_snapshots),
+	m_concurrency(max(1u, _concurrency))
+{
+}
+
+void CallPool::reset(OverlayDB const& _db)
+{
+	DEV_WRITE_GUARDED(x_snapshots)
+	{
+		m_snapshotCache.clear();
+		m_snapshotOrder.clear();
+	}
+
+	vector<unique_ptr<Executor>> idle;
+	{
+		Guard l(x_executors);
+		m_db = _db;
+		++m_generation;
+		idle.swap(m_idle);
+	}
+}
+
+CallPool::SnapshotPtr CallPool::snapshot(h256 const& _hash, bool _next, function<Snapshot()> const& _make)
+{
+	static auto& hits = metrics::counter("eth_call_snapshot_lookups_total", "eth_call state snapshots found cached or made", {{"result", "hit"}});
+	static auto& misses = metrics::counter("eth_call_snapshot_lookups_total", "eth_call state snapshots found cached or made", {{"result", "miss"}});
+
+	auto key = make_pair(_hash, _next);
+	DEV_READ_GUARDED(x_snapshots)
+	{
+		auto it = m_snapshotCache.find(key);
+		if (it != m_snapshotCache.end())
+		{
+			hits.inc();
+			return it->second;
+		}
+	}
+
+	misses.inc();
+	SnapshotPtr ret = make_shared<Snapshot const>(_make());
+	DEV_WRITE_GUARDED(x_snapshots)
+	{
+		auto it = m_snapshotCache.find(key);
+		if (it != m_snapshotCache.end())
+			return it->second;
+
+		m_snapshotCache[key] = ret;
+		m_snapshotOrder.push_back(key);
+		while (m_snapshotOrder.size() > m_snapshots)
+		{
+			m_snapshotCache.erase(m_snapshotOrder.front());
+			m_snapshotOrder.pop_front();
+		}
+	}
+	return ret;
+}
+
+ExecutionResult CallPool::execute(SnapshotPtr const& _s, SealEngineFace const& _sealEngine, Transaction const& _t, u256 const& _endowment)
+{
+	static auto& waits = metrics::histogram("eth_call_wait_us", "Time eth_call waited for an executor, in microseconds");
+
+	unique_ptr<Executor> e;
+	{
+		metrics::ScopedTimer timer(waits);
+		e = acquire(_s);
+	}
+
+	ExecutionResult ret;
+	size_t savepoint = 0;
+	try
+	{
+		if (e->snapshot != _s || e->calls >= c_maxExecutorCalls)
+		{
+			e->snapshot.reset();
+			e->state.setRoot(_s->stateRoot);
+			e->snapshot = _s;
+			e->calls = 0;
+		}
+		++e->calls;
+
+		savepoint = e->state.savepoint();
+		if (_endowment)
+			e->state.addBalance(_t.sender(), _endowment);
+
+		Executive ex(e->state, _s->envInfo, _sealEngine);
+		ex.setResultRecipient(ret);
+		ex.initialize(_t);
+		if (!ex.execute())
+			ex.go();
+		ex.finalize();
+
+		e->state.rollback(savepoint);
+		if (ex.suicided())
+			e->snapshot.reset();
+	}
+	catch (...)
+	{
+		// undo the call's changes before the executor goes back to the pool, and reload the
+		// snapshot on the next call in case the failure left the cache inconsistent
+		try
+		{
+			e->state.rollback(savepoint);
+		}
+		catch (...)
+		{
+		}
+		e->snapshot.reset();
+		release(move(e));
+		throw;
+	}
+	release(move(e));
+	return ret;
+}
+
+unique_ptr<CallPool::Executor> CallPool::acquire(SnapshotPtr const& _s)
+{
+	unique_lock<Mutex> l(x_executors);
+	m_executorFreed.wait(l, [&]() { return m_busy < m_concurrency; });
+	++m_busy;
+
+	// prefer an executor whose cache is already on this snapshot, then the most recently used one
+	for (auto it = m_idle.rbegin(); it != m_idle.rend(); ++it)
+		if ((*it)->snapshot == _s)
+		{
+			unique_ptr<Executor> ret = move(*it);
+			m_idle.erase(next(it).base());
+			return ret;
+		}
+	if (!m_idle.empty())
+	{
+		unique_ptr<Executor> ret = move(m_idle.back());
+		m_idle.pop_back();
+		return ret;
+	}
+
+	unique_ptr<Executor> ret(new Executor(m_accountStartNonce, m_db));
+	ret->generation = m_generation;
+	return ret;
+}
+
+void CallPool::release(unique_ptr<Executor> _e)
+{
+	{
+		Guard l(x_executors);
+		--m_busy;
+		if (_e->generation == m_generation)
+			m_idle.push_back(move(_e));
+	}
+	m_executorFreed.notify_one();
+}
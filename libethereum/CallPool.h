@@ -0,0 +1,119 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: CallPool.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/OverlayDB.h>
+#include <libethcore/SealEngine.h>
+#include <libevm/ExtVMFace.h>
+#include "State.h"
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * Executes read-only calls on the committed post-states of the newest blocks.
+ *
+ * A snapshot is a state root plus the environment calls see; it is made once per block and
+ * never changes, so any number of calls can share it. Calls run on pooled executors: States
+ * that keep their account cache between calls and undo each call through the change log
+ * instead of clearing the cache. At most the configured number of calls execute at once,
+ * further callers wait for an executor; block import and sealing don't go through the pool.
+ */
+class CallPool
+{
+public:
+	struct Snapshot
+	{
+		h256 hash;			///< The block whose post-state this is.
+		bool next;			///< Calls run in the environment of the block on top of it, as on preSeal().
+		h256 stateRoot;
+		EnvInfo envInfo;
+
+		u256 gasLimitRemaining() const { return envInfo.gasLimit() - envInfo.gasUsed(); }
+	};
+	using SnapshotPtr = std::shared_ptr<Snapshot const>;
+
+	/// @param _snapshots how many snapshots to keep, 0 disables the pool.
+	/// @param _concurrency how many calls may execute at once.
+	CallPool(u256 const& _accountStartNonce, unsigned _snapshots, unsigned _concurrency);
+
+	/// Drops all snapshots and executors and opens further ones on @a _db.
+	void reset(OverlayDB const& _db);
+
+	bool enabled() const { return m_snapshots > 0; }
+	unsigned snapshots() const { return m_snapshots; }
+
+	/// @returns the snapshot of block @a _hash, made by @a _make if it isn't cached yet.
+	SnapshotPtr snapshot(h256 const& _hash, bool _next, std::function<Snapshot()> const& _make);
+
+	/// Executes @a _t on @a _s and reverts it, @a _endowment is added to the sender's balance first.
+	ExecutionResult execute(SnapshotPtr const& _s, SealEngineFace const& _sealEngine, Transaction const& _t, u256 const& _endowment);
+
+private:
+	/// Calls after which an executor's cache is dropped; the accounts rolled back in it stay dirty
+	/// and can't be evicted.
+	static const unsigned c_maxExecutorCalls = 10000;
+
+	struct Executor
+	{
+		Executor(u256 const& _accountStartNonce, OverlayDB const& _db): state(_accountStartNonce, _db) {}
+
+		State state;
+		SnapshotPtr snapshot;
+		unsigned calls = 0;
+		unsigned generation = 0;
+	};
+
+	std::unique_ptr<Executor> acquire(SnapshotPtr const& _s);
+	void release(std::unique_ptr<Executor> _e);
+
+	u256 m_accountStartNonce;
+	unsigned m_snapshots;
+	unsigned m_concurrency;
+
+	mutable SharedMutex x_snapshots;
+	std::map<std::pair<h256, bool>, SnapshotPtr> m_snapshotCache;
+	std::deque<std::pair<h256, bool>> m_snapshotOrder;	///< Oldest first.
+
+	Mutex x_executors;
+	std::condition_variable m_executorFreed;
+	OverlayDB m_db;
+	unsigned m_generation = 0;							///< Bumped by reset(); older executors are dropped.
+	unsigned m_busy = 0;
+	std::vector<std::unique_ptr<Executor>> m_idle;
+};
+
+}
+}
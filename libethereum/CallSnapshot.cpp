@@ -0,0 +1,59 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: CallSnapshot.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "CallSnapshot.h"
+
+#include <atomic>
+#include <memory>
+#include "Block.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+std::atomic<uint64_t> g_nextSnapshot{1};
+}
+
+CallSnapshot::CallSnapshot(Block const& _block):
+	m_id(g_nextSnapshot++),
+	m_state(_block.state()),
+	m_info(_block.info()),
+	m_gasUsed(_block.gasUsed()),
+	m_sealEngine(_block.sealEngine()),
+	m_evmCoverLog(_block.evmCoverLog()),
+	m_evmEventLog(_block.evmEventLog())
+{
+}
+
+ExecutionResult CallSnapshot::call(LastHashes const& _lh, Transaction const& _t) const
+{
+	thread_local uint64_t t_id = 0;
+	thread_local unique_ptr<State> t_state;
+	if (t_id != m_id)
+	{
+		t_state.reset(new State(m_state));
+		t_id = m_id;
+	}
+	return t_state->execute(EnvInfo(m_info, _lh, m_gasUsed, m_evmCoverLog, m_evmEventLog), *m_sealEngine, _t, Permanence::Reverted).first;
+}
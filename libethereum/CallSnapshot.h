@@ -0,0 +1,64 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: CallSnapshot.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <libethcore/BlockHeader.h>
+#include <libevm/ExtVMFace.h>
+#include "State.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class Block;
+
+/**
+ * The state a block ends in, taken once per block and shared by every thread that makes
+ * read-only contract calls on it, without holding a lock on the block. Calls run on a copy of
+ * the state kept per thread, made on the thread's first call into a new snapshot.
+ */
+class CallSnapshot
+{
+public:
+	explicit CallSnapshot(Block const& _block);
+
+	/// Executes @a _t on this thread's copy of the state and reverts it.
+	ExecutionResult call(LastHashes const& _lh, Transaction const& _t) const;
+
+	BlockHeader const& info() const { return m_info; }
+	u256 gasLimitRemaining() const { return m_info.gasLimit() - m_gasUsed; }
+	h256 storageRoot(Address const& _contract) const { return m_state.storageRoot(_contract); }
+
+private:
+	uint64_t m_id;			///< Tells the per-thread copies of successive snapshots apart.
+	State m_state;
+	BlockHeader m_info;
+	u256 m_gasUsed;
+	SealEngineFace* m_sealEngine;
+	bool m_evmCoverLog;
+	bool m_evmEventLog;
+};
+
+}
+}
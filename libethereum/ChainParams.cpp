@@ -106,18 +106,27 @@ ChainParams ChainParams::loadConfig(string const& _json, h256 const& ) const
 	cp.logFileConf = obj.count("logconf") ? obj["logconf"].get_str() : "/tmp/ethereum/data/";
 	cp.rateLimitConfig = obj.count("limitconf") ? obj["limitconf"].get_str() : "";
 	cp.statsInterval = obj.count("statsInterval") ? std::stoi(obj["statsInterval"].get_str()) : 10;
+	cp.metricsPort = obj.count("metricsPort") ? std::stoi(obj["metricsPort"].get_str()) : 0;
 	
 	cp.vmKind = obj.count("vm") ? obj["vm"].get_str() : "interpreter";
 	cp.networkId = obj.count("networkid") ? std::stoi(obj["networkid"].get_str()) : (unsigned) - 1;
 	cp.logVerbosity = obj.count("logverbosity") ? std::stoi(obj["logverbosity"].get_str()) : 4;
 	cp.evmEventLog = obj.count("eventlog") ? ( (obj["eventlog"].get_str() == "ON") ? true : false) : false;
 	cp.evmCoverLog = obj.count("coverlog") ? ( (obj["coverlog"].get_str() == "ON") ? true : false) : false;
+	cp.logIndex = obj.count("logindex") ? ( (obj["logindex"].get_str() == "ON") ? true : false) : false;
+	cp.logsLimit = obj.count("logsLimit") ? std::stoi(obj["logsLimit"].get_str()) : 0;
+	cp.callSnapshots = obj.count("callSnapshots") ? std::stoi(obj["callSnapshots"].get_str()) : 4;
+	cp.callConcurrency = obj.count("callConcurrency") ? std::stoi(obj["callConcurrency"].get_str()) : 0;
+	cp.snapshotInterval = obj.count("snapshotInterval") ? std::stoi(obj["snapshotInterval"].get_str()) : 1000;
+	cp.snapshotSync = obj.count("snapshotSync") ? std::stoi(obj["snapshotSync"].get_str()) : 0;
 	//dfs related configure items
 	cp.nodeId = obj.count("dfsNode") ? obj["dfsNode"].get_str() : "";
 	cp.groupId = obj.count("dfsGroup") ? obj["dfsGroup"].get_str() : "";
 	cp.storagePath = obj.count("dfsStorage") ? obj["dfsStorage"].get_str() : "";
+	cp.dfsBlockSize = obj.count("dfsBlockSize") ? std::stoi(obj["dfsBlockSize"].get_str()) : 256;
 	cp.statLog = obj.count("statlog") ? ( (obj["statlog"].get_str() == "ON") ? true : false) : false;
 	cp.broadcastToNormalNode = obj.count("broadcastToNormalNode") ? ( (obj["broadcastToNormalNode"].get_str() == "ON") ? true : false) : false;
+	cp.compactPrepare = obj.count("compactPrepare") ? ( (obj["compactPrepare"].get_str() == "ON") ? true : false) : false;
 	// params
 	if( obj.count("params") )
 	{
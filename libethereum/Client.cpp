@@ -28,6 +28,7 @@
 
 #include <abi/ContractAbiMgr.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <libp2p/Host.h>
 #include <UTXO/UTXOSharedData.h>
 
@@ -40,6 +41,7 @@
 #include "SystemContractApi.h"
 #include "SystemContractApiFactory.h"
 #include "TransactionQueue.h"
+#include "TxTrace.h"
 #include "Utility.h"
 
 using namespace std;
@@ -69,6 +71,7 @@ Client::Client(
 	Worker("client", 0),
 	m_bc(std::shared_ptr<Interface>(this), _params, _dbPath, _forceAction, [](unsigned d, unsigned t) { LOG(ERROR) << "REVISING BLOCKCHAIN: Processed " << d << " of " << t << "...\r"; }),
      m_gp(_gpForAdoption ? _gpForAdoption : make_shared<TrivialGasPricer>()),
+     m_callPool(chainParams().accountStartNonce, chainParams().callSnapshots, chainParams().callConcurrency ? chainParams().callConcurrency : max(1u, thread::hardware_concurrency() / 2)),
      m_preSeal(chainParams().accountStartNonce),
      m_postSeal(chainParams().accountStartNonce),
      m_working(chainParams().accountStartNonce),
@@ -226,6 +229,7 @@ void Client::init(p2p::HostApi* _extNet, std::string const& _dbPath, WithExistin
 	// TODO: consider returning the upgrade mechanism here. will delaying the opening of the blockchain database
 	// until after the construction.
 	m_stateDB = State::openDB(_dbPath, bc().genesisHash(), _forceAction);
+	m_callPool.reset(m_stateDB);
 	// LAZY. TODO: move genesis state construction/commiting to stateDB openning and have this just take the root from the genesis block.
 	m_preSeal = bc().genesisBlock(m_stateDB);
 	m_postSeal = m_preSeal;
@@ -251,6 +255,9 @@ void Client::init(p2p::HostApi* _extNet, std::string const& _dbPath, WithExistin
 
 	auto host = _extNet->registerCapability(make_shared<EthereumHost>(bc(), m_stateDB, m_tq, m_bq, _networkId));
 	m_host = host;
+	host->setOnSnapshot([=](SnapshotManifest const& _manifest, vector<bytes> const& _chunks) {
+		executeInMainThread([=]() { installSnapshot(_manifest, _chunks); });
+	});
 	_extNet->addCapability(host, EthereumHost::staticName(), EthereumHost::c_oldProtocolVersion); //TODO: remove this once v61+ protocol is common
 
 	if (_dbPath.size())
@@ -395,6 +402,7 @@ void Client::reopenChain(ChainParams const& _p, WithExisting _we)
 		m_stateDB = OverlayDB();
 		bc().reopen(_p, _we);
 		m_stateDB = State::openDB(Defaults::dbPath(), bc().genesisHash(), _we);
+		m_callPool.reset(m_stateDB);
 
 		m_preSeal = bc().genesisBlock(m_stateDB);
 		m_preSeal.setAuthor(author);
@@ -413,6 +421,63 @@ void Client::reopenChain(ChainParams const& _p, WithExisting _we)
 		startSealing();
 }
 
+void Client::installSnapshot(SnapshotManifest const& _manifest, vector<bytes> const& _chunks)
+{
+	bool ok = false;
+	try
+	{
+		// the side DBs as of the snapshot, in place of whatever the blocks we had left there;
+		// written only once the chain is at the snapshot, so they never go with the old head
+		vector<leveldb::WriteBatch> batches((unsigned)SnapshotSideDB::Count);
+		for (unsigned i = 0; i < batches.size(); ++i)
+		{
+			unique_ptr<leveldb::Iterator> it(StateSnapshot::sideDB((SnapshotSideDB)i)->NewIterator(leveldb::ReadOptions()));
+			for (it->SeekToFirst(); it->Valid(); it->Next())
+				batches[i].Delete(it->key());
+		}
+		for (unsigned c = 0; c < _chunks.size(); ++c)
+			for (auto const& kv: RLP(_chunks[c]))
+				batches[(unsigned)_manifest.chunks[c].db].Put(kv[0].toString(), kv[1].toString());
+
+		m_bq.clear();
+		bc().insertSnapshot(_manifest.block, _manifest.totalDifficulty, _manifest.ancestors);
+		for (unsigned i = 0; i < batches.size(); ++i)
+		{
+			leveldb::Status s = StateSnapshot::sideDB((SnapshotSideDB)i)->Write(leveldb::WriteOptions(), &batches[i]);
+			if (!s.ok())
+			{
+				LOG(ERROR) << "Error writing snapshot side DB " << i << ": " << s.ToString();
+				LOG(ERROR) << "Fail writing to UTXO database. Bombing out.";
+				exit(-1);
+			}
+		}
+		startedWorking();
+		m_callPool.reset(m_stateDB);
+
+		shared_ptr<Block> head(new Block(0));
+		*head = block(bc().currentHash());
+		m_systemcontractapi->reloadSystemContract(head);
+		UTXOModel::UTXOSharedData::getInstance()->setPreBlockInfo(head, bc().lastHashes());
+		getUTXOMgr()->registerHistoryAccount();
+		updateConfig();
+		ok = true;
+	}
+	catch (...)
+	{
+		LOG(ERROR) << "Installing snapshot #" << _manifest.number << " failed: " << boost::current_exception_diagnostic_information();
+	}
+
+	onPostStateChanged();
+	if (auto h = m_host.lock())
+		h->onSnapshotInstalled(ok);
+}
+
+bool Client::replayWindowKnown() const
+{
+	unsigned snapshot = bc().snapshotNumber();
+	return !snapshot || bc().number() >= snapshot + (unsigned)NonceCheck::maxblocksize;
+}
+
 void Client::executeInMainThread(function<void ()> const& _function)
 {
 	DEV_WRITE_GUARDED(x_functionQueue)
@@ -457,46 +522,66 @@ static S& filtersStreamOut(S& _out, T const& _fs)
 
 void Client::appendFromNewPending(TransactionReceipt const& _receipt, h256Hash& io_changed, h256 _sha3)
 {
+	static auto& matchTime = metrics::histogram("watch_match_duration_us", "Time spent matching new logs against installed filters, in microseconds", {{"source", "pending"}});
+	metrics::ScopedTimer timer(matchTime);
+
 	Guard l(x_filtersWatches);
 	io_changed.insert(PendingChangedFilter);
 	m_specialFilters.at(PendingChangedFilter).push_back(_sha3);
-	for (pair<h256 const, InstalledFilter>& i : m_filters)
+	h256Hash candidates;
+	m_filterIndex.candidates(_receipt, candidates);
+	for (h256 const& id : candidates)
 	{
+		InstalledFilter& f = m_filters.at(id);
 		// acceptable number.
-		auto m = i.second.filter.matches(_receipt);
+		auto m = f.filter.matches(_receipt);
 		if (m.size())
 		{
 			// filter catches them
 			for (LogEntry const& l : m)
-				i.second.changes.push_back(LocalisedLogEntry(l));
-			io_changed.insert(i.first);
+				f.changes.push_back(LocalisedLogEntry(l));
+			io_changed.insert(id);
 		}
 	}
 }
 
 void Client::appendFromBlock(h256 const& _block, BlockPolarity _polarity, h256Hash& io_changed)
 {
-	// TODO: more precise check on whether the txs match.
+	static auto& matchTime = metrics::histogram("watch_match_duration_us", "Time spent matching new logs against installed filters, in microseconds", {{"source", "block"}});
+	metrics::ScopedTimer timer(matchTime);
+
 	auto receipts = bc().receipts(_block).receipts;
+	// the block is only loaded for the hashes of transactions some filter catches
+	bytes block;
+	vector<bytesConstRef> transactions;
+	BlockNumber number = 0;
 
 	Guard l(x_filtersWatches);
 	io_changed.insert(ChainChangedFilter);
 	m_specialFilters.at(ChainChangedFilter).push_back(_block);
-	for (pair<h256 const, InstalledFilter>& i : m_filters)
+	h256Hash candidates;
+	for (size_t j = 0; j < receipts.size(); j++)
 	{
-		// acceptable number & looks like block may contain a matching log entry.
-		for (size_t j = 0; j < receipts.size(); j++)
+		candidates.clear();
+		m_filterIndex.candidates(receipts[j], candidates);
+		for (h256 const& id : candidates)
 		{
-			auto tr = receipts[j];
-			auto m = i.second.filter.matches(tr);
-			if (m.size())
+			InstalledFilter& f = m_filters.at(id);
+			auto m = f.filter.matches(receipts[j]);
+			if (m.empty())
+				continue;
+			if (block.empty())
 			{
-				auto transactionHash = transaction(_block, j).sha3();
-				// filter catches them
-				for (LogEntry const& l : m)
-					i.second.changes.push_back(LocalisedLogEntry(l, _block, (BlockNumber)bc().number(_block), transactionHash, j, 0, _polarity));
-				io_changed.insert(i.first);
+				block = bc().block(_block);
+				for (auto const& t : RLP(block)[1])
+					transactions.push_back(t.data());
+				number = (BlockNumber)bc().number(_block);
 			}
+			h256 transactionHash = j < transactions.size() ? sha3(transactions[j]) : h256();
+			// filter catches them
+			for (LogEntry const& l : m)
+				f.changes.push_back(LocalisedLogEntry(l, _block, number, transactionHash, j, 0, _polarity));
+			io_changed.insert(id);
 		}
 	}
 }
@@ -526,6 +611,73 @@ ExecutionResult Client::call(Address _dest, bytes const& _data, u256 _gas, u256
 	return ret;
 }
 
+ExecutionResult Client::call(Address const& _from, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber, FudgeFactor _ff)
+{
+	CallPool::SnapshotPtr snapshot = callSnapshot(_blockNumber);
+	if (!snapshot)
+	{
+		static auto& blockCalls = metrics::histogram("eth_call_duration_us", "Time spent executing eth_call, in microseconds", {{"path", "block"}});
+		metrics::ScopedTimer timer(blockCalls);
+		return ClientBase::call(_from, _value, _dest, _data, _gas, _gasPrice, _blockNumber, _ff);
+	}
+
+	static auto& snapshotCalls = metrics::histogram("eth_call_duration_us", "Time spent executing eth_call, in microseconds", {{"path", "snapshot"}});
+	metrics::ScopedTimer timer(snapshotCalls);
+	try
+	{
+		// The nonce doesn't change what a call returns, so it isn't looked up in the state and the queue.
+		u256 gas = _gas == Invalid256 ? snapshot->gasLimitRemaining() : _gas;
+		u256 gasPrice = _gasPrice == Invalid256 ? gasBidPrice() : _gasPrice;
+		Transaction t(_value, gasPrice, gas, _dest, _data, 0);
+		t.forceSender(_from);
+
+		u256 check = bc().filterCheck(t, FilterCheckScene::CheckCall);
+		if ((u256)SystemContractCode::Ok != check)
+			BOOST_THROW_EXCEPTION(NoCallPermission());
+
+		u256 endowment = _ff == FudgeFactor::Lenient ? (u256)(t.gas() * t.gasPrice() + t.value()) : 0;
+		return m_callPool.execute(snapshot, *sealEngine(), t, endowment);
+	}
+	catch (...)
+	{
+		LOG(ERROR) << boost::current_exception_diagnostic_information() << "\n";
+		throw;
+	}
+}
+
+CallPool::SnapshotPtr Client::callSnapshot(BlockNumber _block)
+{
+	if (!m_callPool.enabled() || _block == PendingBlock)
+		return nullptr;
+
+	bool latest = _block == LatestBlock;
+	unsigned head = bc().number();
+	if (!latest && (_block > head || head - _block >= m_callPool.snapshots()))
+		return nullptr;
+
+	h256 hash = latest ? bc().currentHash() : bc().numberHash(_block);
+	return m_callPool.snapshot(hash, latest, [&]()
+	{
+		BlockHeader bi = bc().info(hash);
+		CallPool::Snapshot ret;
+		ret.hash = hash;
+		ret.next = latest;
+		ret.stateRoot = bi.stateRoot();
+		if (latest)
+		{
+			// what preSeal() holds after syncing to this block
+			BlockHeader current;
+			current.setAuthor(author());
+			current.setTimestamp(max(bi.timestamp() + 1, u256(utcTime())));
+			sealEngine()->populateFromParent(current, bi);
+			ret.envInfo = EnvInfo(current, bc().lastHashes(hash), 0, false, bc().chainParams().evmEventLog);
+		}
+		else
+			ret.envInfo = EnvInfo(bi, bc().lastHashes(), bi.gasUsed(), false, bc().chainParams().evmEventLog);
+		return ret;
+	});
+}
+
 unsigned static const c_syncMin = 1;
 unsigned static const c_syncMax = 1000;
 double static const c_targetDuration = 1;
@@ -708,6 +860,7 @@ void Client::onChainChanged(ImportRoute const& _ir)
 //	LOG(TRACE) << "onChainChanged()";
 	h256Hash changeds;
 	onDeadBlocks(_ir.deadBlocks, changeds);
+	TxTrace::instance().record(_ir.goodTranactions, TxStage::Committed);
 	for (auto const& t : _ir.goodTranactions)
 	{
 		LOG(TRACE) << "Safely dropping transaction " << t.sha3();
@@ -716,6 +869,7 @@ void Client::onChainChanged(ImportRoute const& _ir)
 	onNewBlocks(_ir.liveBlocks, changeds);
 	resyncStateFromChain();
 	noteChanged(changeds);
+	TxTrace::instance().record(_ir.goodTranactions, TxStage::Receipt);
 }
 
 bool Client::remoteActive() const
@@ -750,7 +904,7 @@ void Client::startSealing()
 void Client::rejigSealing()
 {
 
-	if ((wouldSeal() || remoteActive()) && !isMajorSyncing())
+	if ((wouldSeal() || remoteActive()) && !isMajorSyncing() && replayWindowKnown())
 	{
 		if (sealEngine()->shouldSeal(this))
 		{
@@ -794,12 +948,14 @@ void Client::rejigSealing()
 void Client::noteChanged(h256Hash const& _filters)
 {
 	Guard l(x_filtersWatches);
-	if (_filters.size())
-		filtersStreamOut(LOG(INFO) << "noteChanged:", _filters);
+	if (_filters.size() && logEnabled(el::Level::Info))
+		filtersStreamOut(LOG_STREAM(INFO) << "noteChanged:", _filters);
 	// accrue all changes left in each filter into the watches.
+	vector<unsigned> changedWatches;
 	for (auto& w : m_watches)
 		if (_filters.count(w.second.id))
 		{
+			size_t before = w.second.changes.size();
 			if (m_filters.count(w.second.id))
 			{
 				LOG(INFO) << "!!!" << w.first << w.second.id.abridged();
@@ -811,12 +967,20 @@ void Client::noteChanged(h256Hash const& _filters)
 					LOG(INFO) << "!!!" << w.first <<  (w.second.id == PendingChangedFilter ? "pending" : w.second.id == ChainChangedFilter ? "chain" : "???");
 					w.second.changes.push_back(LocalisedLogEntry(SpecialLogEntry, hash));
 				}
+			if (w.second.changes.size() > before)
+				changedWatches.push_back(w.first);
 		}
-	// clear the filters now.
-	for (auto& i : m_filters)
-		i.second.changes.clear();
+	// clear the filters now; only the changed ones hold any.
+	for (auto const& id : _filters)
+	{
+		auto it = m_filters.find(id);
+		if (it != m_filters.end())
+			it->second.changes.clear();
+	}
 	for (auto& i : m_specialFilters)
 		i.second.clear();
+	if (!changedWatches.empty())
+		m_onWatchesChanged(changedWatches);
 }
 
 void Client::doWork(bool _doWait)
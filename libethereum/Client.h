@@ -38,6 +38,7 @@
 #include <libp2p/Common.h>
 #include "BlockChain.h"
 #include "Block.h"
+#include "CallPool.h"
 #include "CommonNet.h"
 #include "ClientBase.h"
 #include "SystemContractApi.h"
@@ -49,6 +50,7 @@ namespace eth
 class Client;
 class DownloadMan;
 class SystemContractApi;
+struct SnapshotManifest;
 
 enum ClientWorkState
 {
@@ -100,6 +102,9 @@ public:
 	using Interface::call; // to remove warning about hiding virtual function
 	/// Makes the given call. Nothing is recorded into the state. This cheats by creating a null address and endowing it with a lot of ETH.
 	ExecutionResult call(Address _dest, bytes const& _data = bytes(), u256 _gas = 125000, u256 _value = 0, u256 _gasPrice = 1 * ether, Address const& _from = Address());
+	/// Makes the given call on a cached post-state snapshot when @a _blockNumber is the latest block or
+	/// one of the newest ones; see CallPool. Nothing is recorded into the state.
+	virtual ExecutionResult call(Address const& _from, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber, FudgeFactor _ff = FudgeFactor::Strict) override;
 
 	/// Get the remaining gas limit in this block.
 	virtual u256 gasLimitRemaining() const override { return m_postSeal.gasLimitRemaining(); }
@@ -309,13 +314,23 @@ protected:
 	/// Executes the pending functions in m_functionQueue
 	void callQueuedFunctions();
 
+	/// Makes the downloaded snapshot the head of the chain, with the side DBs it comes with.
+	void installSnapshot(SnapshotManifest const& _manifest, std::vector<bytes> const& _chunks);
+	/// Does NonceCheck know every transaction a new block could replay? Not for the first
+	/// maxblocksize blocks after the snapshot the chain starts at, whose transactions it never saw.
+	bool replayWindowKnown() const;
+
 	void updateConfig();
 
+	/// @returns the snapshot eth_call runs on for @a _block, null if it isn't one of the newest blocks.
+	CallPool::SnapshotPtr callSnapshot(BlockNumber _block);
+
 	BlockChain m_bc;						///< Maintains block database and owns the seal engine.
 	BlockQueue m_bq;						///< Maintains a list of incoming blocks not yet on the blockchain (to be imported).
 	std::shared_ptr<GasPricer> m_gp;		///< The gas pricer.
 
 	OverlayDB m_stateDB;					///< Acts as the central point for the state database, so multiple States can share it.
+	CallPool m_callPool;					///< Read-only calls on snapshots of the newest blocks' states.
 	mutable SharedMutex x_preSeal;			///< Lock on m_preSeal.
 	Block m_preSeal;						///< The present state of the client.
 	mutable SharedMutex x_postSeal;			///< Lock on m_postSeal.
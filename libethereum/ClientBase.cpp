@@ -22,6 +22,12 @@
 
 #include "ClientBase.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/thread.hpp>
 #include "BlockChain.h"
 #include "Executive.h"
 #include "State.h"
@@ -32,7 +38,101 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
+namespace
+{
+
+/// Threads that help ClientBase::logs() decode receipts, started once and shared by all calls.
+class LogScanPool
+{
+public:
+	explicit LogScanPool(unsigned _size): m_work(m_service), m_size(_size)
+	{
+		for (unsigned i = 0; i < _size; ++i)
+			m_workers.create_thread([this]() {
+				pthread_setThreadName("logscan");
+				m_service.run();
+			});
+	}
+
+	~LogScanPool()
+	{
+		m_service.stop();
+		m_workers.join_all();
+	}
+
+	unsigned size() const { return m_size; }
+
+	/// Run _scan on the calling thread and on up to _helpers pool threads, and return once every
+	/// thread that started on it is done. Helpers still queued behind other calls then do nothing.
+	/// The first exception thrown by any of them is rethrown.
+	void run(function<void()> const& _scan, unsigned _helpers)
+	{
+		struct Job
+		{
+			function<void()> const* scan;
+			std::mutex x_active;
+			condition_variable done;
+			unsigned active = 0;
+			bool closed = false;
+			exception_ptr error;
+		};
+		auto job = make_shared<Job>();
+		job->scan = &_scan;
+		for (unsigned i = 0; i < _helpers; ++i)
+			m_service.post([job]() {
+				{
+					lock_guard<std::mutex> l(job->x_active);
+					if (job->closed)
+						return;
+					++job->active;
+				}
+				exception_ptr error;
+				try
+				{
+					(*job->scan)();
+				}
+				catch (...)
+				{
+					error = current_exception();
+				}
+				lock_guard<std::mutex> l(job->x_active);
+				if (error && !job->error)
+					job->error = error;
+				if (!--job->active)
+					job->done.notify_all();
+			});
+		exception_ptr error;
+		try
+		{
+			_scan();
+		}
+		catch (...)
+		{
+			error = current_exception();
+		}
+		unique_lock<std::mutex> l(job->x_active);
+		job->closed = true;
+		job->done.wait(l, [&]() { return !job->active; });
+		if (!error)
+			error = job->error;
+		if (error)
+			rethrow_exception(error);
+	}
+
+private:
+	boost::asio::io_service m_service;
+	boost::asio::io_service::work m_work;
+	boost::thread_group m_workers;
+	unsigned m_size;
+};
+
+LogScanPool& logScanPool()
+{
+	static LogScanPool s_pool(min<unsigned>(max(thread::hardware_concurrency(), 1u), 8) - 1);
+	return s_pool;
+}
 
+}
 
 namespace dev { namespace eth { const u256 c_maxGasEstimate = 50000000; } }
 
@@ -269,6 +369,13 @@ LocalisedLogEntries ClientBase::logs(unsigned _watchId) const
 
 LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 {
+	unsigned next;
+	return logs(_f, numeric_limits<size_t>::max(), 0, next);
+}
+
+LocalisedLogEntries ClientBase::logs(LogFilter const& _f, size_t _max, unsigned _cursor, unsigned& o_next) const
+{
+	o_next = 0;
 	LocalisedLogEntries ret;
 	unsigned begin = min(bc().number() + 1, (unsigned)numberFromHash(_f.latest()));
 	unsigned end = min(bc().number(), min(begin, (unsigned)numberFromHash(_f.earliest())));
@@ -276,14 +383,17 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 	// Handle pending transactions differently as they're not on the block chain.
 	if (begin > bc().number())
 	{
-		Block temp = postSeal();
-		for (unsigned i = 0; i < temp.pending().size(); ++i)
+		if (!_cursor)
 		{
-			// Might have a transaction that contains a matching log.
-			TransactionReceipt const& tr = temp.receipt(i);
-			LogEntries le = _f.matches(tr);
-			for (unsigned j = 0; j < le.size(); ++j)
-				ret.insert(ret.begin(), LocalisedLogEntry(le[j]));
+			Block temp = postSeal();
+			for (unsigned i = 0; i < temp.pending().size(); ++i)
+			{
+				// Might have a transaction that contains a matching log.
+				TransactionReceipt const& tr = temp.receipt(i);
+				LogEntries le = _f.matches(tr);
+				for (unsigned j = 0; j < le.size(); ++j)
+					ret.push_back(LocalisedLogEntry(le[j]));
+			}
 		}
 		begin = bc().number();
 	}
@@ -295,8 +405,9 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 	unsigned ancestorIndex;
 	tie(blocks, ancestor, ancestorIndex) = bc().treeRoute(_f.earliest(), _f.latest(), false);
 
-	for (size_t i = 0; i < ancestorIndex; i++)
-		prependLogsFromBlock(_f, blocks[i], BlockPolarity::Dead, ret);
+	if (!_cursor)
+		for (size_t i = 0; i < ancestorIndex; i++)
+			appendLogsFromBlock(_f, blocks[i], BlockPolarity::Dead, ret);
 
 	// cause end is our earliest block, let's compare it with our ancestor
 	// if ancestor is smaller let's move our end to it
@@ -310,36 +421,83 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 	// will give us pair (2, 3)
 	// and we want to get all logs from 1 (ancestor + 1) to 3
 	// so we have to move 2a to g + 1
-	end = min(end, (unsigned)numberFromHash(ancestor) + 1);
+	end = max(min(end, (unsigned)numberFromHash(ancestor) + 1), _cursor);
+	if (end > begin)
+		return ret;
 
 	// Handle blocks from main chain
-	set<unsigned> matchingBlocks;
-	if (!_f.isRangeFilter())
+	vector<unsigned> matchingBlocks;
+	bool wholeRange = false;
+	if (bc().logIndex() && bc().logIndex()->candidates(_f, end, begin, matchingBlocks))
+	{
+		// the index already intersected the postings of the addresses and topics
+	}
+	else if (!_f.isRangeFilter())
+	{
 		for (auto const& i : _f.bloomPossibilities())
 			for (auto u : bc().withBlockBloom(i, end, begin))
-				matchingBlocks.insert(u);
+				matchingBlocks.push_back(u);
+		sort(matchingBlocks.begin(), matchingBlocks.end());
+		matchingBlocks.erase(unique(matchingBlocks.begin(), matchingBlocks.end()), matchingBlocks.end());
+	}
 	else
 		// if it is a range filter, we want to get all logs from all blocks in given range
-		for (unsigned i = end; i <= begin; i++)
-			matchingBlocks.insert(i);
+		wholeRange = true;
+
+	size_t const count = wholeRange ? begin - end + 1 : matchingBlocks.size();
+	auto blockAt = [&](size_t _k) { return wholeRange ? end + (unsigned)_k : matchingBlocks[_k]; };
 
-	for (auto n : matchingBlocks)
-		prependLogsFromBlock(_f, bc().numberHash(n), BlockPolarity::Live, ret);
+	// receipts are decoded on a few threads a window of blocks at a time, then appended in
+	// block order, so a page stops early without scanning the rest of the range
+	LogScanPool& pool = logScanPool();
+	size_t const window = (pool.size() + 1) * 32;
+	vector<LocalisedLogEntries> found;
+	for (size_t from = 0; from < count; from += window)
+	{
+		size_t const n = min(window, count - from);
+		found.assign(n, LocalisedLogEntries());
+		atomic<size_t> next(0);
+		pool.run([&]()
+		{
+			for (size_t i = next++; i < n; i = next++)
+				appendLogsFromBlock(_f, bc().numberHash(blockAt(from + i)), BlockPolarity::Live, found[i]);
+		}, (unsigned)min<size_t>(pool.size(), n - 1));
 
-	reverse(ret.begin(), ret.end());
+		for (size_t i = 0; i < n; ++i)
+		{
+			ret.insert(ret.end(), make_move_iterator(found[i].begin()), make_move_iterator(found[i].end()));
+			if (ret.size() >= _max && from + i + 1 < count)
+			{
+				o_next = blockAt(from + i + 1);
+				return ret;
+			}
+		}
+	}
 	return ret;
 }
 
-void ClientBase::prependLogsFromBlock(LogFilter const& _f, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const
+void ClientBase::appendLogsFromBlock(LogFilter const& _f, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const
 {
 	auto receipts = bc().receipts(_blockHash).receipts;
+	// the block is only loaded for the hashes of transactions with matching logs
+	bytes block;
+	vector<bytesConstRef> transactions;
+	BlockNumber number = 0;
 	for (size_t i = 0; i < receipts.size(); i++)
 	{
-		TransactionReceipt receipt = receipts[i];
-		auto th = transaction(_blockHash, i).sha3();
-		LogEntries le = _f.matches(receipt);
+		LogEntries le = _f.matches(receipts[i]);
+		if (le.empty())
+			continue;
+		if (block.empty())
+		{
+			block = bc().block(_blockHash);
+			for (auto const& t : RLP(block)[1])
+				transactions.push_back(t.data());
+			number = (BlockNumber)bc().number(_blockHash);
+		}
+		h256 th = i < transactions.size() ? sha3(transactions[i]) : h256();
 		for (unsigned j = 0; j < le.size(); ++j)
-			io_logs.insert(io_logs.begin(), LocalisedLogEntry(le[j], _blockHash, (BlockNumber)bc().number(_blockHash), th, i, 0, _polarity));
+			io_logs.push_back(LocalisedLogEntry(le[j], _blockHash, number, th, i, 0, _polarity));
 	}
 }
 
@@ -348,11 +506,15 @@ unsigned ClientBase::installWatch(LogFilter const& _f, Reaping _r)
 	h256 h = _f.sha3();
 	{
 		Guard l(x_filtersWatches);
-		if (!m_filters.count(h))
+		auto it = m_filters.find(h);
+		if (it == m_filters.end())
 		{
 			LOG(DEBUG) << "FFF" << _f << h;
 			m_filters.insert(make_pair(h, _f));
+			m_filterIndex.insert(h, _f);
 		}
+		else
+			++it->second.refCount;
 	}
 	return installWatch(h, _r);
 }
@@ -395,6 +557,7 @@ bool ClientBase::uninstallWatch(unsigned _i)
 		if (!--fit->second.refCount)
 		{
 			LOG(DEBUG) << "*X*" << fit->first << ":" << fit->second.filter;
+			m_filterIndex.erase(fit->first, fit->second.filter);
 			m_filters.erase(fit);
 		}
 	return true;
@@ -427,6 +590,12 @@ LocalisedLogEntries ClientBase::checkWatch(unsigned _watchId)
 	return ret;
 }
 
+Handler<vector<unsigned> const&> ClientBase::onWatchesChanged(function<void(vector<unsigned> const&)> const& _h)
+{
+	Guard l(x_filtersWatches);
+	return m_onWatchesChanged.add(_h);
+}
+
 BlockHeader ClientBase::blockInfo(h256 _hash) const
 {
 	if (_hash == PendingBlockHash)
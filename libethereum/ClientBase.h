@@ -25,6 +25,7 @@
 #include <chrono>
 #include "Interface.h"
 #include "LogFilter.h"
+#include "LogFilterIndex.h"
 #include "TransactionQueue.h"
 #include "Block.h"
 #include "CommonNet.h"
@@ -107,7 +108,8 @@ public:
 
 	virtual LocalisedLogEntries logs(unsigned _watchId) const override;
 	virtual LocalisedLogEntries logs(LogFilter const& _filter) const override;
-	virtual void prependLogsFromBlock(LogFilter const& _filter, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const;
+	virtual LocalisedLogEntries logs(LogFilter const& _filter, size_t _max, unsigned _cursor, unsigned& o_next) const override;
+	virtual void appendLogsFromBlock(LogFilter const& _filter, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const;
 
 	/// Install, uninstall and query watches.
 	virtual unsigned installWatch(LogFilter const& _filter, Reaping _r = Reaping::Automatic) override;
@@ -115,6 +117,7 @@ public:
 	virtual bool uninstallWatch(unsigned _watchId) override;
 	virtual LocalisedLogEntries peekWatch(unsigned _watchId) const override;
 	virtual LocalisedLogEntries checkWatch(unsigned _watchId) override;
+	virtual Handler<std::vector<unsigned> const&> onWatchesChanged(std::function<void(std::vector<unsigned> const&)> const& _h) override;
 
 	virtual h256 hashFromNumber(BlockNumber _number) const override;
 	virtual BlockNumber numberFromHash(h256 _blockHash) const override;
@@ -143,6 +146,7 @@ public:
 	virtual EVMSchedule evmSchedule() const override { return sealEngine()->evmSchedule(EnvInfo(pendingInfo())); }
 
 	virtual std::pair<ImportResult, h256> injectTransaction(bytes const& _rlp, IfDropped _id = IfDropped::Ignore) override { prepareForTransaction(); return m_tq.import(_rlp, _id); }
+	virtual std::vector<std::pair<ImportResult, h256>> injectTransactions(std::vector<bytes> const& _rlps, IfDropped _id = IfDropped::Ignore) override { prepareForTransaction(); return m_tq.import(_rlps, _id); }
 	virtual ImportResult injectBlock(bytes const& _block) override;
 
 	using Interface::addresses;
@@ -189,9 +193,11 @@ protected:
 	// filters
 	mutable Mutex x_filtersWatches;							///< Our lock.
 	std::unordered_map<h256, InstalledFilter> m_filters;	///< The dictionary of filters that are active.
+	LogFilterIndex m_filterIndex;							///< Which of m_filters each log address and topic can reach.
 	std::unordered_map<h256, h256s> m_specialFilters = std::unordered_map<h256, std::vector<h256>> {{PendingChangedFilter, {}}, {ChainChangedFilter, {}}};
 	///< The dictionary of special filters and their additional data
 	std::map<unsigned, ClientWatch> m_watches;				///< Each and every watch - these reference a filter.
+	Signal<std::vector<unsigned> const&> m_onWatchesChanged;	///< Fired by noteChanged() with the watches that gained changes.
 };
 
 }
@@ -51,6 +51,8 @@ static const unsigned c_maxPayload = 262144;	///< Maximum size of packet for us
 #endif
 static const unsigned c_maxNodes = c_maxBlocks; ///< Maximum number of nodes will ever send.
 static const unsigned c_maxReceipts = c_maxBlocks; ///< Maximum number of receipts will ever send.
+static const unsigned c_maxTransactionHashes = 4096; ///< Maximum number of transaction hashes NewTransactionHashes/GetTransactions will carry.
+static const unsigned c_maxSnapshotNodes = 4096; ///< Maximum number of state trie nodes SnapshotData will ever send.
 
 class BlockChain;
 class TransactionQueue;
@@ -67,6 +69,10 @@ enum SubprotocolPacketType : byte
 	GetBlockBodiesPacket = 0x05,
 	BlockBodiesPacket = 0x06,
 	NewBlockPacket = 0x07,
+	NewTransactionHashesPacket = 0x08,
+	GetTransactionsPacket = 0x09,
+	GetSnapshotDataPacket = 0x0a,
+	SnapshotDataPacket = 0x0b,
 
 	GetNodeDataPacket = 0x0d,
 	NodeDataPacket = 0x0e,
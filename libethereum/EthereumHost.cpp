@@ -22,10 +22,12 @@
 #include "EthereumHost.h"
 
 #include <chrono>
+#include <cmath>
 #include <thread>
 
 #include <libdevcore/Common.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <libp2p/Host.h>
 #include <libp2p/Session.h>
 #include <libethcore/Exceptions.h>
@@ -36,6 +38,7 @@
 #include "BlockChainSync.h"
 #include "NodeConnParamsManagerApi.h"
 #include "StatLog.h"
+#include "TxTrace.h"
 
 using namespace std;
 using namespace dev;
@@ -44,6 +47,8 @@ using namespace p2p;
 
 unsigned const EthereumHost::c_oldProtocolVersion = 62; //TODO: remove this once v63+ is common
 static unsigned const c_maxSendTransactions = 10;
+/// How long an announced transaction is considered in flight before another peer may be asked for it.
+static chrono::seconds const c_transactionRequestTimeout = chrono::seconds(5);
 
 char const* const EthereumHost::s_stateNames[static_cast<int>(SyncState::Size)] = {"NotSynced", "Idle", "Waiting", "Blocks", "State", "NewBlocks" };
 
@@ -54,11 +59,16 @@ namespace
 class EthereumPeerObserver: public EthereumPeerObserverFace
 {
 public:
-	EthereumPeerObserver(BlockChainSync& _sync, RecursiveMutex& _syncMutex, TransactionQueue& _tq, Web3Observer::Ptr _observer = Web3Observer::Ptr()):
-		m_sync(_sync), m_syncMutex(_syncMutex), m_tq(_tq), m_channelMessageObserver(_observer) {}
+	EthereumPeerObserver(BlockChainSync& _sync, RecursiveMutex& _syncMutex, TransactionQueue& _tq, SnapshotSync& _snapshot, Web3Observer::Ptr _observer = Web3Observer::Ptr()):
+		m_sync(_sync), m_syncMutex(_syncMutex), m_tq(_tq), m_snapshot(_snapshot), m_channelMessageObserver(_observer) {}
 
 	void onPeerStatus(std::shared_ptr<EthereumPeer> _peer) override
 	{
+		// block sync starts once the snapshot is installed, or none is to be
+		m_snapshot.onPeerStatus(_peer);
+		if (m_snapshot.isActive())
+			return;
+
 		RecursiveGuard l(m_syncMutex);
 		try
 		{
@@ -79,6 +89,46 @@ public:
 		m_tq.enqueue(_r, _peer->id());
 	}
 
+	void onPeerTransactionHashes(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
+	{
+		unsigned itemCount = std::min<unsigned>(_r.itemCount(), c_maxTransactionHashes);
+		LOG(TRACE) << "NewTransactionHashes (" << dec << itemCount << " entries)";
+
+		h256s hashes;
+		hashes.reserve(itemCount);
+		for (unsigned i = 0; i < itemCount; ++i)
+			hashes.push_back(_r[i].toHash<h256>());
+		_peer->markTransactionsKnown(hashes);
+
+		// only ask one peer at a time for a given transaction
+		h256s wanted;
+		auto now = chrono::steady_clock::now();
+		DEV_GUARDED(x_requested)
+		{
+			for (auto const& h: m_tq.unknownTransactions(hashes))
+			{
+				auto it = m_requested.find(h);
+				if (it != m_requested.end() && now - it->second < c_transactionRequestTimeout)
+					continue;
+				m_requested[h] = now;
+				wanted.push_back(h);
+			}
+			if (m_requested.size() > c_maxTransactionHashes)
+			{
+				for (auto it = m_requested.begin(); it != m_requested.end();)
+				{
+					if (now - it->second >= c_transactionRequestTimeout)
+						it = m_requested.erase(it);
+					else
+						++it;
+				}
+			}
+		}
+
+		if (!wanted.empty())
+			_peer->requestTransactions(wanted);
+	}
+
 	void onPeerAborting() override
 	{
 		RecursiveGuard l(m_syncMutex);
@@ -94,6 +144,8 @@ public:
 
 	void onPeerBlockHeaders(std::shared_ptr<EthereumPeer> _peer, RLP const& _headers) override
 	{
+		if (m_snapshot.isActive())
+			return;
 		RecursiveGuard l(m_syncMutex);
 		try
 		{
@@ -109,6 +161,8 @@ public:
 
 	void onPeerBlockBodies(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
 	{
+		if (m_snapshot.isActive())
+			return;
 		RecursiveGuard l(m_syncMutex);
 		try
 		{
@@ -124,6 +178,8 @@ public:
 
 	void onPeerNewHashes(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
 	{
+		if (m_snapshot.isActive())
+			return;
 		RecursiveGuard l(m_syncMutex);
 		try
 		{
@@ -139,6 +195,8 @@ public:
 
 	void onPeerNewBlock(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
 	{
+		if (m_snapshot.isActive())
+			return;
 		RecursiveGuard l(m_syncMutex);
 		try
 		{
@@ -164,6 +222,11 @@ public:
 		LOG(TRACE) << "Receipts (" << dec << itemCount << "entries)";
 	}
 
+	void onPeerSnapshotData(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) override
+	{
+		m_snapshot.onPeerSnapshotData(_peer, _r);
+	}
+
 	void onCustomMessage(std::shared_ptr<EthereumPeer> _peer, std::shared_ptr<dev::bytes> data) override {
 		if (m_channelMessageObserver.get() != NULL) {
 			m_channelMessageObserver->onReceiveChannelMessage(_peer->id(), data);
@@ -174,6 +237,10 @@ private:
 	BlockChainSync& m_sync;
 	RecursiveMutex& m_syncMutex;
 	TransactionQueue& m_tq;
+	SnapshotSync& m_snapshot;
+
+	Mutex x_requested;
+	std::unordered_map<h256, chrono::steady_clock::time_point> m_requested;	///< Announced transactions we asked for, and when.
 
 	Web3Observer::Ptr m_channelMessageObserver;
 
@@ -182,7 +249,7 @@ private:
 class EthereumHostData: public EthereumHostDataFace
 {
 public:
-	EthereumHostData(BlockChain const& _chain, OverlayDB const& _db): m_chain(_chain), m_db(_db) {}
+	EthereumHostData(BlockChain const& _chain, OverlayDB const& _db, TransactionQueue const& _tq, StateSnapshot const& _snapshot): m_chain(_chain), m_db(_db), m_tq(_tq), m_snapshot(_snapshot) {}
 
 	pair<bytes, unsigned> blockHeaders(RLP const& _blockId, unsigned _maxHeaders, u256 _skip, bool _reverse) const override
 	{
@@ -380,9 +447,42 @@ public:
 		return make_pair(rlp, n);
 	}
 
+	pair<bytes, unsigned> transactions(RLP const& _txHashes) const override
+	{
+		unsigned const count = static_cast<unsigned>(_txHashes.itemCount());
+		auto numItemsToSend = std::min(count, c_maxTransactionHashes);
+
+		h256s hashes;
+		hashes.reserve(numItemsToSend);
+		for (unsigned i = 0; i < numItemsToSend; ++i)
+			hashes.push_back(_txHashes[i].toHash<h256>());
+
+		bytes rlp;
+		unsigned n = 0;
+		for (auto const& tx: m_tq.transactionsRLP(hashes))
+		{
+			if (rlp.size() >= c_maxPayload)
+				break;
+			if (tx.empty())
+				continue;
+			rlp += tx;
+			++n;
+		}
+		LOG(TRACE) << n << " transactions known and returned;" << (numItemsToSend - n) << " unknown;" << (count - numItemsToSend) << " ignored";
+
+		return make_pair(rlp, n);
+	}
+
+	bytes snapshotData(SnapshotPart _part, RLP const& _args) const override
+	{
+		return m_snapshot.serve(_part, _args);
+	}
+
 private:
 	BlockChain const& m_chain;
 	OverlayDB const& m_db;
+	TransactionQueue const& m_tq;
+	StateSnapshot const& m_snapshot;
 };
 
 class ChannelMessageObserver: public ChannelMessageObserverFace {
@@ -449,12 +549,14 @@ EthereumHost::EthereumHost(BlockChain const& _ch, OverlayDB const& _db, Transact
 	m_tq		(_tq),
 	m_bq		(_bq),
 	m_networkId	(_networkId),
-	m_hostData(make_shared<EthereumHostData>(m_chain, m_db))
+	m_snapshot(new StateSnapshot(m_chain, m_db, _ch.chainParams().snapshotInterval)),
+	m_hostData(make_shared<EthereumHostData>(m_chain, m_db, m_tq, *m_snapshot))
 {
 	// TODO: Composition would be better. Left like that to avoid initialization
 	//       issues as BlockChainSync accesses other EthereumHost members.
 	m_sync.reset(new BlockChainSync(*this));
-	m_peerObserver = make_shared<EthereumPeerObserver>(*m_sync, x_sync, m_tq);
+	m_snapshotSync.reset(new SnapshotSync(*this, _ch.chainParams().snapshotSync));
+	m_peerObserver = make_shared<EthereumPeerObserver>(*m_sync, x_sync, m_tq, *m_snapshotSync);
 
 	NodeConnManagerSingleton::GetInstance().setEthereumHost(this);
 	m_latestBlockSent = _ch.currentHash();
@@ -512,6 +614,8 @@ void EthereumHost::doWork()
 		}
 	}
 
+	m_snapshotSync->tick();
+
 	time_t  now = std::chrono::system_clock::to_time_t(chrono::system_clock::now());
 	if (now - m_lastTick >= 1)
 	{
@@ -527,92 +631,110 @@ void EthereumHost::doWork()
 
 void EthereumHost::maintainTransactions()
 {
+	static auto& pushBytes = metrics::counter("eth_tx_gossip_bytes_total", "Bytes of transaction gossip sent, by packet", {{"packet", "push"}});
+	static auto& announceBytes = metrics::counter("eth_tx_gossip_bytes_total", "Bytes of transaction gossip sent, by packet", {{"packet", "announce"}});
+	static auto& pushed = metrics::counter("eth_tx_gossip_items_total", "Transactions or hashes sent in transaction gossip, by packet", {{"packet", "push"}});
+	static auto& announced = metrics::counter("eth_tx_gossip_items_total", "Transactions or hashes sent in transaction gossip, by packet", {{"packet", "announce"}});
+
 	// Send any new transactions.
-	unordered_map<std::shared_ptr<EthereumPeer>, std::vector<size_t>> peerTransactions;
+	auto ts = m_tq.topTransactions(c_maxSendTransactions, m_transactionsSent);
 
-	/*
-	auto ts = m_tq.topTransactions(c_maxSendTransactions);
+	vector<shared_ptr<EthereumPeer>> peers;
+	foreachPeer([&](shared_ptr<EthereumPeer> _p) { peers.push_back(_p); return true; });
+
+	// Which transactions each peer already has, taking every peer's lock only once.
+	vector<vector<bool>> known(peers.size(), vector<bool>(ts.size()));
+	for (size_t p = 0; p < peers.size(); ++p)
+		DEV_GUARDED(peers[p]->x_knownTransactions)
+			for (size_t i = 0; i < ts.size(); ++i)
+				known[p][i] = peers[p]->m_knownTransactions.exist(ts[i].sha3());
+
+	// Push the full transaction to about sqrt(n) peers and announce the hash to the
+	// rest, which pull it if they still need it. Peers that don't understand
+	// announcements keep getting full transactions as before.
+	size_t const pushCount = static_cast<size_t>(ceil(sqrt(static_cast<double>(peers.size()))));
+	vector<vector<size_t>> peerTransactions(peers.size());
+	vector<h256s> peerHashes(peers.size());
 	{
 		Guard l(x_transactions);
 		for (size_t i = 0; i < ts.size(); ++i)
 		{
 			auto const& t = ts[i];
 			bool unsent = !m_transactionsSent.count(t.sha3());
-			auto peers = get<1>(randomSelection(0, [&](EthereumPeer * p) { return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3())); }));
-			for (auto const& p : peers)
-				peerTransactions[p].push_back(i);
-		}
-		for (auto const& t : ts)
-			m_transactionsSent.insert(t.sha3());
-	}
-	*/
 
-	//auto ts = m_tq.allTransactions();
-	auto ts = m_tq.topTransactions(c_maxSendTransactions, m_transactionsSent);
-	{
-		Guard l(x_transactions);
-		for (size_t i = 0; i < ts.size(); ++i) {
-			auto const& t = ts[i];
-			bool unsent = !m_transactionsSent.count(t.sha3());
-			vector<shared_ptr<EthereumPeer>> peers;
-			if (t.importType() == 0) {
-				peers = get<1>(randomSelection(0, [&](EthereumPeer * p) {
-					DEV_GUARDED(p->x_knownTransactions)
-					return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3()));
-					return false;
-				}));
-			} else {
-				peers = get<0>(randomSelection(25, [&](EthereumPeer * p) {
-					DEV_GUARDED(p->x_knownTransactions)
-					return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(t.sha3()));
-					return false;
-				}));
-			}
-			for (auto const& p : peers) {
-				peerTransactions[p].push_back(i);
+			vector<size_t> candidates;
+			for (size_t p = 0; p < peers.size(); ++p)
+				if (peers[p]->m_requireTransactions || (unsent && !known[p][i]))
+					candidates.push_back(p);
+			for (size_t k = candidates.size(); k > 1; --k)
+				swap(candidates[k - 1], candidates[rand() % k]);
+
+			for (size_t k = 0; k < candidates.size(); ++k)
+			{
+				size_t p = candidates[k];
+				if (k < pushCount || peers[p]->m_requireTransactions)
+					peerTransactions[p].push_back(i);
+				else if (peers[p]->acceptsTransactionHashes())
+					peerHashes[p].push_back(t.sha3());
+				else if (t.importType() == 0 || rand() % 100 < 25)
+					peerTransactions[p].push_back(i);
 			}
 
-			if (unsent) {
+			if (unsent)
+			{
 				m_transactionsSent.insert(t.sha3());
+				TxTrace::instance().record(t.sha3(), TxStage::Broadcast);
 			}
 		}
 	}
 
-	foreachPeer([&](shared_ptr<EthereumPeer> _p)
+	for (size_t p = 0; p < peers.size(); ++p)
 	{
+		auto const& _p = peers[p];
 		bytes b;
 		unsigned n = 0;
 
 		DEV_GUARDED(_p->x_knownTransactions)
-		for (auto const& i : peerTransactions[_p])
 		{
-			if (_p->m_knownTransactions.size() > EthereumPeer::kKnownTranscationsSize) {
-				_p->m_knownTransactions.pop();
+			for (auto const& i : peerTransactions[p])
+			{
+				_p->m_knownTransactions.insert(ts[i].sha3());
+				b += ts[i].rlp();
+				++n;
 			}
-			_p->m_knownTransactions.insert(ts[i].sha3());
-			b += ts[i].rlp();
-			++n;
-			// LOG(DEBUG) << "Sent transactions to " << _p->session()->id() << " " << ts[i].sha3() ;
+			for (auto const& h : peerHashes[p])
+				_p->m_knownTransactions.insert(h);
 		}
 
-		//_p->clearKnownTransactions();
-
+		auto s = _p->session();
 		if (n || _p->m_requireTransactions)
 		{
 			RLPStream ts;
 			_p->prep(ts, TransactionsPacket, n).appendRaw(b, n);
 
-			auto s = _p->session();
-			if(s) {
+			if (s)
+			{
 				BroadcastTxSizeLog(s->id(), ts.out().size());
+				pushBytes.inc(ts.out().size());
+				pushed.inc(n);
 
 				_p->sealAndSend(ts);
 				LOG(TRACE) << "Sent" << n << "transactions to " << s->info().clientVersion;
 			}
 		}
+		if (!peerHashes[p].empty() && s)
+		{
+			RLPStream hs;
+			_p->prep(hs, NewTransactionHashesPacket, peerHashes[p].size());
+			for (auto const& h : peerHashes[p])
+				hs << h;
+			announceBytes.inc(hs.out().size());
+			announced.inc(peerHashes[p].size());
+			_p->sealAndSend(hs);
+			LOG(TRACE) << "Announced" << peerHashes[p].size() << "transactions to " << s->info().clientVersion;
+		}
 		_p->m_requireTransactions = false;
-		return true;
-	});
+	}
 }
 
 void EthereumHost::foreachPeer(std::function<bool(std::shared_ptr<EthereumPeer>)> const & _f) const
@@ -736,17 +858,63 @@ void EthereumHost::maintainBlocks(h256 const & _currentHash)
 
 bool EthereumHost::isSyncing() const
 {
-	return m_sync->isSyncing();
+	return m_snapshotSync->isActive() || m_sync->isSyncing();
 }
 
 SyncStatus EthereumHost::status() const
 {
 	RecursiveGuard l(x_sync);
-	return m_sync->status();
+	SyncStatus ret = m_sync->status();
+	if (m_snapshotSync->isActive())
+	{
+		ret.state = SyncState::State;
+		ret.majorSyncing = true;
+		ret.highestBlockNumber = max(ret.highestBlockNumber, m_snapshotSync->number());
+	}
+	return ret;
+}
+
+bool EthereumHost::installSnapshot(SnapshotManifest const& _manifest, vector<bytes> const& _chunks)
+{
+	if (!m_onSnapshot)
+		return false;
+	m_onSnapshot(_manifest, _chunks);
+	return true;
+}
+
+void EthereumHost::onSnapshotInstalled(bool _ok)
+{
+	m_snapshotSync->onInstalled(_ok);
+	resumeBlockSync();
+}
+
+void EthereumHost::resumeBlockSync()
+{
+	RecursiveGuard l(x_sync);
+	try
+	{
+		m_sync->restartSync();
+		foreachPeer([&](shared_ptr<EthereumPeer> _p) { m_sync->onPeerStatus(_p); return true; });
+	}
+	catch (FailedInvariant const&)
+	{
+		LOG(WARNING) << "Failed invariant during sync, restarting sync";
+		m_sync->restartSync();
+	}
 }
 
 void EthereumHost::onTransactionImported(ImportResult _ir, h256 const & _h, h512 const & _nodeId)
 {
+	static auto& fresh = metrics::counter("eth_tx_gossip_received_total", "Transactions received from peers, by import result", {{"result", "new"}});
+	static auto& known = metrics::counter("eth_tx_gossip_received_total", "Transactions received from peers, by import result", {{"result", "known"}});
+	static auto& rejected = metrics::counter("eth_tx_gossip_received_total", "Transactions received from peers, by import result", {{"result", "rejected"}});
+	if (_ir == ImportResult::Success)
+		fresh.inc();
+	else if (_ir == ImportResult::AlreadyKnown || _ir == ImportResult::AlreadyInChain)
+		known.inc();
+	else
+		rejected.inc();
+
 	auto session = host()->peerSession(_nodeId);
 	if (!session)
 		return;
@@ -841,7 +1009,7 @@ void EthereumHost::delNodeConnParam(std::string const & sParams)
 }
 
 void EthereumHost::setWeb3Observer(Web3Observer::Ptr _observer) {
-	m_peerObserver = make_shared<EthereumPeerObserver>(*m_sync, x_sync, m_tq, _observer);
+	m_peerObserver = make_shared<EthereumPeerObserver>(*m_sync, x_sync, m_tq, *m_snapshotSync, _observer);
 	_channelObserver = make_shared<ChannelMessageObserver>(_observer, this);
 }
 
@@ -38,6 +38,8 @@
 #include "BlockChainSync.h"
 #include "CommonNet.h"
 #include "EthereumPeer.h"
+#include "SnapshotSync.h"
+#include "StateSnapshot.h"
 #include "Web3Observer.h"
 
 namespace dev
@@ -71,6 +73,7 @@ struct CustomMessageResponse;
  */
 class EthereumHost: public p2p::HostCapability<EthereumPeer>, Worker
 {
+	friend class SnapshotSync;
 public:
 	/// Start server, but don't listen.
 	EthereumHost(BlockChain const& _ch, OverlayDB const& _db, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId);
@@ -90,7 +93,12 @@ public:
 	void noteNewTransactions() { m_newTransactions = true; }
 	void noteNewBlocks() { m_newBlocks = true; }
 	void onForceSync() { m_sync->onForceSync(); }
-	void onBlockImported(BlockHeader const& _info) { m_sync->onBlockImported(_info); }
+	void onBlockImported(BlockHeader const& _info) { m_snapshot->onBlockImported(_info); m_sync->onBlockImported(_info); }
+
+	/// Set how to install a downloaded snapshot; it must call onSnapshotInstalled() when done.
+	void setOnSnapshot(std::function<void(SnapshotManifest const&, std::vector<bytes> const&)> const& _f) { m_onSnapshot = _f; }
+	/// Resumes block sync from the snapshot installed, or from the old head if @a _ok is false.
+	void onSnapshotInstalled(bool _ok);
 
 	BlockChain const& chain() const { return m_chain; }
 	OverlayDB const& db() const { return m_db; }
@@ -141,6 +149,11 @@ private:
 	void maintainBlocks(h256 const& _currentBlock);
 	void onTransactionImported(ImportResult _ir, h256 const& _h, h512 const& _nodeId);
 
+	/// Hands a downloaded snapshot to the installer. @returns false if there is none.
+	bool installSnapshot(SnapshotManifest const& _manifest, std::vector<bytes> const& _chunks);
+	/// Starts block sync with every peer, once snapshot sync is over.
+	void resumeBlockSync();
+
 	///	Check to see if the network peer-state initialisation has happened.
 	bool isInitialised() const { return (bool)m_latestBlockSent; }
 
@@ -170,6 +183,10 @@ private:
 	std::unique_ptr<BlockChainSync> m_sync;
 	std::atomic<time_t> m_lastTick = { 0 };
 
+	std::unique_ptr<StateSnapshot> m_snapshot;			///< Snapshots we serve.
+	std::unique_ptr<SnapshotSync> m_snapshotSync;		///< Snapshot we sync to.
+	std::function<void(SnapshotManifest const&, std::vector<bytes> const&)> m_onSnapshot;
+
 	std::shared_ptr<EthereumHostDataFace> m_hostData;
 	std::shared_ptr<EthereumPeerObserverFace> m_peerObserver;
 	std::shared_ptr<ChannelMessageObserverFace> _channelObserver;
@@ -24,6 +24,7 @@
 #include <chrono>
 #include <libdevcore/Common.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <libethcore/Exceptions.h>
 #include <libp2p/Session.h>
 #include <libp2p/Host.h>
@@ -37,6 +38,10 @@ using namespace p2p;
 
 static const unsigned c_maxIncomingNewHashes = 1024;
 static const unsigned c_maxHeadersToSend = 1024;
+/// Trailing Status item telling the peer we understand NewTransactionHashes/GetTransactions.
+static const unsigned c_transactionHashesVersion = 1;
+/// Trailing Status item telling the peer we understand GetSnapshotData/SnapshotData.
+static const unsigned c_snapshotVersion = 1;
 
 string EthereumPeer::toString(Asking _a)
 {
@@ -141,13 +146,43 @@ void EthereumPeer::requestStatus(u256 _hostNetworkId, u256 _chainTotalDifficulty
 	m_requireTransactions = true;
 	RLPStream s;
 	bool latest = m_peerCapabilityVersion == m_hostProtocolVersion;
-	prep(s, StatusPacket, 6)
+	prep(s, StatusPacket, 8)
 	        << (latest ? m_hostProtocolVersion : EthereumHost::c_oldProtocolVersion)
 	        << _hostNetworkId
 	        << _chainTotalDifficulty
 	        << _chainCurrentHash
 	        << _chainGenesisHash
-	        << _height;
+	        << _height
+	        << c_transactionHashesVersion
+	        << c_snapshotVersion;
+	sealAndSend(s);
+}
+
+void EthereumPeer::markTransactionsKnown(h256s const& _hashes)
+{
+	Guard l(x_knownTransactions);
+	for (auto const& h : _hashes)
+		m_knownTransactions.insert(h);
+}
+
+void EthereumPeer::requestTransactions(h256s const& _hashes)
+{
+	static auto& requestBytes = metrics::counter("eth_tx_gossip_bytes_total", "Bytes of transaction gossip sent, by packet", {{"packet", "request"}});
+	static auto& requested = metrics::counter("eth_tx_gossip_items_total", "Transactions or hashes sent in transaction gossip, by packet", {{"packet", "request"}});
+	RLPStream s;
+	prep(s, GetTransactionsPacket, _hashes.size());
+	for (auto const& h : _hashes)
+		s << h;
+	requestBytes.inc(s.out().size());
+	requested.inc(_hashes.size());
+	sealAndSend(s);
+}
+
+void EthereumPeer::requestSnapshotData(unsigned _id, SnapshotPart _part, bytes const& _args)
+{
+	RLPStream s;
+	prep(s, GetSnapshotDataPacket, 3) << _id << (byte)_part;
+	s.appendRaw(_args, 1);
 	sealAndSend(s);
 }
 
@@ -279,6 +314,8 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 			m_latestHash = _r[3].toHash<h256>();
 			m_genesisHash = _r[4].toHash<h256>();
 			m_height = _r[5].toInt<u256>();
+			m_acceptsTransactionHashes = _r.itemCount() > 6 && _r[6].toInt<unsigned>() >= c_transactionHashesVersion;
+			m_servesSnapshots = _r.itemCount() > 7 && _r[7].toInt<unsigned>() >= c_snapshotVersion;
 			if (m_peerCapabilityVersion == m_hostProtocolVersion)
 				m_protocolVersion = m_hostProtocolVersion;
 
@@ -292,6 +329,44 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 			m_observer->onPeerTransactions(dynamic_pointer_cast<EthereumPeer>(dynamic_pointer_cast<EthereumPeer>(shared_from_this())), _r);
 			break;
 		}
+		case NewTransactionHashesPacket:
+		{
+			m_observer->onPeerTransactionHashes(dynamic_pointer_cast<EthereumPeer>(shared_from_this()), _r);
+			break;
+		}
+		case GetTransactionsPacket:
+		{
+			unsigned count = static_cast<unsigned>(_r.itemCount());
+			LOG(TRACE) << "GetTransactions (" << dec << count << "entries)";
+
+			static auto& replyBytes = metrics::counter("eth_tx_gossip_bytes_total", "Bytes of transaction gossip sent, by packet", {{"packet", "reply"}});
+			static auto& replied = metrics::counter("eth_tx_gossip_items_total", "Transactions or hashes sent in transaction gossip, by packet", {{"packet", "reply"}});
+			pair<bytes, unsigned> const rlpAndItemCount = m_hostData->transactions(_r);
+			RLPStream s;
+			prep(s, TransactionsPacket, rlpAndItemCount.second).appendRaw(rlpAndItemCount.first, rlpAndItemCount.second);
+			replyBytes.inc(s.out().size());
+			replied.inc(rlpAndItemCount.second);
+			sealAndSend(s);
+			break;
+		}
+		case GetSnapshotDataPacket:
+		{
+			/// Packet layout:
+			/// [ id: P, part: P, args: [ ... ] ], answered with [ id: P, part: P, data ]
+			bytes const data = m_hostData->snapshotData((SnapshotPart)_r[1].toInt<byte>(), _r[2]);
+			LOG(TRACE) << "GetSnapshotData (part " << _r[1].toInt<unsigned>() << "), " << data.size() << " bytes returned";
+
+			RLPStream s;
+			prep(s, SnapshotDataPacket, 3) << _r[0].toInt<unsigned>() << _r[1].toInt<byte>();
+			s.appendRaw(data, 1);
+			sealAndSend(s);
+			break;
+		}
+		case SnapshotDataPacket:
+		{
+			m_observer->onPeerSnapshotData(dynamic_pointer_cast<EthereumPeer>(shared_from_this()), _r);
+			break;
+		}
 		case GetBlockHeadersPacket:
 		{
 			/// Packet layout:
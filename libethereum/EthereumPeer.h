@@ -28,6 +28,7 @@
 
 #include <libdevcore/RLP.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/RollingFilter.h>
 #include <libethcore/Common.h>
 #include <libp2p/Capability.h>
 #include "CommonNet.h"
@@ -37,6 +38,8 @@ namespace dev
 namespace eth
 {
 
+enum class SnapshotPart: byte;
+
 class EthereumPeerObserverFace
 {
 public:
@@ -46,6 +49,8 @@ public:
 
 	virtual void onPeerTransactions(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
 
+	virtual void onPeerTransactionHashes(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
+
 	virtual void onPeerBlockHeaders(std::shared_ptr<EthereumPeer> _peer, RLP const& _headers) = 0;
 
 	virtual void onPeerBlockBodies(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
@@ -58,6 +63,8 @@ public:
 
 	virtual void onPeerReceipts(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
 
+	virtual void onPeerSnapshotData(std::shared_ptr<EthereumPeer> _peer, RLP const& _r) = 0;
+
 	virtual void onPeerAborting() = 0;
 
 	virtual void onCustomMessage(std::shared_ptr<EthereumPeer> _peer, std::shared_ptr<dev::bytes> data) = 0;
@@ -75,6 +82,10 @@ public:
 	virtual strings nodeData(RLP const& _dataHashes) const = 0;
 
 	virtual std::pair<bytes, unsigned> receipts(RLP const& _blockHashes) const = 0;
+
+	virtual std::pair<bytes, unsigned> transactions(RLP const& _txHashes) const = 0;
+
+	virtual bytes snapshotData(SnapshotPart _part, RLP const& _args) const = 0;
 };
 
 class ChannelMessageObserverFace {
@@ -157,6 +168,21 @@ public:
 	void setTopics(std::shared_ptr<std::vector<std::string> > topics);
 
 	u256 height() {return m_height;}
+
+	/// Ask the peer for the transactions with the given hashes.
+	void requestTransactions(h256s const& _hashes);
+
+	/// Remember that the peer already has the given transactions.
+	void markTransactionsKnown(h256s const& _hashes);
+
+	/// Does the peer accept NewTransactionHashes announcements?
+	bool acceptsTransactionHashes() const { return m_acceptsTransactionHashes; }
+
+	/// Ask the peer for part of its state snapshot; it answers with a SnapshotData carrying @a _id.
+	void requestSnapshotData(unsigned _id, SnapshotPart _part, bytes const& _args);
+
+	/// Does the peer answer GetSnapshotData?
+	bool servesSnapshots() const { return m_servesSnapshots; }
 private:
 
 	/// Figure out the amount of blocks we should be asking for.
@@ -210,15 +236,18 @@ private:
 	u256 const m_peerCapabilityVersion;			///< Protocol version this peer supports received as capability
 	/// Have we received a GetTransactions packet that we haven't yet answered?
 	bool m_requireTransactions = false;
+	/// Did the peer's Status advertise NewTransactionHashes support?
+	bool m_acceptsTransactionHashes = false;
+	/// Did the peer's Status advertise GetSnapshotData support?
+	bool m_servesSnapshots = false;
 
 	Mutex x_knownBlocks;
 	//h256Hash m_knownBlocks;					///< Blocks that the peer already knows about (that don't need to be sent to them).
 	QueueSet<h256> m_knownBlocks;
-	Mutex x_knownTransactions;
-	//h256Hash m_knownTransactions;			///< Transactions that the peer already knows of.
-	QueueSet<h256> m_knownTransactions;
 	static const size_t kKnownBlockSize = 100;
 	static const size_t kKnownTranscationsSize = 10000;
+	Mutex x_knownTransactions;
+	RollingHashFilter m_knownTransactions{kKnownTranscationsSize};	///< Transactions that the peer already knows of (approximate).
 	unsigned m_unknownNewBlocks = 0;		///< Number of unknown NewBlocks received from this peer
 	unsigned m_lastAskedHeaders = 0;		///< Number of hashes asked
 
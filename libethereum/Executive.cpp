@@ -167,6 +167,11 @@ u256 Executive::gasUsed() const
 	return m_t.gas() - m_gas;
 }
 
+bool Executive::suicided() const
+{
+	return m_ext && !m_ext->sub.suicides.empty();
+}
+
 u256 Executive::gasUsedNoRefunds() const
 {
 	return m_t.gas() - m_gas + m_refunded;
@@ -176,6 +176,9 @@ public:
 	Address newAddress() const { return m_newAddress; }
 	/// @returns true iff the operation ended with a VM exception.
 	bool excepted() const { return m_excepted != TransactionException::None; }
+	/// @returns true if the operation killed accounts; State::rollback() can't undo that.
+	/// @warning Only valid after finalise().
+	bool suicided() const;
 
 	/// Collect execution results in the result storage provided.
 	void setResultRecipient(ExecutionResult& _res) { m_res = &_res; }
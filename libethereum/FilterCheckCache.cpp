@@ -0,0 +1,141 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: FilterCheckCache.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "FilterCheckCache.h"
+
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+FilterCheckCache::FilterCheckCache(size_t _capacity):
+	m_shardCapacity(max<size_t>(_capacity / c_shards, 1)),
+	m_hits(metrics::counter("filter_check_cache_lookups_total", "Transaction filter check cache lookups, by result", {{"result", "hit"}})),
+	m_misses(metrics::counter("filter_check_cache_lookups_total", "Transaction filter check cache lookups, by result", {{"result", "miss"}})),
+	m_evictions(metrics::counter("filter_check_cache_evictions_total", "Transaction filter check results evicted from the cache to make room")),
+	m_size(metrics::gauge("filter_check_cache_size", "Transaction filter check results cached"))
+{
+}
+
+h256 FilterCheckCache::key(Transaction const& _t)
+{
+	RLPStream s;
+	s.appendList(4) << _t.safeSender() << _t.from() << _t.to() << bytesConstRef(&_t.data()).cropped(0, 4);
+	return sha3(s.out());
+}
+
+bool FilterCheckCache::get(h256 const& _key, u256& o_result)
+{
+	Shard& s = shard(_key);
+	Guard l(s.lock);
+	auto it = s.index.find(_key);
+	if (it == s.index.end())
+	{
+		m_misses.inc();
+		return false;
+	}
+	s.lru.splice(s.lru.begin(), s.lru, it->second);
+	o_result = it->second->second;
+	m_hits.inc();
+	return true;
+}
+
+void FilterCheckCache::put(h256 const& _key, u256 const& _result, uint64_t _generation)
+{
+	Shard& s = shard(_key);
+	Guard l(s.lock);
+	// read before a clear that may already have swept this shard
+	if (_generation != m_generation)
+		return;
+	auto it = s.index.find(_key);
+	if (it != s.index.end())
+	{
+		it->second->second = _result;
+		s.lru.splice(s.lru.begin(), s.lru, it->second);
+		return;
+	}
+	s.lru.emplace_front(_key, _result);
+	s.index[_key] = s.lru.begin();
+	if (s.lru.size() > m_shardCapacity)
+	{
+		s.index.erase(s.lru.back().first);
+		s.lru.pop_back();
+		m_evictions.inc();
+	}
+	else
+		m_size.add(1);
+}
+
+void FilterCheckCache::clear()
+{
+	Guard l(m_watchLock);
+	clearWatched();
+}
+
+void FilterCheckCache::watch(Address const& _contract, h256 const& _storageRoot, uint64_t _generation)
+{
+	Guard l(m_watchLock);
+	if (_generation != m_generation)
+		return;
+	auto it = m_watched.find(_contract);
+	if (it == m_watched.end())
+		m_watched[_contract] = _storageRoot;
+	else if (it->second != _storageRoot)
+		// read on an older or newer block than the first reader, let the next refresh clear
+		it->second = h256();
+}
+
+bool FilterCheckCache::refresh(std::function<h256(Address const&)> const& _storageRoot)
+{
+	Guard l(m_watchLock);
+	// results still being read on the block before are not put
+	++m_generation;
+	for (auto const& w: m_watched)
+		if (_storageRoot(w.first) != w.second)
+		{
+			clearWatched();
+			return true;
+		}
+	return false;
+}
+
+bool FilterCheckCache::watches(Address const& _contract) const
+{
+	Guard l(m_watchLock);
+	return m_watched.count(_contract);
+}
+
+void FilterCheckCache::clearWatched()
+{
+	// bumped first, so a result computed before the clear cannot be put after its shard is swept
+	++m_generation;
+	m_watched.clear();
+	for (auto& s: m_shards)
+		DEV_GUARDED(s.lock)
+		{
+			m_size.add(-(int64_t)s.lru.size());
+			s.lru.clear();
+			s.index.clear();
+		}
+}
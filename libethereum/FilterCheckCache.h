@@ -0,0 +1,101 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: FilterCheckCache.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/Metrics.h>
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * Bounded cache of transaction filter results, split in independently locked LRU shards.
+ * The key covers what the filter contracts decide on: origin, from, to and the function selector.
+ * The owner watches the contracts the results were read from, the filter chain, its filters and
+ * the groups they looked up, and refresh() drops everything once the storage of any of them
+ * changes, whether by a direct or an internal call. Blocks that leave them alone keep the cache.
+ * Hits, misses, evictions and the size are exported as filter_check_cache_* metrics.
+ */
+class FilterCheckCache
+{
+public:
+	explicit FilterCheckCache(size_t _capacity = 64 * 1024);
+
+	static h256 key(Transaction const& _t);
+
+	/// @returns true and sets @a o_result if @a _key is cached.
+	bool get(h256 const& _key, u256& o_result);
+	/// Caches a result read at @a _generation; dropped if the cache was refreshed or cleared since.
+	void put(h256 const& _key, u256 const& _result, uint64_t _generation);
+	void clear();
+
+	/// Bumped by every refresh and clear. Read it before taking the state a result is computed on.
+	uint64_t generation() const { return m_generation; }
+
+	/// Records that results read at @a _generation depend on @a _contract, whose storage root was @a _storageRoot.
+	void watch(Address const& _contract, h256 const& _storageRoot, uint64_t _generation);
+	/// Clears the cache if the storage root of a watched contract, as given by @a _storageRoot, changed.
+	/// @returns true if it cleared.
+	bool refresh(std::function<h256(Address const&)> const& _storageRoot);
+	/// @returns true if @a _contract is watched; nothing is after a clear.
+	bool watches(Address const& _contract) const;
+
+private:
+	static const unsigned c_shards = 16;
+
+	struct Shard
+	{
+		mutable Mutex lock;
+		std::list<std::pair<h256, u256>> lru;	///< Most recently used first.
+		std::unordered_map<h256, std::list<std::pair<h256, u256>>::iterator> index;
+	};
+
+	Shard& shard(h256 const& _key) { return m_shards[_key[0] % c_shards]; }
+	/// Clears with m_watchLock held.
+	void clearWatched();
+
+	size_t m_shardCapacity;
+	std::array<Shard, c_shards> m_shards;
+
+	mutable Mutex m_watchLock;
+	std::unordered_map<Address, h256> m_watched;	///< Storage root of each watched contract when first read.
+	std::atomic<uint64_t> m_generation{0};
+
+	metrics::Counter& m_hits;
+	metrics::Counter& m_misses;
+	metrics::Counter& m_evictions;
+	metrics::Gauge& m_size;
+};
+
+}
+}
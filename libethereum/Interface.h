@@ -110,6 +110,9 @@ public:
 	/// Injects the RLP-encoded transaction given by the _rlp into the transaction queue directly.
 	virtual std::pair<ImportResult, h256> injectTransaction(bytes const& _rlp, IfDropped _id = IfDropped::Ignore) = 0;
 
+	/// Injects a batch of RLP-encoded transactions into the transaction queue with a single import.
+	virtual std::vector<std::pair<ImportResult, h256>> injectTransactions(std::vector<bytes> const& _rlps, IfDropped _id = IfDropped::Ignore) = 0;
+
 	/// Injects the RLP-encoded block given by the _rlp into the block queue directly.
 	virtual ImportResult injectBlock(bytes const& _block) = 0;
 
@@ -142,6 +145,10 @@ public:
 
 	virtual LocalisedLogEntries logs(unsigned _watchId) const = 0;
 	virtual LocalisedLogEntries logs(LogFilter const& _filter) const = 0;
+	/// One page of logs(_filter): scanning stops after the first block at which at least @a _max
+	/// entries are collected. @a _cursor is the main chain block to resume from, 0 for the start
+	/// of the filter, and @a o_next receives the cursor of the next page, 0 after the last one.
+	virtual LocalisedLogEntries logs(LogFilter const& _filter, size_t _max, unsigned _cursor, unsigned& o_next) const = 0;
 
 	/// Install, uninstall and query watches.
 	virtual unsigned installWatch(LogFilter const& _filter, Reaping _r = Reaping::Automatic) = 0;
@@ -151,6 +158,9 @@ public:
 	LocalisedLogEntries checkWatchSafe(unsigned _watchId) { try { return checkWatch(_watchId); } catch (...) { return LocalisedLogEntries(); } }
 	virtual LocalisedLogEntries peekWatch(unsigned _watchId) const = 0;
 	virtual LocalisedLogEntries checkWatch(unsigned _watchId) = 0;
+	/// Calls @a _h with the ids of the watches that gained changes, as soon as they are in place.
+	/// Called with the watches locked: be nice and exit fast.
+	virtual Handler<std::vector<unsigned> const&> onWatchesChanged(std::function<void(std::vector<unsigned> const&)> const& _h) = 0;
 
 	// [BLOCK QUERY API]
 
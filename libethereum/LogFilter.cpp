@@ -157,7 +157,7 @@ LogEntries LogFilter::matches(TransactionReceipt const& _m) const
 			if (!m_addresses.empty() && !m_addresses.count(e.address))
 				goto continue2;
 			for (unsigned i = 0; i < 4; ++i)
-				if (!m_topics[i].empty() && (e.topics.size() < i || !m_topics[i].count(e.topics[i])))
+				if (!m_topics[i].empty() && (e.topics.size() <= i || !m_topics[i].count(e.topics[i])))
 					goto continue2;
 			ret.push_back(e);
 			continue2:;
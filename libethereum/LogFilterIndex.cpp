@@ -0,0 +1,92 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogFilterIndex.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "LogFilterIndex.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+template <class K> void LogFilterIndex::remove(unordered_map<K, h256Hash>& io_map, K const& _k, h256 const& _id)
+{
+	auto it = io_map.find(_k);
+	if (it == io_map.end())
+		return;
+	it->second.erase(_id);
+	if (it->second.empty())
+		io_map.erase(it);
+}
+
+void LogFilterIndex::insert(h256 const& _id, LogFilter const& _f)
+{
+	if (!_f.addresses().empty())
+	{
+		for (auto const& a: _f.addresses())
+			add(m_byAddress, a, _id);
+		return;
+	}
+	for (unsigned i = 0; i < 4; ++i)
+		if (!_f.topics()[i].empty())
+		{
+			for (auto const& t: _f.topics()[i])
+				add(m_byTopic[i], t, _id);
+			return;
+		}
+	m_unconstrained.insert(_id);
+}
+
+void LogFilterIndex::erase(h256 const& _id, LogFilter const& _f)
+{
+	if (!_f.addresses().empty())
+	{
+		for (auto const& a: _f.addresses())
+			remove(m_byAddress, a, _id);
+		return;
+	}
+	for (unsigned i = 0; i < 4; ++i)
+		if (!_f.topics()[i].empty())
+		{
+			for (auto const& t: _f.topics()[i])
+				remove(m_byTopic[i], t, _id);
+			return;
+		}
+	m_unconstrained.erase(_id);
+}
+
+void LogFilterIndex::candidates(TransactionReceipt const& _r, h256Hash& o_ids) const
+{
+	if (_r.log().empty())
+		return;
+	o_ids.insert(m_unconstrained.begin(), m_unconstrained.end());
+	for (LogEntry const& e: _r.log())
+	{
+		auto a = m_byAddress.find(e.address);
+		if (a != m_byAddress.end())
+			o_ids.insert(a->second.begin(), a->second.end());
+		for (unsigned i = 0; i < 4 && i < e.topics.size(); ++i)
+		{
+			auto t = m_byTopic[i].find(e.topics[i]);
+			if (t != m_byTopic[i].end())
+				o_ids.insert(t->second.begin(), t->second.end());
+		}
+	}
+}
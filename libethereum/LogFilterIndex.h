@@ -0,0 +1,62 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogFilterIndex.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <libdevcore/FixedHash.h>
+#include "LogFilter.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * Inverted index from log address and topic to the installed filters that can match them, so
+ * a receipt is only checked against those filters instead of every installed one.
+ *
+ * Each filter is filed under a single constraint: its addresses if it has any, otherwise the
+ * topics of its first constrained position. Filters with neither match every log. Not thread
+ * safe; ClientBase keeps it under x_filtersWatches.
+ */
+class LogFilterIndex
+{
+public:
+	void insert(h256 const& _id, LogFilter const& _f);
+	void erase(h256 const& _id, LogFilter const& _f);
+
+	/// Adds the ids of the filters that may match a log of @a _r to @a o_ids.
+	void candidates(TransactionReceipt const& _r, h256Hash& o_ids) const;
+
+private:
+	template <class K> static void add(std::unordered_map<K, h256Hash>& io_map, K const& _k, h256 const& _id) { io_map[_k].insert(_id); }
+	template <class K> static void remove(std::unordered_map<K, h256Hash>& io_map, K const& _k, h256 const& _id);
+
+	std::unordered_map<Address, h256Hash> m_byAddress;
+	std::array<std::unordered_map<h256, h256Hash>, 4> m_byTopic;
+	h256Hash m_unconstrained;
+};
+
+}
+}
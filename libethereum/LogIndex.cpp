@@ -0,0 +1,296 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogIndex.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "LogIndex.h"
+
+#include <cstdlib>
+#include <libdevcore/easylog.h>
+#include <libdevcore/RLP.h>
+#include <libdiskencryption/BatchEncrypto.h>
+#include "BlockChain.h"
+#include "LogFilter.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+static const char c_array = 0;
+static const char c_bitmap = 1;
+static const unsigned c_batchBlocks = 1000;
+static const char* const c_markerKey = "logIndex";
+
+}
+
+bool LogIndex::Chunk::empty() const
+{
+	for (auto w: bits)
+		if (w)
+			return false;
+	return true;
+}
+
+LogIndex::Chunk& LogIndex::Chunk::operator|=(Chunk const& _c)
+{
+	for (unsigned i = 0; i < bits.size(); ++i)
+		bits[i] |= _c.bits[i];
+	return *this;
+}
+
+LogIndex::Chunk& LogIndex::Chunk::operator&=(Chunk const& _c)
+{
+	for (unsigned i = 0; i < bits.size(); ++i)
+		bits[i] &= _c.bits[i];
+	return *this;
+}
+
+string LogIndex::Chunk::encode() const
+{
+	unsigned count = 0;
+	for (auto w: bits)
+		count += __builtin_popcountll(w);
+
+	string ret;
+	if (count * 2 < bits.size() * 8)
+	{
+		ret.reserve(1 + count * 2);
+		ret.push_back(c_array);
+		for (unsigned i = 0; i < c_chunkSize; ++i)
+			if (test(i))
+			{
+				ret.push_back((char)(i >> 8));
+				ret.push_back((char)(i & 0xff));
+			}
+	}
+	else
+	{
+		ret.reserve(1 + bits.size() * 8);
+		ret.push_back(c_bitmap);
+		for (auto w: bits)
+			for (unsigned b = 0; b < 8; ++b)
+				ret.push_back((char)(w >> (b * 8)));
+	}
+	return ret;
+}
+
+LogIndex::Chunk LogIndex::Chunk::decode(string const& _s)
+{
+	Chunk ret;
+	if (_s.empty())
+		return ret;
+	auto p = (uint8_t const*)_s.data() + 1;
+	if (_s[0] == c_array)
+	{
+		for (size_t i = 1; i + 1 < _s.size(); i += 2, p += 2)
+			ret.set((unsigned(p[0]) << 8 | p[1]) % c_chunkSize);
+	}
+	else if (_s.size() == 1 + ret.bits.size() * 8)
+	{
+		for (auto& w: ret.bits)
+			for (unsigned b = 0; b < 8; ++b)
+				w |= uint64_t(*p++) << (b * 8);
+	}
+	return ret;
+}
+
+LogIndex::LogIndex(ldb::DB* _db, function<string(string const&)> const& _decrypt):
+	m_db(_db),
+	m_decrypt(_decrypt)
+{
+}
+
+string LogIndex::key(h256 const& _term, unsigned _position, unsigned _chunk)
+{
+	// 38 bytes, so it can't collide with the 33 byte keys of the other extras
+	string ret((char const*)_term.data(), h256::size);
+	ret.push_back((char)ExtraLogIndex);
+	ret.push_back((char)_position);
+	for (int s = 24; s >= 0; s -= 8)
+		ret.push_back((char)(_chunk >> s));
+	return ret;
+}
+
+string LogIndex::read(string const& _key) const
+{
+	string ret;
+	m_db->Get(ldb::ReadOptions(), ldb::Slice(_key), &ret);
+	if (m_decrypt && !ret.empty())
+		ret = m_decrypt(ret);
+	return ret;
+}
+
+void LogIndex::open(unsigned _head)
+{
+	string marker = read(c_markerKey);
+	if (marker.empty())
+	{
+		// nothing indexed yet: only blocks imported from now on are covered
+		m_from = _head ? _head + 1 : 0;
+		return;
+	}
+
+	RLP r(marker);
+	unsigned from = r[0].toInt<unsigned>();
+	unsigned to = r[1].toInt<unsigned>();
+	if (to < _head)
+	{
+		LOG(WARNING) << "Log index covers blocks up to" << to << "only, chain head is" << _head << "; run with --rebuild-logindex to cover the whole chain";
+		m_from = _head + 1;
+	}
+	else
+		m_from = from;
+}
+
+LogIndex::Chunk& LogIndex::pending(h256 const& _term, unsigned _position, unsigned _chunk)
+{
+	string k = key(_term, _position, _chunk);
+	auto it = m_pending.find(k);
+	if (it == m_pending.end())
+		it = m_pending.emplace(k, Chunk::decode(read(k))).first;
+	return it->second;
+}
+
+void LogIndex::add(unsigned _number, TransactionReceipts const& _receipts)
+{
+	unsigned chunk = _number >> c_chunkBits;
+	unsigned offset = _number % c_chunkSize;
+	Guard l(x_pending);
+	for (auto const& r: _receipts)
+		for (auto const& e: r.log())
+		{
+			pending(h256(e.address), 0, chunk).set(offset);
+			for (unsigned i = 0; i < e.topics.size() && i < 4; ++i)
+				pending(e.topics[i], i + 1, chunk).set(offset);
+		}
+}
+
+void LogIndex::writeMarker(unsigned _head, BatchEncrypto& io_batch) const
+{
+	RLPStream s(2);
+	s << m_from.load() << _head;
+	io_batch.Put(ldb::Slice(c_markerKey), (ldb::Slice)dev::ref(s.out()));
+}
+
+void LogIndex::commit(unsigned _head, BatchEncrypto& io_batch)
+{
+	Guard l(x_pending);
+	for (auto const& p: m_pending)
+		io_batch.Put(ldb::Slice(p.first), ldb::Slice(p.second.encode()));
+	m_pending.clear();
+	writeMarker(_head, io_batch);
+}
+
+void LogIndex::rebuild(unsigned _head, function<TransactionReceipts(unsigned)> const& _receipts, function<void(unsigned, unsigned)> const& _progress)
+{
+	LOG(INFO) << "Rebuilding log index of" << _head << "blocks";
+	for (unsigned n = 1; n <= _head; ++n)
+	{
+		add(n, _receipts(n));
+		if (n % c_batchBlocks && n != _head)
+			continue;
+
+		// coverage only widens with the last batch, so an interrupted rebuild is redone
+		if (n == _head)
+			m_from = 0;
+		BatchEncrypto batch;
+		commit(_head, batch);
+		ldb::Status o = m_db->Write(ldb::WriteOptions(), &batch);
+		if (!o.ok())
+		{
+			LOG(ERROR) << "Error writing log index: " << o.ToString();
+			exit(-1);
+		}
+		if (_progress)
+			_progress(n, _head);
+	}
+	m_from = 0;
+	LOG(INFO) << "Log index rebuilt";
+}
+
+LogIndex::Chunks LogIndex::unite(vector<h256> const& _terms, unsigned _position, vector<unsigned> const& _chunks) const
+{
+	// point lookups rather than an iterator, since not every extras backend can iterate
+	Chunks ret;
+	for (auto const& t: _terms)
+		for (unsigned c: _chunks)
+		{
+			string v = read(key(t, _position, c));
+			if (!v.empty())
+				ret[c] |= Chunk::decode(v);
+		}
+	return ret;
+}
+
+bool LogIndex::candidates(LogFilter const& _f, unsigned _earliest, unsigned _latest, vector<unsigned>& o_blocks) const
+{
+	if (_f.isRangeFilter() || _earliest < m_from || _earliest > _latest)
+		return false;
+
+	// the filter matches an address in any of its addresses and, for each constrained topic
+	// position, a topic in any of its topics there
+	vector<pair<unsigned, vector<h256>>> groups;
+	if (!_f.addresses().empty())
+	{
+		groups.push_back({0, {}});
+		for (auto const& a: _f.addresses())
+			groups.back().second.push_back(h256(a));
+	}
+	for (unsigned i = 0; i < 4; ++i)
+		if (!_f.topics()[i].empty())
+			groups.push_back({i + 1, vector<h256>(_f.topics()[i].begin(), _f.topics()[i].end())});
+
+	// later groups are only looked up in the chunks the earlier ones left
+	vector<unsigned> chunks;
+	for (unsigned c = _earliest >> c_chunkBits; c <= _latest >> c_chunkBits; ++c)
+		chunks.push_back(c);
+	Chunks matching;
+	for (size_t g = 0; g < groups.size() && !chunks.empty(); ++g)
+	{
+		Chunks u = unite(groups[g].second, groups[g].first, chunks);
+		if (!g)
+			matching.swap(u);
+		else
+			for (auto it = matching.begin(); it != matching.end();)
+			{
+				auto other = u.find(it->first);
+				if (other == u.end() || (it->second &= other->second).empty())
+					it = matching.erase(it);
+				else
+					++it;
+			}
+		chunks.clear();
+		for (auto const& c: matching)
+			chunks.push_back(c.first);
+	}
+
+	for (auto const& c: matching)
+		for (unsigned w = 0; w < c.second.bits.size(); ++w)
+			for (uint64_t bits = c.second.bits[w]; bits; bits &= bits - 1)
+			{
+				unsigned n = (c.first << c_chunkBits) + w * 64 + __builtin_ctzll(bits);
+				if (n >= _earliest && n <= _latest)
+					o_blocks.push_back(n);
+			}
+	return true;
+}
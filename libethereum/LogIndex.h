@@ -0,0 +1,120 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: LogIndex.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <libdevcore/db.h>
+#include <libdevcore/Guards.h>
+#include "TransactionReceipt.h"
+
+class BatchEncrypto;
+
+namespace dev
+{
+namespace eth
+{
+
+class LogFilter;
+
+/**
+ * Secondary index of the extras database from log address and topic to the numbers of the
+ * blocks that emitted them, so eth_getLogs can intersect posting lists instead of loading the
+ * receipts of every block whose bloom happens to match.
+ *
+ * As in roaring bitmaps, each posting list is split in chunks of c_chunkSize blocks stored as
+ * a sorted array of 16 bit offsets while sparse and as a bitmap once that is smaller. The
+ * index is a superset: blocks of abandoned forks stay in it, so matches are still checked
+ * against the receipts.
+ */
+class LogIndex
+{
+public:
+	static const unsigned c_chunkBits = 12;
+	static const unsigned c_chunkSize = 1 << c_chunkBits;
+
+	/// Posting list of one term over one chunk.
+	struct Chunk
+	{
+		std::array<uint64_t, c_chunkSize / 64> bits;
+
+		Chunk() { bits.fill(0); }
+		void set(unsigned _offset) { bits[_offset / 64] |= uint64_t(1) << (_offset % 64); }
+		bool test(unsigned _offset) const { return bits[_offset / 64] & (uint64_t(1) << (_offset % 64)); }
+		bool empty() const;
+		Chunk& operator|=(Chunk const& _c);
+		Chunk& operator&=(Chunk const& _c);
+
+		std::string encode() const;
+		static Chunk decode(std::string const& _s);
+	};
+
+	/// @a _decrypt turns a stored value back into plain text; empty when the database isn't encrypted.
+	LogIndex(ldb::DB* _db, std::function<std::string(std::string const&)> const& _decrypt);
+
+	/// Reads the coverage marker for a chain whose head is @a _head. Blocks imported while the
+	/// index was switched off are not covered until rebuild() has run.
+	void open(unsigned _head);
+
+	/// Lowest block from which on every imported block is indexed.
+	unsigned indexedFrom() const { return m_from; }
+
+	/// Queues the log addresses and topics of the receipts of block @a _number.
+	void add(unsigned _number, TransactionReceipts const& _receipts);
+	/// Moves the postings queued by add() and the coverage up to @a _head into @a io_batch.
+	void commit(unsigned _head, BatchEncrypto& io_batch);
+
+	/// Indexes blocks 1 to @a _head, reading their receipts through @a _receipts, and marks the
+	/// whole chain as covered. Must not run concurrently with imports.
+	void rebuild(unsigned _head, std::function<TransactionReceipts(unsigned)> const& _receipts, std::function<void(unsigned, unsigned)> const& _progress);
+
+	/// Numbers of the blocks between @a _earliest and @a _latest, in ascending order, that may
+	/// hold logs matching @a _f.
+	/// @returns false if @a _f names neither address nor topic or the range isn't covered.
+	bool candidates(LogFilter const& _f, unsigned _earliest, unsigned _latest, std::vector<unsigned>& o_blocks) const;
+
+private:
+	using Chunks = std::map<unsigned, Chunk>;
+
+	/// @returns the key of chunk @a _chunk of @a _term; @a _position is 0 for addresses and 1-4 for topics.
+	static std::string key(h256 const& _term, unsigned _position, unsigned _chunk);
+	/// @returns the union of the postings of @a _terms over @a _chunks, leaving out empty chunks.
+	Chunks unite(std::vector<h256> const& _terms, unsigned _position, std::vector<unsigned> const& _chunks) const;
+	Chunk& pending(h256 const& _term, unsigned _position, unsigned _chunk);
+	std::string read(std::string const& _key) const;
+	void writeMarker(unsigned _head, BatchEncrypto& io_batch) const;
+
+	ldb::DB* m_db;
+	std::function<std::string(std::string const&)> m_decrypt;
+	std::atomic<unsigned> m_from{0};
+
+	Mutex x_pending;
+	std::map<std::string, Chunk> m_pending;
+};
+
+}
+}
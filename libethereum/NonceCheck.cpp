@@ -23,6 +23,8 @@
 
 #include <libethereum/NonceCheck.h>
 #include <libdevcore/Common.h>
+#include <libdevcore/SHA3.h>
+#include <atomic>
 
 using namespace dev;
 
@@ -35,40 +37,53 @@ u256 NonceCheck::maxblocksize=1000;
 
 void NonceCheck::init(BlockChain const& _bc)
 {   
-    m_startblk=0;
-    m_endblk=0;   
-
-
     updateCache(_bc,true);
 
 }//fun 
 
 
-std::string NonceCheck::generateKey(Transaction const & _t)
+h256 NonceCheck::generateKey(Transaction const & _t)
 {   
-    Address account=_t.from();
-    std::string key=toHex(account.ref());
-    key += "_"+toString(_t.randomid());
+    bytes key = _t.from().asBytes();
+    key += toBigEndian(_t.randomid());
 
-    return key; 
+    return sha3(key); 
 }
 
-bool NonceCheck::ok(Transaction const & _transaction,bool _needinsert)
+void NonceCheck::insertKeys(h256s const& _keys)
 {
-    DEV_WRITE_GUARDED(m_lock)
+    for (auto const& key : _keys)
     {
-        string key=this->generateKey(_transaction);
-        auto iter=  m_cache.find( key );
-        if( iter != m_cache.end() )
-            return false;
-        if( _needinsert )
-        {
-            m_cache.insert(std::pair<std::string,bool>(key,true));  
-        }
+        Shard& s = shard(key);
+        DEV_WRITE_GUARDED(s.lock)
+            s.keys.insert(key);
+    }
+}
+
+void NonceCheck::eraseKeys(h256s const& _keys)
+{
+    for (auto const& key : _keys)
+    {
+        Shard& s = shard(key);
+        DEV_WRITE_GUARDED(s.lock)
+            s.keys.erase(key);
+    }
+}
 
+bool NonceCheck::ok(Transaction const & _transaction,bool _needinsert)
+{
+    h256 key = generateKey(_transaction);
+    Shard& s = shard(key);
+    DEV_READ_GUARDED(s.lock)
+        if (s.keys.count(key))
+            return false;
 
-        
-    }   
+    if( _needinsert )
+    {
+        DEV_WRITE_GUARDED(s.lock)
+            if (!s.keys.insert(key).second)
+                return false;
+    }
 
     return true;
 }
@@ -77,94 +92,119 @@ bool NonceCheck::ok(Transaction const & _transaction,bool _needinsert)
 
 void NonceCheck::delCache( Transactions const & _transcations)
 {
-    DEV_WRITE_GUARDED(m_lock)
+    h256s keys;
+    keys.reserve(_transcations.size());
+    for (auto const& t : _transcations)
+        keys.push_back(generateKey(t));
+    eraseKeys(keys);
+}
+
+void NonceCheck::expire_WITH_LOCK(unsigned _last)
+{
+    m_endblk = _last;
+    m_startblk = _last > (unsigned)NonceCheck::maxblocksize ? _last - (unsigned)NonceCheck::maxblocksize : 0;
+    while (!m_blocks.empty() && m_blocks.front().first < m_startblk)
     {
-        for( unsigned i=0;i<_transcations.size();i++)
-        {
-            string key=this->generateKey(_transcations[i]);
-            auto iter=  m_cache.find( key );
-            if( iter != m_cache.end() )
-                m_cache.erase(iter);   
-        }//for 
+        eraseKeys(m_blocks.front().second);
+        m_blocks.pop_front();
     }
 }
 
+void NonceCheck::addBlock(unsigned _number, Transactions const& _transactions)
+{
+    h256s keys;
+    keys.reserve(_transactions.size());
+    for (auto const& t : _transactions)
+        keys.push_back(generateKey(t));
 
+    DEV_GUARDED(x_blocks)
+    {
+        insertKeys(keys);
+        m_blocks.emplace_back(_number, std::move(keys));
+        expire_WITH_LOCK(_number);
+    }
+}
+
+std::vector<h256s> NonceCheck::loadKeys(BlockTransactions const& _transactions, unsigned _from, unsigned _to) const
+{
+    std::vector<h256s> ret(_to >= _from ? _to - _from + 1 : 0);
+    if (ret.empty())
+        return ret;
+
+    // sender recovery dominates, so spread the blocks over a few threads
+    unsigned threads = std::min<unsigned>(std::max(std::thread::hardware_concurrency(), 1u), 8);
+    threads = std::min<unsigned>(threads, ret.size());
+    std::atomic<unsigned> next(0);
+    auto load = [&]()
+    {
+        for (unsigned i = next++; i < ret.size(); i = next++)
+        {
+            try
+            {
+                std::vector<bytes> bytestrans = _transactions(_from + i);
+                ret[i].reserve(bytestrans.size());
+                for (auto const& b : bytestrans)
+                    ret[i].push_back(generateKey(Transaction(b, CheckTransaction::None)));
+            }
+            catch (...)
+            {
+                LOG(WARNING) << "NonceCheck::loadKeys block " << (_from + i) << " " << boost::current_exception_diagnostic_information();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+        workers.emplace_back(load);
+    load();
+    for (auto& w : workers)
+        w.join();
+    return ret;
+}
 
 void NonceCheck::updateCache(BlockChain const& _bc,bool _rebuild)
+{
+    updateCache(_bc.number(), [&](unsigned _number) { return _bc.transactions(_bc.numberHash(_number)); }, _rebuild);
+}
+
+void NonceCheck::updateCache(unsigned _last, BlockTransactions const& _transactions, bool _rebuild)
 { 
-  
-    DEV_WRITE_GUARDED(m_lock)
+    DEV_GUARDED(x_blocks)
     {
         try
         {
             Timer timer;
-            unsigned lastnumber=_bc.number();
-
-             
-            unsigned prestartblk=m_startblk;
+            unsigned lastnumber=_last;
             unsigned preendblk=m_endblk;
 
-            m_endblk=lastnumber;
-            if( lastnumber >(unsigned)NonceCheck::maxblocksize )
-                m_startblk=lastnumber-(unsigned)NonceCheck::maxblocksize;
-            else
-                m_startblk=0;
-           
-            LOG(TRACE)<<"NonceCheck::updateCache m_startblk="<<m_startblk<<",m_endblk="<<m_endblk<<",prestartblk="<<prestartblk<<",preendblk="<<preendblk<<",_rebuild="<<_rebuild;
             if( _rebuild ) 
             {
-                m_cache.clear();
+                for (auto& s : m_shards)
+                    DEV_WRITE_GUARDED(s.lock)
+                        s.keys.clear();
+                m_blocks.clear();
                 preendblk=0;
             }
-            else
+
+            expire_WITH_LOCK(lastnumber);
+
+            unsigned from = std::max((m_blocks.empty() ? preendblk : m_blocks.back().first) + 1, m_startblk);
+            std::vector<h256s> loaded = loadKeys(_transactions, from, m_endblk);
+            for (unsigned i = 0; i < loaded.size(); ++i)
             {
-                
-                 for( unsigned  i=prestartblk;i<m_startblk;i++)
-                {
-                    h256 blockhash=_bc.numberHash(i);
-
-                    std::vector<bytes> bytestrans=_bc.transactions(blockhash);
-                    for( unsigned j=0;j<bytestrans.size();j++)
-                    {
-                            Transaction	t = Transaction(bytestrans[j], CheckTransaction::None);
-                            string key=this->generateKey(t);
-                            auto iter=  m_cache.find( key );
-                            if( iter != m_cache.end() )
-                                m_cache.erase(iter);   
-                    }//for 
-                }//for
+                insertKeys(loaded[i]);
+                m_blocks.emplace_back(from + i, std::move(loaded[i]));
             }
-           
-            
-            for( unsigned  i=std::max(preendblk+1,m_startblk);i<=m_endblk;i++)
-            {
-                h256 blockhash=_bc.numberHash(i);
-
-                std::vector<bytes> bytestrans=_bc.transactions(blockhash);
-                for( unsigned j=0;j<bytestrans.size();j++)
-                {
-                        Transaction	t = Transaction(bytestrans[j], CheckTransaction::None);
-                        string key=this->generateKey(t);
-                        auto iter=  m_cache.find( key );
-                        if( iter == m_cache.end() )
-                            m_cache.insert(std::pair<std::string,bool>(key,true));   
-                }//for 
-            }//for
-                
-            LOG(TRACE)<<"NonceCheck::updateCache cache size="<<m_cache.size()<<",cost"<<(timer.elapsed() * 1000);
 
+            size_t size = 0;
+            for (auto const& b : m_blocks)
+                size += b.second.size();
+            LOG(TRACE)<<"NonceCheck::updateCache m_startblk="<<m_startblk<<",m_endblk="<<m_endblk<<",preendblk="<<preendblk<<",_rebuild="<<_rebuild<<",loaded="<<loaded.size()<<" blocks,cache size="<<size<<",cost"<<(timer.elapsed() * 1000);
         }
         catch (...)
         {
             // should not happen as exceptions 
             LOG(WARNING) << "o NO!!!!  NonceCheck::updateCache " << boost::current_exception_diagnostic_information();
-            //m_aborting=true;
         }
     }
-      
-    
 }//fun
-
-
-
@@ -24,6 +24,10 @@
 
 #pragma once
 
+#include <array>
+#include <deque>
+#include <functional>
+#include <unordered_set>
 #include <libdevcore/Common.h>
 #include <libdevcore/Guards.h>
 #include <libdevcore/easylog.h>
@@ -44,20 +48,47 @@ namespace eth
 {
 
 
+/**
+ * Replay protection: remembers sender+randomid of the transactions in the last maxblocksize blocks.
+ * Keys are the hash of sender and randomid, kept in sharded sets so concurrent ok() checks only
+ * take a shard read lock, and bucketed per block so that expiring a block never touches the DB.
+ */
 class NonceCheck 
 {
 private:   
-   
-    std::unordered_map< std::string,bool  > m_cache;    
-    unsigned m_startblk;  
-    unsigned m_endblk;  
+    static const unsigned c_shards = 16;
 
-    
+    struct Shard
+    {
+        mutable SharedMutex lock;
+        std::unordered_set<h256> keys;
+    };
+
+    std::array<Shard, c_shards> m_shards;
+
+    /// Keys of each cached block, oldest first.
+    std::deque<std::pair<unsigned, h256s>> m_blocks;
+    unsigned m_startblk = 0;
+    unsigned m_endblk = 0;
+    mutable Mutex x_blocks;
+
+    static h256 generateKey(Transaction const & _t);
+    Shard& shard(h256 const& _key) { return m_shards[_key[0] % c_shards]; }
+
+    void insertKeys(h256s const& _keys);
+    void eraseKeys(h256s const& _keys);
+
+    /// Drop the blocks that fell out of the window ending at _last. Requires x_blocks.
+    void expire_WITH_LOCK(unsigned _last);
+
+public:
+    /// The RLP transactions of the block with the given number.
+    using BlockTransactions = std::function<std::vector<bytes>(unsigned)>;
+
+private:
+    /// Decode the keys of blocks [_from, _to], in parallel.
+    std::vector<h256s> loadKeys(BlockTransactions const& _transactions, unsigned _from, unsigned _to) const;
 
-    mutable SharedMutex  m_lock;
-    
-   std::string generateKey(Transaction const & _t);  
-   
 public:
     static u256    maxblocksize;
 
@@ -71,9 +102,14 @@ public:
 	void init(BlockChain const& _bc);
 	
     bool ok(Transaction const & _transaction,bool _needinsert=false);
-   
 
+    /// Record the transactions of the newly imported head block and expire the ones out of the window.
+    void addBlock(unsigned _number, Transactions const& _transactions);
+
+    /// Catch up with the chain head from the DB, or reload the whole window if _rebuild.
     void updateCache(BlockChain const& _bc,bool _rebuild=false);
+    /// The same, with the head at _last and the blocks read through _transactions.
+    void updateCache(unsigned _last, BlockTransactions const& _transactions, bool _rebuild=false);
 
     void delCache( Transactions const & _transcations);
 
@@ -0,0 +1,433 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SnapshotSync.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "SnapshotSync.h"
+
+#include <set>
+#include <unordered_map>
+#include <libdevcrypto/Common.h>
+#include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
+#include <libdevcore/SHA3.h>
+#include <libethcore/CommonJS.h>
+#include <libethcore/Exceptions.h>
+#include "BlockChain.h"
+#include "EthereumHost.h"
+#include "EthereumPeer.h"
+#include "NodeConnParamsManagerApi.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// How long peers get to offer their snapshots after the first one connected.
+static chrono::seconds const c_manifestWait = chrono::seconds(5);
+static chrono::seconds const c_requestTimeout = chrono::seconds(10);
+static chrono::seconds const c_reportInterval = chrono::seconds(5);
+/// Trie nodes asked for at once; the peer sends what's below them too, up to a packet.
+static const unsigned c_nodesAsk = 64;
+/// Nodes already in the state DB walked for one request.
+static const unsigned c_localWalk = 4096;
+
+namespace
+{
+
+/// The miners this node knows of, by index, as PBFT orders them.
+h512s trustedMiners()
+{
+	map<string, NodeConnParams> all;
+	NodeConnManagerSingleton::GetInstance().getAllNodeConnInfo(-1, all);
+	h512s ret;
+	for (auto const& i: all)
+		if (i.second._iIdentityType == EN_ACCOUNT_TYPE_MINER)
+		{
+			auto idx = static_cast<unsigned>(i.second._iIdx);
+			if (idx >= ret.size())
+				ret.resize(idx + 1);
+			ret[idx] = jsToPublic(toJS(i.second._sNodeId));
+		}
+	return ret;
+}
+
+}
+
+SnapshotSync::SnapshotSync(EthereumHost& _host, unsigned _quorum):
+	m_host(_host),
+	m_quorum(_quorum),
+	m_db(_host.db())
+{
+	if (m_quorum)
+		m_phase = Phase::Manifests;
+}
+
+bool SnapshotSync::isActive() const
+{
+	Guard l(x_sync);
+	return m_phase == Phase::Manifests || m_phase == Phase::Download || m_phase == Phase::Install;
+}
+
+unsigned SnapshotSync::number() const
+{
+	Guard l(x_sync);
+	return m_manifest.number;
+}
+
+void SnapshotSync::onPeerStatus(shared_ptr<EthereumPeer> _peer)
+{
+	Guard l(x_sync);
+	if (m_phase != Phase::Manifests && m_phase != Phase::Download)
+		return;
+	// started by any peer, so that block sync isn't held up if none of them serves snapshots
+	if (m_phase == Phase::Manifests && m_deadline == chrono::steady_clock::time_point())
+		m_deadline = chrono::steady_clock::now() + c_manifestWait;
+	if (!_peer->servesSnapshots())
+		return;
+
+	Peer& p = m_peers[_peer->id()];
+	if (p.request)
+		requeue(p);
+	p = Peer();
+	p.peer = _peer;
+	request(_peer, p, SnapshotPart::Manifest, rlpList());
+}
+
+void SnapshotSync::request(shared_ptr<EthereumPeer> const& _peer, Peer& _p, SnapshotPart _part, bytes const& _args)
+{
+	_p.request = m_nextRequest++;
+	_p.part = _part;
+	_p.asked = chrono::steady_clock::now();
+	_peer->requestSnapshotData(_p.request, _part, _args);
+}
+
+void SnapshotSync::onPeerSnapshotData(shared_ptr<EthereumPeer> _peer, RLP const& _r)
+{
+	Guard l(x_sync);
+	auto it = m_peers.find(_peer->id());
+	if (it == m_peers.end() || !it->second.request || _r[0].toInt<unsigned>() != it->second.request)
+	{
+		LOG(TRACE) << "Snapshot data from " << _peer->id() << " we didn't ask for";
+		return;
+	}
+
+	Peer& p = it->second;
+	p.request = 0;
+	try
+	{
+		switch (p.part)
+		{
+		case SnapshotPart::Manifest:
+			onManifest(it->first, p, _r[2]);
+			break;
+		case SnapshotPart::Nodes:
+			onNodes(p, _r[2]);
+			break;
+		case SnapshotPart::SideChunk:
+			onChunk(p, _r[2]);
+			break;
+		}
+	}
+	catch (...)
+	{
+		LOG(WARNING) << "Bad snapshot data from " << _peer->id() << ", not asking it any more: " << boost::current_exception_diagnostic_information();
+		requeue(p);
+		m_peers.erase(it);
+		return;
+	}
+
+	if (m_phase == Phase::Download)
+		askPeers();
+}
+
+void SnapshotSync::onManifest(p2p::NodeID const& _id, Peer& _p, RLP const& _r)
+{
+	// a peer asked again after reconnecting votes once, for what it offers last
+	for (auto it = m_offered.begin(); it != m_offered.end();)
+		if (it->second.second.erase(_id) && it->second.second.empty())
+			it = m_offered.erase(it);
+		else
+			++it;
+
+	if (!_r.isList() || !_r.itemCount())
+		return;
+
+	SnapshotManifest m(_r);
+	checkSeal(m);
+	_p.manifest = m.id();
+	auto& offered = m_offered[_p.manifest];
+	if (offered.second.empty())
+		offered.first = move(m);
+	offered.second.insert(_id);
+}
+
+void SnapshotSync::checkSeal(SnapshotManifest const& _m) const
+{
+	// the header checks a block gets before its transactions are executed
+	m_host.chain().verifyBlock(&_m.block, nullptr, ImportRequirements::ValidSeal | ImportRequirements::CheckTransactions);
+
+	// and it must be signed by as many of the miners we know of as PBFT commits a block with; the
+	// miners the peers say signed it don't count, they're only as trustworthy as the peers
+	h512s miners = trustedMiners();
+	BlockHeader header(_m.block);
+	if (miners.empty() || header.nodeList() != miners)
+	{
+		LOG(WARNING) << "Snapshot #" << _m.number << " was sealed by other miners than the " << miners.size() << " we know of";
+		BOOST_THROW_EXCEPTION(CheckSignFailed());
+	}
+	auto signs = RLP(_m.block)[4].toVector<pair<u256, Signature>>();
+	if (signs.size() < miners.size() - (miners.size() - 1) / 3)
+		BOOST_THROW_EXCEPTION(CheckSignFailed());
+	h256 hash = header.hash(WithoutSeal);
+	set<u256> signers;
+	for (auto const& i: signs)
+		if (i.first >= miners.size() || !signers.insert(i.first).second || !dev::verify(miners[(unsigned)i.first], i.second, hash))
+			BOOST_THROW_EXCEPTION(CheckSignFailed());
+}
+
+void SnapshotSync::onNodes(Peer& _p, RLP const& _r)
+{
+	static auto& downloaded = metrics::counter("snapshot_sync_bytes_total", "Bytes of state snapshot downloaded", {{"part", "nodes"}});
+
+	if (!_r.itemCount())
+		BOOST_THROW_EXCEPTION(InvalidSnapshotData());
+
+	// every node must be one we asked for or one that a node before it refers to
+	unordered_map<h256, SnapshotNodeKind> expected;
+	for (auto const& w: _p.nodes)
+		expected.emplace(w.second, w.first);
+	for (auto const& n: _r)
+	{
+		SnapshotNodeKind kind = (SnapshotNodeKind)n[0].toInt<byte>();
+		bytesConstRef node = n[1].toBytesConstRef();
+		auto e = expected.find(sha3(node));
+		if (e == expected.end() || e->second != kind)
+			BOOST_THROW_EXCEPTION(InvalidSnapshotData());
+
+		m_db.insert(e->first, node);
+		expected.erase(e);
+		StateSnapshot::forEachChild(kind, node, [&](SnapshotNodeKind _kind, h256 const& _h) { expected.emplace(_h, _kind); });
+		++m_nodes;
+		m_bytes += node.size();
+		downloaded.inc(node.size());
+	}
+	m_db.commit();
+
+	// what we asked for and didn't get, and what's below what we got
+	for (auto const& e: expected)
+		m_wanted.emplace_back(e.second, e.first);
+	_p.nodes.clear();
+}
+
+void SnapshotSync::onChunk(Peer& _p, RLP const& _r)
+{
+	static auto& downloaded = metrics::counter("snapshot_sync_bytes_total", "Bytes of state snapshot downloaded", {{"part", "side"}});
+
+	if (sha3(_r.data()) != m_manifest.chunks[_p.chunk].hash)
+		BOOST_THROW_EXCEPTION(InvalidSnapshotData());
+	m_chunks[_p.chunk] = _r.data().toBytes();
+	m_bytes += _r.data().size();
+	downloaded.inc(_r.data().size());
+}
+
+void SnapshotSync::requeue(Peer& _p)
+{
+	if (_p.part == SnapshotPart::Nodes)
+		m_wanted.insert(m_wanted.end(), _p.nodes.begin(), _p.nodes.end());
+	else if (_p.part == SnapshotPart::SideChunk && _p.chunk < m_chunks.size() && m_chunks[_p.chunk].empty())
+		m_chunksWanted.push_back(_p.chunk);
+	_p.nodes.clear();
+}
+
+void SnapshotSync::choose()
+{
+	unsigned head = m_host.chain().number();
+	unsigned interval = m_host.chain().chainParams().snapshotInterval;
+
+	// f peers may be faulty, so fewer than f + 1 alike prove nothing about the side DBs
+	size_t miners = trustedMiners().size();
+	unsigned least = miners ? (miners - 1) / 3 + 1 : 1;
+	if (m_quorum < least)
+	{
+		LOG(ERROR) << "snapshotSync " << m_quorum << " is below f + 1 = " << least << " of " << miners << " miners, syncing blocks";
+		m_phase = Phase::Done;
+		return;
+	}
+
+	auto best = m_offered.end();
+	for (auto it = m_offered.begin(); it != m_offered.end(); ++it)
+		if (it->second.second.size() >= m_quorum && it->second.first.number > head + interval && (best == m_offered.end() || it->second.first.number > best->second.first.number))
+			best = it;
+	if (best == m_offered.end())
+	{
+		LOG(INFO) << "No snapshot ahead of #" << head << " offered by " << m_quorum << " peers, syncing blocks";
+		m_phase = Phase::Done;
+		return;
+	}
+
+	m_manifest = best->second.first;
+	m_id = best->first;
+	m_wanted.assign(1, Wanted(SnapshotNodeKind::State, m_manifest.stateRoot));
+	m_chunks.assign(m_manifest.chunks.size(), bytes());
+	// side chunks first: peers only keep them until two snapshots later
+	m_chunksWanted.clear();
+	for (unsigned i = m_manifest.chunks.size(); i > 0; --i)
+		m_chunksWanted.push_back(i - 1);
+	m_phase = Phase::Download;
+	m_lastReport = chrono::steady_clock::now();
+	LOG(INFO) << "Syncing snapshot #" << m_manifest.number << " " << m_manifest.hash << " offered by " << best->second.second.size() << " peers, state root " << m_manifest.stateRoot;
+}
+
+vector<SnapshotSync::Wanted> SnapshotSync::nextNodes()
+{
+	vector<Wanted> ret;
+	unsigned walked = 0;
+	while (!m_wanted.empty() && ret.size() < c_nodesAsk && walked < c_localWalk)
+	{
+		Wanted w = m_wanted.back();
+		m_wanted.pop_back();
+		if (!m_db.exists(w.second))
+		{
+			ret.push_back(w);
+			continue;
+		}
+
+		// downloaded before the sync was cut short, or there from our own blocks; what's below may not be
+		++walked;
+		string node = m_db.lookup(w.second);
+		StateSnapshot::forEachChild(w.first, bytesConstRef(&node), [&](SnapshotNodeKind _kind, h256 const& _h) { m_wanted.emplace_back(_kind, _h); });
+	}
+	return ret;
+}
+
+void SnapshotSync::askPeers()
+{
+	for (auto it = m_peers.begin(); it != m_peers.end();)
+	{
+		Peer& p = it->second;
+		auto peer = p.peer.lock();
+		if (!peer)
+		{
+			requeue(p);
+			it = m_peers.erase(it);
+			continue;
+		}
+
+		if (!p.request && p.manifest == m_id)
+		{
+			if (!m_chunksWanted.empty())
+			{
+				p.chunk = m_chunksWanted.back();
+				m_chunksWanted.pop_back();
+				RLPStream s(2);
+				s << m_id << p.chunk;
+				request(peer, p, SnapshotPart::SideChunk, s.out());
+			}
+			else
+			{
+				p.nodes = nextNodes();
+				if (!p.nodes.empty())
+				{
+					RLPStream s(p.nodes.size());
+					for (auto const& w: p.nodes)
+						s.appendList(2) << (byte)w.first << w.second;
+					request(peer, p, SnapshotPart::Nodes, s.out());
+				}
+			}
+		}
+		++it;
+	}
+}
+
+void SnapshotSync::tick()
+{
+	bool resume = false;
+	bool install = false;
+	{
+		Guard l(x_sync);
+		auto now = chrono::steady_clock::now();
+		if (m_phase == Phase::Manifests && m_deadline != chrono::steady_clock::time_point() && now >= m_deadline)
+		{
+			choose();
+			resume = m_phase == Phase::Done;
+		}
+		if (m_phase == Phase::Download)
+		{
+			for (auto& i: m_peers)
+				if (i.second.request && now - i.second.asked > c_requestTimeout)
+				{
+					LOG(WARNING) << "Snapshot request to " << i.first << " timed out, not asking it any more";
+					requeue(i.second);
+					i.second.request = 0;
+					i.second.manifest = h256();
+				}
+			askPeers();
+
+			bool busy = false;
+			bool offered = false;
+			for (auto const& i: m_peers)
+			{
+				busy |= i.second.request && i.second.part != SnapshotPart::Manifest;
+				offered |= i.second.manifest == m_id;
+			}
+			if (!busy && m_wanted.empty() && m_chunksWanted.empty())
+			{
+				LOG(INFO) << "Snapshot #" << m_manifest.number << " downloaded: " << m_nodes << " trie nodes, " << m_bytes << " bytes";
+				m_phase = Phase::Install;
+				install = true;
+			}
+			else if (!busy && !offered)
+			{
+				LOG(WARNING) << "No peer left to download snapshot #" << m_manifest.number << " from, syncing blocks";
+				m_phase = Phase::Done;
+				resume = true;
+			}
+			else if (now - m_lastReport >= c_reportInterval)
+			{
+				m_lastReport = now;
+				unsigned chunks = 0;
+				for (auto const& c: m_chunks)
+					chunks += !c.empty();
+				LOG(INFO) << "Snapshot #" << m_manifest.number << ": " << m_nodes << " trie nodes, " << m_bytes << " bytes downloaded, "
+					<< m_wanted.size() << " nodes wanted, " << chunks << "/" << m_chunks.size() << " side chunks";
+			}
+		}
+	}
+
+	// the manifest and chunks don't change while installing
+	if (install && !m_host.installSnapshot(m_manifest, m_chunks))
+		m_host.onSnapshotInstalled(false);
+	if (resume)
+		m_host.resumeBlockSync();
+}
+
+void SnapshotSync::onInstalled(bool _ok)
+{
+	Guard l(x_sync);
+	if (_ok)
+		LOG(INFO) << "Chain now at snapshot #" << m_manifest.number;
+	else
+		LOG(ERROR) << "Installing snapshot #" << m_manifest.number << " failed, syncing blocks";
+	m_phase = Phase::Done;
+	m_peers.clear();
+	m_offered.clear();
+	m_wanted.clear();
+	m_chunks.clear();
+}
@@ -0,0 +1,140 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SnapshotSync.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/OverlayDB.h>
+#include <libp2p/Common.h>
+#include "StateSnapshot.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class EthereumHost;
+class EthereumPeer;
+
+/**
+ * Brings a node far behind its peers up to a snapshot instead of executing every block.
+ *
+ * On startup every peer that serves snapshots is asked for its newest one. Its block must be
+ * signed by enough of the miners this node knows of, as PBFT commits blocks. A few seconds after
+ * the first peer connects, the newest snapshot offered alike by at least the quorum of peers,
+ * which must be more than the f faulty peers PBFT tolerates, is downloaded if it is more than a
+ * snapshot interval ahead of the chain; otherwise block sync starts as usual. Trie nodes are asked from all those peers at once, each checked against the
+ * hash its parent refers to, starting with the state root of the snapshot's header, and written
+ * to the state DB as they come; nodes already there are walked locally, so a download cut short
+ * resumes where it stopped. The side chunks are checked against the manifest. The host then
+ * installs the snapshot and resumes block sync from it. Block sync is paused meanwhile.
+ */
+class SnapshotSync
+{
+public:
+	/// @param _quorum peers that must offer the same snapshot, 0 never to sync from one.
+	SnapshotSync(EthereumHost& _host, unsigned _quorum);
+
+	/// Is block sync paused for a snapshot?
+	bool isActive() const;
+	/// The snapshot being synced, null before it is chosen.
+	unsigned number() const;
+
+	void onPeerStatus(std::shared_ptr<EthereumPeer> _peer);
+	void onPeerSnapshotData(std::shared_ptr<EthereumPeer> _peer, RLP const& _r);
+
+	/// Called by the host when the snapshot was installed, or failed to be.
+	void onInstalled(bool _ok);
+
+	/// Chooses the snapshot, times out requests and keeps every peer asked for something.
+	void tick();
+
+private:
+	enum class Phase
+	{
+		Off,		///< Not syncing from a snapshot.
+		Manifests,	///< Asking peers which snapshots they offer.
+		Download,
+		Install,	///< Waiting for the host to install it.
+		Done
+	};
+
+	using Wanted = std::pair<SnapshotNodeKind, h256>;
+
+	struct Peer
+	{
+		std::weak_ptr<EthereumPeer> peer;
+		h256 manifest;						///< Id of the snapshot the peer offers.
+		unsigned request = 0;				///< Id of the request in flight, 0 for none.
+		SnapshotPart part;
+		std::vector<Wanted> nodes;			///< The nodes asked for.
+		unsigned chunk = 0;					///< The side chunk asked for.
+		std::chrono::steady_clock::time_point asked;
+	};
+
+	void request(std::shared_ptr<EthereumPeer> const& _peer, Peer& _p, SnapshotPart _part, bytes const& _args);
+	void onManifest(p2p::NodeID const& _id, Peer& _p, RLP const& _r);
+	/// Throws unless @a _m's block is sealed by enough of the miners this node knows of.
+	void checkSeal(SnapshotManifest const& _m) const;
+	void onNodes(Peer& _p, RLP const& _r);
+	void onChunk(Peer& _p, RLP const& _r);
+	/// Puts back what @a _p was asked for and wasn't given.
+	void requeue(Peer& _p);
+
+	/// Picks the snapshot to sync once the peers had time to answer.
+	void choose();
+	/// Asks idle peers offering the chosen snapshot for more of it.
+	void askPeers();
+	/// @returns the next nodes to ask for, walking those already in the state DB.
+	std::vector<Wanted> nextNodes();
+	/// Starts block sync again, installing the snapshot first if it's complete.
+	void finish();
+
+	EthereumHost& m_host;
+	unsigned m_quorum;
+	OverlayDB m_db;
+
+	mutable Mutex x_sync;
+	Phase m_phase = Phase::Off;
+	std::chrono::steady_clock::time_point m_deadline;		///< When to choose the snapshot.
+	unsigned m_nextRequest = 1;
+	std::map<p2p::NodeID, Peer> m_peers;
+	std::map<h256, std::pair<SnapshotManifest, std::set<p2p::NodeID>>> m_offered;	///< Manifests peers offer and the peers offering each.
+
+	SnapshotManifest m_manifest;
+	h256 m_id;
+	std::vector<Wanted> m_wanted;							///< Trie nodes to download; a stack, to keep it small.
+	std::vector<bytes> m_chunks;							///< Side chunks, empty until downloaded.
+	std::vector<unsigned> m_chunksWanted;
+	unsigned m_nodes = 0;
+	u256 m_bytes = 0;
+	std::chrono::steady_clock::time_point m_lastReport;
+};
+
+}
+}
@@ -39,6 +39,18 @@ uint64_t LogFlowConstant::TxReportInterval(60); // imin
 uint64_t LogConstant::BroadcastTxInterval(60); // imin
 uint64_t LogConstant::BroadcastBlockInterval(60); // imin
 
+metrics::Histogram& StatTxExecLogGuard::histogram()
+{
+    static auto& h = metrics::histogram("tx_exec_duration_us", "Time spent executing a transaction, in microseconds");
+    return h;
+}
+
+// time spent in every pbft stage, in microseconds
+static metrics::Histogram& pbftStage(char const* _stage)
+{
+    return metrics::histogram("pbft_stage_duration_us", "Time spent in a pbft stage, in microseconds", {{"stage", _stage}});
+}
+
 inline string millisecondsToString(uint64_t&& milliseconds,int offset = 8) 
 {
     uint16_t tmp[4];
@@ -76,6 +88,7 @@ void StartBlockState::handle(StatLogContext& context, const string& str, void* e
 
     // state monitor
     clearAllStateMonitor(context, "init");
+    context.lap();
 
     if (isLeader) 
     {
@@ -103,6 +116,8 @@ void SealedState::handle(StatLogContext& context, const string& str, void* ext)
     context << ": " << millisecondsToString(utcTime());
     // monitor
     statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_SEAL, STAT_BLOCK_PBFT_SEAL, "", 1, context.getCode());
+    static auto& sealTime = pbftStage("seal");
+    sealTime.observe(context.lap());
     bool is_empty_blk = *(bool*)ext;
     
     if (!is_empty_blk) {
@@ -123,10 +138,13 @@ void ExecedState::handle(StatLogContext& context, const string& str, void* ext)
     if (code == 1) // empty block  不参与记时，把succes置-1，表示不记录此时的时间
     {
         statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_EXEC, STAT_BLOCK_PBFT_SEAL, "", -1, context.getCode());
+        context.lap();
     }
     else // normal block
     {
         statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_EXEC, STAT_BLOCK_PBFT_SEAL, "", 1, context.getCode());
+        static auto& execTime = pbftStage("exec");
+        execTime.observe(context.lap());
         statemonitor::recordStateByTimeStart(dev::StatCode::BLOCK_SIGN, LogFlowConstant::PBFTReportInterval, context.getCode());
     }
     context.changeState(std::make_unique<CollectedSignState>());
@@ -140,6 +158,8 @@ void CollectedSignState::handle(StatLogContext& context, const string& str, void
     context << ": " << millisecondsToString(utcTime());
     // monitor
     statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_SIGN, STAT_BLOCK_PBFT_SIGN, "", 1, context.getCode());
+    static auto& signTime = pbftStage("sign");
+    signTime.observe(context.lap());
     statemonitor::recordStateByTimeStart(dev::StatCode::BLOCK_COMMIT, LogFlowConstant::PBFTReportInterval, context.getCode());
 
     context.changeState(std::make_unique<CollectedCommitState>());
@@ -153,6 +173,8 @@ void CollectedCommitState::handle(StatLogContext& context, const string& str, vo
     context << ": " << millisecondsToString(utcTime());
     // monitor
     statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_COMMIT, STAT_BLOCK_PBFT_COMMIT, "", 1, context.getCode());
+    static auto& commitTime = pbftStage("commit");
+    commitTime.observe(context.lap());
     statemonitor::recordStateByTimeStart(dev::StatCode::BLOCK_BLKTOCHAIN, LogFlowConstant::PBFTReportInterval, context.getCode());
 
     context.changeState(std::make_unique<BlkToChainState>());
@@ -166,6 +188,8 @@ void BlkToChainState::handle(StatLogContext& context, const string& str, void*)
     context << ": " << millisecondsToString(utcTime());
     // monitor
     statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_BLKTOCHAIN, STAT_BLOCK_PBFT_CHAIN, "", 1, context.getCode());
+    static auto& chainTime = pbftStage("to_chain");
+    chainTime.observe(context.lap());
 
     context.changeState(std::make_unique<DestoriedState>());
     ((PBFTStatLog*)&context)->m_is_final = true; // 正常转换到了final状态
@@ -180,6 +204,7 @@ void ViewChangeStartState::handle(StatLogContext& context, const string& str, vo
     // clear all
     clearAllStateMonitor(context, "viewchange");
     statemonitor::recordStateByTimeStart(dev::StatCode::BLOCK_VIEWCHANG, LogFlowConstant::PBFTReportInterval, context.getCode());
+    context.lap();
 
     context.changeState(std::make_unique<ViewChangedState>());    
 }
@@ -192,6 +217,8 @@ void ViewChangedState::handle(StatLogContext& context, const string& str, void*)
     context << ": " << millisecondsToString(utcTime());
     // monitor
     statemonitor::recordStateByTimeEnd(dev::StatCode::BLOCK_VIEWCHANG, STAT_BLOCK_PBFT_VIEWCHANGE, "", 1, context.getCode());
+    static auto& viewchangeTime = pbftStage("viewchange");
+    viewchangeTime.observe(context.lap());
     context.changeState(std::make_unique<DestoriedState>());
     ((PBFTStatLog*)&context)->m_is_final = true;
 }
@@ -221,6 +248,7 @@ void TxInitState::handle(StatLogContext& context, const string& str, void*)
     context << ": " << millisecondsToString(utcTime());
     
     statemonitor::recordStateByTimeStart(dev::StatCode::TX_TRACE, LogFlowConstant::TxReportInterval, context.getCode());
+    context.lap();
     context.changeState(std::make_unique<TxToChainState>());
 }
 
@@ -237,6 +265,11 @@ void TxToChainState::handle(StatLogContext& context, const string& str, void* ex
     context << ": " << millisecondsToString(utcTime());
 
     statemonitor::recordStateByTimeEnd(dev::StatCode::TX_TRACE, STAT_TX_TRACE, "", 1, context.getCode());
+    static auto& latency = metrics::histogram("tx_latency_us", "Time from a transaction entering the queue to leaving it, in microseconds");
+    static auto& onChain = metrics::counter("tx_total", "Transactions leaving the queue, by outcome", {{"result", "onchain"}});
+    static auto& discarded = metrics::counter("tx_total", "Transactions leaving the queue, by outcome", {{"result", "discarded"}});
+    latency.observe(context.lap());
+    (is_discarded ? discarded : onChain).inc();
 
     context.changeState(std::make_unique<TxDestoriedState>());
     ((TxStatLog*)&context)->m_is_final = true; 
@@ -252,6 +285,8 @@ void TxDestoriedState::handle(StatLogContext& context, const string& str, void*
             context << "[" << str << "]";
 
         statemonitor::recordStateByTimeEnd(dev::StatCode::TX_TRACE, STAT_TX_TRACE, context.str(), 0, context.getCode());
+        static auto& lost = metrics::counter("tx_total", "Transactions leaving the queue, by outcome", {{"result", "untracked"}});
+        lost.inc();
     }   
     string final_log = context.str();
 
@@ -280,6 +315,8 @@ void TxFlowLog(const u256& hash, const string& str, bool is_discarded, bool is_i
 
 void BroadcastTxSizeLog(const h512 &node_id, size_t packet_size)
 {
+    static auto& size = metrics::histogram("broadcast_packet_bytes", "Size of broadcast packets", {{"type", "tx"}});
+    size.observe(packet_size);
     u256 idx = u256(0);
     if (!NodeConnManagerSingleton::GetInstance().getIdx(node_id, idx))
     {
@@ -292,6 +329,8 @@ void BroadcastTxSizeLog(const h512 &node_id, size_t packet_size)
 
 void BroadcastBlockSizeLog(const h512 &node_id, size_t packet_size)
 {
+    static auto& size = metrics::histogram("broadcast_packet_bytes", "Size of broadcast packets", {{"type", "block"}});
+    size.observe(packet_size);
     u256 idx = u256(0);
     if (!NodeConnManagerSingleton::GetInstance().getIdx(node_id, idx))
     {
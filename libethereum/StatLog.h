@@ -25,6 +25,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/LogGuard.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/Metrics.h>
 
 namespace std 
 {
@@ -44,13 +45,16 @@ namespace eth
 class StatTxExecLogGuard : public TimeIntervalLogGuard 
 {
 public:
-    StatTxExecLogGuard() : TimeIntervalLogGuard(StatCode::TX_EXEC, STAT_TX_EXEC, report_interval) 
+    StatTxExecLogGuard() : TimeIntervalLogGuard(StatCode::TX_EXEC, STAT_TX_EXEC, report_interval), m_timer(histogram())
     { }
 
     void txExecFailed() { m_success = 0; }
 
     static uint64_t report_interval;
+    static metrics::Histogram& histogram();
 
+private:
+    metrics::ScopedTimer m_timer;
 };
 
 class StatLogContext;
@@ -86,6 +90,15 @@ public:
     const u256& getId() const { return m_id; }
     const int& getCode() const { return m_code; }
 
+    /// @returns the microseconds since the previous lap, or since the context was created.
+    uint64_t lap()
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto ret = std::chrono::duration_cast<std::chrono::microseconds>(now - m_lap).count();
+        m_lap = now;
+        return ret;
+    }
+
 protected:
     const u256 m_id;
     bool m_is_final = false;
@@ -95,6 +108,7 @@ protected:
 private:
     std::string m_tag;
     std::unique_ptr<StatLogState> m_state;
+    std::chrono::steady_clock::time_point m_lap = std::chrono::steady_clock::now();
 };
 
 // pbft state flow 
@@ -0,0 +1,329 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: StateSnapshot.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "StateSnapshot.h"
+
+#include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieCommon.h>
+#include <libdevcore/TrieDB.h>
+#include <libethcore/Exceptions.h>
+#include <UTXO/UTXOSharedData.h>
+#include "BlockChain.h"
+#include "CommonNet.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+bytes chunkRLP(vector<pair<string, string>> const& _entries)
+{
+	RLPStream s(_entries.size());
+	for (auto const& e: _entries)
+		s.appendList(2) << e.first << e.second;
+	return s.out();
+}
+
+}
+
+SnapshotManifest::SnapshotManifest(RLP const& _r)
+{
+	number = _r[0].toInt<unsigned>();
+	hash = _r[1].toHash<h256>(RLP::VeryStrict);
+	stateRoot = _r[2].toHash<h256>(RLP::VeryStrict);
+	totalDifficulty = _r[3].toInt<u256>();
+	block = _r[4].toBytes();
+	ancestors = _r[5].toVector<h256>();
+	for (auto const& c: _r[6])
+	{
+		if (c[0].toInt<unsigned>() >= (unsigned)SnapshotSideDB::Count)
+			BOOST_THROW_EXCEPTION(InvalidBlockFormat());
+		chunks.push_back(SnapshotChunk{(SnapshotSideDB)c[0].toInt<byte>(), c[1].toString(), c[2].toInt<unsigned>(), c[3].toHash<h256>(RLP::VeryStrict)});
+	}
+
+	BlockHeader header(block);
+	if (header.hash() != hash || header.number() != number)
+		BOOST_THROW_EXCEPTION(InvalidBlockFormat());
+	if (header.stateRoot() != stateRoot)
+		BOOST_THROW_EXCEPTION(InvalidStateRoot());
+	if (ancestors.size() > 255 || (number && (ancestors.empty() || ancestors.front() != header.parentHash())))
+		BOOST_THROW_EXCEPTION(InvalidParentHash());
+}
+
+bytes SnapshotManifest::rlp() const
+{
+	RLPStream s(7);
+	s << number << hash << stateRoot << totalDifficulty << block;
+	s.appendVector(ancestors);
+	s.appendList(chunks.size());
+	for (auto const& c: chunks)
+		s.appendList(4) << (byte)c.db << c.firstKey << c.count << c.hash;
+	return s.out();
+}
+
+StateSnapshot::StateSnapshot(BlockChain const& _bc, OverlayDB const& _db, unsigned _interval):
+	m_chain(_bc),
+	m_db(_db),
+	m_interval(_interval)
+{
+}
+
+StateSnapshot::~StateSnapshot()
+{
+	if (m_lister.joinable())
+		m_lister.join();
+}
+
+StateSnapshot::Taken::~Taken()
+{
+	for (unsigned i = 0; i < sides.size(); ++i)
+		sideDB((SnapshotSideDB)i)->ReleaseSnapshot(sides[i]);
+}
+
+leveldb::DB* StateSnapshot::sideDB(SnapshotSideDB _db)
+{
+	auto utxo = UTXOModel::UTXOSharedData::getInstance();
+	return _db == SnapshotSideDB::UTXOData ? utxo->getDB() : utxo->getExtraDB();
+}
+
+void StateSnapshot::onBlockImported(BlockHeader const& _info)
+{
+	if (!m_interval || !_info.number() || _info.number() % m_interval)
+		return;
+	if (m_listing)
+	{
+		LOG(WARNING) << "Snapshot #" << _info.number() << " skipped, the one before is still being listed";
+		return;
+	}
+
+	// the side DBs were written with the block, freeze them before the next one
+	auto t = make_shared<Taken>();
+	for (unsigned i = 0; i < (unsigned)SnapshotSideDB::Count; ++i)
+		t->sides.push_back(sideDB((SnapshotSideDB)i)->GetSnapshot());
+
+	t->manifest.number = (unsigned)_info.number();
+	t->manifest.hash = _info.hash();
+	t->manifest.stateRoot = _info.stateRoot();
+	t->manifest.totalDifficulty = m_chain.details(_info.hash()).totalDifficulty;
+	t->manifest.block = m_chain.block(_info.hash());
+	// the block after this one asks for the same hashes, so this doesn't cost the cache anything
+	LastHashes lh = m_chain.lastHashes(_info.hash());
+	for (unsigned i = 1; i < lh.size() && lh[i]; ++i)
+		t->manifest.ancestors.push_back(lh[i]);
+
+	DEV_GUARDED(x_taken)
+	{
+		m_taken.push_back(t);
+		while (m_taken.size() > 2)
+			m_taken.pop_front();
+	}
+
+	if (m_lister.joinable())
+		m_lister.join();
+	m_listing = true;
+	m_lister = thread([=]() { list(t); });
+}
+
+void StateSnapshot::list(shared_ptr<Taken> _t)
+{
+	vector<SnapshotChunk> chunks;
+	try
+	{
+		for (unsigned i = 0; i < _t->sides.size(); ++i)
+		{
+			leveldb::ReadOptions o;
+			o.snapshot = _t->sides[i];
+			o.fill_cache = false;
+			unique_ptr<leveldb::Iterator> it(sideDB((SnapshotSideDB)i)->NewIterator(o));
+
+			vector<pair<string, string>> entries;
+			size_t size = 0;
+			auto flush = [&]() {
+				chunks.push_back(SnapshotChunk{(SnapshotSideDB)i, entries.front().first, (unsigned)entries.size(), sha3(chunkRLP(entries))});
+				entries.clear();
+				size = 0;
+			};
+			for (it->SeekToFirst(); it->Valid(); it->Next())
+			{
+				entries.emplace_back(it->key().ToString(), it->value().ToString());
+				size += it->key().size() + it->value().size();
+				if (entries.size() >= c_chunkEntries || size >= c_chunkBytes)
+					flush();
+			}
+			if (!entries.empty())
+				flush();
+		}
+	}
+	catch (...)
+	{
+		LOG(WARNING) << "Snapshot #" << _t->manifest.number << " not served, listing it failed: " << boost::current_exception_diagnostic_information();
+		m_listing = false;
+		return;
+	}
+
+	DEV_GUARDED(x_taken)
+	{
+		_t->manifest.chunks = move(chunks);
+		_t->id = _t->manifest.id();
+		_t->ready = true;
+	}
+	LOG(INFO) << "Serving snapshot #" << _t->manifest.number << " " << _t->manifest.hash << " with " << _t->manifest.chunks.size() << " side chunks";
+	m_listing = false;
+}
+
+bytes StateSnapshot::serve(SnapshotPart _part, RLP const& _args) const
+{
+	static auto& manifests = metrics::counter("snapshot_served_bytes_total", "Bytes of state snapshot served to syncing nodes", {{"part", "manifest"}});
+	static auto& nodeBytes = metrics::counter("snapshot_served_bytes_total", "Bytes of state snapshot served to syncing nodes", {{"part", "nodes"}});
+	static auto& sideBytes = metrics::counter("snapshot_served_bytes_total", "Bytes of state snapshot served to syncing nodes", {{"part", "side"}});
+
+	bytes ret;
+	switch (_part)
+	{
+	case SnapshotPart::Manifest:
+	{
+		DEV_GUARDED(x_taken)
+			for (auto it = m_taken.rbegin(); it != m_taken.rend() && ret.empty(); ++it)
+				if ((*it)->ready)
+					ret = (*it)->manifest.rlp();
+		if (ret.empty())
+			ret = rlpList();
+		manifests.inc(ret.size());
+		break;
+	}
+	case SnapshotPart::Nodes:
+		ret = nodes(_args);
+		nodeBytes.inc(ret.size());
+		break;
+	case SnapshotPart::SideChunk:
+		ret = sideChunk(_args[0].toHash<h256>(), _args[1].toInt<unsigned>());
+		sideBytes.inc(ret.size());
+		break;
+	default:
+		ret = rlpList();
+		break;
+	}
+	return ret;
+}
+
+bytes StateSnapshot::nodes(RLP const& _wanted) const
+{
+	deque<pair<SnapshotNodeKind, h256>> queue;
+	for (auto const& w: _wanted)
+		if (w[0].toInt<unsigned>() <= (unsigned)SnapshotNodeKind::Code)
+			queue.emplace_back((SnapshotNodeKind)w[0].toInt<byte>(), w[1].toHash<h256>());
+
+	// breadth first, so a node always comes after the one that refers to it
+	h256Hash seen;
+	vector<pair<SnapshotNodeKind, string>> found;
+	size_t size = 0;
+	while (!queue.empty() && found.size() < c_maxSnapshotNodes && size < c_maxPayload)
+	{
+		auto w = queue.front();
+		queue.pop_front();
+		if (!seen.insert(w.second).second)
+			continue;
+
+		string node = m_db.lookup(w.second);
+		if (node.empty())
+			continue;
+		size += node.size();
+		forEachChild(w.first, bytesConstRef(&node), [&](SnapshotNodeKind _kind, h256 const& _h) {
+			if (!seen.count(_h))
+				queue.emplace_back(_kind, _h);
+		});
+		found.emplace_back(w.first, move(node));
+	}
+
+	RLPStream s(found.size());
+	for (auto const& f: found)
+		s.appendList(2) << (byte)f.first << f.second;
+	return s.out();
+}
+
+bytes StateSnapshot::sideChunk(h256 const& _id, unsigned _index) const
+{
+	shared_ptr<Taken> t;
+	DEV_GUARDED(x_taken)
+		for (auto const& i: m_taken)
+			if (i->ready && i->id == _id && _index < i->manifest.chunks.size())
+				t = i;
+	if (!t)
+		return rlpList();
+
+	SnapshotChunk const& c = t->manifest.chunks[_index];
+	leveldb::ReadOptions o;
+	o.snapshot = t->sides[(unsigned)c.db];
+	o.fill_cache = false;
+	unique_ptr<leveldb::Iterator> it(sideDB(c.db)->NewIterator(o));
+
+	vector<pair<string, string>> entries;
+	for (it->Seek(c.firstKey); it->Valid() && entries.size() < c.count; it->Next())
+		entries.emplace_back(it->key().ToString(), it->value().ToString());
+	return chunkRLP(entries);
+}
+
+void StateSnapshot::forEachChild(SnapshotNodeKind _kind, bytesConstRef _node, function<void(SnapshotNodeKind, h256 const&)> const& _f)
+{
+	if (_kind == SnapshotNodeKind::Code)
+		return;
+
+	auto child = [&](RLP const& _c) {
+		if (_c.isList())
+			forEachChild(_kind, _c.data(), _f);
+		else if (_c.isData() && _c.payload().size() == h256::size)
+			_f(_kind, _c.toHash<h256>());
+	};
+	auto value = [&](RLP const& _v) {
+		if (_kind != SnapshotNodeKind::State)
+			return;
+		RLP account(_v.payload());
+		if (!account.isList() || account.itemCount() < 4)
+			return;
+		h256 storageRoot = account[2].toHash<h256>();
+		h256 codeHash = account[3].toHash<h256>();
+		if (storageRoot != EmptyTrie)
+			_f(SnapshotNodeKind::Storage, storageRoot);
+		if (codeHash != EmptySHA3)
+			_f(SnapshotNodeKind::Code, codeHash);
+	};
+
+	RLP r(_node);
+	if (r.isList() && r.itemCount() == 17)
+	{
+		for (unsigned i = 0; i < 16; ++i)
+			child(r[i]);
+		if (!r[16].isEmpty())
+			value(r[16]);
+	}
+	else if (r.isList() && r.itemCount() == 2)
+	{
+		if (isLeaf(r))
+			value(r[1]);
+		else
+			child(r[1]);
+	}
+}
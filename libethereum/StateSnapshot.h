@@ -0,0 +1,162 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: StateSnapshot.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <leveldb/db.h>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/OverlayDB.h>
+#include <libdevcore/RLP.h>
+#include <libethcore/BlockHeader.h>
+
+namespace dev
+{
+namespace eth
+{
+
+class BlockChain;
+
+/// What a snapshot node is, which tells what it refers to.
+enum class SnapshotNodeKind: byte
+{
+	State = 0,		///< Account trie node; leaves refer to storage tries and code.
+	Storage = 1,	///< Storage trie node of an account.
+	Code = 2		///< Contract code.
+};
+
+/// The parts of a snapshot GetSnapshotData asks for.
+enum class SnapshotPart: byte
+{
+	Manifest = 0,	///< [] -> the newest SnapshotManifest, or an empty list.
+	Nodes = 1,		///< [[kind, hash], ...] -> [[kind, node], ...]: those nodes, then their descendants breadth first.
+	SideChunk = 2	///< [manifest id, index] -> [[key, value], ...], or an empty list.
+};
+
+/// The databases besides the state trie that blocks write to and a snapshot carries.
+enum class SnapshotSideDB: byte
+{
+	UTXOData = 0,	///< UTXO tokens and transactions.
+	UTXOExtra = 1,	///< UTXO account list.
+	Count
+};
+
+/// A key range of a side database.
+struct SnapshotChunk
+{
+	SnapshotSideDB db;
+	std::string firstKey;
+	unsigned count;
+	h256 hash;					///< sha3 of the chunk's [[key, value], ...].
+};
+
+struct SnapshotManifest
+{
+	SnapshotManifest() {}
+	/// Reads a peer's manifest, throwing if the block doesn't match the hashes it comes with.
+	explicit SnapshotManifest(RLP const& _r);
+
+	bytes rlp() const;
+	/// Peers offering the same snapshot send manifests with the same id.
+	h256 id() const { return sha3(rlp()); }
+	explicit operator bool() const { return !!hash; }
+
+	unsigned number = 0;
+	h256 hash;
+	h256 stateRoot;
+	u256 totalDifficulty;
+	bytes block;
+	h256s ancestors;			///< Hashes of the 256 blocks before it, parent first, for BLOCKHASH.
+	std::vector<SnapshotChunk> chunks;
+};
+
+/**
+ * Snapshots of the chain state for nodes far behind to download instead of executing every block.
+ *
+ * Every interval blocks the imported block becomes the newest snapshot: its header, the hashes
+ * before it and the side databases as of that block, frozen with leveldb snapshots and listed in
+ * hashed key ranges by a background thread. Blocks are final once imported (PBFT), so every node
+ * serving the same interval offers the same snapshot. Trie nodes are served from the state DB,
+ * which keeps the state of every block. The two newest snapshots are kept so that a download
+ * started before an interval can finish after it.
+ */
+class StateSnapshot
+{
+public:
+	/// @param _interval blocks between snapshots, 0 to serve none.
+	StateSnapshot(BlockChain const& _bc, OverlayDB const& _db, unsigned _interval);
+	~StateSnapshot();
+
+	/// Takes a snapshot of @a _info if it's on the interval. Called after the block is committed.
+	void onBlockImported(BlockHeader const& _info);
+
+	/// @returns the SnapshotData payload answering a request for @a _part with @a _args.
+	bytes serve(SnapshotPart _part, RLP const& _args) const;
+
+	/// Calls @a _f with the kind and hash of every node @a _node refers to, looking into inlined nodes.
+	static void forEachChild(SnapshotNodeKind _kind, bytesConstRef _node, std::function<void(SnapshotNodeKind, h256 const&)> const& _f);
+
+	/// @returns the side database @a _db.
+	static leveldb::DB* sideDB(SnapshotSideDB _db);
+
+private:
+	/// Most entries and bytes in a side chunk, so any chunk fits in one packet.
+	static const unsigned c_chunkEntries = 4096;
+	static const unsigned c_chunkBytes = 128 * 1024;
+
+	struct Taken
+	{
+		~Taken();
+
+		SnapshotManifest manifest;
+		h256 id;
+		bool ready = false;				///< The side chunks are listed.
+		std::vector<leveldb::Snapshot const*> sides;
+	};
+
+	/// Lists the side chunks of @a _t.
+	void list(std::shared_ptr<Taken> _t);
+
+	bytes nodes(RLP const& _wanted) const;
+	bytes sideChunk(h256 const& _id, unsigned _index) const;
+
+	BlockChain const& m_chain;
+	OverlayDB const& m_db;
+	unsigned m_interval;
+
+	mutable Mutex x_taken;
+	std::deque<std::shared_ptr<Taken>> m_taken;		///< Newest last.
+
+	std::thread m_lister;
+	std::atomic<bool> m_listing = { false };
+};
+
+}
+}
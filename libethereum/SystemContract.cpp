@@ -23,9 +23,11 @@
 #include <libdevcore/CommonJS.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <abi/ContractAbiMgr.h>
 
 #include "SystemContract.h"
+#include "SystemContractEvents.h"
 #include <libdevcore/SHA3.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -36,10 +38,12 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
 {
 
 
-    Timer t;
+    static auto& updateTime = metrics::histogram("system_contract_update_duration_us", "Time spent refreshing the system contract caches after a block, in microseconds");
+    metrics::ScopedTimer timer(updateTime);
 
     LOG(TRACE) << "SystemContract::updateSystemContract m_systemproxyaddress=" << toString(m_systemproxyaddress) << ",number=" << m_client->blockChain().number() << "," << m_client->blockChain().info();
    
+    std::shared_ptr<CallSnapshot const> snapshot;
     DEV_WRITE_GUARDED(m_blocklock)
     {
 
@@ -47,7 +51,11 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
         m_tempblock->clearCurrentBytes();
         m_tempblock->setEvmEventLog(true);
         LOG(TRACE) << "SystemContract::updateSystemContract blocknumber=" << m_tempblock->info().number();
+        // taken under the lock, call() executes on the temp block
+        snapshot = std::make_shared<CallSnapshot>(*m_tempblock);
     }
+    DEV_GUARDED(m_snapshotlock)
+        m_snapshot = snapshot;
 
 
     bool configChange = false, nodeChange = false, caChange = false, routeChange = false, coChange = false;
@@ -60,14 +68,14 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
     routeChangeArg.push_back("");
 
 
-    bytes nodehash1 = sha3("cancelNode(string)").ref().cropped(0, 4).toBytes();
-    bytes nodehash2 = sha3("registerNode(string,string,uint256,uint8,string,string,string,uint256)").ref().cropped(0, 4).toBytes();
+    static Selector const nodehash1 = selectorOf("cancelNode(string)");
+    static Selector const nodehash2 = selectorOf("registerNode(string,string,uint256,uint8,string,string,string,uint256)");
 
-    bytes cahash1 = sha3("updateStatus(string,uint8)").ref().cropped(0, 4).toBytes();
-    bytes cahash2 = sha3("update(string,string,string,uint256,uint256,uint8,string,string)").ref().cropped(0, 4).toBytes();
+    static Selector const cahash1 = selectorOf("updateStatus(string,uint8)");
+    static Selector const cahash2 = selectorOf("update(string,string,string,uint256,uint256,uint8,string,string)");
 
-    bytes cohash1 = sha3("addAbi(string,string,string,string,address)").ref().cropped(0, 4).toBytes();
-    bytes cohash2 = sha3("updateAbi(string,string,string,string,address)").ref().cropped(0, 4).toBytes();
+    static Selector const cohash1 = selectorOf("addAbi(string,string,string,string,address)");
+    static Selector const cohash2 = selectorOf("updateAbi(string,string,string,string,address)");
 
     Address configaction;
     Address nodeAction;
@@ -84,39 +92,33 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
 
     for (auto it = m_tempblock->pending().begin(); it != m_tempblock->pending().end(); ++it)
     {
-        LOG(TRACE) << "SystemContract::updateSystemContract ==> abi address => " << contractAbiMgr.hex() << " ,to= > " << (it->to().hex());
+        Address const& to = it->to();
+        if ( it->isCreation() || (to != m_systemproxyaddress && to != configaction && to != nodeAction && to != caAction && to != contractAbiMgr) )
+            continue;
 
-        bytes tempdata = it->data();
-        bytesRef fundata = ref(tempdata);
-        bytes funhash = fundata.cropped(0, 4).toBytes();
-        /*
-        cout<<"funhash="<<toString(funhash)<<"\n";
-        cout<<"cahash1="<<toString(cahash1)<<"\n";
-        cout<<"cahash2="<<toString(cahash2)<<"\n";
-        cout<<"caAction="<<toString(caAction)<<"\n";
-        cout<<"it->to()="<<toString(it->to())<<"\n";*/
+        Selector funhash = selectorOf(*it);
+        bytesConstRef fundata(&it->data());
 
-        if ( (it->to() == m_systemproxyaddress ) && (dev::ZeroAddress != m_systemproxyaddress) ) //命中
+        if ( (to == m_systemproxyaddress ) && (dev::ZeroAddress != m_systemproxyaddress) ) //命中
         {
             routeChange = true;
-            LOG(TRACE) << "SystemContract::updateSystemContract SystemProxy setRoute! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContract::updateSystemContract SystemProxy setRoute! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == configaction   ) && (dev::ZeroAddress != configaction) ) //命中
+        else if ( (to == configaction   ) && (dev::ZeroAddress != configaction) ) //命中
         {
             configChange = true;
-            LOG(TRACE) << "SystemContract::updateSystemContract ConfigAction set! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContract::updateSystemContract ConfigAction set! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == nodeAction ) && (dev::ZeroAddress != nodeAction) && ((funhash == nodehash1) || (funhash == nodehash2) ) ) //命中
+        else if ( (to == nodeAction ) && (dev::ZeroAddress != nodeAction) && ((funhash == nodehash1) || (funhash == nodehash2) ) ) //命中
         {
             nodeChange = true;
-            LOG(TRACE) << "SystemContract::updateSystemContract NodeAction cancelNode|registerNode ! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContract::updateSystemContract NodeAction cancelNode|registerNode ! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == caAction ) && (dev::ZeroAddress != caAction) && ( (funhash == cahash1) || (funhash == cahash2) ) ) //命中
+        else if ( (to == caAction ) && (dev::ZeroAddress != caAction) && ( (funhash == cahash1) || (funhash == cahash2) ) ) //命中
         {
             string hashkey;
 
-            bytes calldata = fundata.cropped(4, fundata.size() - 4).toBytes();
-            bytesConstRef o(&(calldata));
+            bytesConstRef o = fundata.cropped(4);
 
            
             if ( funhash == cahash2 )
@@ -139,24 +141,19 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
 
             caChangeArg.push_back(hashkey);
             caChange = true;
-            LOG(TRACE) << "SystemContract::updateSystemContract CAAction updateStatus|update ! hash=" << hashkey << ", to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContract::updateSystemContract CAAction updateStatus|update ! hash=" << hashkey << ", to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ((it->to() == contractAbiMgr) && (dev::ZeroAddress != contractAbiMgr) && (cohash1 == funhash || funhash == cohash2))
+        else if ((to == contractAbiMgr) && (dev::ZeroAddress != contractAbiMgr) && (cohash1 == funhash || funhash == cohash2))
         {
             coChange = true;
-            //LOG(TRACE) << "SystemContract::updateSystemContract ContractAbiMgr addAbi ! hash=" << funhash << ", to=" << it->to() << ",sha3=" << toString(it->sha3());
         }
 
     }//for
 
-    DEV_WRITE_GUARDED(m_lockfilter)
-    {
-
-        m_filterchecktranscache.clear();
-        m_transcount = 0;
-        m_transcachehit = 0;
-
-    }
+    // a filter's answer changes with the storage of the filter chain, its filters or the groups they
+    // look senders up in, however the block wrote it; blocks that leave them alone keep the cache
+    if (m_filterchecktranscache.refresh([&](Address const& _contract) { return snapshot->storageRoot(_contract); }))
+        LOG(TRACE) << "SystemContract::updateSystemContract clear filter cache, watched contract changed";
 
 
 
@@ -166,6 +163,9 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
         routeChange = true;
         updateRoute();
     }
+    // nothing is watched after a clear, here or in updateRoute
+    if (!m_filterchecktranscache.watches(m_transactionfilter.filter))
+        watchFilters();
     if ( configChange )
     {
         
@@ -179,16 +179,26 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
         nodeChange = true;
         updateNode();
     }//
-    if ( caChange || (m_calist.size() < 1) )
+    if ( m_calist.size() < 1 )
     {
       
         caChange = true;
         updateCa();
     }//
+    else if ( caChange )
+    {
+        // only the certificates named by this block's transactions can have changed
+        updateCa(caChangeArg);
+    }
 
     
-    if (coChange || (0 == libabi::ContractAbiMgr::getInstance()->getContractC()))
+    if (0 == libabi::ContractAbiMgr::getInstance()->getContractC())
+    {
+        updateContractAbiInfo();
+    }
+    else if (coChange && 0 == applyAbiEvents(*m_tempblock, contractAbiMgr))
     {
+        // no AddAbi/UpdateAbi events to go by, read the whole list back
         updateContractAbiInfo();
     }
 
@@ -237,8 +247,6 @@ void SystemContract::updateSystemContract(std::shared_ptr<Block> block)
         }//
     }
 
-    LOG(TRACE) << "SystemContract::updateSystemContract took:" << (t.elapsed() * 1000000);
-
 }
 
 void SystemContract::updateRoute()
@@ -272,8 +280,6 @@ void SystemContract::updateRoute()
         m_transactionfilter.name = "TransactionFilterChain";
 
         m_filterchecktranscache.clear();
-        m_transcount = 0;
-        m_transcachehit = 0;
     }
 
     DEV_READ_GUARDED(m_lockroute)
@@ -330,41 +336,10 @@ void SystemContract::updateCa( )
                 string hashkey = abiOut<string>(ret2.output);
 
                 
-                std::string  hash; 
-                std::string pubkey;
-                std::string orgname;  
-                u256 notbefore;
-                u256 notafter;
-                byte status;
-                u256    blocknumber;
-
-                bytes inputdata4 = abiIn("get(string)", hashkey);
-                ExecutionResult ret4 = call(caAction, inputdata4);
-
-                bytesConstRef o(&(ret4.output));
-                dev::eth::ContractABI().abiOut<>(o, hash, pubkey, orgname, notbefore, notafter, status, blocknumber);
-
-                string white;
-                string black;
-
-                bytes inputdata5 = abiIn("getIp(string)", hashkey);
-                ExecutionResult ret5 = call(caAction, inputdata5);
-
-                bytesConstRef o2(&(ret5.output));
-                dev::eth::ContractABI().abiOut<>(o2, white, black);
-
                 CaInfo cainfo;
-                cainfo.hash = hash;
-                cainfo.pubkey = pubkey;
-                cainfo.orgname = orgname;
-                cainfo.notbefore = notbefore;
-                cainfo.notafter = notafter;
-                cainfo.status = status ? CaStatus::Ok : CaStatus::Invalid;
-                cainfo.blocknumber = blocknumber;
-                cainfo.white = white;
-                cainfo.black = black;
-
-                m_calist.insert(pair<string, CaInfo>(hash, cainfo) );
+                readCa(caAction, hashkey, cainfo);
+
+                m_calist.insert(pair<string, CaInfo>(cainfo.hash, cainfo) );
                 LOG(TRACE) << "SystemContract::updateCa Ca[" << i << "]=" << cainfo.toString();
 
             }//for
@@ -377,6 +352,70 @@ void SystemContract::updateCa( )
     }
 }
 
+void SystemContract::updateCa(std::vector<string> const& _hashes)
+{
+    DEV_WRITE_GUARDED(m_lockca)
+    {
+        Address caAction;
+        DEV_READ_GUARDED(m_lockroute)
+        {
+            caAction = getRoute("CAAction");
+        }
+        if ( Address() == caAction )
+        {
+            LOG(WARNING) << "SystemContract::updateCa No CAAction!!!!!!!!!!!!";
+            return;
+        }
+
+        for (string const& hashkey: _hashes)
+        {
+            CaInfo cainfo;
+            readCa(caAction, hashkey, cainfo);
+            if ( cainfo.hash.empty() )
+                m_calist.erase(hashkey);
+            else
+                m_calist[hashkey] = cainfo;
+            LOG(TRACE) << "SystemContract::updateCa Ca[" << hashkey << "]=" << cainfo.toString();
+        }
+    }
+}
+
+void SystemContract::readCa(Address const& _caAction, string const& _hashkey, CaInfo& o_cainfo)
+{
+    std::string  hash; 
+    std::string pubkey;
+    std::string orgname;  
+    u256 notbefore;
+    u256 notafter;
+    byte status;
+    u256    blocknumber;
+
+    bytes inputdata4 = abiIn("get(string)", _hashkey);
+    ExecutionResult ret4 = call(_caAction, inputdata4);
+
+    bytesConstRef o(&(ret4.output));
+    dev::eth::ContractABI().abiOut<>(o, hash, pubkey, orgname, notbefore, notafter, status, blocknumber);
+
+    string white;
+    string black;
+
+    bytes inputdata5 = abiIn("getIp(string)", _hashkey);
+    ExecutionResult ret5 = call(_caAction, inputdata5);
+
+    bytesConstRef o2(&(ret5.output));
+    dev::eth::ContractABI().abiOut<>(o2, white, black);
+
+    o_cainfo.hash = hash;
+    o_cainfo.pubkey = pubkey;
+    o_cainfo.orgname = orgname;
+    o_cainfo.notbefore = notbefore;
+    o_cainfo.notafter = notafter;
+    o_cainfo.status = status ? CaStatus::Ok : CaStatus::Invalid;
+    o_cainfo.blocknumber = blocknumber;
+    o_cainfo.white = white;
+    o_cainfo.black = black;
+}
+
 void SystemContract::updateContractAbiInfo()
 {
     Address contractAbiMgrAddr;
@@ -620,13 +659,6 @@ Address SystemContract::getRoute(const string & _route) const
 }
 
 
-h256 SystemContract::filterCheckTransCacheKey(const Transaction & _t) const
-{
-    RLPStream s;
-    s << _t.safeSender() << _t.from() << _t.to() << toString(_t.data()) ;//<< _t.randomid() ;
-    return dev::sha3(s.out());
-}
-
 u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
     if ((int)transaction.getUTXOType() != UTXOType::InValid)
     {
@@ -641,8 +673,6 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
     }
 
     LOG(TRACE) << "SystemContract::transactionFilterCheck sender:" << transaction.safeSender();
-    
-    m_transcount++;
 
 
     u256 checkresult = -1;
@@ -654,7 +684,7 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
                                "deploy(address)",
                                transaction.safeSender());
 
-        ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
+        ExecutionResult res = snapshotCall(*callSnapshot(), m_transactionfilter.filter, inputBytes);
 
         if (res.output.empty()) {
             
@@ -669,23 +699,10 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
         }
     }
     else {
-    h256 key = filterCheckTransCacheKey(transaction);
-
-    DEV_READ_GUARDED(m_lockfilter)
-    {
-        std::map<h256, u256>::iterator iter = m_filterchecktranscache.find(key);
+    h256 key = FilterCheckCache::key(transaction);
 
-        if (iter != m_filterchecktranscache.end()) {
-            checkresult = iter->second;
-        }
-    }
-
-    if (checkresult != -1) {
-        //if ( iter != m_filterchecktranscache.end() ) //命中cache
-        //{
-        //checkresult = iter->second;
-        m_transcachehit++;
-		LOG(TRACE) << "SystemContract::transactionFilterCheck hit cache";
+    if (m_filterchecktranscache.get(key, checkresult)) {
+        LOG(TRACE) << "SystemContract::transactionFilterCheck hit cache";
     }
     else {
         string input = toHex(transaction.data());
@@ -696,7 +713,9 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
                                transaction.safeSender(), transaction.from(), transaction.to(), func,
                                input);
 
-        ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
+        uint64_t generation = m_filterchecktranscache.generation();
+        std::shared_ptr<CallSnapshot const> snapshot = callSnapshot();
+        ExecutionResult res = snapshotCall(*snapshot, m_transactionfilter.filter, inputBytes);
 
         if (res.output.empty()) {
             
@@ -709,10 +728,8 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
 			LOG(TRACE) << "SystemContract::transactionFilterCheck result:" << result;
             checkresult = result ? ((u256)SystemContractCode::Ok) : (u256)SystemContractCode::Other;
         }
-        DEV_WRITE_GUARDED(m_lockfilter)
-        {
-            m_filterchecktranscache.insert(pair<h256, u256>(key, checkresult)); //更新cache
-        }
+        watchGroups(*snapshot, transaction.safeSender(), generation);
+        m_filterchecktranscache.put(key, checkresult, generation);
     }
 	}
     if ( (u256)SystemContractCode::Ok != checkresult )
@@ -723,14 +740,29 @@ u256 SystemContract::transactionFilterCheck(const Transaction & transaction) {
         LOG(TRACE) << "SystemContract::transactionFilterCheck Suc!"  << toJS(transaction.sha3()) << ",from=" << toJS(transaction.from());
     }
 
-    if (  (0 == (rand() % 1000)  ) && (m_transcount) )
-        LOG(TRACE) << "SystemContract Cache Hint:" << ((100 * m_transcachehit) / m_transcount) << "%";
-
     return checkresult;
 
 }
 
 
+void SystemContract::reloadSystemContract(std::shared_ptr<Block> block)
+{
+    LOG(INFO) << "SystemContract::reloadSystemContract blocknumber=" << block->info().number();
+
+    DEV_WRITE_GUARDED(m_lockroute)
+        m_routes.clear();
+    DEV_WRITE_GUARDED(m_locknode)
+        m_nodelist.clear();
+    DEV_WRITE_GUARDED(m_lockca)
+        m_calist.clear();
+    m_filterchecktranscache.clear();
+
+    // the caches are empty, so this reads routes, nodes and certificates back
+    updateSystemContract(block);
+    updateConfig();
+    updateContractAbiInfo();
+}
+
 void SystemContract::updateCache(Address ) {
 
  
@@ -799,3 +831,79 @@ ExecutionResult SystemContract::call(Address const& _to, bytes const& _inputdata
     }
     return ret;
 }
+
+std::shared_ptr<CallSnapshot const> SystemContract::callSnapshot() const
+{
+    std::shared_ptr<CallSnapshot const> ret;
+    DEV_GUARDED(m_snapshotlock)
+        ret = m_snapshot;
+    return ret;
+}
+
+ExecutionResult SystemContract::snapshotCall(CallSnapshot const& _snapshot, Address const& _to, bytes const& _inputdata)
+{
+    ExecutionResult ret;
+    try
+    {
+        srand((unsigned)utcTime());
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        u256 nonce = (u256)(rand() + rand() + tv.tv_usec);
+
+        u256 gas = _snapshot.gasLimitRemaining();
+        u256 gasPrice = 100000000;
+        Transaction t(0, gasPrice, gas, _to, _inputdata, nonce);
+        t.forceSender(m_god);
+        LOG(TRACE) << "SystemContract::snapshotCall gas=" << gas << ",gasPrice=" << gasPrice << ",nonce=" << nonce;
+        ret = _snapshot.call(m_client->blockChain().lastHashes(), t);
+    }
+    catch (...)
+    {
+        LOG(WARNING) << "SystemContract::snapshotCall Fail!" << toString(_inputdata);
+        LOG(WARNING) << boost::current_exception_diagnostic_information() << "\n";
+    }
+    return ret;
+}
+
+void SystemContract::watchFilters()
+{
+    uint64_t generation = m_filterchecktranscache.generation();
+    std::shared_ptr<CallSnapshot const> snapshot = callSnapshot();
+    Address chain;
+    DEV_READ_GUARDED(m_lockfilter)
+        chain = m_transactionfilter.filter;
+
+    std::vector<Address> filters;
+    if (Address() != chain)
+    {
+        u256 size = abiOut<u256>(snapshotCall(*snapshot, chain, abiIn("getFiltersLength()")).output);
+        for (size_t i = 0; i < (size_t)size; i++)
+            filters.push_back(abiOut<Address>(snapshotCall(*snapshot, chain, abiIn("getFilter(uint256)", (u256)i)).output));
+    }
+    LOG(TRACE) << "SystemContract::watchFilters chain=" << chain << ",filters=" << filters.size();
+
+    m_filterchecktranscache.watch(chain, snapshot->storageRoot(chain), generation);
+    for (auto const& filter: filters)
+        m_filterchecktranscache.watch(filter, snapshot->storageRoot(filter), generation);
+    DEV_WRITE_GUARDED(m_lockfilter)
+        m_filters = filters;
+}
+
+void SystemContract::watchGroups(CallSnapshot const& _snapshot, Address const& _origin, uint64_t _generation)
+{
+    std::vector<Address> filters;
+    DEV_READ_GUARDED(m_lockfilter)
+        filters = m_filters;
+
+    bytes input = abiIn("getUserGroup(address)", _origin);
+    for (auto const& filter: filters)
+    {
+        // filters other than AuthorityFilter have no groups and answer nothing
+        ExecutionResult res = snapshotCall(_snapshot, filter, input);
+        if (res.output.size() < 32)
+            continue;
+        Address group = abiOut<Address>(res.output);
+        if (Address() != group)
+            m_filterchecktranscache.watch(group, _snapshot.storageRoot(group), _generation);
+    }
+}
@@ -29,6 +29,8 @@
 
 #include "Client.h"
 #include "SystemContractApi.h"
+#include "FilterCheckCache.h"
+#include "CallSnapshot.h"
 
 using namespace std;
 using namespace dev;
@@ -74,6 +76,8 @@ public:
   
     virtual void updateSystemContract(std::shared_ptr<Block> block) override;
 
+    virtual void reloadSystemContract(std::shared_ptr<Block> block) override;
+
     Address getRoute(const string & _route) const override;
 
 private:
@@ -83,16 +87,17 @@ private:
     mutable SharedMutex  m_blocklock; 
    
     std::shared_ptr<Block> m_tempblock;
+    /// The temp block's state as snapshotCall() sees it, replaced by updateSystemContract.
+    mutable Mutex m_snapshotlock;
+    std::shared_ptr<CallSnapshot const> m_snapshot;
 
     mutable SharedMutex  m_lockroute;
     std::vector<SystemAction> m_routes;
 
     mutable SharedMutex  m_lockfilter;
     SystemFilter m_transactionfilter;
-    std::map<h256, u256> m_filterchecktranscache; 
-
-    unsigned m_transcachehit;
-    unsigned m_transcount;
+    FilterCheckCache m_filterchecktranscache;
+    std::vector<Address> m_filters;	///< The filters in m_transactionfilter, when it was last watched.
 
     mutable SharedMutex  m_locknode;
     std::vector< NodeConnParams> m_nodelist;
@@ -103,16 +108,24 @@ private:
 	mutable Address m_abiMgrAddr;
 
     ExecutionResult call(Address const& _to, bytes const& _inputdata, bool cache = false) ;
+    std::shared_ptr<CallSnapshot const> callSnapshot() const;
+    /// Like call(), but on @a _snapshot of the temp block, so concurrent callers do not serialise on m_blocklock.
+    ExecutionResult snapshotCall(CallSnapshot const& _snapshot, Address const& _to, bytes const& _inputdata);
+    /// Has the filter check cache watch the filter chain and its filters.
+    void watchFilters();
+    /// Has the filter check cache watch the groups the filters put @a _origin in.
+    void watchGroups(CallSnapshot const& _snapshot, Address const& _origin, uint64_t _generation);
 
     //ExecutionResult call(const std::string &name, bytes const& _inputdata) ; 
 
-    h256 filterCheckTransCacheKey(const Transaction & _t) const ;
 
     void updateRoute( );
     void updateNode( );
     void tempGetAllNode(int _blocknumber,std::vector< NodeConnParams> & _nodevector);//在指定块上面获取列表
     void updateConfig( );
     void updateCa( );
+    void updateCa(std::vector<string> const& _hashes);
+    void readCa(Address const& _caAction, string const& _hashkey, CaInfo& o_cainfo);
 	void updateContractAbiInfo();
 
     void getNodeFromContract(std::function<ExecutionResult(Address const,bytes const,bool cache )>,std::vector< NodeConnParams> & _nodelist);
@@ -160,6 +160,12 @@ class SystemContractApi
     virtual void    updateSystemContract(std::shared_ptr<Block>)
     {
     }
+
+    /// Reads everything back from @a _block, as after the chain jumped to a snapshot; the caches can't be updated block by block.
+    virtual void    reloadSystemContract(std::shared_ptr<Block> _block)
+    {
+        updateSystemContract(_block);
+    }
     
     
 	virtual bool isAdmin(const Address & ) 
@@ -0,0 +1,83 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SystemContractEvents.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "SystemContractEvents.h"
+
+#include <libdevcore/SHA3.h>
+#include <libdevcore/easylog.h>
+#include <libethcore/ABI.h>
+#include <abi/ContractAbiMgr.h>
+#include "Block.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+Selector dev::eth::selectorOf(string const& _signature)
+{
+	return Selector(sha3(_signature).ref().cropped(0, 4));
+}
+
+Selector dev::eth::selectorOf(Transaction const& _t)
+{
+	return Selector(bytesConstRef(&_t.data()).cropped(0, 4));
+}
+
+unsigned dev::eth::applyAbiEvents(Block const& _block, Address const& _abiMgr)
+{
+	static h256 const c_addAbi = sha3("AddAbi(string,string,string,string,address,uint256,uint256)");
+	static h256 const c_updateAbi = sha3("UpdateAbi(string,string,string,string,address,uint256,uint256)");
+
+	unsigned ret = 0;
+	for (unsigned i = 0; i < _block.pending().size(); ++i)
+	{
+		if (_block.pending()[i].to() != _abiMgr)
+			continue;
+		for (LogEntry const& l: _block.log(i))
+		{
+			if (l.address != _abiMgr)
+				continue;
+			++ret;
+			if (l.topics.empty() || (l.topics[0] != c_addAbi && l.topics[0] != c_updateAbi))
+				continue;
+
+			string cnsName;
+			string name;
+			string version;
+			string abi;
+			Address addr;
+			u256 blocknumber;
+			u256 timestamp;
+			try
+			{
+				ContractABI().abiOut(bytesConstRef(&l.data), cnsName, name, version, abi, addr, blocknumber, timestamp);
+				libabi::ContractAbiMgr::getInstance()->addContractAbi(name, version, abi, addr, blocknumber, timestamp);
+				LOG(TRACE) << "applyAbiEvents cns=" << cnsName << ",name=" << name << ",version=" << version << ",address=0x" << addr.hex();
+			}
+			catch (...)
+			{
+				LOG(WARNING) << "applyAbiEvents invalid abi event, cns=" << cnsName << ",name=" << name << ",version=" << version;
+			}
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,53 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: SystemContractEvents.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <string>
+#include <libdevcore/FixedHash.h>
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class Block;
+
+using Selector = FixedHash<4>;
+
+/// @returns the 4-byte function selector of @a _signature, e.g. "cancelNode(string)".
+Selector selectorOf(std::string const& _signature);
+
+/// @returns the function selector called by @a _t, zero if its data is too short.
+Selector selectorOf(Transaction const& _t);
+
+/**
+ * Apply the AddAbi/UpdateAbi events emitted by the ContractAbiMgr contract at @a _abiMgr
+ * in the enacted @a _block to the in-memory ContractAbiMgr.
+ * @returns the number of logs the contract emitted in @a _block, applied or not (AbiExist,
+ * AbiNotExist); 0 tells the caller the events cannot be relied on for this block.
+ */
+unsigned applyAbiEvents(Block const& _block, Address const& _abiMgr);
+
+}
+}
@@ -23,9 +23,11 @@
 #include <libdevcore/CommonJS.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <abi/ContractAbiMgr.h>
 
 #include "SystemContractSSL.h"
+#include "SystemContractEvents.h"
 #include <libdevcore/SHA3.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -36,10 +38,12 @@ using namespace dev::eth;
 */
 void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
 {
-    Timer t;
+    static auto& updateTime = metrics::histogram("system_contract_update_duration_us", "Time spent refreshing the system contract caches after a block, in microseconds");
+    metrics::ScopedTimer timer(updateTime);
 
     LOG(TRACE) << "SystemContractSSL::updateSystemContract m_systemproxyaddress=" << toString(m_systemproxyaddress) << ",number=" << m_client->blockChain().number() << "," << m_client->blockChain().info();
     //每次有新块import 就构建一次就好了，提高性能
+    std::shared_ptr<CallSnapshot const> snapshot;
     DEV_WRITE_GUARDED(m_blocklock)
     {
 
@@ -48,7 +52,11 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
         m_tempblock->clearCurrentBytes();
         m_tempblock->setEvmEventLog(true);//方便看log
         LOG(TRACE) << "SystemContractSSL::updateSystemContract blocknumber=" << m_tempblock->info().number();
+        // taken under the lock, call() executes on the temp block
+        snapshot = std::make_shared<CallSnapshot>(*m_tempblock);
     }
+    DEV_GUARDED(m_snapshotlock)
+        m_snapshot = snapshot;
 
 
     bool configChange = false, nodeChange = false, caChange = false, routeChange = false, coChange = false;
@@ -60,13 +68,14 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
     std::vector<string> routeChangeArg;
     routeChangeArg.push_back("");
 
-    bytes nodehash1 = sha3("cancelNode(string)").ref().cropped(0, 4).toBytes();
-    bytes nodehash2 = sha3("registerNode(string,string,string,string)").ref().cropped(0, 4).toBytes();
+    static Selector const nodehash1 = selectorOf("cancelNode(string)");
+    static Selector const nodehash2 = selectorOf("registerNode(string,string,string,string)");
 
-    bytes cahash1 = sha3("add(string,string,string)").ref().cropped(0, 4).toBytes();
+    static Selector const cahash1 = selectorOf("add(string,string,string)");
+    static Selector const cahash2 = selectorOf("remove(string)");
 
-    bytes cohash1 = sha3("addAbi(string,string,string,string,address)").ref().cropped(0, 4).toBytes();
-    bytes cohash2 = sha3("updateAbi(string,string,string,string,address)").ref().cropped(0, 4).toBytes();
+    static Selector const cohash1 = selectorOf("addAbi(string,string,string,string,address)");
+    static Selector const cohash2 = selectorOf("updateAbi(string,string,string,string,address)");
 
     Address configaction;
     Address nodeAction;
@@ -84,60 +93,51 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
     //下面除了CAAction NodeAction其他都粗暴的做
     for (auto it = m_tempblock->pending().begin(); it != m_tempblock->pending().end(); ++it)
     {
-        LOG(TRACE) << "SystemContractSSL::updateSystemContract ==> abi address => " << contractAbiMgr.hex() << " ,to= > " << (it->to().hex());
+        //绝大部分交易不是发给系统合约的，先按地址过滤掉
+        Address const& to = it->to();
+        if ( it->isCreation() || (to != m_systemproxyaddress && to != configaction && to != nodeAction && to != caAction && to != contractAbiMgr) )
+            continue;
 
-        bytes tempdata = it->data();
-        bytesRef fundata = ref(tempdata);
-        bytes funhash = fundata.cropped(0, 4).toBytes();
-        
+        Selector funhash = selectorOf(*it);
+        bytesConstRef fundata(&it->data());
 
-        if ( (it->to() == m_systemproxyaddress ) && (dev::ZeroAddress != m_systemproxyaddress) ) //命中
+        if ( (to == m_systemproxyaddress ) && (dev::ZeroAddress != m_systemproxyaddress) ) //命中
         {
             routeChange = true;
-            LOG(TRACE) << "SystemContractSSL::updateSystemContract SystemProxy setRoute! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContractSSL::updateSystemContract SystemProxy setRoute! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == configaction   ) && (dev::ZeroAddress != configaction) ) //命中
+        else if ( (to == configaction   ) && (dev::ZeroAddress != configaction) ) //命中
         {
             configChange = true;
-            LOG(TRACE) << "SystemContractSSL::updateSystemContract ConfigAction set! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContractSSL::updateSystemContract ConfigAction set! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == nodeAction ) && (dev::ZeroAddress != nodeAction) && ((funhash == nodehash1) || (funhash == nodehash2) ) ) //命中
+        else if ( (to == nodeAction ) && (dev::ZeroAddress != nodeAction) && ((funhash == nodehash1) || (funhash == nodehash2) ) ) //命中
         {
             nodeChange = true;
-            LOG(TRACE) << "SystemContractSSL::updateSystemContract NodeAction cancelNode|registerNode ! to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
+            LOG(TRACE) << "SystemContractSSL::updateSystemContract NodeAction cancelNode|registerNode ! to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ( (it->to() == caAction ) && (dev::ZeroAddress != caAction)   ) //命中
+        else if ( (to == caAction ) && (dev::ZeroAddress != caAction) && ( (funhash == cahash1) || (funhash == cahash2) ) ) //命中
         {
             caChange = true;
-            if( funhash == cahash1 )
-            {
-                bytes calldata = fundata.cropped(4, fundata.size() - 4).toBytes();
-                bytesConstRef o(&(calldata));
-                string hashkey;
-                string pubkey;
-                string name;
-                dev::eth::ContractABI().abiOut<>(o, hashkey, pubkey, name);
-                caChangeArg.push_back(hashkey);
-                
-                LOG(TRACE) << "SystemContractSSL::updateSystemContract CAAction updateStatus|update ! hash=" << hashkey << ", to=" << it->to() << ",sha3=" << toString(it->sha3()) ;
-            }
+            //add和remove的第一个参数都是serial
+            bytesConstRef o = fundata.cropped(4);
+            string hashkey;
+            dev::eth::ContractABI().abiOut<>(o, hashkey);
+            caChangeArg.push_back(hashkey);
+
+            LOG(TRACE) << "SystemContractSSL::updateSystemContract CAAction add|remove ! hash=" << hashkey << ", to=" << to << ",sha3=" << toString(it->sha3()) ;
         }
-        else if ((it->to() == contractAbiMgr) && (dev::ZeroAddress != contractAbiMgr) && (cohash1 == funhash || funhash == cohash2))
+        else if ((to == contractAbiMgr) && (dev::ZeroAddress != contractAbiMgr) && (cohash1 == funhash || funhash == cohash2))
         {
             coChange = true;
-            //LOG(TRACE) << "SystemContractSSL::updateSystemContract ContractAbiMgr addAbi ! hash=" << funhash << ", to=" << it->to() << ",sha3=" << toString(it->sha3());
         }
 
     }//for
 
-    DEV_WRITE_GUARDED(m_lockfilter)
-    {
-
-        m_filterchecktranscache.clear();//清除缓存
-        m_transcount = 0;
-        m_transcachehit = 0;
-
-    }
+    // a filter's answer changes with the storage of the filter chain, its filters or the groups they
+    // look senders up in, however the block wrote it; blocks that leave them alone keep the cache
+    if (m_filterchecktranscache.refresh([&](Address const& _contract) { return snapshot->storageRoot(_contract); }))
+        LOG(TRACE) << "SystemContractSSL::updateSystemContract clear filter cache, watched contract changed";
 
     if ( routeChange || (m_routes.size() < 1) )
     {
@@ -145,6 +145,9 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
         routeChange = true;
         updateRoute();
     }
+    // nothing is watched after a clear, here or in updateRoute
+    if (!m_filterchecktranscache.watches(m_transactionfilter.filter))
+        watchFilters();
     if ( configChange )
     {
         //没有config缓存，全部通知即可
@@ -158,19 +161,28 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
         nodeChange = true;
         updateNode();
     }//
-    if ( caChange || (m_calist.size() < 1) )
+    if ( m_calist.size() < 1 )
     {
-        //上面应该已经更新 caChangeArg
         //更新CA缓存列表
         caChange = true;
         updateCa();
     }//
+    else if ( caChange )
+    {
+        //只刷新本块交易涉及的证书
+        updateCa(caChangeArg);
+    }
 
     //abi信息是否已经初始化，用于初次初始化使用。
-    if (coChange || (0 == libabi::ContractAbiMgr::getInstance()->getContractC()))
+    if (0 == libabi::ContractAbiMgr::getInstance()->getContractC())
     {
         updateContractAbiInfo();
     }
+    else if (coChange && 0 == applyAbiEvents(*m_tempblock, contractAbiMgr))
+    {
+        //没有AddAbi/UpdateAbi事件可用，整体重新读取
+        updateContractAbiInfo();
+    }
 
     //通知回调池
 
@@ -217,8 +229,6 @@ void SystemContractSSL::updateSystemContract(std::shared_ptr<Block> block)
         }//
     }
 
-    LOG(TRACE) << "SystemContractSSL::updateSystemContract took:" << (t.elapsed() * 1000000);
-
 }
 
 void SystemContractSSL::updateRoute()
@@ -255,8 +265,6 @@ void SystemContractSSL::updateRoute()
         m_transactionfilter.name = "TransactionFilterChain";
 
         m_filterchecktranscache.clear();//清除缓存
-        m_transcount = 0;
-        m_transcachehit = 0;
     }
 
     DEV_READ_GUARDED(m_lockroute)
@@ -309,24 +317,10 @@ void SystemContractSSL::updateCa( )
                 string hashkey = abiOut<string>(ret2.output);
 
                 //第二步，拿到ca 信息
-                std::string  serial;  
-                std::string pubkey;
-                std::string name;  
-                u256    blocknumber;
-
-                bytes inputdata4 = abiIn("get(string)", hashkey);
-                ExecutionResult ret4 = call(caAction, inputdata4);
-
-                bytesConstRef o(&(ret4.output));
-                dev::eth::ContractABI().abiOut<>(o, serial, pubkey, name, blocknumber);
-
                 CaInfo cainfo;
-                cainfo.serial = serial;
-                cainfo.pubkey = pubkey;
-                cainfo.name = name;
-                cainfo.blocknumber = blocknumber;
-               
-                m_calist.insert(pair<string, CaInfo>(serial, cainfo) );
+                readCa(caAction, hashkey, cainfo);
+
+                m_calist.insert(pair<string, CaInfo>(cainfo.serial, cainfo) );
                 LOG(TRACE) << "SystemContractSSL::updateCa Ca[" << i << "]=" << cainfo.toString();
             }//for
         }
@@ -338,6 +332,53 @@ void SystemContractSSL::updateCa( )
     }
 }
 
+void SystemContractSSL::updateCa(std::vector<string> const& _hashes)
+{
+    DEV_WRITE_GUARDED(m_lockca)
+    {
+        Address caAction;
+        DEV_READ_GUARDED(m_lockroute)
+        {
+            caAction = getRoute("CAAction");
+        }
+        if ( Address() == caAction )
+        {
+            LOG(WARNING) << "SystemContractSSL::updateCa No CAAction!!!!!!!!!!!!";
+            return;
+        }
+
+        for (string const& hashkey: _hashes)
+        {
+            CaInfo cainfo;
+            readCa(caAction, hashkey, cainfo);
+            if ( cainfo.serial.empty() ) //已经remove
+                m_calist.erase(hashkey);
+            else
+                m_calist[hashkey] = cainfo;
+            LOG(TRACE) << "SystemContractSSL::updateCa Ca[" << hashkey << "]=" << cainfo.toString();
+        }
+    }
+}
+
+void SystemContractSSL::readCa(Address const& _caAction, string const& _hashkey, CaInfo& o_cainfo)
+{
+    std::string  serial;  
+    std::string pubkey;
+    std::string name;  
+    u256    blocknumber;
+
+    bytes inputdata4 = abiIn("get(string)", _hashkey);
+    ExecutionResult ret4 = call(_caAction, inputdata4);
+
+    bytesConstRef o(&(ret4.output));
+    dev::eth::ContractABI().abiOut<>(o, serial, pubkey, name, blocknumber);
+
+    o_cainfo.serial = serial;
+    o_cainfo.pubkey = pubkey;
+    o_cainfo.name = name;
+    o_cainfo.blocknumber = blocknumber;
+}
+
 void SystemContractSSL::updateContractAbiInfo()
 {
     Address contractAbiMgrAddr;
@@ -573,13 +614,6 @@ Address SystemContractSSL::getRoute(const string & _route) const
 }
 
 
-h256 SystemContractSSL::filterCheckTransCacheKey(const Transaction & _t) const
-{
-    RLPStream s;
-    s << _t.safeSender() << _t.from() << _t.to() << toString(_t.data()) ;//<< _t.randomid() ;
-    return dev::sha3(s.out());
-}
-
 u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction) {
     if ((int)transaction.getUTXOType() != UTXOType::InValid)
     {
@@ -595,8 +629,6 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
 
     LOG(TRACE) << "SystemContractSSL::transactionFilterCheck sender:" << transaction.safeSender();
 
-    m_transcount++;
-
 
     u256 checkresult = -1;
     LOG(TRACE) << "SystemContractSSL::transactionFilterCheck filter:" << m_transactionfilter.filter;
@@ -607,7 +639,7 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
                                "deploy(address)",
                                transaction.safeSender());
 
-        ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
+        ExecutionResult res = snapshotCall(*callSnapshot(), m_transactionfilter.filter, inputBytes);
 
         if (res.output.empty()) {
             
@@ -622,22 +654,9 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
         }
     }
     else {
-        h256 key = filterCheckTransCacheKey(transaction);
-
-        DEV_READ_GUARDED(m_lockfilter)
-        {
-            std::map<h256, u256>::iterator iter = m_filterchecktranscache.find(key);
+        h256 key = FilterCheckCache::key(transaction);
 
-            if (iter != m_filterchecktranscache.end()) {
-                checkresult = iter->second;
-            }
-        }
-
-        if (checkresult != -1) {
-            //if ( iter != m_filterchecktranscache.end() ) //命中cache
-            //{
-            //checkresult = iter->second;
-            m_transcachehit++;
+        if (m_filterchecktranscache.get(key, checkresult)) {
             LOG(TRACE) << "SystemContractSSL::transactionFilterCheck hit cache";
         }
         else {
@@ -650,7 +669,9 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
                                input);
 
 		    LOG(TRACE) << "SystemContractSSL::transactionFilterCheck: call"  << toJS(transaction.sha3());
-            ExecutionResult res = call(m_transactionfilter.filter, inputBytes);
+            uint64_t generation = m_filterchecktranscache.generation();
+            std::shared_ptr<CallSnapshot const> snapshot = callSnapshot();
+            ExecutionResult res = snapshotCall(*snapshot, m_transactionfilter.filter, inputBytes);
 
             if (res.output.empty()) {
                 LOG(TRACE) << "SystemContractSSL::transactionFilterCheck res.output.empty()";
@@ -662,10 +683,8 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
                 LOG(TRACE) << "SystemContractSSL::transactionFilterCheck result:" << result;
                 checkresult = result ? ((u256)SystemContractCode::Ok) : (u256)SystemContractCode::Other;
             }
-            DEV_WRITE_GUARDED(m_lockfilter)
-            {
-                m_filterchecktranscache.insert(pair<h256, u256>(key, checkresult)); //更新cache
-            }
+            watchGroups(*snapshot, transaction.safeSender(), generation);
+            m_filterchecktranscache.put(key, checkresult, generation);
         }
     }
     if ( (u256)SystemContractCode::Ok != checkresult )
@@ -676,14 +695,29 @@ u256 SystemContractSSL::transactionFilterCheck(const Transaction & transaction)
         LOG(TRACE) << "SystemContractSSL::transactionFilterCheck Suc!"  << toJS(transaction.sha3()) << ",from=" << toJS(transaction.from());
     }
 
-    if (  (0 == (rand() % 1000)  ) && (m_transcount) )
-        LOG(TRACE) << "SystemContract Cache Hint:" << ((100 * m_transcachehit) / m_transcount) << "%";
-
     return checkresult;
 
 }
 
 
+void SystemContractSSL::reloadSystemContract(std::shared_ptr<Block> block)
+{
+    LOG(INFO) << "SystemContractSSL::reloadSystemContract blocknumber=" << block->info().number();
+
+    DEV_WRITE_GUARDED(m_lockroute)
+        m_routes.clear();
+    DEV_WRITE_GUARDED(m_locknode)
+        m_nodelist.clear();
+    DEV_WRITE_GUARDED(m_lockca)
+        m_calist.clear();
+    m_filterchecktranscache.clear();
+
+    // the caches are empty, so this reads routes, nodes and certificates back
+    updateSystemContract(block);
+    updateConfig();
+    updateContractAbiInfo();
+}
+
 void SystemContractSSL::updateCache(Address ) {
 
     //如果被写的合约已有缓存，清空之
@@ -757,3 +791,79 @@ ExecutionResult SystemContractSSL::call(Address const& _to, bytes const& _inputd
     }
     return ret;
 }
+
+std::shared_ptr<CallSnapshot const> SystemContractSSL::callSnapshot() const
+{
+    std::shared_ptr<CallSnapshot const> ret;
+    DEV_GUARDED(m_snapshotlock)
+        ret = m_snapshot;
+    return ret;
+}
+
+ExecutionResult SystemContractSSL::snapshotCall(CallSnapshot const& _snapshot, Address const& _to, bytes const& _inputdata)
+{
+    ExecutionResult ret;
+    try
+    {
+        srand((unsigned)utcTime());
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        u256 nonce = (u256)(rand() + rand() + tv.tv_usec);
+
+        u256 gas = _snapshot.gasLimitRemaining();
+        u256 gasPrice = 100000000;
+        Transaction t(0, gasPrice, gas, _to, _inputdata, nonce);
+        t.forceSender(m_god);
+        LOG(TRACE) << "SystemContractSSL::snapshotCall gas=" << gas << ",gasPrice=" << gasPrice << ",nonce=" << nonce;
+        ret = _snapshot.call(m_client->blockChain().lastHashes(), t);
+    }
+    catch (...)
+    {
+        LOG(WARNING) << "SystemContractSSL::snapshotCall Fail!" << toString(_inputdata);
+        LOG(WARNING) << boost::current_exception_diagnostic_information() << "\n";
+    }
+    return ret;
+}
+
+void SystemContractSSL::watchFilters()
+{
+    uint64_t generation = m_filterchecktranscache.generation();
+    std::shared_ptr<CallSnapshot const> snapshot = callSnapshot();
+    Address chain;
+    DEV_READ_GUARDED(m_lockfilter)
+        chain = m_transactionfilter.filter;
+
+    std::vector<Address> filters;
+    if (Address() != chain)
+    {
+        u256 size = abiOut<u256>(snapshotCall(*snapshot, chain, abiIn("getFiltersLength()")).output);
+        for (size_t i = 0; i < (size_t)size; i++)
+            filters.push_back(abiOut<Address>(snapshotCall(*snapshot, chain, abiIn("getFilter(uint256)", (u256)i)).output));
+    }
+    LOG(TRACE) << "SystemContractSSL::watchFilters chain=" << chain << ",filters=" << filters.size();
+
+    m_filterchecktranscache.watch(chain, snapshot->storageRoot(chain), generation);
+    for (auto const& filter: filters)
+        m_filterchecktranscache.watch(filter, snapshot->storageRoot(filter), generation);
+    DEV_WRITE_GUARDED(m_lockfilter)
+        m_filters = filters;
+}
+
+void SystemContractSSL::watchGroups(CallSnapshot const& _snapshot, Address const& _origin, uint64_t _generation)
+{
+    std::vector<Address> filters;
+    DEV_READ_GUARDED(m_lockfilter)
+        filters = m_filters;
+
+    bytes input = abiIn("getUserGroup(address)", _origin);
+    for (auto const& filter: filters)
+    {
+        // filters other than AuthorityFilter have no groups and answer nothing
+        ExecutionResult res = snapshotCall(_snapshot, filter, input);
+        if (res.output.size() < 32)
+            continue;
+        Address group = abiOut<Address>(res.output);
+        if (Address() != group)
+            m_filterchecktranscache.watch(group, _snapshot.storageRoot(group), _generation);
+    }
+}
@@ -30,6 +30,8 @@
 
 #include "Client.h"
 #include "SystemContractApi.h"
+#include "FilterCheckCache.h"
+#include "CallSnapshot.h"
 
 using namespace std;
 using namespace dev;
@@ -81,6 +83,8 @@ public:
     //virtual void    updateSystemContract(const Transactions &) override;
     virtual void updateSystemContract(std::shared_ptr<Block> block) override;
 
+    virtual void reloadSystemContract(std::shared_ptr<Block> block) override;
+
 private:
 
     Client* m_client;
@@ -89,16 +93,17 @@ private:
     //Block m_tempblock;//提高性能，避免反复构建
 
     std::shared_ptr<Block> m_tempblock;
+    /// The temp block's state as snapshotCall() sees it, replaced by updateSystemContract.
+    mutable Mutex m_snapshotlock;
+    std::shared_ptr<CallSnapshot const> m_snapshot;
 
     mutable SharedMutex  m_lockroute;//锁cache
     std::vector<SystemAction> m_routes;
 
     mutable SharedMutex  m_lockfilter;//锁cache
     SystemFilter m_transactionfilter;//目前只有交易，就先只用一个变量吧
-    std::map<h256, u256> m_filterchecktranscache; //filterCheck 交易的cache
-
-    unsigned m_transcachehit;//命中次数
-    unsigned m_transcount;//总数
+    FilterCheckCache m_filterchecktranscache;
+    std::vector<Address> m_filters;	///< The filters in m_transactionfilter, when it was last watched.
 
     mutable SharedMutex  m_locknode;//锁节点列表更新
     std::vector< NodeParams> m_nodelist;//缓存当前最新块的节点列表
@@ -110,18 +115,26 @@ private:
 
 
     ExecutionResult call(Address const& _to, bytes const& _inputdata, bool cache = false) ; // 系统合约调用
+    std::shared_ptr<CallSnapshot const> callSnapshot() const;
+    /// Like call(), but on @a _snapshot of the temp block, so concurrent callers do not serialise on m_blocklock.
+    ExecutionResult snapshotCall(CallSnapshot const& _snapshot, Address const& _to, bytes const& _inputdata);
+    /// Has the filter check cache watch the filter chain and its filters.
+    void watchFilters();
+    /// Has the filter check cache watch the groups the filters put @a _origin in.
+    void watchGroups(CallSnapshot const& _snapshot, Address const& _origin, uint64_t _generation);
 
     //ExecutionResult call(const std::string &name, bytes const& _inputdata) ; // 系统合约调用
 
     Address getRoute(const string & _route)const;
 
-    h256 filterCheckTransCacheKey(const Transaction & _t) const ;
 
     void updateRoute( );
     void updateNode( );
     void tempGetAllNode(int _blocknumber,std::vector< NodeParams> & _nodevector);//在指定块上面获取列表
     void updateConfig( );
     void updateCa( );
+    void updateCa(std::vector<string> const& _hashes);//只刷新指定的证书
+    void readCa(Address const& _caAction, string const& _hashkey, CaInfo& o_cainfo);
 	void updateContractAbiInfo();
 
     void getNodeFromContract(std::function<ExecutionResult(Address const,bytes const,bool cache )>,std::vector< NodeParams> & _nodelist);
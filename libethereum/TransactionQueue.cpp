@@ -26,6 +26,7 @@
 #include "Transaction.h"
 #include "TransactionQueue.h"
 #include "StatLog.h"
+#include "TxTrace.h"
 #include "SystemContractApi.h"
 
 using namespace std;
@@ -89,6 +90,7 @@ std::pair<ImportResult, h256> TransactionQueue::import(bytesConstRef _transactio
 			}
 
 			t.setImportTime(utcTime());
+			TxTrace::instance().record(h, TxStage::Verified);
 
 			UpgradeGuard ul(l);
 			LOG(TRACE) << "Importing" << t;
@@ -129,6 +131,7 @@ ImportResult TransactionQueue::import(Transaction const& _transaction, IfDropped
 
 		{
 			_transaction.safeSender(); // Perform EC recovery outside of the write lock
+			TxTrace::instance().record(h, TxStage::Verified);
 			UpgradeGuard ul(l);
 			ret = manageImport_WITH_LOCK(h, _transaction);
 		}
@@ -136,6 +139,50 @@ ImportResult TransactionQueue::import(Transaction const& _transaction, IfDropped
 	return ret;
 }
 
+std::vector<std::pair<ImportResult, h256>> TransactionQueue::import(std::vector<bytes> const& _txs, IfDropped _ik)
+{
+	std::vector<std::pair<ImportResult, h256>> ret(_txs.size());
+	std::vector<Transaction> ts(_txs.size());
+	for (size_t i = 0; i < _txs.size(); ++i)
+	{
+		ret[i] = std::make_pair(ImportResult::Success, sha3(_txs[i]));
+		try
+		{
+			ts[i] = Transaction(_txs[i], CheckTransaction::Everything);
+			if (ts[i].isCNS())
+				ts[i].receiveAddress();
+			ts[i].setImportTime(utcTime());
+			TxTrace::instance().record(ret[i].second, TxStage::Verified);
+		}
+		catch (...)
+		{
+			LOG(WARNING) << boost::current_exception_diagnostic_information() << "\n";
+			ret[i].first = ImportResult::Malformed;
+		}
+	}
+
+	WriteGuard l(m_lock);
+	for (size_t i = 0; i < _txs.size(); ++i)
+	{
+		if (ret[i].first != ImportResult::Success)
+			continue;
+		ret[i].first = check_WITH_LOCK(ret[i].second, _ik);
+		if (ret[i].first != ImportResult::Success)
+			continue;
+		try
+		{
+			LOG(TRACE) << "Importing" << ts[i];
+			ret[i].first = manageImport_WITH_LOCK(ret[i].second, ts[i]);
+		}
+		catch (...)
+		{
+			LOG(WARNING) << boost::current_exception_diagnostic_information() << "\n";
+			ret[i].first = ImportResult::Malformed;
+		}
+	}
+	return ret;
+}
+
 Transactions TransactionQueue::topTransactions(unsigned _limit, h256Hash const& _avoid) const
 {
 	ReadGuard l(m_lock);
@@ -161,6 +208,29 @@ Transactions TransactionQueue::allTransactions() const {
 	return ret;
 }
 
+std::vector<bytes> TransactionQueue::transactionsRLP(h256s const& _txHashes) const
+{
+	std::vector<bytes> ret(_txHashes.size());
+	ReadGuard l(m_lock);
+	for (size_t i = 0; i < _txHashes.size(); ++i)
+	{
+		auto t = m_currentByHash.find(_txHashes[i]);
+		if (t != m_currentByHash.end())
+			ret[i] = t->second->transaction.rlp();
+	}
+	return ret;
+}
+
+h256s TransactionQueue::unknownTransactions(h256s const& _txHashes) const
+{
+	h256s ret;
+	ReadGuard l(m_lock);
+	for (auto const& h: _txHashes)
+		if (!m_known.count(h) && !m_dropped.count(h))
+			ret.push_back(h);
+	return ret;
+}
+
 h256Hash TransactionQueue::knownTransactions() const
 {
 	ReadGuard l(m_lock);
@@ -396,6 +466,7 @@ void TransactionQueue::insertCurrent_WITH_LOCK(std::pair<h256, Transaction> cons
 	// TODO FLAG 1  "0x" + _p.first.hex().substr(0, 5) => _p.first.hex()
 	// dev::eth::TxFlowLog(_p.first, "0x" + _p.first.hex().substr(0, 5), false, true);	
 	dev::eth::TxFlowLog(_p.first, _p.first.hex(), false, true);
+	TxTrace::instance().record(_p.first, TxStage::Imported);
 	LOG(TRACE) << " Hash=" << (t.sha3()) << ",Randid=" << t.randomid() << ",insert_time=" << utcTime();
 }
 
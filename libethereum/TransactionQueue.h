@@ -73,6 +73,13 @@ public:
 	/// @returns Import result code.
 	ImportResult import(Transaction const& _tx, IfDropped _ik = IfDropped::Ignore);
 
+	/// Verify and add a batch of transactions to the queue synchronously.
+	/// Signatures are checked before the queue lock is taken, and the lock is then held once for the whole batch.
+	/// @param _txs RLP encoded transactions.
+	/// @param _ik Set to Retry to force re-addinga transactions that were previously dropped.
+	/// @returns Import result code and hash for each transaction, in order.
+	std::vector<std::pair<ImportResult, h256>> import(std::vector<bytes> const& _txs, IfDropped _ik = IfDropped::Ignore);
+
 	/// Remove transaction from the queue
 	/// @param _txHash Trasnaction hash
 	void drop(h256 const& _txHash);
@@ -88,6 +95,15 @@ public:
 	Transactions topTransactions(unsigned _limit, h256Hash const& _avoid = h256Hash()) const;
 
 	Transactions allTransactions() const;
+
+	/// Get RLP of current transactions by hash.
+	/// @param _txHashes Transaction hashes to look up.
+	/// @returns RLP encoded transaction data for each hash, empty for transactions not in the queue.
+	std::vector<bytes> transactionsRLP(h256s const& _txHashes) const;
+
+	/// Filter announced transaction hashes down to the ones worth fetching.
+	/// @returns those of _txHashes that are neither in the queue nor previously dropped.
+	h256s unknownTransactions(h256s const& _txHashes) const;
 	size_t currentTxNum() const {ReadGuard l(m_lock); return m_current.size();}
 
 	std::size_t unverifiedSize(){return m_unverified.size();}
@@ -0,0 +1,222 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: TxTrace.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "TxTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+TxTrace::StageStats statsOf(metrics::Histogram::Snapshot const& _s)
+{
+	TxTrace::StageStats ret;
+	ret.count = _s.count;
+	if (!_s.count)
+		return ret;
+	ret.p50 = _s.quantile(0.5);
+	ret.p90 = _s.quantile(0.9);
+	ret.p99 = _s.quantile(0.99);
+	ret.max = _s.max();
+	return ret;
+}
+
+void observe(array<atomic<uint64_t>, metrics::Histogram::c_buckets>& _buckets, uint64_t _ns)
+{
+	_buckets[metrics::Histogram::bucketOf(_ns / 1000)].fetch_add(1, memory_order_relaxed);
+}
+
+void add(metrics::Histogram::Snapshot& _s, array<atomic<uint64_t>, metrics::Histogram::c_buckets> const& _buckets)
+{
+	for (unsigned i = 0; i < _buckets.size(); ++i)
+	{
+		uint64_t n = _buckets[i].load(memory_order_relaxed);
+		_s.buckets[i] += n;
+		_s.count += n;
+	}
+}
+
+}
+
+char const* dev::eth::stageName(TxStage _s)
+{
+	switch (_s)
+	{
+	case TxStage::Received: return "received";
+	case TxStage::Verified: return "verified";
+	case TxStage::Imported: return "imported";
+	case TxStage::Broadcast: return "broadcast";
+	case TxStage::Proposed: return "proposed";
+	case TxStage::Executed: return "executed";
+	case TxStage::Committed: return "committed";
+	case TxStage::Receipt: return "receipt";
+	default: return "unknown";
+	}
+}
+
+TxTrace& TxTrace::instance()
+{
+	static TxTrace s_instance;
+	return s_instance;
+}
+
+void TxTrace::Slice::clear()
+{
+	txs.store(0, memory_order_relaxed);
+	for (auto& stage: stages)
+		for (auto& b: stage)
+			b.store(0, memory_order_relaxed);
+	for (auto& b: total)
+		b.store(0, memory_order_relaxed);
+}
+
+bool TxTrace::claim(Slice& _s, uint64_t _epoch)
+{
+	uint64_t held = _s.epoch.load(memory_order_acquire);
+	while (held < _epoch)
+		if (_s.epoch.compare_exchange_weak(held, _epoch, memory_order_acq_rel))
+		{
+			_s.clear();
+			return true;
+		}
+	return held == _epoch;
+}
+
+TxTrace::Slice* TxTrace::slice(uint64_t _epoch)
+{
+	Slice& s = m_slices[_epoch % c_slices];
+	if (!claim(s, _epoch))
+		// older than the slices kept
+		return nullptr;
+	Slice& next = m_slices[(_epoch + 1) % c_slices];
+	if (next.epoch.load(memory_order_relaxed) <= _epoch)
+		claim(next, _epoch + 1);
+	return &s;
+}
+
+void TxTrace::record(h256 const& _tx, TxStage _stage, uint64_t _time)
+{
+	uint64_t key;
+	uint64_t tail;
+	memcpy(&key, _tx.data(), sizeof(key));
+	memcpy(&tail, _tx.data() + h256::size - sizeof(tail), sizeof(tail));
+	key ^= tail;
+	if (!key)
+		key = 1;
+	uint64_t const bit = 1ull << (unsigned)_stage;
+
+	// the transaction's entry in its set, else a free one, else the one idle longest
+	Tx* set = &m_txs[(key % (c_txs / c_ways)) * c_ways];
+	Tx* tx = nullptr;
+	Tx* victim = nullptr;
+	uint64_t victimKey = 0;
+	for (size_t i = 0; i < c_ways; ++i)
+	{
+		uint64_t k = set[i].key.load(memory_order_relaxed);
+		if (k == key)
+		{
+			tx = &set[i];
+			break;
+		}
+		if (!victim || (victimKey && (!k || set[i].last.load(memory_order_relaxed) < victim->last.load(memory_order_relaxed))))
+		{
+			victim = &set[i];
+			victimKey = k;
+		}
+	}
+
+	Slice* s = slice(epochOf(_time));
+	if (!tx)
+	{
+		if (s)
+			s->txs.fetch_add(1, memory_order_relaxed);
+		// nothing follows the last stage
+		if (_stage == TxStage::Receipt)
+			return;
+		victim->key.store(key, memory_order_relaxed);
+		victim->first.store(_time, memory_order_relaxed);
+		victim->last.store(_time, memory_order_relaxed);
+		victim->stages.store(bit, memory_order_relaxed);
+		return;
+	}
+
+	uint64_t stages = tx->stages.fetch_or(bit, memory_order_relaxed);
+	if (stages & bit)
+		// recorded again, by another path or node role; the first one counts
+		return;
+	uint64_t last = tx->last.load(memory_order_relaxed);
+	if (_time > last)
+		tx->last.store(_time, memory_order_relaxed);
+	if (s)
+		observe(s->stages[(size_t)_stage], _time > last ? _time - last : 0);
+
+	if (_stage == TxStage::Receipt)
+	{
+		if (s)
+			observe(s->total, max(_time, last) - tx->first.load(memory_order_relaxed));
+		tx->key.store(0, memory_order_relaxed);
+	}
+}
+
+TxTrace::Breakdown TxTrace::breakdown(unsigned _seconds) const
+{
+	uint64_t const end = now();
+	uint64_t const window = _seconds * 1000000000ull;
+	uint64_t const current = epochOf(end);
+	uint64_t const first = max(epochOf(end > window ? end - window : 0), current + 1 - min<uint64_t>(current + 1, c_slices - 1));
+
+	Breakdown ret;
+	uint64_t oldest = end;
+	array<metrics::Histogram::Snapshot, c_stages> stages;
+	metrics::Histogram::Snapshot total;
+	for (auto& h: stages)
+		h.buckets.fill(0);
+	total.buckets.fill(0);
+	for (uint64_t e = first; e <= current; ++e)
+	{
+		Slice const& s = m_slices[e % c_slices];
+		if (s.epoch.load(memory_order_acquire) != e)
+			continue;
+		uint64_t txs = s.txs.load(memory_order_relaxed);
+		bool any = txs;
+		for (size_t i = 0; i < c_stages; ++i)
+		{
+			size_t before = stages[i].count;
+			add(stages[i], s.stages[i]);
+			any = any || stages[i].count != before;
+		}
+		add(total, s.total);
+		if (any)
+			oldest = min<uint64_t>(oldest, e * c_sliceSeconds * 1000000000ull);
+		ret.txs += txs;
+	}
+	ret.span = min<uint64_t>(end - oldest, window) / 1000;
+	for (size_t i = 0; i < c_stages; ++i)
+		ret.stages[i] = statsOf(stages[i]);
+	ret.total = statsOf(total);
+	return ret;
+}
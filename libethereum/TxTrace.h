@@ -0,0 +1,143 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: TxTrace.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Metrics.h>
+#include "Transaction.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/// Points of the transaction pipeline at which a transaction is timestamped, in pipeline order.
+enum class TxStage: uint8_t
+{
+	Received,	///< eth_sendRawTransaction entered
+	Verified,	///< decoded and signature checked
+	Imported,	///< accepted into the transaction queue
+	Broadcast,	///< first gossiped to peers
+	Proposed,	///< part of a PrepareReq, sent as leader or received as replica
+	Executed,	///< block executed for consensus
+	Committed,	///< block imported into the chain
+	Receipt,	///< receipt and filters visible to clients
+	Count
+};
+
+char const* stageName(TxStage _s);
+
+/**
+ * Per stage latencies of the transaction pipeline, aggregated as events arrive. A fixed, lock
+ * free table follows each transaction in flight, its first and latest stage times; an event
+ * adds the time since the transaction's latest stage to its stage's histogram in the slice of
+ * the current c_sliceSeconds. breakdown() sums the slices of its window, so the window is
+ * bounded by c_slices, not by the transaction rate. Events racing on one transaction may be
+ * miscounted, and a transaction evicted from a full table set starts over.
+ */
+class TxTrace
+{
+public:
+	struct StageStats
+	{
+		size_t count = 0;
+		/// microseconds
+		uint64_t p50 = 0;
+		uint64_t p90 = 0;
+		uint64_t p99 = 0;
+		uint64_t max = 0;
+	};
+
+	struct Breakdown
+	{
+		/// microseconds covered by the slices with events, at most the requested window
+		uint64_t span = 0;
+		size_t txs = 0;
+		/// time from the latest stage recorded before it for the same transaction to this one
+		std::array<StageStats, (size_t)TxStage::Count> stages;
+		/// time from the first to the last stage of the transactions that reached the last one
+		StageStats total;
+	};
+
+	static TxTrace& instance();
+
+	static uint64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+	void record(h256 const& _tx, TxStage _stage, uint64_t _time = now());
+
+	void record(Transactions const& _txs, TxStage _stage, uint64_t _time = now())
+	{
+		for (auto const& t: _txs)
+			record(t.sha3(), _stage, _time);
+	}
+
+	/// Per stage latency percentiles of the transactions seen in the last @a _seconds,
+	/// rounded up to whole slices.
+	Breakdown breakdown(unsigned _seconds) const;
+
+private:
+	static const size_t c_stages = (size_t)TxStage::Count;
+	static const unsigned c_sliceSeconds = 5;
+	/// Ten minutes of slices, and the one being filled.
+	static const size_t c_slices = 10 * 60 / c_sliceSeconds + 1;
+	/// Transactions followed at once, in sets of c_ways.
+	static const size_t c_txs = 1 << 18;
+	static const size_t c_ways = 4;
+
+	/// One transaction in flight; key 0 is a free entry.
+	struct Tx
+	{
+		std::atomic<uint64_t> key{0};
+		std::atomic<uint64_t> first{0};
+		std::atomic<uint64_t> last{0};
+		std::atomic<uint64_t> stages{0};	///< bit per stage recorded
+	};
+
+	/// The events of one c_sliceSeconds period, as histogram buckets in microseconds.
+	struct Slice
+	{
+		std::atomic<uint64_t> epoch{0};		///< period held, time / c_sliceSeconds
+		std::atomic<uint64_t> txs{0};
+		std::array<std::array<std::atomic<uint64_t>, metrics::Histogram::c_buckets>, c_stages> stages;
+		std::array<std::atomic<uint64_t>, metrics::Histogram::c_buckets> total;
+		void clear();
+	};
+
+	TxTrace(): m_txs(new Tx[c_txs]), m_slices(new Slice[c_slices]) {}
+
+	static uint64_t epochOf(uint64_t _time) { return _time / (c_sliceSeconds * 1000000000ull); }
+	/// @returns the slice of @a _epoch, claimed and cleared if it held an older one, and clears
+	/// the next one ahead of time, so that claims seldom race with writers.
+	Slice* slice(uint64_t _epoch);
+	bool claim(Slice& _s, uint64_t _epoch);
+
+	std::unique_ptr<Tx[]> m_txs;
+	std::unique_ptr<Slice[]> m_slices;
+};
+
+}
+}
@@ -28,6 +28,8 @@ using namespace dev;
 using namespace dev::p2p;
 
 const unsigned dev::p2p::c_protocolVersion = 4;
+const unsigned dev::p2p::c_wireCompression = dev::p2p::BlockCompression;
+const size_t dev::p2p::c_compressionThreshold = 1024;
  unsigned dev::p2p::c_defaultIPPort = 16789;
 static_assert(dev::p2p::c_protocolVersion == 4, "Replace v3 compatbility with v4 compatibility before updating network version.");
 
@@ -57,6 +57,19 @@ namespace p2p
 extern const unsigned c_protocolVersion;
 extern  unsigned c_defaultIPPort;
 
+/// Wire compression codec advertised as the optional trailing item of the Hello packet.
+/// Peers that do not send it (older nodes) get uncompressed packets.
+enum WireCompression
+{
+	NoCompression = 0,
+	BlockCompression
+};
+
+/// Codec this node advertises in its Hello packet.
+extern const unsigned c_wireCompression;
+/// Packets at least this large are compressed when the peer negotiated compression.
+extern const size_t c_compressionThreshold;
+
 class NodeIPEndpoint;
 class Node;
 extern const NodeIPEndpoint UnspecifiedNodeIPEndpoint;
@@ -92,6 +105,7 @@ enum PacketType
 	PeersPacket,
 	GetAnnouncementHashPacket,
 	AnnouncementPacket,
+	CompressedPacket,
 	UserPacket = 0x10
 };
 
@@ -236,6 +250,7 @@ struct PeerSessionInfo
 	std::map<std::string, std::string> notes;
 	unsigned const protocolVersion;
 	NodeIPEndpoint nodeIPEndpoint;
+	bool const compression;				///< True if both ends negotiated BlockCompression.
 };
 
 using PeerSessionInfos = std::vector<PeerSessionInfo>;
@@ -424,13 +424,14 @@ void RLPXHandshake::transition(boost::system::error_code _ech)
 		h256 hash;
         if (!NodeConnManagerSingleton::GetInstance().nodeInfoHash(hash))
             return;
-		s.append((unsigned)HelloPacket).appendList(6)
+		s.append((unsigned)HelloPacket).appendList(7)
 		        << dev::p2p::c_protocolVersion
 		        << m_host->m_clientVersion
 		        << m_host->caps()
 		        << m_host->listenPort()
 		        << m_host->id()
-				<< hash;
+				<< hash
+				<< dev::p2p::c_wireCompression;
 
 		bytes packet;
 		s.swapOut(packet);
@@ -25,6 +25,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/CommonIO.h>
 #include <libdevcore/Exceptions.h>
+#include <libdevcore/Compression.h>
 #include "Host.h"
 #include "Capability.h"
 #include <libdevcore/easylog.h>
@@ -125,7 +126,11 @@ template <class T> vector<T> randomSelection(vector<T> const& _t, unsigned _n)
 // read package after receive the packae
 bool Session::readPacket(uint16_t _capId, PacketType _t, RLP const& _r)
 {
-	m_lastReceived = chrono::steady_clock::now();
+	auto start = m_lastReceived = chrono::steady_clock::now();
+	ScopeGuard recordPacket([&]() {
+		if (m_statistics)
+			packetHistogram(_capId, _t).observe(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+	});
 	try // Generic try-catch block designed to capture RLP format errors - TODO: give decent diagnostics, make a bit more specific over what is caught.
 	{
 		// v4 frame headers are useless, offset packet type used
@@ -157,6 +162,17 @@ bool Session::readPacket(uint16_t _capId, PacketType _t, RLP const& _r)
 	return true;
 }
 
+metrics::Histogram& Session::packetHistogram(uint16_t _capId, PacketType _t)
+{
+	if ((unsigned)_t >= c_packetTypes)
+		return m_statistics->histogram(std::to_string(_capId) + "-" + std::to_string(_t));
+	// packets are read one at a time, so the lookups need no lock
+	auto& h = m_packetHistograms[_capId][_t];
+	if (!h)
+		h = &m_statistics->histogram(std::to_string(_capId) + "-" + std::to_string(_t));
+	return *h;
+}
+
 bool Session::interpret(PacketType _t, RLP const& _r)
 {
 	switch (_t)
@@ -240,6 +256,27 @@ bool Session::interpret(PacketType _t, RLP const& _r)
 		
 		break;
 	}
+	case CompressedPacket:
+	{
+		bytes packet;
+		if (!decompressBlock(_r[0].toBytesConstRef(), packet) || packet.size() < 2 || !checkPacket(&packet))
+		{
+			LOG(WARNING) << "Invalid compressed packet From " << m_info.id.abridged();
+			disconnect(BadProtocol);
+			break;
+		}
+
+		bytesConstRef frame(&packet);
+		auto packetType = (PacketType)RLP(frame.cropped(0, 1)).toInt<unsigned>();
+		if (packetType == CompressedPacket)
+		{
+			disconnect(BadProtocol);
+			break;
+		}
+		if (!readPacket(0, packetType, RLP(frame.cropped(1))))
+			LOG(WARNING) << "Couldn't interpret compressed packet." << packetType;
+		break;
+	}
 	case GetPeersPacket:
 	case PeersPacket:
 		break;
@@ -282,7 +319,7 @@ void Session::sealAndSend(RLPStream& _s, uint16_t _protocolID)
 
 bool Session::checkPacket(bytesConstRef _msg)
 {
-	if (_msg[0] > 0x7f || _msg.size() < 2)
+	if (_msg.size() < 2 || _msg[0] > 0x7f)
 		return false;
 	if (RLP(_msg.cropped(1)).actualSize() + 1 != _msg.size())
 		return false;
@@ -301,6 +338,9 @@ void Session::send(bytes&& _msg, uint16_t _protocolID)
 	if (!m_socket->isConnected())
 		return;
 
+	if (m_info.compression && !isFramingEnabled() && _msg.size() >= c_compressionThreshold)
+		compress(_msg);
+
 	bool doWrite = false;
 	if (isFramingEnabled())
 	{
@@ -332,6 +372,17 @@ void Session::send(bytes&& _msg, uint16_t _protocolID)
 	}
 }
 
+void Session::compress(bytes& io_msg)
+{
+	bytes compressed = compressBlock(&io_msg);
+	if (compressed.size() + 8 >= io_msg.size())
+		return;
+
+	RLPStream s;
+	prep(s, CompressedPacket, 1) << compressed;
+	s.swapOut(io_msg);
+}
+
 void Session::onWrite(boost::system::error_code ec, std::size_t length)
 {
 	try
@@ -144,6 +144,9 @@ private:
 
 	void send(bytes&& _msg, uint16_t _protocolID);
 
+	/// Replace @a io_msg with a CompressedPacket wrapping it, if that makes it smaller.
+	void compress(bytes& io_msg);
+
 	/// Drop the connection for the reason @a _r.
 	void drop(DisconnectReason _r);
 
@@ -161,6 +164,8 @@ private:
 
 	/// Deliver RLPX packet to Session or Capability for interpretation.
 	bool readPacket(uint16_t _capId, PacketType _t, RLP const& _r);
+	/// @returns the m_statistics histogram packets @a _t of capability @a _capId are timed in.
+	metrics::Histogram& packetHistogram(uint16_t _capId, PacketType _t);
 
 	/// Interpret an incoming Session packet.
 	bool interpret(PacketType _t, RLP const& _r);
@@ -190,6 +195,9 @@ private:
 
 	std::map<CapDesc, std::shared_ptr<Capability>> m_capabilities;	///< The peer's capability set.
 	std::shared_ptr<dev::InterfaceStatistics> m_statistics = nullptr;
+	static const unsigned c_packetTypes = 256;
+	/// m_statistics histograms by capability and packet type, looked up on the first such packet.
+	std::map<uint16_t, std::array<metrics::Histogram*, c_packetTypes>> m_packetHistograms;
 
 	// framing-related stuff (protected by x_writeQueue mutex)
 	struct Framing
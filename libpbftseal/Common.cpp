@@ -27,3 +27,125 @@ using namespace std;
 using namespace dev;
 using namespace eth;
 
+CompactPrepareReq::CompactPrepareReq(PrepareReq const& _req) {
+	height = _req.height;
+	view = _req.view;
+	idx = _req.idx;
+	timestamp = _req.timestamp;
+	block_hash = _req.block_hash;
+	sig = _req.sig;
+	sig2 = _req.sig2;
+
+	RLP rlp(_req.block);
+	RLPView block(rlp);
+	header = block[0].data().toBytes();
+	RLP txs = block[1];
+	tx_hashes.reserve(txs.itemCount());
+	for (auto const& tx : txs)
+		tx_hashes.push_back(sha3(tx.data()));
+
+	size_t tailSize = 0;
+	for (size_t i = 2; i < block.size(); ++i)
+		tailSize += block[i].data().size();
+	RLPStream ts;
+	ts.reserve(tailSize + 9);
+	ts.appendList(block.size() - 2, tailSize);
+	for (size_t i = 2; i < block.size(); ++i)
+		ts.appendRaw(block[i].data());
+	ts.swapOut(tail);
+}
+
+PrepareReq CompactPrepareReq::toPrepareReq(std::vector<bytes> const& _txs) const {
+	PrepareReq req;
+	req.height = height;
+	req.view = view;
+	req.idx = idx;
+	req.timestamp = timestamp;
+	req.block_hash = block_hash;
+	req.sig = sig;
+	req.sig2 = sig2;
+
+	size_t txsSize = 0;
+	for (auto const& tx : _txs)
+		txsSize += tx.size();
+
+	RLP tail_rlp(tail);
+	RLPStream block;
+	size_t blockSize = header.size() + txsSize + 9 + tail.size();
+	block.reserve(blockSize + 9);
+	block.appendList(2 + tail_rlp.itemCount(), blockSize);
+	block.appendRaw(header);
+	block.appendList(_txs.size(), txsSize);
+	for (auto const& tx : _txs)
+		block.appendRaw(tx);
+	for (auto const& field : tail_rlp)
+		block.appendRaw(field.data());
+	block.swapOut(req.block);
+	return req;
+}
+
+std::vector<size_t> CompactPrepareCollector::reset(CompactPrepareReq const& _req, std::vector<bytes> _txs) {
+	m_req = _req;
+	m_txs = std::move(_txs);
+	m_txs.resize(_req.tx_hashes.size());
+
+	std::vector<size_t> missing;
+	for (size_t i = 0; i < m_txs.size(); ++i) {
+		if (m_txs[i].empty() || sha3(m_txs[i]) != _req.tx_hashes[i]) {
+			m_txs[i].clear();
+			missing.push_back(i);
+		}
+	}
+	m_missing = missing.size();
+	return missing;
+}
+
+bool CompactPrepareCollector::fill(RLP const& _r) {
+	if (m_req.block_hash != _r[0].toHash<h256>(RLP::VeryStrict) || m_missing == 0)
+		return false;
+
+	for (auto const& item : _r[1]) {
+		size_t index = item[0].toInt<unsigned>();
+		if (index >= m_txs.size() || !m_txs[index].empty())
+			continue;
+		bytesConstRef tx = item[1].data();
+		if (sha3(tx) == m_req.tx_hashes[index]) {
+			m_txs[index] = tx.toBytes();
+			--m_missing;
+		}
+	}
+	return true;
+}
+
+PrepareReq CompactPrepareCollector::complete() {
+	PrepareReq req = m_req.toPrepareReq(m_txs);
+	m_txs.clear();
+	return req;
+}
+
+// like PBFTMsg::streamRLPFields, the fields are not wrapped in a list: PBFTPeer sends the body as a
+// byte string and the receiver indexes the items of its payload
+bytes dev::eth::getPrepareTxsRLP(h256 const& _block_hash, std::vector<size_t> const& _indexes) {
+	RLPStream ts;
+	ts << _block_hash;
+	ts.appendList(_indexes.size());
+	for (auto i : _indexes)
+		ts << (unsigned)i;
+	return ts.out();
+}
+
+bytes dev::eth::prepareTxsRLP(PrepareReq const& _prepare, RLP const& _r) {
+	RLP txs = RLP(_prepare.block)[1];
+	RLPStream ts;
+	ts << _prepare.block_hash;
+	ts.appendList(_r[1].itemCount());
+	for (auto const& i : _r[1]) {
+		unsigned index = i.toInt<unsigned>();
+		ts.appendList(2) << index;
+		if (index < txs.itemCount())
+			ts.appendRaw(txs[index].data());
+		else
+			ts << bytes();
+	}
+	return ts.out();
+}
@@ -45,6 +45,9 @@ enum PBFTPacketType : byte
 	SignReqPacket = 0x01,
 	CommitReqPacket = 0x02,
 	ViewChangeReqPacket = 0x03,
+	CompactPrepareReqPacket = 0x04,
+	GetPrepareTxsPacket = 0x05,
+	PrepareTxsPacket = 0x06,
 
 	PBFTPacketCount
 };
@@ -82,7 +85,12 @@ struct PBFTMsg {
 	virtual void streamRLPFields(RLPStream& _s) const {
 		_s << height << view << idx << timestamp << block_hash << sig.asBytes() << sig2.asBytes();
 	}
-	virtual void  populate(RLP const& _rlp) {
+	void populate(RLP const& _rlp) {
+		// the fields are indexed in one walk over the message, whichever type reads them
+		RLPView fields(_rlp);
+		populateFields(fields);
+	}
+	virtual void populateFields(RLPView const& _rlp) {
 		int field = 0;
 		try	{
 			height = _rlp[field = 0].toInt<u256>();
@@ -118,8 +126,8 @@ struct PBFTMsg {
 struct PrepareReq : public PBFTMsg {
 	bytes block;
 	virtual void streamRLPFields(RLPStream& _s) const {	PBFTMsg::streamRLPFields(_s); _s << block; }
-	virtual void populate(RLP const& _rlp) {
-		PBFTMsg::populate(_rlp);
+	virtual void populateFields(RLPView const& _rlp) {
+		PBFTMsg::populateFields(_rlp);
 		int field = 0;
 		try	{
 			block = _rlp[field = 7].toBytes();
@@ -129,9 +137,63 @@ struct PrepareReq : public PBFTMsg {
 		}
 	}
 };
+// prepare request carrying the block header and transaction hashes instead of the full block
+struct CompactPrepareReq : public PBFTMsg {
+	bytes header; // raw block header rlp
+	h256s tx_hashes; // hashes of the block's transactions, in block order
+	bytes tail; // raw rlp list of the block fields after the transaction list
+
+	CompactPrepareReq() {}
+	CompactPrepareReq(PrepareReq const& _req);
+
+	virtual void streamRLPFields(RLPStream& _s) const {	PBFTMsg::streamRLPFields(_s); _s << header << tx_hashes << tail; }
+	virtual void populateFields(RLPView const& _rlp) {
+		PBFTMsg::populateFields(_rlp);
+		int field = 0;
+		try	{
+			header = _rlp[field = 7].toBytes();
+			tx_hashes = _rlp[field = 8].toVector<h256>();
+			tail = _rlp[field = 9].toBytes();
+		} catch (Exception const& _e)	{
+			_e << errinfo_name("invalid msg format") << BadFieldError(field, toHex(_rlp[field].data().toBytes()));
+			throw;
+		}
+	}
+
+	// rebuild the full prepare request from the transactions' rlp, in tx_hashes order
+	PrepareReq toPrepareReq(std::vector<bytes> const& _txs) const;
+};
 struct SignReq : public PBFTMsg {};
 struct CommitReq : public PBFTMsg {};
 struct ViewChangeReq : public PBFTMsg {};
 
+// follower side of a compact prepare: the block's transactions gathered so far and the ones still missing
+class CompactPrepareCollector {
+public:
+	// starts on _req with the rlp of the transactions found locally, empty for unknown ones
+	// returns the indexes of the transactions still missing
+	std::vector<size_t> reset(CompactPrepareReq const& _req, std::vector<bytes> _txs);
+	// takes the transactions of a PrepareTxsPacket that match their hashes
+	// returns false if the reply is not for the prepare being collected
+	bool fill(RLP const& _r);
+	// rebuilds the full prepare once nothing is missing; req() stays to spot duplicates
+	PrepareReq complete();
+	// gives up on the missing transactions
+	void clear() { m_missing = 0; m_txs.clear(); }
+
+	CompactPrepareReq const& req() const { return m_req; }
+	size_t missing() const { return m_missing; }
+
+private:
+	CompactPrepareReq m_req;
+	std::vector<bytes> m_txs;
+	size_t m_missing = 0;
+};
+
+// GetPrepareTxsPacket asking for the transactions at _indexes, or for the full prepare if there are none
+bytes getPrepareTxsRLP(h256 const& _block_hash, std::vector<size_t> const& _indexes);
+// PrepareTxsPacket answering the GetPrepareTxsPacket _r with the transactions of _prepare
+bytes prepareTxsRLP(PrepareReq const& _prepare, RLP const& _r);
+
 }
 }
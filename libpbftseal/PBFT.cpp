@@ -27,12 +27,15 @@
 #include <libethereum/Interface.h>
 #include <libethereum/BlockChain.h>
 #include <libethereum/EthereumHost.h>
+#include <libethereum/TransactionQueue.h>
 #include <libethereum/NodeConnParamsManagerApi.h>
 #include <libdevcrypto/Common.h>
 #include "PBFT.h"
 #include <libdevcore/easylog.h>
 #include <libdevcore/LogGuard.h>
+#include <libdevcore/Metrics.h>
 #include <libethereum/StatLog.h>
+#include <libethereum/TxTrace.h>
 #include <libethereum/ConsensusControl.h>
 using namespace std;
 using namespace dev;
@@ -54,7 +57,7 @@ PBFT::~PBFT() {
 	stopWorking();
 }
 
-void PBFT::initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _db, BlockQueue *bq, KeyPair const& _key_pair, unsigned _view_timeout)
+void PBFT::initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _db, BlockQueue *bq, TransactionQueue *tq, KeyPair const& _key_pair, unsigned _view_timeout)
 {
 	Guard l(m_mutex);
 
@@ -62,6 +65,7 @@ void PBFT::initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _d
 	m_bc.reset(_bc);
 	m_stateDB.reset(_db);
 	m_bq.reset(bq);
+	m_tq = tq;
 
 	m_bc->setSignChecker([this](BlockHeader const & _header, std::vector<std::pair<u256, Signature>> _sign_list) {
 		return checkBlockSign(_header, _sign_list);
@@ -313,7 +317,7 @@ void PBFT::reportBlock(BlockHeader const & _b, u256 const &) {
 }
 
 void PBFT::onPBFTMsg(unsigned _id, std::shared_ptr<p2p::Capability> _peer, RLP const & _r) {
-	if (_id <= ViewChangeReqPacket) {
+	if (_id < PBFTPacketCount) {
 		NodeID nodeid;
 		auto session = _peer->session();
 		if (session && (nodeid = session->id()))
@@ -345,6 +349,7 @@ void PBFT::workLoop() {
 			}
 
 			checkTimeout();
+			retryCompactPrepare();
 			handleFutureBlock();
 			collectGarbage();
 		} catch (Exception &_e) {
@@ -364,6 +369,9 @@ void PBFT::handleMsg(unsigned _id, u256 const& _from, h512 const& _node, RLP con
 		PrepareReq req;
 		req.populate(_r);
 		handlePrepareMsg(_from, req);
+		if (req.block_hash == m_compact_prepare.req().block_hash) {
+			m_compact_prepare.clear();  // the full prepare a compact one fell back to
+		}
 		key = req.block_hash.hex();
 		pbft_msg = req;
 		break;
@@ -392,6 +400,22 @@ void PBFT::handleMsg(unsigned _id, u256 const& _from, h512 const& _node, RLP con
 		pbft_msg = req;
 		break;
 	}
+	case CompactPrepareReqPacket: {
+		CompactPrepareReq req;
+		req.populate(_r);
+		handleCompactPrepareMsg(_from, req);
+		key = req.block_hash.hex();
+		pbft_msg = req;
+		break;
+	}
+	case GetPrepareTxsPacket: {
+		handleGetPrepareTxsMsg(_node, _r);
+		return;
+	}
+	case PrepareTxsPacket: {
+		handlePrepareTxsMsg(_r);
+		return;
+	}
 	default: {
 		LOG(WARNING) << "Recv error msg, id=" << _id;
 		return;
@@ -597,9 +621,26 @@ bool PBFT::broadcastPrepareReq(BlockHeader const & _bi, bytes const & _block_dat
 	req.sig2 = signHash(req.fieldsWithoutBlock());
 	req.block = _block_data;
 
+	static auto& compactBytes = metrics::counter("pbft_prepare_bytes_total", "Bytes of prepare requests broadcast by the leader, and of the blocks they carry", {{"kind", "compact"}});
+	static auto& fullBytes = metrics::counter("pbft_prepare_bytes_total", "Bytes of prepare requests broadcast by the leader, and of the blocks they carry", {{"kind", "full"}});
+	static auto& blockBytes = metrics::counter("pbft_prepare_bytes_total", "Bytes of prepare requests broadcast by the leader, and of the blocks they carry", {{"kind", "block"}});
+	static auto& prepares = metrics::counter("pbft_prepares_total", "Prepare requests broadcast by the leader");
+
 	RLPStream ts;
-	req.streamRLPFields(ts);
-	if (broadcastMsg(req.block_hash.hex(), PrepareReqPacket, ts.out())) {
+	unsigned packet_id = PrepareReqPacket;
+	if (m_bc->chainParams().compactPrepare) {
+		CompactPrepareReq compact_req(req);
+		compact_req.streamRLPFields(ts);
+		packet_id = CompactPrepareReqPacket;
+		compactBytes.inc(ts.out().size());
+		LOG(DEBUG) << "broadcastPrepareReq compact, blk=" << req.height << ",txs=" << compact_req.tx_hashes.size() << ",bytes=" << ts.out().size() << ",full_bytes=" << req.block.size();
+	} else {
+		req.streamRLPFields(ts);
+		fullBytes.inc(ts.out().size());
+	}
+	blockBytes.inc(req.block.size());
+	prepares.inc();
+	if (broadcastMsg(req.block_hash.hex(), packet_id, ts.out())) {
 		addRawPrepare(req);
 		return true;
 	}
@@ -643,8 +684,27 @@ bool PBFT::broadcastMsg(std::string const & _key, unsigned _id, bytes const & _d
 	return false;
 }
 
+bool PBFT::sendMsg(h512 const& _node, unsigned _id, bytes const& _data) {
+	bool sent = false;
+	if (auto h = m_host.lock()) {
+		h->foreachPeer([&](shared_ptr<PBFTPeer> _p)
+		{
+			auto session = _p->session();
+			if (session && session->id() == _node) {
+				RLPStream ts;
+				_p->prep(ts, _id, 1).append(_data);
+				_p->sealAndSend(ts);
+				sent = true;
+				return false;
+			}
+			return true;
+		});
+	}
+	return sent;
+}
+
 bool PBFT::broadcastFilter(std::string const & _key, unsigned _id, shared_ptr<PBFTPeer> _p) {
-	if (_id == PrepareReqPacket) {
+	if (_id == PrepareReqPacket || _id == CompactPrepareReqPacket) {
 		DEV_GUARDED(_p->x_knownPrepare)
 		return _p->m_knownPrepare.exist(_key);
 	} else if (_id == SignReqPacket) {
@@ -663,7 +723,7 @@ bool PBFT::broadcastFilter(std::string const & _key, unsigned _id, shared_ptr<PB
 }
 
 void PBFT::broadcastMark(std::string const & _key, unsigned _id, shared_ptr<PBFTPeer> _p) {
-	if (_id == PrepareReqPacket) {
+	if (_id == PrepareReqPacket || _id == CompactPrepareReqPacket) {
 		DEV_GUARDED(_p->x_knownPrepare)
 		{
 			if (_p->m_knownPrepare.size() > kKnownPrepare) {
@@ -747,6 +807,7 @@ bool PBFT::isExistViewChange(ViewChangeReq const & _req) {
 
 void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _self) {
 	Timer t;
+	auto received = TxTrace::now();
 	ostringstream oss;
 	oss << "handlePrepareMsg: idx=" << _req.idx << ",view=" << _req.view << ",blk=" << _req.height << ",hash=" << _req.block_hash.abridged() << ",from=" << _from;
 	VLOG(10) << oss.str() << ", net-time=" << u256(utcTime()) - _req.timestamp;
@@ -831,6 +892,8 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 	}
 
 	LOG(DEBUG) << "finish exec tx, blk=" << _req.height << ", time=" << utcTime();
+	TxTrace::instance().record(outBlock.pending(), TxStage::Proposed, received);
+	TxTrace::instance().record(outBlock.pending(), TxStage::Executed);
 	// execed log
 	stringstream ss;
 	// TODO FLAG2  hash means real hash!
@@ -869,6 +932,122 @@ void PBFT::handlePrepareMsg(u256 const & _from, PrepareReq const & _req, bool _s
 	return;
 }
 
+void PBFT::handleCompactPrepareMsg(u256 const & _from, CompactPrepareReq const & _req) {
+	ostringstream oss;
+	oss << "handleCompactPrepareMsg: idx=" << _req.idx << ",view=" << _req.view << ",blk=" << _req.height << ",hash=" << _req.block_hash.abridged() << ",from=" << _from;
+
+	if (m_compact_prepare.req().block_hash == _req.block_hash && m_compact_prepare.missing() > 0) {
+		// still waiting for txs: whoever relayed it can serve the full prepare if the leader doesn't
+		if (std::find(m_compact_prepare_sources.begin(), m_compact_prepare_sources.end(), _from) == m_compact_prepare_sources.end())
+			m_compact_prepare_sources.push_back(_from);
+		VLOG(10) << oss.str() << "Compact prepare still missing " << m_compact_prepare.missing() << " txs, sources=" << m_compact_prepare_sources.size();
+		return;
+	}
+
+	if (m_raw_prepare_cache.block_hash == _req.block_hash || m_compact_prepare.req().block_hash == _req.block_hash) {
+		VLOG(10) << oss.str() << "Discard a compact prepare, duplicated";
+		return;
+	}
+
+	if (_req.height < m_consensus_block_number || _req.view < m_view) {
+		VLOG(10) << oss.str() << "Discard a compact prepare, lower than your needed blk";
+		return;
+	}
+
+	if (!checkSign(_req)) {
+		LOG(WARNING) << oss.str() << "CheckSign failed";
+		return;
+	}
+
+	m_compact_prepare_from = _from;
+	std::vector<size_t> missing = m_compact_prepare.reset(_req, m_tq ? m_tq->transactionsRLP(_req.tx_hashes) : std::vector<bytes>());
+	m_compact_prepare_sources.assign(1, _req.idx);
+	if (_from != _req.idx)
+		m_compact_prepare_sources.push_back(_from);
+	m_compact_prepare_tries = 0;
+
+	LOG(DEBUG) << oss.str() << ",txs=" << _req.tx_hashes.size() << ",missing=" << missing.size();
+
+	if (missing.empty())
+		completeCompactPrepare();
+	else
+		requestPrepareTxs(missing, _req.idx);
+}
+
+void PBFT::requestPrepareTxs(std::vector<size_t> const& _indexes, u256 const& _to) {
+	static auto& txFetches = metrics::counter("pbft_prepare_fetch_total", "Requests for what a compact prepare left out", {{"what", "txs"}});
+	static auto& fullFetches = metrics::counter("pbft_prepare_fetch_total", "Requests for what a compact prepare left out", {{"what", "full"}});
+	static auto& missingTxs = metrics::counter("pbft_prepare_missing_txs_total", "Transactions of compact prepares missing from the local queue");
+	if (_indexes.empty()) {
+		fullFetches.inc();
+	} else {
+		txFetches.inc();
+		missingTxs.inc(_indexes.size());
+	}
+
+	m_compact_prepare_asked = utcTime();
+	h512 node_id = h512(0);
+	if (!NodeConnManagerSingleton::GetInstance().getPublicKey(_to, node_id)) {
+		LOG(WARNING) << "requestPrepareTxs: can't find node, idx=" << _to;
+		return;
+	}
+
+	// an empty index list asks for the full prepare
+	if (!sendMsg(node_id, GetPrepareTxsPacket, getPrepareTxsRLP(m_compact_prepare.req().block_hash, _indexes)))
+		LOG(WARNING) << "requestPrepareTxs: node not connected, idx=" << _to;
+}
+
+void PBFT::retryCompactPrepare() {
+	Guard l(m_mutex);
+	if (m_compact_prepare.missing() == 0 || utcTime() - m_compact_prepare_asked < kCompactPrepareRetry) {
+		return;
+	}
+	if (m_compact_prepare.req().height < m_consensus_block_number || m_compact_prepare.req().view < m_view) {
+		// consensus moved on without it
+		m_compact_prepare.clear();
+		return;
+	}
+
+	// the leader had its turn with the missing txs; go round every source for the full prepare
+	u256 to = m_compact_prepare_sources[m_compact_prepare_tries++ % m_compact_prepare_sources.size()];
+	LOG(WARNING) << "retryCompactPrepare: still missing " << m_compact_prepare.missing() << " txs, ask idx=" << to << " for the full prepare, try=" << m_compact_prepare_tries << ",hash=" << m_compact_prepare.req().block_hash.abridged();
+	requestPrepareTxs(std::vector<size_t>(), to);
+}
+
+void PBFT::handleGetPrepareTxsMsg(h512 const & _node, RLP const & _r) {
+	h256 block_hash = _r[0].toHash<h256>(RLP::VeryStrict);
+	if (m_raw_prepare_cache.block_hash != block_hash) {
+		LOG(INFO) << "handleGetPrepareTxsMsg: prepare not cached, hash=" << block_hash.abridged();
+		return;
+	}
+
+	if (_r[1].itemCount() == 0) {
+		RLPStream ts;
+		m_raw_prepare_cache.streamRLPFields(ts);
+		sendMsg(_node, PrepareReqPacket, ts.out());
+		return;
+	}
+
+	sendMsg(_node, PrepareTxsPacket, prepareTxsRLP(m_raw_prepare_cache, _r));
+}
+
+void PBFT::handlePrepareTxsMsg(RLP const & _r) {
+	if (!m_compact_prepare.fill(_r)) {
+		return;
+	}
+
+	if (m_compact_prepare.missing() == 0) {
+		completeCompactPrepare();
+	} else {
+		LOG(WARNING) << "handlePrepareTxsMsg: still missing " << m_compact_prepare.missing() << " txs, fall back to full prepare, hash=" << m_compact_prepare.req().block_hash.abridged();
+		requestPrepareTxs(std::vector<size_t>(), m_compact_prepare.req().idx);
+	}
+}
+
+void PBFT::completeCompactPrepare() {
+	handlePrepareMsg(m_compact_prepare_from, m_compact_prepare.complete());
+}
+
 void PBFT::handleSignMsg(u256 const & _from, SignReq const & _req) {
 	Timer t;
 	ostringstream oss;
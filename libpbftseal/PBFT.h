@@ -84,7 +84,7 @@ public:
 	bool shouldSeal(Interface* _i) override;
 
 	// should be called before start
-	void initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _db, BlockQueue *bq, KeyPair const& _key_pair, unsigned _view_timeout);
+	void initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _db, BlockQueue *bq, TransactionQueue *tq, KeyPair const& _key_pair, unsigned _view_timeout);
 	void setOmitEmptyBlock(bool _flag) {m_omit_empty_block = _flag;}
 
 	// report newest block 上报最新块
@@ -127,6 +127,7 @@ private:
 	bool broadcastCommitReq(PrepareReq const & _req);
 	bool broadcastViewChangeReq();
 	bool broadcastMsg(std::string const& _key, unsigned _id, bytes const& _data, std::unordered_set<h512> const& _filter = std::unordered_set<h512>());
+	bool sendMsg(h512 const& _node, unsigned _id, bytes const& _data);
 	bool broadcastFilter(std::string const& _key, unsigned _id, shared_ptr<PBFTPeer> _p);
 	void broadcastMark(std::string const& _key, unsigned _id, shared_ptr<PBFTPeer> _p);
 	void clearMask();
@@ -139,6 +140,15 @@ private:
 	void handleCommitMsg(u256 const& _from, CommitReq const& _req);
 	void handleViewChangeMsg(u256 const& _from, ViewChangeReq const& _req);
 
+	// compact prepare: rebuild the block from the local transaction queue, fetch missing txs from the leader
+	void handleCompactPrepareMsg(u256 const& _from, CompactPrepareReq const& _req);
+	void handleGetPrepareTxsMsg(h512 const& _node, RLP const& _r);
+	void handlePrepareTxsMsg(RLP const& _r);
+	void requestPrepareTxs(std::vector<size_t> const& _indexes, u256 const& _to);
+	void completeCompactPrepare();
+	// asks the peers that relayed the compact prepare in turn for the full one while txs are still missing
+	void retryCompactPrepare();
+
 	void reHandlePrepareReq(PrepareReq const& _req);
 
 	// cache访问（未加锁，外层要加锁保护）
@@ -181,6 +191,7 @@ private:
 	std::shared_ptr<BlockChain> m_bc;
 	std::shared_ptr<OverlayDB> m_stateDB;
 	std::shared_ptr<BlockQueue> m_bq;
+	TransactionQueue* m_tq = nullptr;
 
 	u256 m_node_idx = 0;
 	u256 m_view = 0;
@@ -206,6 +217,13 @@ private:
 	ldb::ReadOptions m_readOptions;
 	PrepareReq m_committed_prepare_cache;
 
+	// compact prepare waiting for transactions missing from the local queue
+	CompactPrepareCollector m_compact_prepare;
+	u256 m_compact_prepare_from;
+	std::vector<u256> m_compact_prepare_sources;  // leader first, then the peers that relayed it
+	unsigned m_compact_prepare_tries = 0;
+	uint64_t m_compact_prepare_asked = 0;
+
 	std::chrono::system_clock::time_point m_last_collect_time;
 
 	BlockHeader m_highest_block;
@@ -233,6 +251,7 @@ private:
 	static const size_t kKnownViewChange = 1024;
 
 	static const unsigned kMaxChangeCycle = 20;
+	static const uint64_t kCompactPrepareRetry = 500; // ms
 	// log whether the commit is called before, use to trigger commit phase under consensus control
 	std::unordered_map<h256, bool> m_commitMap;
 };
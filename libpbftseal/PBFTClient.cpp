@@ -30,6 +30,7 @@
 #include "PBFTHost.h"
 #include <libdevcore/easylog.h>
 #include <libethereum/StatLog.h>
+#include <libethereum/TxTrace.h>
 using namespace std;
 using namespace dev;
 using namespace dev::eth;
@@ -86,7 +87,7 @@ void PBFTClient::init(ChainParams const& _params, p2p::HostApi *_host) {
 		pbft()->onPBFTMsg(_id, _peer, _r);
 	}));
 
-	pbft()->initEnv(pbft_host, &m_bc, &m_stateDB, &m_bq, _host->keyPair(), static_cast<unsigned>(sealEngine()->getIntervalBlockTime()) * 3);
+	pbft()->initEnv(pbft_host, &m_bc, &m_stateDB, &m_bq, &m_tq, _host->keyPair(), static_cast<unsigned>(sealEngine()->getIntervalBlockTime()) * 3);
 	pbft()->setOmitEmptyBlock(m_omit_empty_block);
 
 	pbft()->reportBlock(bc().info(), bc().details().totalDifficulty);
@@ -247,7 +248,8 @@ void PBFTClient::doWork(bool _doWait)
 void PBFTClient::rejigSealing() {
 	bool would_seal = m_wouldSeal && (pbft()->accountType() == EN_ACCOUNT_TYPE_MINER);
 	bool is_major_syncing = isMajorSyncing();
-	if (would_seal && !is_major_syncing)
+	// a leader that can't tell replays from new transactions lets its turn time out
+	if (would_seal && !is_major_syncing && replayWindowKnown())
 	{
 		if (pbft()->shouldSeal(this)) // am i leader? 自己是不是leader？
 		{
@@ -343,6 +345,7 @@ void PBFTClient::rejigSealing() {
 			LOG(INFO) << "+++++++++++++++++++++++++++ Generating seal on" << m_sealingInfo.hash(WithoutSeal) << "#" << m_sealingInfo.number() << "tx:" << tx_num << ",maxtx:" << max_block_txs << ",tq.num=" << m_tq.currentTxNum() << "time:" << utcTime();
 
 			u256 view = 0;
+			auto proposed = TxTrace::now();
 			bool generate_ret = pbft()->generateSeal(m_sealingInfo, block_data, view);
 
 			// empty block 空块切换
@@ -368,6 +371,8 @@ void PBFTClient::rejigSealing() {
 					return;
 				}
 
+				TxTrace::instance().record(m_working.pending(), TxStage::Proposed, proposed);
+
 				// run txs 跑交易重新打包
 				auto start_exec_time = utcTime();
 
@@ -401,6 +406,7 @@ void PBFTClient::rejigSealing() {
 				}
 
 				m_last_exec_finish_time = utcTime();
+				TxTrace::instance().record(m_working.pending(), TxStage::Executed);
 				if (tx_num != 0) {
 					auto exec_time_per_tx = (float)(m_last_exec_finish_time - start_exec_time) / tx_num;
 					m_exec_time_per_tx = (m_exec_time_per_tx + exec_time_per_tx) / 2;
@@ -25,145 +25,102 @@
 #include "libdevcore/easylog.h"
 #include <ctime>
 #include <iomanip>
+#include <vector>
 
 using namespace std;
 using namespace dev;
-using namespace boost::interprocess;
 
-InterfaceStatistics::InterfaceStatistics(const std::string &_moduleName, const int &interval) : writeThread(nullptr), moduleName(_moduleName),
-                                                                                                writeInterval(interval), shutdownThread(false), turn(0), mappedFile(nullptr)
+InterfaceStatistics::InterfaceStatistics(const std::string &_moduleName, const int &interval) : moduleName(_moduleName), writeInterval(interval),
+                                                                                                lastWrite(chrono::system_clock::now()), writeThread(nullptr), shutdownThread(false)
 {
+    auto i = moduleName.find_last_of("/") == std::string::npos ? 0 : moduleName.find_last_of("/") + 1;
+    moduleName = moduleName.substr(i);
+    if (moduleName.size() > 8)
+        moduleName = moduleName.substr(0, 8);
+
     if (!moduleName.empty() && writeInterval > 0)
     {
-        shmName = moduleName + IS_MAPPED_FILE_NAME;
-        auto i = moduleName.find_last_of("/") == std::string::npos ? 0 : moduleName.find_last_of("/") + 1;
-        moduleName = moduleName.substr(i);
-        if (moduleName.size() > 8)
-            moduleName = moduleName.substr(0, 8);
-        checkShm();
-        init();
+        writeThread = make_shared<thread>([this]() {
+            unique_lock<std::mutex> l(mt);
+            while (!shutdownThread)
+            {
+                cv.wait_for(l, chrono::seconds(writeInterval), [this]() { return shutdownThread; });
+                if (shutdownThread)
+                    break;
+                l.unlock();
+                writeLog();
+                l.lock();
+            }
+        });
     }
     else
     {
-        LOG(DEBUG) << moduleName << " 's statistics is off";
+        LOG(DEBUG) << moduleName << " 's statistics log is off";
     }
 }
 
-void InterfaceStatistics::checkShm()
+metrics::Histogram &InterfaceStatistics::histogram(const std::string &key)
 {
-    int freeSize = 0;
-    int shmSize = 0;
-    try
-    {
-        managed_mapped_file mfile(open_or_create, shmName.c_str(), IS_MAPPED_FILE_SIZE);
-        freeSize = mfile.get_free_memory();
-        shmSize = mfile.get_size();
-    }
-    catch (interprocess_exception &e)
-    {
-        LOG(ERROR) << e.what();
-    }
-    if (freeSize < IS_SHM_GROW_SIZE)
+    DEV_READ_GUARDED(x_histograms)
     {
-        managed_mapped_file::grow(shmName.c_str(), shmSize);
+        auto it = histograms.find(key);
+        if (it != histograms.end())
+            return *it->second;
     }
-}
-
-void InterfaceStatistics::init()
-{
-    try
-    {
-        mappedFile = new managed_mapped_file(open_or_create, shmName.c_str(), IS_MAPPED_FILE_SIZE);
-    }
-    catch (interprocess_exception &e)
-    {
-        LOG(ERROR) << e.what();
-    }
-    shmHashMapArray = mappedFile->find_or_construct<ShmHashMap>(IS_SHM_HASH_MAP_ARRAY)[IS_SHM_VARS] //object name
-                      (100, boost::hash<KeyType>(), std::equal_to<KeyType>()                        //
-                       ,
-                       mappedFile->get_allocator<ValueType>()); //allocator instance
-    timeArray = mappedFile->find_or_construct<time_point>(IS_SHM_TIME_POINT_ARRAY)[IS_SHM_VARS](chrono::system_clock::now());
-    // deal after restart
-    for (int i = 0; i < IS_SHM_VARS; ++i)
-        writeLog(i);
-
-    writeThread = make_shared<thread>(thread([&]() {
-        while (!shutdownThread)
-        {
-            this_thread::sleep_for(chrono::seconds(writeInterval));
-            int toWrite = turn;
-            {
-                lock_guard<std::mutex> l(mt);
-                turn = !turn;
-                //update time
-                if (!shutdownThread)
-                    timeArray[turn] = chrono::system_clock::now();
-            }
-            writeLog(toWrite);
-        }
-    }));
+    auto &h = metrics::histogram("interface_call_duration_us", "Time spent serving a call, in microseconds", {{"module", moduleName}, {"name", key}});
+    DEV_WRITE_GUARDED(x_histograms)
+        histograms[key] = &h;
+    return h;
 }
 
 void InterfaceStatistics::interfaceCalled(const std::string &key, const int &timeUsed)
 {
-    if (writeInterval <= 0)
-        return;
-    lock_guard<std::mutex> l(mt);
-    ShmString shmString(key.c_str(), ShmCharAllocator(mappedFile->get_segment_manager()));
-    auto got = shmHashMapArray[turn].find(shmString);
-    if (got == shmHashMapArray[turn].end())
-    {
-        interfaceInfo info;
-        info.count++;
-        info.totalTime += timeUsed;
-        info.maxTime = max(timeUsed, info.maxTime);
-        shmHashMapArray[turn].insert(ValueType(ShmString(key.c_str(), mappedFile->get_segment_manager()), info));
-    }
-    else
-    {
-        got->second.count++;
-        got->second.totalTime += timeUsed;
-        got->second.maxTime = max(timeUsed, got->second.maxTime);
-    }
+    histogram(key).observe(timeUsed < 0 ? 0 : timeUsed);
 }
 
-void InterfaceStatistics::writeLog(int i)
+void InterfaceStatistics::writeLog()
 {
-    //write log and truncate hashmap
-    if (!shmHashMapArray[i].empty())
+    vector<pair<string, metrics::Histogram *>> current;
+    DEV_READ_GUARDED(x_histograms)
+        current.assign(histograms.begin(), histograms.end());
+
+    auto t = chrono::system_clock::to_time_t(lastWrite);
+    lastWrite = chrono::system_clock::now();
+    for (auto const &item : current)
     {
-        auto t = chrono::system_clock::to_time_t(timeArray[i]);
-        for (auto item : shmHashMapArray[i])
-        {
+        auto snapshot = item.second->snapshot();
+        auto window = snapshot;
+        auto last = lastSnapshots.find(item.first);
+        if (last != lastSnapshots.end())
+            window -= last->second;
+        lastSnapshots[item.first] = snapshot;
+        if (!window.count)
+            continue;
+
 #if defined(__GNUC__) && __GNUC__ > 5
-            LOG(INFO) << std::put_time(std::localtime(&t), "%H:%M:%S") << left << setfill(' ')
-                      << "|Statistics " << moduleName << "|Name:" << setw(25) << item.first
-                      << "|Count: " << right << setw(3) << item.second.count
-                      << "|Avg: " << fixed << setprecision(2) << item.second.totalTime / (float)item.second.count
-                      << " ms|Max: " << setw(2) << item.second.maxTime << " ms" << endl;
+        LOG(INFO) << std::put_time(std::localtime(&t), "%H:%M:%S") << left << setfill(' ')
 #else
-            char timeStr[10];
-            strftime(timeStr, sizeof(timeStr), "%H:%M:%S", std::localtime(&t));
-            LOG(INFO) << timeStr << left << setfill(' ')
-                      << "|Statistics " << moduleName << "|Name:" << setw(25) << item.first
-                      << "|Count: " << right << setw(3) << item.second.count
-                      << "|Avg: " << fixed << setprecision(2) << item.second.totalTime / (float)item.second.count
-                      << " ms|Max: " << setw(2) << item.second.maxTime << " ms" << endl;
+        char timeStr[10];
+        strftime(timeStr, sizeof(timeStr), "%H:%M:%S", std::localtime(&t));
+        LOG(INFO) << timeStr << left << setfill(' ')
 #endif
-        }
-        timeArray[i] = chrono::system_clock::now();
-        shmHashMapArray[i].clear();
+                  << "|Statistics " << moduleName << "|Name:" << setw(25) << item.first
+                  << "|Count: " << right << setw(3) << window.count
+                  << "|Avg: " << fixed << setprecision(2) << window.sum / 1000.0 / window.count
+                  << " ms|P99: " << setprecision(2) << window.quantile(0.99) / 1000.0
+                  << " ms|Max: " << setprecision(2) << window.max() / 1000.0 << " ms" << endl;
     }
 }
 
 InterfaceStatistics::~InterfaceStatistics()
 {
-    if (writeInterval > 0)
+    if (writeThread)
     {
-        shutdownThread = true;
+        {
+            lock_guard<std::mutex> l(mt);
+            shutdownThread = true;
+        }
+        cv.notify_all();
         writeThread->join();
-        delete mappedFile;
-        boost::interprocess::file_mapping::remove(shmName.c_str());
     }
 }
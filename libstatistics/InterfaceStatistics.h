@@ -28,58 +28,49 @@
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>
-#include "boost_shm.h"
-
-#define IS_MAPPED_FILE_NAME "_MappedFile"
-#define IS_MAPPED_FILE_SIZE 1048576
-#define IS_SHM_HASH_MAP_ARRAY "shm_hash_map_array"
-#define IS_SHM_TIME_POINT_ARRAY "shm_time_point_array"
-#define IS_SHM_VARS 2
-#define IS_SHM_GROW_SIZE 102400
+#include <map>
+#include <unordered_map>
+#include "libdevcore/Guards.h"
+#include "libdevcore/Metrics.h"
 
 namespace dev
 {
 
 using time_point = std::chrono::system_clock::time_point;
-struct interfaceInfo
-{
-  int count;
-  // milliseconds
-  int totalTime;
-  int maxTime;
-  interfaceInfo() : count(0), totalTime(0), maxTime(0) {}
-};
-
-// ShmHashMap
-typedef ShmString KeyType;
-typedef interfaceInfo MappedType;
-typedef std::pair<const KeyType, MappedType> ValueType;
-typedef boost::interprocess::allocator<ValueType, SegmentManager> ShmemAllocator;
-typedef boost::unordered_map<KeyType, MappedType, boost::hash<KeyType>, std::equal_to<KeyType>, ShmemAllocator> ShmHashMap;
 
+/**
+ * Per module call statistics. Every call is recorded in the process wide metrics registry
+ * as interface_call_duration_us{module, name}; if an interval is given, a summary of the
+ * calls made since the previous one is also written to the log every interval seconds.
+ */
 class InterfaceStatistics
 {
 public:
   explicit InterfaceStatistics(const std::string &_moduleName, const int &interval = 0);
   ~InterfaceStatistics();
+  /// @param timeUsed microseconds
   void interfaceCalled(const std::string &key, const int &timeUsed = 0);
+  /// @returns the histogram calls to @a key are recorded in, valid for the life of the process;
+  /// hot callers keep it rather than building the key on every call
+  metrics::Histogram &histogram(const std::string &key);
 
 private:
-  void init();
-  void checkShm();
-  std::shared_ptr<std::thread> writeThread;
+  void writeLog();
+
   std::string moduleName;
-  std::string shmName;
   // seconds to write
   int writeInterval;
+  SharedMutex x_histograms;
+  std::unordered_map<std::string, metrics::Histogram *> histograms;
+  // state as of the previous writeLog, only touched by the write thread
+  std::map<std::string, metrics::Histogram::Snapshot> lastSnapshots;
+  time_point lastWrite;
+  std::shared_ptr<std::thread> writeThread;
   std::mutex mt;
+  std::condition_variable cv;
   bool shutdownThread;
-  int turn;
-  boost::interprocess::managed_mapped_file *mappedFile;
-  time_point *timeArray;
-  ShmHashMap *shmHashMapArray;
-  void writeLog(int i);
 };
 }
 
@@ -0,0 +1,103 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: MetricsHttpServer.cpp
+ * @author: fisco-dev
+ * 
+ * @date: 2018
+ */
+
+#include "MetricsHttpServer.h"
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <microhttpd.h>
+#include <libdevcore/Metrics.h>
+#include <libdevcore/easylog.h>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+int answer(void *, struct MHD_Connection *connection, const char *url, const char *method, const char *, const char *, size_t *, void **)
+{
+    string body;
+    unsigned int code = MHD_HTTP_OK;
+    if (strcmp(method, "GET") != 0)
+    {
+        code = MHD_HTTP_METHOD_NOT_ALLOWED;
+    }
+    else if (strcmp(url, "/metrics") != 0)
+    {
+        code = MHD_HTTP_NOT_FOUND;
+    }
+    else
+    {
+        body = metrics::Registry::instance().exposition();
+    }
+
+    struct MHD_Response *response = MHD_create_response_from_buffer(body.size(), (void *)body.c_str(), MHD_RESPMEM_MUST_COPY);
+    MHD_add_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+    int ret = MHD_queue_response(connection, code, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+}
+
+MetricsHttpServer::MetricsHttpServer(int port) : port(port), daemon(nullptr)
+{
+}
+
+MetricsHttpServer::~MetricsHttpServer()
+{
+    StopListening();
+}
+
+bool MetricsHttpServer::StartListening()
+{
+    if (daemon)
+        return true;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY, port, NULL, NULL, &answer, NULL,
+                              MHD_OPTION_SOCK_ADDR, (struct sockaddr *)&addr,
+                              MHD_OPTION_END);
+    if (!daemon)
+    {
+        LOG(ERROR) << "metrics server failed to listen on 127.0.0.1:" << port;
+        return false;
+    }
+    LOG(INFO) << "metrics server listening on 127.0.0.1:" << port;
+    return true;
+}
+
+void MetricsHttpServer::StopListening()
+{
+    if (daemon)
+    {
+        MHD_stop_daemon(daemon);
+        daemon = nullptr;
+    }
+}
@@ -0,0 +1,54 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: MetricsHttpServer.h
+ * @author: fisco-dev
+ * 
+ * @date: 2018
+ */
+
+#ifndef DEV_METRICS_HTTP_SERVER_H_
+#define DEV_METRICS_HTTP_SERVER_H_
+
+#include <string>
+
+struct MHD_Daemon;
+
+namespace dev
+{
+
+/**
+ * Serves the metrics registry on GET /metrics in the Prometheus text format. The server
+ * only binds to the loopback interface; a collector on another host is expected to go
+ * through a local agent or tunnel.
+ */
+class MetricsHttpServer
+{
+public:
+  explicit MetricsHttpServer(int port);
+  ~MetricsHttpServer();
+
+  bool StartListening();
+  void StopListening();
+
+private:
+  int port;
+  struct MHD_Daemon *daemon;
+};
+}
+
+#endif //DEV_METRICS_HTTP_SERVER_H_
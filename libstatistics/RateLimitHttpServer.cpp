@@ -185,7 +185,7 @@ int HttpServer::callback(void *cls, MHD_Connection *connection, const char *url,
 
                 client_connection->code = MHD_HTTP_OK;
                 if (client_connection->server->checkPermit(client_connection, response))
-                    handler->HandleRequest(client_connection->request.str(), response);
+                    client_connection->server->processRequest(handler, client_connection->request.str(), response);
                 client_connection->server->SendResponse(response, client_connection);
             }
         }
@@ -211,8 +211,7 @@ bool HttpServer::checkPermit(void *client_conn, string &response)
     struct mhd_coninfo *client_connection = static_cast<struct mhd_coninfo *>(client_conn);
     const MHD_ConnectionInfo *info = MHD_get_connection_info(client_connection->connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
     struct sockaddr_in *client = (struct sockaddr_in *)(info->client_addr);
-    string ip(16, '0');
-    inet_ntop(AF_INET, &client->sin_addr, &ip[0], ip.size());
+    uint32_t ip = client->sin_addr.s_addr;
 
     Json::Reader reader;
     Json::Value req;
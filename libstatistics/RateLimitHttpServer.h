@@ -80,6 +80,9 @@ public:
 
     bool isRunning() const {return running;}
 
+    /// Methods the handler serves get their own interface limit, calls to any other method share one.
+    void setMethods(const std::vector<std::string> &methods) { limiter.registerInterfaces(methods); }
+
     virtual pCallBack getCallback() {
         return HttpServer::callback;
     }
@@ -107,6 +110,9 @@ protected:
         enum MHD_RequestTerminationCode toe) {}
 
     IClientConnectionHandler *GetHandler(const std::string &url);
+
+    /// Hand a permitted request body to the handler; subclasses may answer some requests themselves.
+    virtual void processRequest(IClientConnectionHandler *handler, const std::string &request, std::string &response) { handler->HandleRequest(request, response); }
 };
 
 } /* namespace jsonrpc */
@@ -22,13 +22,64 @@
  */
 
 #include "RateLimiter.h"
+#include <arpa/inet.h>
 #include "libdevcore/easylog.h"
 
 using namespace std;
 using namespace dev;
 
-RateLimiter::RateLimiter(const std::string &configJson) : enable(true), callCost(1), asioThread(NULL), cleanInterval(8), shutdownThread(false)
+namespace
 {
+
+int64_t steadyNow()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Per thread view of a RateLimiter's tables, so that checks after the first one of a
+// thread for a given ip and interface take no lock at all.
+struct ThreadCache
+{
+    uint64_t owner = 0;
+    uint64_t generation = 0;
+    unordered_map<uint64_t, shared_ptr<TokenBucket>> buckets;
+    unordered_map<string, pair<uint32_t, int>> interfaces;
+};
+
+thread_local ThreadCache t_cache;
+
+atomic<uint64_t> s_instances{0};
+
+}
+
+TokenBucket::TokenBucket(int capacity, int64_t now) :
+    interval(capacity > 0 ? max<int64_t>(1000000000LL / capacity, 1) : 0),
+    burst(interval * max(capacity, 0)),
+    tat(now + burst / 4)
+{
+}
+
+bool TokenBucket::tryAcquire(int64_t now, int cost)
+{
+    if (interval == 0)
+        return false;
+    int64_t old = tat.load(memory_order_relaxed);
+    int64_t next;
+    do
+    {
+        next = max(old, now) + interval * cost;
+        if (next - now > burst)
+            return false;
+    } while (!tat.compare_exchange_weak(old, next, memory_order_relaxed));
+    return true;
+}
+
+RateLimiter::RateLimiter(const std::string &configJson) : enable(true), globalLimitEnable(false), ipLimitEnable(false), ipLimit(0),
+    interfaceLimitEnable(false), interfacelLimit(0), m_generation(0), m_instance(++s_instances), callCost(1), asioThread(NULL), cleanInterval(8), shutdownThread(false)
+{
+    // ids c_ipBucket and c_otherInterface are reserved
+    m_interfaceLimits.assign(c_otherInterface + 1, -1);
+
     if (configJson.empty() || !phraseConfig(configJson))
     {
         enable = false;
@@ -39,16 +90,26 @@ RateLimiter::RateLimiter(const std::string &configJson) : enable(true), callCost
     {
         LOG(INFO) << "rate limiter started.";
         LOG(INFO) << "RateLimiter Config" << configJson << endl;
-        asioThread = make_shared<thread>(thread([&]() {
-            while (!shutdownThread)
-            {
-                this_thread::sleep_for(std::chrono::seconds(cleanInterval));
+        asioThread = make_shared<thread>([this]() {
+            unique_lock<std::mutex> l(x_shutdown);
+            while (!m_shutdown.wait_for(l, std::chrono::seconds(cleanInterval), [this]() { return shutdownThread; }))
                 cleanInvalidKey();
-            }
-        }));
+        });
     }
 }
 
+RateLimiter::~RateLimiter()
+{
+    if (!asioThread)
+        return;
+    {
+        lock_guard<std::mutex> l(x_shutdown);
+        shutdownThread = true;
+    }
+    m_shutdown.notify_all();
+    asioThread->join();
+}
+
 // check necessary params
 bool RateLimiter::validateConfigJson(const Json::Value &config)
 {
@@ -70,6 +131,25 @@ bool RateLimiter::validateConfigJson(const Json::Value &config)
         LOG(ERROR) << "Rate Limit config file error. " << RL_GLOBAL_LIMIT << " missing " << RL_DEFAULT_LIMIT << " or type isn't uint";
         return false;
     }
+    // ipLimit is optional
+    if (config.isMember(RL_IP_LIMIT))
+    {
+        if (!config[RL_IP_LIMIT].isObject())
+        {
+            LOG(ERROR) << "Rate Limit config file error. " << RL_IP_LIMIT << " type isn't json Object";
+            return false;
+        }
+        if (!(config[RL_IP_LIMIT].isMember(RL_ENABLE) && config[RL_IP_LIMIT][RL_ENABLE].isBool()))
+        {
+            LOG(ERROR) << "Rate Limit config file error. " << RL_IP_LIMIT << " missing " << RL_ENABLE << " or type isn't bool";
+            return false;
+        }
+        if (!(config[RL_IP_LIMIT].isMember(RL_DEFAULT_LIMIT) && config[RL_IP_LIMIT][RL_DEFAULT_LIMIT].isUInt()))
+        {
+            LOG(ERROR) << "Rate Limit config file error. " << RL_IP_LIMIT << " missing " << RL_DEFAULT_LIMIT << " or type isn't uint";
+            return false;
+        }
+    }
     if (!(config.isMember(RL_INTERFACE_LIMIT) && config[RL_INTERFACE_LIMIT].isObject()))
     {
         LOG(ERROR) << "Rate Limit config file error. Missing " << RL_INTERFACE_LIMIT << " or type isn't json Object";
@@ -114,16 +194,22 @@ bool RateLimiter::phraseConfig(const std::string &configJson)
     if (!validateConfigJson(config))
         return false;
 
-    Json::Value value;
     globalLimitEnable = config[RL_GLOBAL_LIMIT][RL_ENABLE].asBool();
-    globalBucket.capacity = config[RL_GLOBAL_LIMIT][RL_DEFAULT_LIMIT].asInt();
-    if (globalLimitEnable && globalBucket.capacity <= 0)
+    int globalLimit = config[RL_GLOBAL_LIMIT][RL_DEFAULT_LIMIT].asInt();
+    if (globalLimitEnable && globalLimit <= 0)
     { //shouldn't happen
         globalLimitEnable = false;
-        globalBucket.capacity = 0;
+        globalLimit = 0;
     }
+    globalBucket.reset(new TokenBucket(globalLimit, steadyNow()));
 
-    globalBucket.lastCall = chrono::steady_clock::now();
+    if (config.isMember(RL_IP_LIMIT))
+    {
+        ipLimitEnable = config[RL_IP_LIMIT][RL_ENABLE].asBool();
+        ipLimit = config[RL_IP_LIMIT][RL_DEFAULT_LIMIT].asInt();
+        if (ipLimitEnable && ipLimit <= 0)
+            ipLimitEnable = false;
+    }
 
     interfaceLimitEnable = config[RL_INTERFACE_LIMIT][RL_ENABLE].asBool();
     if (!interfaceLimitEnable)
@@ -136,6 +222,8 @@ bool RateLimiter::phraseConfig(const std::string &configJson)
         interfaceLimitEnable = false;
         return true;
     }
+    // interfaces without own config: limited by default, or not at all when the default is 0
+    m_interfaceLimits[c_otherInterface] = interfacelLimit ? interfacelLimit : -1;
     if (!config[RL_INTERFACE_LIMIT][RL_CUSTOM].isNull())
     {
         // phrase interface limit config
@@ -143,24 +231,61 @@ bool RateLimiter::phraseConfig(const std::string &configJson)
         for (auto name : mem)
         {
             m_interfaceLimit[name] = config[RL_INTERFACE_LIMIT][RL_CUSTOM][name].asInt();
+            m_interfaceIds[name] = m_interfaceLimits.size();
+            m_interfaceLimits.push_back(m_interfaceLimit[name]);
         }
     }
     return true;
 }
 
-void RateLimiter::updateBucket(TokenBucket &bucket)
+void RateLimiter::registerInterfaces(const std::vector<std::string> &interfaces)
+{
+    DEV_WRITE_GUARDED(x_interfaces)
+        for (auto const &name : interfaces)
+            if (!m_interfaceIds.count(name))
+            {
+                m_interfaceIds[name] = m_interfaceLimits.size();
+                m_interfaceLimits.push_back(m_interfaceLimits[c_otherInterface]);
+            }
+}
+
+uint32_t RateLimiter::interfaceId(const std::string &interface, int &o_limit)
+{
+    DEV_READ_GUARDED(x_interfaces)
+    {
+        auto it = m_interfaceIds.find(interface);
+        if (it != m_interfaceIds.end())
+        {
+            o_limit = m_interfaceLimits[it->second];
+            return it->second;
+        }
+        o_limit = m_interfaceLimits[c_otherInterface];
+    }
+    return c_otherInterface;
+}
+
+shared_ptr<TokenBucket> RateLimiter::bucket(uint64_t key, int capacity, int64_t now)
 {
-    if (bucket.tokens == RL_NEW_BUCKET)
-        bucket.tokens = bucket.capacity * 0.75;
-    rl_time_point currTime = chrono::steady_clock::now();
-    chrono::milliseconds timeLong = chrono::duration_cast<chrono::milliseconds>(currTime - bucket.lastCall);
-    if (timeLong.count() > 0)
+    auto &cached = t_cache.buckets[key];
+    if (cached)
+        return cached;
+
+    Shard &shard = m_shards[(key * 0x9E3779B97F4A7C15ULL) >> 58];
+    DEV_READ_GUARDED(shard.lock)
     {
-        double newToken = bucket.capacity / 1000.0 * timeLong.count() + bucket.tokens;
-        lock_guard<std::mutex> l(mt);
-        bucket.tokens = min((double)bucket.capacity, newToken);
-        bucket.lastCall = currTime;
+        auto it = shard.buckets.find(key);
+        if (it != shard.buckets.end())
+            cached = it->second;
     }
+    if (!cached)
+        DEV_WRITE_GUARDED(shard.lock)
+        {
+            auto &b = shard.buckets[key];
+            if (!b)
+                b = make_shared<TokenBucket>(capacity, now);
+            cached = b;
+        }
+    return cached;
 }
 
 bool RateLimiter::isPermitted(const std::string &ip, const std::string &interface)
@@ -168,78 +293,81 @@ bool RateLimiter::isPermitted(const std::string &ip, const std::string &interfac
     // limiter is off, always return true
     if (!isEnable())
         return true;
-    // check global limit
-    if (globalLimitEnable)
+    in_addr addr;
+    if (inet_pton(AF_INET, ip.c_str(), &addr) == 1)
+        return isPermitted((uint32_t)addr.s_addr, interface);
+    return isPermitted((uint32_t)std::hash<std::string>()(ip), interface);
+}
+
+bool RateLimiter::isPermitted(uint32_t ip, const std::string &interface)
+{
+    // limiter is off, always return true
+    if (!isEnable())
+        return true;
+    int64_t now = steadyNow();
+
+    uint64_t generation = m_generation.load(memory_order_acquire);
+    if (t_cache.owner != m_instance || t_cache.generation != generation)
     {
-        updateBucket(globalBucket);
-        if (globalBucket.tokens > callCost)
-        {
-            lock_guard<std::mutex> l(mt);
-            globalBucket.tokens -= callCost;
-        }
-        else
-            return false;
+        if (t_cache.owner != m_instance)
+            t_cache.interfaces.clear();
+        t_cache.buckets.clear();
+        t_cache.owner = m_instance;
+        t_cache.generation = generation;
     }
 
+    // narrowest limit first, so calls refused for one interface do not use up the ip and global allowance
+    uint64_t ipKey = (uint64_t)ip << 32;
     //check interface limit
-    string key = ip + interface;
     if (interfaceLimitEnable)
     {
-        if (interfacelLimit == 0)
-        { //check if has own config
-            auto it = m_interfaceLimit.find(interface);
-            if (it != m_interfaceLimit.end())
-            {
-                m_tokenBuckets[key].capacity = it->second;
-                updateBucket(m_tokenBuckets[key]);
-                if (m_tokenBuckets[key].tokens > callCost)
-                {
-                    lock_guard<std::mutex> l(mt);
-                    m_tokenBuckets[key].tokens -= callCost;
-                }
-                else
-                    return false;
-            }
+        uint32_t id;
+        int limit;
+        auto it = t_cache.interfaces.find(interface);
+        if (it != t_cache.interfaces.end())
+        {
+            id = it->second.first;
+            limit = it->second.second;
         }
         else
         {
-            //if no own config then config by default
-            auto it = m_interfaceLimit.find(interface);
-            if (it != m_interfaceLimit.end())
-            {
-                m_tokenBuckets[key].capacity = it->second;
-            }
-            else
-            {
-                m_tokenBuckets[key].capacity = interfacelLimit;
-            }
-
-            updateBucket(m_tokenBuckets[key]);
-            if (m_tokenBuckets[key].tokens > callCost)
-            {
-                lock_guard<std::mutex> l(mt);
-                m_tokenBuckets[key].tokens -= callCost;
-            }
-            else
-                return false;
+            id = interfaceId(interface, limit);
+            // names that aren't registered are not kept, they come from clients
+            if (id != c_otherInterface)
+                t_cache.interfaces.insert(make_pair(interface, make_pair(id, limit)));
         }
+        if (limit >= 0 && !bucket(ipKey | id, limit, now)->tryAcquire(now, callCost))
+            return false;
     }
 
+    // check ip limit
+    if (ipLimitEnable && !bucket(ipKey | c_ipBucket, ipLimit, now)->tryAcquire(now, callCost))
+        return false;
+
+    // check global limit
+    if (globalLimitEnable && !globalBucket->tryAcquire(now, callCost))
+        return false;
+
     return true;
 }
 
 void RateLimiter::cleanInvalidKey()
 {
-    rl_time_point currTime = chrono::steady_clock::now();
-    for (auto it = m_tokenBuckets.begin(); it != m_tokenBuckets.end();)
-    {
-        chrono::seconds timeLong = chrono::duration_cast<chrono::seconds>(currTime - it->second.lastCall);
-        if (timeLong.count() > cleanInterval * 2)
-        {
-            lock_guard<std::mutex> l(mt);
-            it = m_tokenBuckets.erase(it);
-        }
-        else
-            ++it;
-    }
+    int64_t idleBefore = steadyNow() - (int64_t)cleanInterval * 2 * 1000000000LL;
+    size_t erased = 0;
+    for (auto &shard : m_shards)
+        DEV_WRITE_GUARDED(shard.lock)
+            for (auto it = shard.buckets.begin(); it != shard.buckets.end();)
+            {
+                if (it->second->idleSince() < idleBefore)
+                {
+                    it = shard.buckets.erase(it);
+                    ++erased;
+                }
+                else
+                    ++it;
+            }
+    if (erased)
+        m_generation.fetch_add(1, memory_order_release);
+    LOG(TRACE) << "RateLimiter::cleanInvalidKey erased " << erased << " idle buckets";
 }
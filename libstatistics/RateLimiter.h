@@ -24,30 +24,47 @@
 #ifndef DEV_RATE_LIMITER_H_
 #define DEV_RATE_LIMITER_H_
 #include <json/json.h>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <string>
 #include <unordered_map>
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <vector>
+#include <libdevcore/Guards.h>
 
 #define RL_GLOBAL_LIMIT "globalLimit"
+#define RL_IP_LIMIT "ipLimit"
 #define RL_INTERFACE_LIMIT "interfaceLimit"
 #define RL_ENABLE "enable"
 #define RL_DEFAULT_LIMIT "defaultLimit"
 #define RL_CUSTOM "custom"
-#define RL_NEW_BUCKET -1
 
 namespace dev
 {
-using rl_time_point = std::chrono::steady_clock::time_point;
 
-struct TokenBucket
+/**
+ * Token bucket kept as a single atomic "theoretical arrival time" (GCRA), so acquiring
+ * and refilling is one compare-and-swap and needs no lock.
+ * capacity tokens are refilled per second and at most capacity tokens are banked.
+ */
+class TokenBucket
 {
-	int capacity;
-	double tokens;
-	rl_time_point lastCall;
-	TokenBucket() : tokens(RL_NEW_BUCKET), lastCall(std::chrono::steady_clock::now()) {}
+  public:
+	/// A new bucket starts with 0.75 * capacity tokens.
+	TokenBucket(int capacity, int64_t now);
+
+	bool tryAcquire(int64_t now, int cost);
+	/// @returns the time after which the bucket is full again, i.e. idle.
+	int64_t idleSince() const { return tat.load(std::memory_order_relaxed); }
+
+  private:
+	int64_t interval;   // nanoseconds per token, 0 if the bucket never permits
+	int64_t burst;      // nanoseconds worth of tokens that may be banked
+	std::atomic<int64_t> tat;
 };
 
 class RateLimiter
@@ -55,41 +72,66 @@ class RateLimiter
 
   public:
 	explicit RateLimiter(const std::string &configJson = std::string());
-	~RateLimiter()
-	{
-		shutdownThread = true;
-		asioThread->join();
-	};
+	~RateLimiter();
 	bool isPermitted(const std::string &ip, const std::string &interface);
+	/// @param ip IPv4 address in network byte order, as in sockaddr_in::sin_addr.
+	bool isPermitted(uint32_t ip, const std::string &interface);
 	bool isEnable() { return enable; }
+	/// Intern the methods the server handles, the names clients send are not trusted to be any of them.
+	void registerInterfaces(const std::vector<std::string> &interfaces);
 
   private:
+	static const unsigned c_shards = 64;
+	static const uint32_t c_ipBucket = 0;
+	static const uint32_t c_otherInterface = 1;
+
+	struct Shard
+	{
+		mutable SharedMutex lock;
+		std::unordered_map<uint64_t, std::shared_ptr<TokenBucket>> buckets;
+	};
+
 	bool enable;
 	bool globalLimitEnable;
 	// total calls per second
-	TokenBucket globalBucket;
+	std::unique_ptr<TokenBucket> globalBucket;
+	bool ipLimitEnable;
+	// calls per ip per second
+	int ipLimit;
 	bool interfaceLimitEnable;
 	// default calls limit of (per ip+interface per second)
 	int interfacelLimit;
 	Json::Value config;
-	std::mutex mt;
-	std::unordered_map<std::string, TokenBucket> m_tokenBuckets;
+	// buckets by (ip << 32 | interface id), interface id c_ipBucket is the per ip bucket
+	std::array<Shard, c_shards> m_shards;
+	// bumped when cleanInvalidKey() drops buckets, so threads drop their cached pointers
+	std::atomic<uint64_t> m_generation;
+	// identifies this limiter in the per thread caches
+	uint64_t m_instance;
 	// custom interface frequency
 	std::unordered_map<std::string, int> m_interfaceLimit;
+	// registered interface names and their limits by id, -1 for unlimited
+	mutable SharedMutex x_interfaces;
+	std::unordered_map<std::string, uint32_t> m_interfaceIds;
+	std::vector<int> m_interfaceLimits;
 	int callCost;
 
 	std::shared_ptr<std::thread> asioThread;
 	// seconds to call cleanInvalidKey()
 	int cleanInterval;
 	bool shutdownThread;
-	//clean invalid key in m_tokenBuckets
+	std::mutex x_shutdown;
+	std::condition_variable m_shutdown;
+	//clean invalid key in m_shards
 	void cleanInvalidKey();
 	// check config file
 	bool validateConfigJson(const Json::Value &config);
 	//config from json
 	bool phraseConfig(const std::string &configJson);
-	//update token bucket
-	void updateBucket(TokenBucket &bucket);
+	// @returns the id and limit of the interface, c_otherInterface if it isn't registered
+	uint32_t interfaceId(const std::string &interface, int &o_limit);
+	// @returns the bucket of key, creating it with capacity on first use
+	std::shared_ptr<TokenBucket> bucket(uint64_t key, int capacity, int64_t now);
 };
 }
 #endif //DEV_RATE_LIMITER_H_
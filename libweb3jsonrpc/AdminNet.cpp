@@ -24,10 +24,12 @@
 #include <libwebthree/WebThree.h>
 #include <libdevcore/CommonJS.h>
 #include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
 #include <libethcore/Common.h>
 #include <libethereum/NodeConnParamsManagerApi.h>
 #include <libethereum/EthereumPeer.h>
 #include <libethereum/EthereumHost.h>
+#include <libethereum/TxTrace.h>
 #include "AdminNet.h"
 #include "SessionManager.h"
 #include "JsonHelper.h"
@@ -196,3 +198,37 @@ Json::Value AdminNet::admin_ConfNodePubKeyInfos()
 
 	return ret;
 }
+
+static Json::Value stageStatsToJson(TxTrace::StageStats const& _s)
+{
+	Json::Value ret;
+	ret["count"] = (Json::UInt64)_s.count;
+	ret["p50"] = (Json::UInt64)_s.p50;
+	ret["p90"] = (Json::UInt64)_s.p90;
+	ret["p99"] = (Json::UInt64)_s.p99;
+	ret["max"] = (Json::UInt64)_s.max;
+	return ret;
+}
+
+//per stage latency of recent transactions, in microseconds
+Json::Value AdminNet::admin_txLatency(int _seconds)
+{
+	if (_seconds <= 0)
+		_seconds = 60;
+	auto b = TxTrace::instance().breakdown(_seconds);
+
+	Json::Value ret;
+	ret["span"] = (Json::UInt64)b.span;
+	ret["txs"] = (Json::UInt64)b.txs;
+	for (size_t s = 0; s < b.stages.size(); ++s)
+		if (b.stages[s].count)
+			ret["stages"][stageName((TxStage)s)] = stageStatsToJson(b.stages[s]);
+	ret["total"] = stageStatsToJson(b.total);
+	return ret;
+}
+
+//the metrics registry in the Prometheus text format, as GET /metrics serves it
+std::string AdminNet::admin_metrics()
+{
+	return metrics::Registry::instance().exposition();
+}
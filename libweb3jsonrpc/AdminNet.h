@@ -54,6 +54,8 @@ public:
 	virtual Json::Value admin_NodePubKeyInfos() override;
 	virtual Json::Value admin_ConfNodePubKeyInfos() override;
 	virtual bool admin_delNodePubKeyInfo(string const& _node) override;
+	virtual Json::Value admin_txLatency(int _seconds) override;
+	virtual std::string admin_metrics() override;
 
 private:
 	NetworkFace& m_network;
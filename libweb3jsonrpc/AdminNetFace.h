@@ -26,6 +26,8 @@ namespace dev {
 					this->bindAndAddMethod(jsonrpc::Procedure("admin_ConfNodePubKeyInfos", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, NULL), &dev::rpc::AdminNetFace::admin_ConfNodePubKeyInfosI);
 					this->bindAndAddMethod(jsonrpc::Procedure("admin_addNodePubKeyInfo", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1", jsonrpc::JSON_STRING, NULL), &dev::rpc::AdminNetFace::admin_addNodePubKeyInfoI);
 					this->bindAndAddMethod(jsonrpc::Procedure("admin_delNodePubKeyInfo", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1", jsonrpc::JSON_STRING, NULL), &dev::rpc::AdminNetFace::admin_delNodePubKeyInfoI);
+					this->bindAndAddMethod(jsonrpc::Procedure("admin_txLatency", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1", jsonrpc::JSON_INTEGER, NULL), &dev::rpc::AdminNetFace::admin_txLatencyI);
+					this->bindAndAddMethod(jsonrpc::Procedure("admin_metrics", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, NULL), &dev::rpc::AdminNetFace::admin_metricsI);
 					
 				}
 
@@ -81,6 +83,15 @@ namespace dev {
 					(void)request;
 					response = this->admin_ConfNodePubKeyInfos();
 				}
+				inline virtual void admin_txLatencyI(const Json::Value &request, Json::Value &response)
+				{
+					response = this->admin_txLatency(request[0u].asInt());
+				}
+				inline virtual void admin_metricsI(const Json::Value &request, Json::Value &response)
+				{
+					(void)request;
+					response = this->admin_metrics();
+				}
 
 				
 
@@ -97,6 +108,8 @@ namespace dev {
 				virtual bool admin_delNodePubKeyInfo(const std::string& param1) = 0;
 				virtual Json::Value admin_NodePubKeyInfos() = 0;
 				virtual Json::Value admin_ConfNodePubKeyInfos() = 0;
+				virtual Json::Value admin_txLatency(int param1) = 0;
+				virtual std::string admin_metrics() = 0;
         };
 
     }
@@ -0,0 +1,130 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: BatchRequest.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#include "BatchRequest.h"
+
+#include <json/json.h>
+#include <jsonrpccpp/common/exception.h>
+#include <libdevcore/CommonJS.h>
+#include <libdevcore/easylog.h>
+#include <libethereum/Interface.h>
+#include <libethereum/TxTrace.h>
+#include "Eth.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+bool isRawTransactionCall(Json::Value const& _item)
+{
+	return _item.isObject()
+		&& _item.isMember("id")
+		&& _item.get("jsonrpc", "").asString() == "2.0"
+		&& _item.get("method", "").asString() == "eth_sendRawTransaction"
+		&& _item["params"].isArray()
+		&& _item["params"].size() == 1
+		&& _item["params"][0u].isString();
+}
+
+}
+
+bool dev::rpc::handleTransactionBatch(string const& _request, Interface& _client, jsonrpc::IClientConnectionHandler& _handler, string& o_response)
+{
+	// single calls take the regular path without being parsed twice
+	auto start = _request.find_first_not_of(" \t\r\n");
+	if (start == string::npos || _request[start] != '[')
+		return false;
+
+	auto received = TxTrace::now();
+	Json::Reader reader;
+	Json::Value req;
+	if (!reader.parse(_request, req, false) || !req.isArray())
+		return false;
+
+	vector<Json::Value> ids;
+	vector<bytes> txs;
+	Json::Value others(Json::arrayValue);
+	for (Json::ArrayIndex i = 0; i < req.size(); ++i)
+	{
+		if (isRawTransactionCall(req[i]))
+		{
+			try
+			{
+				txs.push_back(jsToBytes(req[i]["params"][0u].asString(), OnFailed::Throw));
+				ids.push_back(req[i]["id"]);
+				continue;
+			}
+			catch (...)
+			{
+				// let the regular handler report the bad parameter
+			}
+		}
+		others.append(req[i]);
+	}
+	if (txs.empty())
+		return false;
+
+	auto results = _client.injectTransactions(txs);
+	LOG(DEBUG) << "batch imported " << txs.size() << " raw transactions, " << others.size() << " other calls";
+
+	Json::Value resp(Json::arrayValue);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		Json::Value r;
+		r["jsonrpc"] = "2.0";
+		r["id"] = ids[i];
+		if (results[i].first == ImportResult::Success)
+		{
+			TxTrace::instance().record(results[i].second, TxStage::Received, received);
+			r["result"] = toJS(results[i].second);
+		}
+		else
+		{
+			jsonrpc::JsonRpcException e(importResultErrorMessage(results[i].first));
+			r["error"]["code"] = e.GetCode();
+			r["error"]["message"] = e.GetMessage();
+		}
+		resp.append(r);
+	}
+
+	if (others.size())
+	{
+		string othersResponse;
+		_handler.HandleRequest(Json::FastWriter().write(others), othersResponse);
+		Json::Value othersResp;
+		if (reader.parse(othersResponse, othersResp, false))
+		{
+			if (othersResp.isArray())
+				for (auto const& r: othersResp)
+					resp.append(r);
+			else if (othersResp.isObject())
+				resp.append(othersResp);
+		}
+	}
+
+	o_response = Json::FastWriter().write(resp);
+	return true;
+}
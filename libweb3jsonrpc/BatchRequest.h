@@ -0,0 +1,50 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: BatchRequest.h
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <string>
+#include <jsonrpccpp/server/iclientconnectionhandler.h>
+
+namespace dev
+{
+namespace eth
+{
+class Interface;
+}
+
+namespace rpc
+{
+
+/**
+ * Handle a JSON-RPC batch carrying eth_sendRawTransaction calls.
+ * The raw transactions are imported into the transaction queue with a single
+ * Interface::injectTransactions() call, and any other calls in the batch go
+ * through @a _handler as a smaller batch. The responses for the raw
+ * transactions come first in the result array, which JSON-RPC 2.0 allows.
+ * @returns false, leaving @a o_response untouched, if @a _request is not such a batch.
+ */
+bool handleTransactionBatch(std::string const& _request, eth::Interface& _client, jsonrpc::IClientConnectionHandler& _handler, std::string& o_response);
+
+}
+}
@@ -40,6 +40,7 @@
 #include <uuid/uuid.h>
 #include "JsonHelper.h"
 #include <libweb3jsonrpc/RPCallback.h>
+#include "BatchRequest.h"
 
 using namespace dev;
 using namespace dev::eth;
@@ -203,6 +204,13 @@ bool ChannelRPCServer::SendResponse(const std::string& _response, void* _addInfo
 	return false;
 }
 
+void ChannelRPCServer::setClient(dev::eth::Interface* client) {
+	_client = client;
+
+	_subscriptions = std::make_shared<ChannelSubscriptions>(client);
+	_subscriptions->start();
+}
+
 void dev::ChannelRPCServer::removeSession(int sessionID) {
 	std::lock_guard<std::mutex> lock(_sessionMutex);
 	auto it = _sessions.find(sessionID);
@@ -269,6 +277,10 @@ void ChannelRPCServer::onDisconnect(dev::channel::ChannelException e, dev::chann
 		}
 	}
 
+	if (_subscriptions) {
+		_subscriptions->removeSession(session);
+	}
+
 	updateHostTopics();
 }
 
@@ -304,6 +316,11 @@ void dev::ChannelRPCServer::onClientRequest(dev::channel::ChannelSession::Ptr se
 		case 0x32:
 			onClientTopicRequest(session, message);
 			break;
+		case 0x40:
+			if (_subscriptions) {
+				_subscriptions->onRequest(session, message);
+			}
+			break;
 		default:
 			LOG(ERROR) << "unknown client message: " << message->type();
 			break;
@@ -370,7 +387,13 @@ void dev::ChannelRPCServer::onClientEthereumRequest(dev::channel::ChannelSession
 
 	std::string *addInfo = new std::string(message->seq());
 
-	OnRequest(body, addInfo);
+	std::string response;
+	if (_client && GetHandler() && dev::rpc::handleTransactionBatch(body, *_client, *GetHandler(), response)) {
+		SendResponse(response, addInfo);
+	}
+	else {
+		OnRequest(body, addInfo);
+	}
 	RPCallback::getInstance().parseAndSaveSession(body, message->seq(), session);
 }
 
@@ -39,11 +39,13 @@
 #include <libethereum/Web3Observer.h>
 #include <libchannelserver/ThreadPool.h>
 #include "IpcServerBase.h"
+#include "ChannelSubscriptions.h"
 
 namespace dev
 {
 namespace eth {
 class EthereumHost;
+class Interface;
 }
 
 class ChannelRPCServer: public jsonrpc::AbstractServerConnector, public std::enable_shared_from_this<ChannelRPCServer> {
@@ -113,6 +115,8 @@ public:
 
 	void setHost(std::weak_ptr<dev::eth::EthereumHost> host);
 
+	void setClient(dev::eth::Interface* client);
+
 	void setSSLContext(std::shared_ptr<boost::asio::ssl::context> sslContext);
 
 	void asyncPushChannelMessage(std::string topic, dev::channel::Message::Ptr message,	std::function<void(dev::channel::ChannelException, dev::channel::Message::Ptr)> callback);
@@ -155,6 +159,10 @@ private:
 	int _sessionCount = 1;
 
 	std::weak_ptr<dev::eth::EthereumHost> _host;
+
+	dev::eth::Interface* _client = nullptr;
+
+	ChannelSubscriptions::Ptr _subscriptions;
 };
 
 }
@@ -0,0 +1,340 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ChannelSubscriptions.cpp
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#include "ChannelSubscriptions.h"
+
+#include <uuid/uuid.h>
+#include <libdevcore/easylog.h>
+#include <libdevcore/Metrics.h>
+#include <libethereum/ClientBase.h>
+#include "JsonHelper.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::channel;
+
+namespace
+{
+
+static const int c_subscribeType = 0x40;
+static const int c_pushType = 0x41;
+
+string pushSeq()
+{
+	uuid_t uuid;
+	uuid_generate(uuid);
+	return toHex(uuid);
+}
+
+}
+
+ChannelSubscriptions::ChannelSubscriptions(Interface* _client, size_t _queueLimit, size_t _sessionLimit, unsigned _receiptExpiry):
+	m_client(_client),
+	m_queueLimit(_queueLimit),
+	m_sessionLimit(_sessionLimit),
+	m_receiptExpiry(_receiptExpiry),
+	m_pool("ChannelPush", 1)
+{
+}
+
+ChannelSubscriptions::~ChannelSubscriptions()
+{
+	m_watchesChanged.reset();
+}
+
+void ChannelSubscriptions::start()
+{
+	m_chainWatch = m_client->installWatch(ChainChangedFilter, Reaping::Manual);
+
+	weak_ptr<ChannelSubscriptions> self(shared_from_this());
+	m_watchesChanged = m_client->onWatchesChanged([self](vector<unsigned> const& _watches) {
+		if (auto s = self.lock())
+			s->m_pool.enqueue([self, _watches]() {
+				if (auto s = self.lock())
+					s->dispatch(_watches);
+			});
+	});
+}
+
+void ChannelSubscriptions::onRequest(ChannelSession::Ptr _session, Message::Ptr _message)
+{
+	string body(_message->data(), _message->data() + _message->dataSize());
+	LOG(DEBUG) << "SDK subscription request seq:" << _message->seq() << " body:" << body;
+
+	Json::Value response;
+	bool receipt = false;
+	try
+	{
+		Json::Value request;
+		if (!Json::Reader().parse(body, request) || !request.isObject())
+			BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("invalid request"));
+
+		string method = request["method"].asString();
+		if (method == "subscribe")
+		{
+			response = subscribe(_session, request);
+			receipt = request["type"].asString() == "receipt";
+		}
+		else if (method == "unsubscribe")
+			response["result"] = unsubscribe(_session, request["id"].asUInt());
+		else
+			BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("unknown method " + method));
+	}
+	catch (exception const& e)
+	{
+		LOG(ERROR) << "subscription request error:" << e.what();
+		response = Json::Value();
+		response["error"] = e.what();
+	}
+
+	string out = Json::FastWriter().write(response);
+	_message->setType(c_subscribeType);
+	_message->setResult(response.isMember("error") ? 1 : 0);
+	_message->setData((byte const*)out.data(), out.size());
+	_session->asyncSendMessage(_message, ChannelSession::CallbackType(), 0);
+
+	// a receipt that is already in the chain goes out after the id it belongs to
+	if (receipt)
+	{
+		weak_ptr<ChannelSubscriptions> self(shared_from_this());
+		m_pool.enqueue([self]() {
+			if (auto s = self.lock())
+			{
+				Guard l(s->x_subscriptions);
+				s->pushReceipts();
+			}
+		});
+	}
+}
+
+Json::Value ChannelSubscriptions::subscribe(ChannelSession::Ptr _session, Json::Value const& _request)
+{
+	string type = _request["type"].asString();
+	Subscription s;
+	s.session = _session;
+	if (type == "newHeads")
+		s.kind = Kind::NewHeads;
+	else if (type == "logs")
+		s.kind = Kind::Logs;
+	else if (type == "receipt")
+	{
+		s.kind = Kind::Receipt;
+		s.transaction = jsToFixed<32>(_request["hash"].asString());
+	}
+	else
+		BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("unknown subscription type " + type));
+
+	Guard l(x_subscriptions);
+	auto held = m_bySession.find(_session.get());
+	if (held != m_bySession.end() && held->second >= m_sessionLimit)
+		BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("too many subscriptions, at most " + toString(m_sessionLimit) + " per session"));
+	unsigned id = m_nextId++;
+	if (s.kind == Kind::Logs)
+	{
+		s.watch = m_client->installWatch(toLogFilter(_request["filter"], *m_client), Reaping::Manual);
+		m_byWatch[s.watch] = id;
+	}
+	else if (s.kind == Kind::Receipt)
+	{
+		// registered before looking, so a block imported in between still reaches it
+		m_byTransaction.insert(make_pair(s.transaction, id));
+		s.ready = m_client->isKnownTransaction(s.transaction);
+		s.expires = m_client->number() + m_receiptExpiry;
+	}
+	m_subscriptions.insert(make_pair(id, s));
+	++m_bySession[_session.get()];
+
+	LOG(DEBUG) << "subscription" << id << type << "from" << _session->host() << ":" << _session->port();
+	Json::Value ret;
+	ret["result"] = id;
+	return ret;
+}
+
+bool ChannelSubscriptions::unsubscribe(ChannelSession::Ptr _session, unsigned _id)
+{
+	Guard l(x_subscriptions);
+	auto it = m_subscriptions.find(_id);
+	if (it == m_subscriptions.end() || it->second.session != _session)
+		return false;
+	erase(it);
+	return true;
+}
+
+void ChannelSubscriptions::removeSession(ChannelSession::Ptr _session)
+{
+	Guard l(x_subscriptions);
+	for (auto it = m_subscriptions.begin(); it != m_subscriptions.end();)
+		if (it->second.session == _session)
+			erase(it++);
+		else
+			++it;
+}
+
+void ChannelSubscriptions::erase(map<unsigned, Subscription>::iterator _it)
+{
+	Subscription const& s = _it->second;
+	if (s.kind == Kind::Logs)
+	{
+		m_byWatch.erase(s.watch);
+		m_client->uninstallWatch(s.watch);
+	}
+	else if (s.kind == Kind::Receipt)
+	{
+		auto range = m_byTransaction.equal_range(s.transaction);
+		for (auto i = range.first; i != range.second; ++i)
+			if (i->second == _it->first)
+			{
+				m_byTransaction.erase(i);
+				break;
+			}
+	}
+	auto held = m_bySession.find(s.session.get());
+	if (held != m_bySession.end() && !--held->second)
+		m_bySession.erase(held);
+	m_subscriptions.erase(_it);
+}
+
+void ChannelSubscriptions::dispatch(vector<unsigned> const& _watches)
+{
+	Guard l(x_subscriptions);
+	for (unsigned w: _watches)
+	{
+		if (w == m_chainWatch)
+		{
+			h256s blocks;
+			for (auto const& e: m_client->checkWatchSafe(w))
+				blocks.push_back(e.special);
+			onNewBlocks(blocks);
+			continue;
+		}
+
+		auto it = m_byWatch.find(w);
+		if (it == m_byWatch.end())
+			continue;
+		LocalisedLogEntries entries = m_client->checkWatchSafe(w);
+		if (entries.empty())
+			continue;
+		Json::Value result(Json::arrayValue);
+		for (auto const& e: entries)
+			result.append(toJson(e));
+		push(it->second, m_subscriptions.at(it->second), result);
+	}
+}
+
+void ChannelSubscriptions::onNewBlocks(h256s const& _blocks)
+{
+	bool heads = false;
+	for (auto const& s: m_subscriptions)
+		heads = heads || s.second.kind == Kind::NewHeads;
+
+	for (h256 const& b: _blocks)
+	{
+		BlockHeader info = m_client->blockInfo(b);
+		// blocks of an abandoned fork are announced through the same watch
+		if (m_client->hashFromNumber((BlockNumber)info.number()) != b)
+			continue;
+
+		if (heads)
+		{
+			Json::Value header = toJson(info, m_client->sealEngine());
+			for (auto& s: m_subscriptions)
+				if (s.second.kind == Kind::NewHeads)
+					push(s.first, s.second, header);
+		}
+
+		if (m_byTransaction.empty())
+			continue;
+		for (h256 const& t: m_client->transactionHashes(b))
+		{
+			auto range = m_byTransaction.equal_range(t);
+			for (auto i = range.first; i != range.second; ++i)
+				m_subscriptions.at(i->second).ready = true;
+		}
+	}
+	// also retries the receipts a full session couldn't take before
+	if (!m_byTransaction.empty())
+	{
+		pushReceipts();
+		expireReceipts(m_client->number());
+	}
+}
+
+void ChannelSubscriptions::pushReceipts()
+{
+	for (auto it = m_subscriptions.begin(); it != m_subscriptions.end();)
+	{
+		Subscription& s = it->second;
+		if (s.kind == Kind::Receipt && s.ready && push(it->first, s, toJson(m_client->localisedTransactionReceipt(s.transaction))))
+			erase(it++);
+		else
+			++it;
+	}
+}
+
+void ChannelSubscriptions::expireReceipts(unsigned _number)
+{
+	for (auto it = m_subscriptions.begin(); it != m_subscriptions.end();)
+	{
+		Subscription& s = it->second;
+		if (s.kind == Kind::Receipt && !s.ready && _number > s.expires)
+		{
+			LOG(DEBUG) << "receipt subscription" << it->first << "for" << s.transaction << "expired at" << _number;
+			// best effort, the subscription ends either way
+			push(it->first, s, Json::Value());
+			erase(it++);
+		}
+		else
+			++it;
+	}
+}
+
+bool ChannelSubscriptions::push(unsigned _id, Subscription& _s, Json::Value const& _result)
+{
+	static auto& pushed = metrics::counter("channel_push_total", "Events pushed to channel subscriptions");
+	static auto& dropped = metrics::counter("channel_push_dropped_total", "Events not pushed to channel subscriptions because the session's send queue was full");
+
+	Json::Value event;
+	event["subscription"] = _id;
+	event["result"] = _result;
+	if (_s.dropped)
+		event["dropped"] = (Json::UInt64)_s.dropped;
+	string out = Json::FastWriter().write(event);
+
+	auto message = make_shared<Message>();
+	message->setSeq(pushSeq());
+	message->setType(c_pushType);
+	message->setResult(0);
+	message->setData((byte const*)out.data(), out.size());
+
+	if (!_s.session->tryPushMessage(message, m_queueLimit))
+	{
+		// a receipt is retried rather than counted, it is delivered with the next block
+		if (_s.kind != Kind::Receipt)
+			++_s.dropped;
+		dropped.inc();
+		return false;
+	}
+	_s.dropped = 0;
+	pushed.inc();
+	return true;
+}
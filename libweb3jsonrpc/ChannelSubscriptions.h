@@ -0,0 +1,132 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: ChannelSubscriptions.h
+ * @author: fisco-dev
+ * @date: 2018
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <json/json.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include <libethcore/Common.h>
+#include <libchannelserver/ChannelSession.h>
+#include <libchannelserver/ThreadPool.h>
+
+namespace dev
+{
+namespace eth
+{
+class Interface;
+}
+
+/**
+ * Server push of new blocks, logs and transaction receipts to SDK sessions over the channel
+ * protocol, instead of the SDK polling eth_getFilterChanges or eth_getTransactionReceipt.
+ *
+ * A 0x40 message carries {"method":"subscribe","type":"newHeads"|"logs"|"receipt",...} or
+ * {"method":"unsubscribe","id":...} and is answered under the same seq. Events go out as 0x41
+ * messages {"subscription":id,"result":...}. Log subscriptions are client watches, so they match
+ * exactly what eth_newFilter would; all of them are drained as soon as Client::noteChanged fires.
+ *
+ * A session whose send queue is full doesn't get further events until it drains; the number of
+ * events it missed is reported as "dropped" with the next one it gets, so the SDK knows to catch
+ * up with eth_getLogs. A receipt is kept until it could be delivered.
+ *
+ * A session holds at most sessionLimit subscriptions, further ones are refused. A receipt
+ * subscription whose transaction isn't in the chain receiptExpiry blocks after it was made gets a
+ * null result and ends.
+ */
+class ChannelSubscriptions: public std::enable_shared_from_this<ChannelSubscriptions>
+{
+public:
+	typedef std::shared_ptr<ChannelSubscriptions> Ptr;
+
+	static const size_t c_defaultQueueLimit = 1024;
+	static const size_t c_defaultSessionLimit = 256;
+	static const unsigned c_defaultReceiptExpiry = 1000;
+
+	ChannelSubscriptions(eth::Interface* _client, size_t _queueLimit = c_defaultQueueLimit, size_t _sessionLimit = c_defaultSessionLimit, unsigned _receiptExpiry = c_defaultReceiptExpiry);
+	~ChannelSubscriptions();
+
+	/// Starts listening to the watches of the client.
+	void start();
+
+	void onRequest(dev::channel::ChannelSession::Ptr _session, dev::channel::Message::Ptr _message);
+
+	/// Drops every subscription of @a _session.
+	void removeSession(dev::channel::ChannelSession::Ptr _session);
+
+private:
+	enum class Kind
+	{
+		NewHeads,
+		Logs,
+		Receipt
+	};
+
+	struct Subscription
+	{
+		Kind kind;
+		dev::channel::ChannelSession::Ptr session;
+		unsigned watch = 0;		///< Logs only.
+		h256 transaction;		///< Receipt only.
+		bool ready = false;		///< Receipt only: in the chain but not delivered yet.
+		unsigned expires = 0;	///< Receipt only: last block the transaction is waited for.
+		size_t dropped = 0;
+	};
+
+	Json::Value subscribe(dev::channel::ChannelSession::Ptr _session, Json::Value const& _request);
+	bool unsubscribe(dev::channel::ChannelSession::Ptr _session, unsigned _id);
+	void erase(std::map<unsigned, Subscription>::iterator _it);
+
+	/// Drains the watches in @a _watches and pushes what they caught. Runs on m_pool.
+	void dispatch(std::vector<unsigned> const& _watches);
+	/// These expect x_subscriptions to be held.
+	void onNewBlocks(h256s const& _blocks);
+	void pushReceipts();
+	void expireReceipts(unsigned _number);
+	/// @returns false if the session of @a _s couldn't take @a _result.
+	bool push(unsigned _id, Subscription& _s, Json::Value const& _result);
+
+	eth::Interface* m_client;
+	size_t m_queueLimit;
+	size_t m_sessionLimit;
+	unsigned m_receiptExpiry;
+
+	/// One thread, so the events of a subscription go out in order.
+	ThreadPool m_pool;
+	eth::Handler<std::vector<unsigned> const&> m_watchesChanged;
+	/// Watch on new blocks shared by newHeads and receipt subscriptions.
+	unsigned m_chainWatch = 0;
+
+	Mutex x_subscriptions;
+	unsigned m_nextId = 1;
+	std::map<unsigned, Subscription> m_subscriptions;
+	std::map<dev::channel::ChannelSession*, size_t> m_bySession;	///< Subscriptions held by each session.
+	std::map<unsigned, unsigned> m_byWatch;						///< Client watch to log subscription.
+	std::unordered_multimap<h256, unsigned> m_byTransaction;	///< Transaction hash to receipt subscriptions.
+};
+
+}
@@ -35,6 +35,7 @@
 #include <libethereum/Client.h>
 #include <libethereum/Pool.hpp>
 #include <libethereum/BlockQueue.h>
+#include <libethereum/TxTrace.h>
 #include <libpbftseal/PBFT.h>
 #include <libwebthree/WebThree.h>
 #include <libweb3jsonrpc/JsonHelper.h>
@@ -57,6 +58,33 @@ const unsigned dev::SensibleHttpThreads = 8;
 #endif
 const unsigned dev::SensibleHttpPort = 6789;
 
+namespace
+{
+
+/// Page size of eth_getLogsPage when the request doesn't give one.
+static const size_t c_defaultLogsPage = 1000;
+
+size_t logsLimit(eth::Interface const& _client)
+{
+	SealEngineFace* se = _client.sealEngine();
+	return se ? se->chainParams().logsLimit : 0;
+}
+
+/// @returns logs(_f), refusing queries with more entries than the logsLimit option allows.
+LocalisedLogEntries limitedLogs(eth::Interface const& _client, LogFilter const& _f)
+{
+	size_t limit = logsLimit(_client);
+	if (!limit)
+		return _client.logs(_f);
+	unsigned next;
+	LocalisedLogEntries ret = _client.logs(_f, limit + 1, 0, next);
+	if (next || ret.size() > limit)
+		BOOST_THROW_EXCEPTION(JsonRpcException("More than " + toString(limit) + " logs match, narrow the block range or use eth_getLogsPage."));
+	return ret;
+}
+
+}
+
 Eth::Eth(eth::Interface& _eth, eth::AccountHolder& _ethAccounts):
 	m_eth(_eth),
 	m_ethAccounts(_ethAccounts)
@@ -428,7 +456,7 @@ string Eth::eth_sendTransaction(Json::Value const& _json)
 		CnsParams params;
 		if (isOldCNSCall(t, params, _json))
 		{//CNS v1
-			eth_sendTransactionOldCNSSetParams(t);
+			eth_sendTransactionOldCNSSetParams(t, params);
 		}
 		else if (isNewCNSCall(t))
 		{//CNS v2
@@ -527,89 +555,65 @@ Json::Value Eth::eth_inspectTransaction(std::string const& _rlp)
 	}
 }
 
+std::string dev::rpc::importResultErrorMessage(ImportResult _ir)
+{
+	switch (_ir)
+	{
+	case ImportResult::NonceCheckFail:
+		return "Nonce Check Fail.";
+	case ImportResult::BlockLimitCheckFail:
+		return "BlockLimit Check Fail.";
+	case ImportResult::NoTxPermission:
+		return "NoTxPermission .";
+	case ImportResult::NoDeployPermission:
+		return "NoDeployPermission .";
+	case ImportResult::Malformed:
+		return "Malformed!!";
+	case ImportResult::UTXOInvalidType:
+		return "UTXOInvalidType.";
+	case ImportResult::UTXOJsonParamError:
+		return "UTXOJsonParamError.";
+	case ImportResult::UTXOTokenIDInvalid:
+		return "UTXOTokenIDInvalid.";
+	case ImportResult::UTXOTokenUsed:
+		return "UTXOTokenUsed.";
+	case ImportResult::UTXOTokenOwnerShipCheckFail:
+		return "UTXOTokenOwnerShipCheckFail.";
+	case ImportResult::UTXOTokenLogicCheckFail:
+		return "UTXOTokenLogicCheckFail.";
+	case ImportResult::UTXOTokenAccountingBalanceFail:
+		return "UTXOTokenAccountingBalanceFail.";
+	case ImportResult::UTXOTokenCntOutofRange:
+		return "UTXOTokenCntOutofRange.";
+	case ImportResult::UTXOTokenKeyRepeat:
+		return "UTXOTokenKeyRepeat.";
+	case ImportResult::UTXOTxError:
+		return "Something Other Error in UTXO Tx.";
+	case ImportResult::UTXOLowEthVersion:
+		return "UTXOLowEthVersion.";
+	default:
+		return " Something Fail!";
+	}
+}
+
 string Eth::eth_sendRawTransaction(std::string const& _rlp)
 {
 	try
 	{
+		auto received = TxTrace::now();
 		auto tx_data = jsToBytes(_rlp, OnFailed::Throw);
 		std::pair<ImportResult, h256> ret = client()->injectTransaction(tx_data);//when do import, it will use CheckTransaction::Everything for check
 		ImportResult ir = ret.first;
 		if ( ImportResult::Success == ir)
 		{
+			TxTrace::instance().record(ret.second, TxStage::Received, received);
 			return toJS(ret.second);
 			//Transaction tx(tx_data, CheckTransaction::None);
 			//LOG(INFO) << "eth_sendRawTransaction Hash=" << (tx.sha3()) << ",Randid=" << tx.randomid() << ",RPC=" << utcTime();
 
 			//return toJS(tx.sha3());
 		}
-		else if ( ImportResult::NonceCheckFail == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("Nonce Check Fail."));
-		}
-		else if ( ImportResult::BlockLimitCheckFail == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("BlockLimit Check Fail."));
-		}
-		else if ( ImportResult::NoTxPermission == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("NoTxPermission ."));
-		}
-		else if ( ImportResult::NoDeployPermission == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("NoDeployPermission ."));
-		}
-		else if ( ImportResult::Malformed == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("Malformed!!"));
-		}
-		else if ( ImportResult::UTXOInvalidType == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOInvalidType."));
-		}
-		else if ( ImportResult::UTXOJsonParamError == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOJsonParamError."));
-		}
-		else if ( ImportResult::UTXOTokenIDInvalid == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenIDInvalid."));
-		}
-		else if ( ImportResult::UTXOTokenUsed == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenUsed."));
-		}
-		else if ( ImportResult::UTXOTokenOwnerShipCheckFail == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenOwnerShipCheckFail."));
-		}
-		else if ( ImportResult::UTXOTokenLogicCheckFail == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenLogicCheckFail."));
-		}
-		else if ( ImportResult::UTXOTokenAccountingBalanceFail == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenAccountingBalanceFail."));
-		}
-		else if ( ImportResult::UTXOTokenCntOutofRange == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenCntOutofRange."));
-		}
-		else if ( ImportResult::UTXOTokenKeyRepeat == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOTokenKeyRepeat."));
-		}
-		else if ( ImportResult::UTXOTxError == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("Something Other Error in UTXO Tx."));
-		}
-		else if ( ImportResult::UTXOLowEthVersion == ir )
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException("UTXOLowEthVersion."));
-		}
-		else
-		{
-			BOOST_THROW_EXCEPTION(JsonRpcException(" Something Fail!"));
-		}
+		BOOST_THROW_EXCEPTION(JsonRpcException(importResultErrorMessage(ir)));
 
 	}
 	catch (JsonRpcException const& _e)
@@ -668,12 +672,12 @@ Json::Value Eth::eth_jsonCall(Json::Value const& _json, std::string const& _bloc
 		//parse params
 		fromJsonGetParams(_json, params);
 
-		libabi::SolidityAbi abiinfo;
-		//get abi info
-		libabi::ContractAbiMgr::getInstance()->getContractAbi(params.strContractName, params.strVersion, abiinfo);
+		//get compiled abi info
+		auto compiled = libabi::ContractAbiMgr::getInstance()->getCompiledContractAbi(params.strContractName, params.strVersion);
 
 		//encode abi
-		const auto &f = abiinfo.getFunction(params.strFunc);
+		auto encoder = compiled->getEncoder(params.strFunc);
+		const auto &f = encoder->function();
 		//do call for non-constant function in contract
 		if (!f.bConstant())
 		{
@@ -683,15 +687,11 @@ Json::Value Eth::eth_jsonCall(Json::Value const& _json, std::string const& _bloc
 		Json::Value jResult(Json::objectValue);
 		Json::Value jReturn;
 		{
-			//abi info
-			auto strData = libabi::SolidityCoder::getInstance()->encode(f, params.jParams);
-
-        
 			TransactionSkeleton t;
 			setTransactionDefaults(t);
 			//get contract address
-			t.to = jsToAddress(abiinfo.getAddr());
-			t.data = jsToBytes(strData);
+			t.to = compiled->addr();
+			t.data = encoder->encode(params.jParams);
 			ExecutionResult er = client()->call(t.from, t.value, t.to, t.data, t.gas, t.gasPrice, jsToBlockNumber(_blockNumber), FudgeFactor::Lenient);
 			//abi decode
 			jReturn = libabi::SolidityCoder::getInstance()->decode(f, toJS(er.output));
@@ -1506,7 +1506,11 @@ Json::Value Eth::eth_getLogs(Json::Value const& _json)
 {
 	try
 	{
-		return toJson(client()->logs(toLogFilter(_json, *client())));
+		return toJson(limitedLogs(*client(), toLogFilter(_json, *client())));
+	}
+	catch (JsonRpcException const&)
+	{
+		throw;
 	}
 	catch (...)
 	{
@@ -1518,7 +1522,36 @@ Json::Value Eth::eth_getLogsEx(Json::Value const& _json)
 {
 	try
 	{
-		return toJsonByBlock(client()->logs(toLogFilter(_json)));
+		return toJsonByBlock(limitedLogs(*client(), toLogFilter(_json)));
+	}
+	catch (JsonRpcException const&)
+	{
+		throw;
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+}
+
+Json::Value Eth::eth_getLogsPage(Json::Value const& _json)
+{
+	try
+	{
+		// same filter object as eth_getLogs plus "limit", the page size, and "cursor", the
+		// value returned by the previous page
+		size_t limit = c_defaultLogsPage;
+		if (!_json["limit"].empty())
+			limit = _json["limit"].isString() ? jsToInt(_json["limit"].asString()) : _json["limit"].asUInt();
+		if (size_t max = logsLimit(*client()))
+			limit = min(limit, max);
+		unsigned cursor = _json["cursor"].empty() ? 0 : jsToInt(_json["cursor"].asString());
+
+		unsigned next;
+		Json::Value ret(Json::objectValue);
+		ret["logs"] = toJson(client()->logs(toLogFilter(_json, *client()), max<size_t>(limit, 1), cursor, next));
+		ret["cursor"] = next ? Json::Value(toJS(next)) : Json::Value(Json::nullValue);
+		return ret;
 	}
 	catch (...)
 	{
@@ -1808,10 +1841,8 @@ bool Eth::isNewCNSCall(const TransactionSkeleton &t)
 	return !t.strContractName.empty();
 }
 
-void Eth::eth_sendTransactionOldCNSSetParams(TransactionSkeleton &t)
+void Eth::eth_sendTransactionOldCNSSetParams(TransactionSkeleton &t, const CnsParams &params)
 {
-	CnsParams params;
-	fromJsonGetParams(t.jData, params);
 	auto r = libabi::ContractAbiMgr::getInstance()->getAddrAndDataFromCache(params.strContractName, params.strFunc, params.strVersion, params.jParams);
 	t.to   = r.first;
 	t.data = r.second;
@@ -1833,14 +1864,10 @@ void Eth::eth_sendTransactionNewCNSSetParams(TransactionSkeleton &t)
 
 	LOG(DEBUG) << "sendTransactionNewCNS ## contract = " << contract << " ,version = " << version;
 
-	//2. get abi info
-	libabi::SolidityAbi abiinfo;
-	libabi::ContractAbiMgr::getInstance()->getContractAbi(contract, version, abiinfo);
-	LOG(DEBUG) << "sendTransactionNewCNS ## contract_name = " << t.strContractName << " ,contract_address = " << abiinfo.getAddr();
-
-	//3. get contract address
-	t.to = dev::jsToAddress(abiinfo.getAddr());
+	//2. get contract address
+	t.to = libabi::ContractAbiMgr::getInstance()->getCompiledContractAbi(contract, version)->addr();
 	t.creation = false;
+	LOG(DEBUG) << "sendTransactionNewCNS ## contract_name = " << t.strContractName << " ,contract_address = " << t.to;
 }
 
 std::string Eth::eth_callDefault(TransactionSkeleton &t, std::string const& _blockNumber)
@@ -1858,12 +1885,12 @@ std::string Eth::eth_callOldCNS(TransactionSkeleton &t, const CnsParams &params,
 		<< params.strFunc << "|"
 		<< params.jParams.toStyledString();
 
-	libabi::SolidityAbi abiinfo;
-	//2. get abi info
-	libabi::ContractAbiMgr::getInstance()->getContractAbi(params.strContractName, params.strVersion, abiinfo);
+	//2. get compiled abi info
+	auto compiled = libabi::ContractAbiMgr::getInstance()->getCompiledContractAbi(params.strContractName, params.strVersion);
 
 	//encode abi
-	const auto &f = abiinfo.getFunction(params.strFunc);
+	auto encoder = compiled->getEncoder(params.strFunc);
+	const auto &f = encoder->function();
 	//do call invoke in non-constant function
 	if (!f.bConstant())
 	{
@@ -1871,12 +1898,11 @@ std::string Eth::eth_callOldCNS(TransactionSkeleton &t, const CnsParams &params,
 	}
 
 	//3. abi serialize
-	std::string strData = libabi::SolidityCoder::getInstance()->encode(abiinfo.getFunction(params.strFunc), params.jParams);
+	t.data = encoder->encode(params.jParams);
 	//4. call contract
-	t.to = dev::jsToAddress(abiinfo.getAddr());
-	t.data = dev::jsToBytes(strData);
+	t.to = compiled->addr();
 
-	LOG(DEBUG) << "eth_callOldCNS # address => " << abiinfo.getAddr();
+	LOG(DEBUG) << "eth_callOldCNS # address => " << t.to;
 	//5. do call
 	ExecutionResult er = client()->call(t.from, t.value, t.to, t.data, t.gas, t.gasPrice, jsToBlockNumber(_blockNumber), FudgeFactor::Lenient);
 	//6. decode result
@@ -1899,15 +1925,11 @@ std::string Eth::eth_callNewCNS(TransactionSkeleton &t, std::string const& _bloc
 
 	LOG(TRACE) << "eth_callNewCNS ## contract = " << contract << " ,version = " << version;
 
-	//2. get abi info
-	libabi::SolidityAbi abiinfo;
-	libabi::ContractAbiMgr::getInstance()->getContractAbi(contract, version, abiinfo);
-	LOG(DEBUG) << "eth_callNewCNS ## contract_address = " << abiinfo.getAddr();
-
-	//3. get contract address
-	t.to = dev::jsToAddress(abiinfo.getAddr());
+	//2. get contract address
+	t.to = libabi::ContractAbiMgr::getInstance()->getCompiledContractAbi(contract, version)->addr();
+	LOG(DEBUG) << "eth_callNewCNS ## contract_address = " << t.to;
 
-	//4. call invoke
+	//3. call invoke
 	ExecutionResult er = client()->call(t.from, t.value, t.to, t.data, t.gas, t.gasPrice, jsToBlockNumber(_blockNumber), FudgeFactor::Lenient);
 
 	return toJS(er.output);
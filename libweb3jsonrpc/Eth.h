@@ -123,6 +123,7 @@ public:
 	virtual Json::Value eth_getFilterLogsEx(std::string const& _filterId) override;
 	virtual Json::Value eth_getLogs(Json::Value const& _json) override;
 	virtual Json::Value eth_getLogsEx(Json::Value const& _json) override;
+	virtual Json::Value eth_getLogsPage(Json::Value const& _json) override;
 	virtual Json::Value eth_getWork() override;
 	virtual bool eth_submitWork(std::string const& _nonce, std::string const&, std::string const& _mixHash) override;
 	virtual bool eth_submitHashrate(std::string const& _hashes, std::string const& _id) override;
@@ -147,7 +148,7 @@ public:
 	bool isOldCNSCall(const TransactionSkeleton &t, CnsParams &params ,const Json::Value &_json);
 	bool isNewCNSCall(const TransactionSkeleton &t);
 
-	void eth_sendTransactionOldCNSSetParams(TransactionSkeleton &t);
+	void eth_sendTransactionOldCNSSetParams(TransactionSkeleton &t, const CnsParams &params);
 	void eth_sendTransactionNewCNSSetParams(TransactionSkeleton &t);
 
 	std::string eth_callDefault(TransactionSkeleton &t, std::string const& _blockNumber);
@@ -184,5 +185,8 @@ protected:
 	string utxo_call_getBalance(Json::Value const& utxoData);
 };
 
+/// @returns the eth_sendRawTransaction error message for a failed import.
+std::string importResultErrorMessage(eth::ImportResult _ir);
+
 }
 } //namespace dev
@@ -77,6 +77,7 @@ public:
 	: m_handler(jsonrpc::RequestHandlerFactory::createProtocolHandler(jsonrpc::JSONRPC_SERVER_V2, *this))
 	{
 		m_handler->AddProcedure(jsonrpc::Procedure("rpc_modules", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, NULL));
+		m_procedureNames.push_back("rpc_modules");
 		m_implementedModules = Json::objectValue;
 	}
 	inline virtual void modules(const Json::Value &request, Json::Value &response)
@@ -140,11 +141,15 @@ public:
 		return m_connectors.at(_i).get();
 	}
 
+	/// @returns the names of all methods and notifications the server handles.
+	std::vector<std::string> const& procedureNames() const { return m_procedureNames; }
+
 protected:
 	std::vector<std::unique_ptr<jsonrpc::AbstractServerConnector>> m_connectors;
 	std::unique_ptr<jsonrpc::IProtocolHandler> m_handler;
 	/// Mapping for implemented modules, to be filled by subclasses during construction.
 	Json::Value m_implementedModules;
+	std::vector<std::string> m_procedureNames;
 	std::shared_ptr<dev::InterfaceStatistics> statistics = nullptr;
 };
 
@@ -163,12 +168,14 @@ public:
 		{
 			m_methods[std::get<0>(method).GetProcedureName()] = std::get<1>(method);
 			this->m_handler->AddProcedure(std::get<0>(method));
+			this->m_procedureNames.push_back(std::get<0>(method).GetProcedureName());
 		}
 
 		for (auto const& notification: m_interface->notifications())
 		{
 			m_notifications[std::get<0>(notification).GetProcedureName()] = std::get<1>(notification);
 			this->m_handler->AddProcedure(std::get<0>(notification));
+			this->m_procedureNames.push_back(std::get<0>(notification).GetProcedureName());
 		}
 		// Store module with version.
 		for (auto const& module: m_interface->implementedModules())
@@ -184,7 +191,7 @@ public:
 				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 				(m_interface.get()->*(pointer->second))(_input, _output);
 				std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-				std::chrono::milliseconds timeLong = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+				std::chrono::microseconds timeLong = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 				if (ModularServer<Is...>::statistics.get() != nullptr)
 					ModularServer<Is...>::statistics->interfaceCalled(_proc.GetProcedureName(), timeLong.count());
 			} catch(std::exception& e)
@@ -24,6 +24,7 @@
 #include <sstream>
 #include "SafeHttpServer.h"
 #include "DfsFileServer.h"
+#include "BatchRequest.h"
 
 using namespace std;
 using namespace dev;
@@ -96,8 +97,15 @@ int SafeHttpServer::callback(void *cls, struct MHD_Connection *connection, const
 	return HttpServer::callback(cls, connection, url, method, version, upload_data, upload_data_size, con_cls);
 }
 
+void SafeHttpServer::processRequest(jsonrpc::IClientConnectionHandler* _handler, std::string const& _request, std::string& _response) {
+	if (!m_eth || !rpc::handleTransactionBatch(_request, *m_eth, *_handler, _response))
+		_handler->HandleRequest(_request, _response);
+}
+
 bool SafeHttpServer::StartListening() {
 	if (!isRunning()) {
+		if (m_DfsBlockSize > 0)
+			DfsFileServer::getInstance()->m_BlockSize = m_DfsBlockSize;
 		if (0 != DfsFileServer::getInstance()->init(m_DfsStoragePath, m_DfsNodeGroupId, m_DfsNodeId, m_eth))
 		{
 			LOG(INFO) << "init DfsFileServer failed !";
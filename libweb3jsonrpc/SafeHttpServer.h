@@ -47,6 +47,7 @@ public:
 	void setGroup(const std::string& group) { m_DfsNodeGroupId = group; }
 	void setNode(const std::string& node) {m_DfsNodeId = node;}
 	void setStoragePath(const std::string& storage) {m_DfsStoragePath = storage;}
+	void setBlockSize(size_t blockSize) {m_DfsBlockSize = blockSize;}
 	void setEth(eth::Client* _eth) {m_eth = _eth;}
 
 	virtual bool StartListening();
@@ -60,15 +61,21 @@ public:
 	virtual pCompletedCallbak getCompletedCallback() {
         return dev::rpc::fs::DfsFileServer::request_completed;
     }
+
+protected:
+	/// Import the raw transactions of a batch request at once, see handleTransactionBatch().
+	virtual void processRequest(jsonrpc::IClientConnectionHandler* _handler, std::string const& _request, std::string& _response) override;
+
 private:
 	std::string m_allowedOrigin;
 
 	std::string m_path_sslrootca;
 	std::string m_sslrootca;
-	eth::Client* m_eth;
+	eth::Client* m_eth = nullptr;
 	std::string m_DfsNodeGroupId;
 	std::string m_DfsNodeId;
 	std::string m_DfsStoragePath;
+	size_t m_DfsBlockSize = 0;
 };
 
 }
@@ -5,10 +5,10 @@
 #include "microhttpd.h"
 #include <libdevcore/easylog.h>
 
-#define dfs_debug (LOG(DEBUG))
-#define dfs_warn  (LOG(ERROR))
-#define dfs_trace  (LOG(TRACE))
-#define dfs_error (LOG(ERROR))
+#define dfs_debug LOG(DEBUG)
+#define dfs_warn  LOG(ERROR)
+#define dfs_trace  LOG(TRACE)
+#define dfs_error LOG(ERROR)
 
 
 using std::string;
@@ -0,0 +1,550 @@
+#include "DfsChunkDownloader.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <thread>
+
+#include "DfsCommon.h"
+#include "DfsFileServer.h"
+#include "DfsFileCache.h"
+
+
+using namespace dev::rpc::fs;
+
+
+//state of one file download shared by the fetching threads
+struct DfsChunkDownloader::Transfer
+{
+	const DfsFileTask*			task;
+	vector<DfsSource>*			sources;
+	string 						partPath;
+	string 						statePath;
+	int 						fd;
+	uint64_t 					size;
+	uint64_t 					chunks;
+	uint64_t 					next;//first chunk not requested yet
+	uint64_t 					hashed;//chunks hashed so far, they are in the partial file
+	std::deque<uint64_t> 		retries;
+	std::map<uint64_t, int> 	attempts;
+	std::map<uint64_t, string> 	ready;//fetched, waiting for the chunks before them to be hashed
+	int 						maxAttempts;
+	bool 						failed;
+	MD5_CTX 					ctx;
+	std::mutex 					mutex;
+	std::condition_variable 	cond;
+};
+
+//saved next to the partial file
+typedef struct DfsPartState {
+	char 		magic[8];
+	uint64_t 	size;
+	uint64_t 	chunk_size;
+	uint64_t 	hashed;
+	MD5_CTX 	ctx;
+	char 		filehash[64];
+} DfsPartState;
+
+static const char s_PartMagic[8] = {'D', 'F', 'S', 'P', 'A', 'R', 'T', '1'};
+
+//what curl writes a response to
+typedef struct DfsChunkSink {
+	CURL* 					curl;
+	std::atomic<bool>* 		stop;
+	string* 				data;
+	size_t 					limit;//of data
+	int 					fd;//a 200 answer is written here if not -1
+	MD5_CTX* 				ctx;
+	uint64_t 				streamed;
+	string 					etag;
+	string 					content_range;
+} DfsChunkSink;
+
+static size_t recv_data(void *ptr, size_t size, size_t nmemb, void *cls)
+{
+	DfsChunkSink *sink = (DfsChunkSink*)cls;
+	size_t bytes = size * nmemb;
+	if (*(sink->stop))
+		return 0;
+
+	long response_code = 0;
+	curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &response_code);
+	if (response_code == 200 && sink->fd != -1)
+	{
+		const char *p = (const char*)ptr;
+		size_t left = bytes;
+		while (left > 0)
+		{
+			ssize_t written = pwrite(sink->fd, p, left, (off_t)sink->streamed);
+			if (written <= 0)
+			{
+				dfs_warn << "write streamed file failed, errno: " << errno;
+				return 0;
+			}
+			ms_MD5_Update(sink->ctx, p, (unsigned long)written);
+			sink->streamed += written;
+			p += written;
+			left -= written;
+		}
+		return bytes;
+	}
+
+	//more than asked for, e.g. the whole file from a source ignoring the range
+	if (sink->data->size() + bytes > sink->limit)
+		return 0;
+
+	sink->data->append((const char*)ptr, bytes);
+	return bytes;
+}
+
+static size_t recv_header(void *ptr, size_t size, size_t nmemb, void *cls)
+{
+	DfsChunkSink *sink = (DfsChunkSink*)cls;
+	size_t bytes = size * nmemb;
+	string strLine((const char*)ptr, bytes);
+	size_t pos = strLine.find(':');
+	if (pos == string::npos)
+		return bytes;
+
+	string strName = strLine.substr(0, pos);
+	string strValue = strLine.substr(pos + 1);
+	size_t begin = strValue.find_first_not_of(" \t");
+	size_t end = strValue.find_last_not_of(" \t\r\n");
+	strValue = begin == string::npos ? "" : strValue.substr(begin, end - begin + 1);
+
+	if (0 == strcasecmp(strName.c_str(), "ETag"))
+		sink->etag = strValue;
+	else if (0 == strcasecmp(strName.c_str(), "Content-Range"))
+		sink->content_range = strValue;
+	return bytes;
+}
+
+static bool write_chunk(int fd, const string& data, uint64_t offset)
+{
+	for (size_t done = 0; done < data.size();)
+	{
+		ssize_t written = pwrite(fd, data.data() + done, data.size() - done, (off_t)(offset + done));
+		if (written <= 0)
+		{
+			dfs_warn << "write chunk failed, errno: " << errno;
+			return false;
+		}
+		done += written;
+	}
+	return true;
+}
+
+static std::once_flag s_CurlInit;
+
+
+DfsChunkDownloader::DfsChunkDownloader(size_t chunk_size, int max_transfers)
+{
+	m_ChunkSize = chunk_size;
+	m_MaxTransfers = max_transfers;
+	m_Stop = false;
+}
+
+DfsChunkDownloader::~DfsChunkDownloader()
+{
+}
+
+void DfsChunkDownloader::start()
+{
+	m_Stop = false;
+}
+
+void DfsChunkDownloader::stop()
+{
+	m_Stop = true;
+}
+
+int DfsChunkDownloader::download(const DfsFileTask& task, vector<DfsSource>& sources)
+{
+	if (sources.empty())
+	{
+		dfs_warn << "no source node to download fileid: " << task.id;
+		return -1;
+	}
+
+	//the fetching threads share curl
+	std::call_once(s_CurlInit, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+	Transfer transfer;
+	transfer.task = &task;
+	transfer.sources = &sources;
+	transfer.partPath = DfsFileServer::getInstance()->m_PartialStorePath;
+	transfer.partPath += "/";
+	transfer.partPath += task.id;
+	transfer.partPath += "_";
+	transfer.partPath += task.filename;
+	transfer.statePath = transfer.partPath;
+	transfer.statePath += ".state";
+	transfer.size = 0;
+	transfer.chunks = 0;
+	transfer.next = 0;
+	transfer.hashed = 0;
+	transfer.maxAttempts = std::max(3, (int)sources.size() * 2);
+	transfer.failed = false;
+	ms_MD5_Init(&transfer.ctx);
+
+	transfer.fd = open(transfer.partPath.c_str(), O_RDWR | O_CREAT, 0644);
+	if (transfer.fd == -1)
+	{
+		dfs_warn << "cannot open partial file: " << transfer.partPath << ", errno: " << errno;
+		return -1;
+	}
+
+	bool streamed = false;
+	bool probed = false;
+	if (loadState(transfer))
+	{
+		dfs_debug << "resume download of fileid: " << task.id << " at chunk " << transfer.hashed;
+	}
+	else
+	{
+		//the first chunk tells the size; a source ignoring the range sends the whole file, it is
+		//hashed as it comes in
+		for (size_t i = 0; i < sources.size() && !m_Stop; ++i)
+		{
+			string data;
+			string etag;
+			uint64_t size = 0;
+			ms_MD5_Init(&transfer.ctx);
+			int code = fetch(transfer, sources[i], 0, m_ChunkSize - 1, data, size, etag, true);
+			if (code == 206 && !write_chunk(transfer.fd, data, 0))
+			{
+				break;
+			}
+
+			if (code == 206 || code == 200 || (code == 416 && size == 0))
+			{
+				probed = true;
+				streamed = code == 200;
+				sources[i].etag = etag;
+				transfer.size = size;
+				if (code == 206)
+				{
+					transfer.ready[0].swap(data);
+				}
+				break;
+			}
+
+			dfs_warn << "fileid: " << task.id << " not available from " << sources[i].host << ":" << sources[i].port << ", status: " << code;
+			++sources[i].failures;
+		}
+
+		if (!probed)
+		{
+			close(transfer.fd);
+			return -1;
+		}
+	}
+
+	if (!streamed)
+	{
+		transfer.chunks = (transfer.size + m_ChunkSize - 1) / m_ChunkSize;
+		{
+			std::unique_lock<std::mutex> l(transfer.mutex);
+			hashReady(transfer);
+		}
+		transfer.next = transfer.hashed;
+
+		uint64_t left = transfer.chunks - transfer.hashed;
+		int threads = (int)std::min<uint64_t>(m_MaxTransfers, left);
+		vector<std::thread> workers;
+		for (int i = 0; i < threads; ++i)
+		{
+			workers.push_back(std::thread([this, &transfer]() { fetchChunks(transfer); }));
+		}
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+
+		if (transfer.failed || transfer.hashed != transfer.chunks)
+		{
+			dfs_warn << "download of fileid: " << task.id << " stopped at chunk " << transfer.hashed << "/" << transfer.chunks << ", resumes later";
+			close(transfer.fd);
+			return -1;
+		}
+	}
+
+	unsigned char szResult[16] = {0};
+	ms_MD5_Final(szResult, &transfer.ctx);
+	string strHash;
+	char szTmp[8];
+	for (size_t i = 0; i < 16; ++i)
+	{
+		snprintf(szTmp, sizeof(szTmp), "%02x", szResult[i]);
+		strHash += szTmp;
+	}
+
+	//a partial file of an earlier attempt may have been longer
+	if (0 != ftruncate(transfer.fd, (off_t)transfer.size))
+	{
+		dfs_warn << "cannot truncate partial file: " << transfer.partPath;
+	}
+	close(transfer.fd);
+	FileRm(transfer.statePath);
+	if (0 != strcasecmp(strHash.c_str(), task.filehash.c_str()))
+	{
+		dfs_warn << "the calculate hash not equal, srcHash: " << task.filehash.data() << ", dstHash: " << strHash.data();
+		FileRm(transfer.partPath);
+		return -1;
+	}
+
+	string strFile;
+	string strFileBak;
+	createDfsFileNames(task.directory, task.id, task.filename, strFile, strFileBak);
+	if (0 != FileMv(transfer.partPath, strFile))
+	{
+		dfs_warn << "cannot move downloaded file " << transfer.partPath << " to " << strFile;
+		FileRm(transfer.partPath);
+		return -1;
+	}
+	DfsFileCache::getInstance()->invalidate(task.directory, task.id);
+
+	dfs_debug << "the calculate hash check success, fileid: " << task.id << ", " << transfer.size << " bytes";
+	return 0;
+}
+
+void DfsChunkDownloader::fetchChunks(Transfer& transfer)
+{
+	std::unique_lock<std::mutex> l(transfer.mutex);
+	while (!transfer.failed && !m_Stop && transfer.hashed < transfer.chunks)
+	{
+		uint64_t chunk = 0;
+		if (!transfer.retries.empty())
+		{
+			chunk = transfer.retries.front();
+			transfer.retries.pop_front();
+		}
+		else if (transfer.next < transfer.chunks && transfer.next < transfer.hashed + 2 * m_MaxTransfers)
+		{
+			chunk = transfer.next++;
+		}
+		else
+		{
+			transfer.cond.wait_for(l, std::chrono::seconds(1));
+			continue;
+		}
+
+		size_t index = pickSource(transfer, chunk, transfer.attempts[chunk]);
+		DfsSource source = (*transfer.sources)[index];
+		l.unlock();
+
+		uint64_t first = chunk * m_ChunkSize;
+		uint64_t last = std::min<uint64_t>(first + m_ChunkSize, transfer.size) - 1;
+		string data;
+		string etag;
+		uint64_t size = 0;
+		int code = fetch(transfer, source, first, last, data, size, etag, false);
+		bool ok = code == 206 && size == transfer.size && write_chunk(transfer.fd, data, first);
+
+		l.lock();
+		DfsSource& shared = (*transfer.sources)[index];
+		//every chunk from a node must be of the same version of the file
+		if (ok && !shared.etag.empty() && shared.etag != etag)
+		{
+			ok = false;
+		}
+
+		if (ok)
+		{
+			shared.etag = etag;
+			shared.failures = 0;
+			transfer.ready[chunk].swap(data);
+			hashReady(transfer);
+		}
+		else
+		{
+			dfs_warn << "chunk " << chunk << " of fileid: " << transfer.task->id << " failed from " << source.host << ":" << source.port << ", status: " << code;
+			++shared.failures;
+			if (++transfer.attempts[chunk] >= transfer.maxAttempts)
+			{
+				transfer.failed = true;
+			}
+			else
+			{
+				transfer.retries.push_back(chunk);
+			}
+		}
+		transfer.cond.notify_all();
+	}
+	transfer.cond.notify_all();
+}
+
+size_t DfsChunkDownloader::pickSource(Transfer& transfer, uint64_t chunk, int attempt)
+{
+	size_t count = transfer.sources->size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t index = (chunk + attempt + i) % count;
+		if ((*transfer.sources)[index].failures < JZ_MAX_SOURCE_FAILURES)
+		{
+			return index;
+		}
+	}
+
+	return (chunk + attempt) % count;
+}
+
+void DfsChunkDownloader::hashReady(Transfer& transfer)
+{
+	uint64_t hashed = transfer.hashed;
+	while (!transfer.ready.empty() && transfer.ready.begin()->first == transfer.hashed)
+	{
+		string& data = transfer.ready.begin()->second;
+		ms_MD5_Update(&transfer.ctx, data.data(), (unsigned long)data.size());
+		transfer.ready.erase(transfer.ready.begin());
+		++transfer.hashed;
+	}
+
+	if (transfer.hashed != hashed)
+	{
+		saveState(transfer);
+	}
+}
+
+bool DfsChunkDownloader::loadState(Transfer& transfer)
+{
+	FILE* fp = fopen(transfer.statePath.c_str(), "rb");
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	DfsPartState state;
+	size_t bytes = fread(&state, 1, sizeof(state), fp);
+	fclose(fp);
+
+	struct stat buf;
+	if (bytes != sizeof(state) || 0 != memcmp(state.magic, s_PartMagic, sizeof(s_PartMagic))
+		|| state.chunk_size != m_ChunkSize
+		|| 0 != strncmp(state.filehash, transfer.task->filehash.c_str(), sizeof(state.filehash))
+		|| 0 != fstat(transfer.fd, &buf)
+		|| (uint64_t)buf.st_size < std::min<uint64_t>(state.hashed * m_ChunkSize, state.size))
+	{
+		dfs_warn << "the partial download state " << transfer.statePath << " doesn't match, download again";
+		FileRm(transfer.statePath);
+		return false;
+	}
+
+	transfer.size = state.size;
+	transfer.hashed = state.hashed;
+	memcpy(&transfer.ctx, &state.ctx, sizeof(state.ctx));
+	return true;
+}
+
+void DfsChunkDownloader::saveState(Transfer& transfer)
+{
+	DfsPartState state;
+	memset(&state, 0, sizeof(state));
+	memcpy(state.magic, s_PartMagic, sizeof(s_PartMagic));
+	state.size = transfer.size;
+	state.chunk_size = m_ChunkSize;
+	state.hashed = transfer.hashed;
+	memcpy(&state.ctx, &transfer.ctx, sizeof(state.ctx));
+	strncpy(state.filehash, transfer.task->filehash.c_str(), sizeof(state.filehash) - 1);
+
+	//the hashed chunks must be on disk before the state says so
+	fdatasync(transfer.fd);
+
+	string strTmp = transfer.statePath;
+	strTmp += ".tmp";
+	FILE* fp = fopen(strTmp.c_str(), "wb");
+	if (fp == NULL)
+	{
+		return;
+	}
+	size_t bytes = fwrite(&state, 1, sizeof(state), fp);
+	fclose(fp);
+	if (bytes == sizeof(state))
+	{
+		FileMv(strTmp, transfer.statePath);
+	}
+}
+
+int DfsChunkDownloader::fetch(Transfer& transfer, const DfsSource& source, uint64_t first, uint64_t last, string& data,
+	uint64_t& size, string& etag, bool stream)
+{
+	char szUrl[512];
+	snprintf(szUrl, sizeof(szUrl), "%s:%d/fs/%s/files/%s", source.host.c_str(), source.port, JZ_MODULE_VERSION_V1, transfer.task->id.c_str());
+	char szRange[64];
+	snprintf(szRange, sizeof(szRange), "%llu-%llu", (unsigned long long)first, (unsigned long long)last);
+
+	CURL *curl = curl_easy_init();
+	if (!curl)
+	{
+		dfs_warn << "curl_easy_init() failed\n";
+		return -1;
+	}
+
+	DfsChunkSink sink;
+	sink.curl = curl;
+	sink.stop = &m_Stop;
+	sink.data = &data;
+	sink.limit = (size_t)(last - first + 1);
+	sink.fd = stream ? transfer.fd : -1;
+	sink.ctx = &transfer.ctx;
+	sink.streamed = 0;
+
+	curl_easy_setopt(curl, CURLOPT_URL, szUrl);
+	curl_easy_setopt(curl, CURLOPT_RANGE, szRange);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+	//a stalled link is given up, the chunk goes to another source
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)JZ_LOW_SPEED_LIMIT);
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)JZ_LOW_SPEED_TIME);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, recv_data);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, recv_header);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, &sink);
+
+	CURLcode res = curl_easy_perform(curl);
+	long response_code = 0;
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+	curl_easy_cleanup(curl);
+	if (res != CURLE_OK)
+	{
+		dfs_debug << "URL: " << szUrl << ", range: " << szRange << ", curl_easy_perform() failed: " << curl_easy_strerror(res);
+		return -1;
+	}
+
+	etag = sink.etag;
+	if (response_code == 200 && stream)
+	{
+		size = sink.streamed;
+		return 200;
+	}
+
+	unsigned long long ullFirst = 0;
+	unsigned long long ullLast = 0;
+	unsigned long long ullSize = 0;
+	if (response_code == 416 && 1 == sscanf(sink.content_range.c_str(), "bytes */%llu", &ullSize))
+	{
+		size = ullSize;
+		return 416;
+	}
+
+	if (response_code != 206)
+	{
+		return response_code == 0 ? -1 : (int)response_code;
+	}
+
+	//the range must be the one asked for, cut at the end of the file
+	if (3 != sscanf(sink.content_range.c_str(), "bytes %llu-%llu/%llu", &ullFirst, &ullLast, &ullSize)
+		|| ullFirst != first || ullLast < ullFirst || ullLast >= ullSize
+		|| (ullLast != last && ullLast != ullSize - 1)
+		|| data.size() != ullLast - ullFirst + 1)
+	{
+		dfs_warn << "bad range: " << sink.content_range << " for " << szRange << ", " << data.size() << " bytes";
+		return -1;
+	}
+
+	size = ullSize;
+	return 206;
+}
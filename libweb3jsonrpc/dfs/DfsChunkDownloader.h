@@ -0,0 +1,100 @@
+/**
+* @file DfsChunkDownloader.h
+* @time 2018
+**@desc replication of a file from the nodes holding it, in chunks fetched in parallel
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+
+#include "DfsBase.h"
+#include "DfsConst.h"
+#include "DfsMd5.h"
+
+using std::string;
+using std::vector;
+
+
+namespace dev
+{
+
+namespace rpc
+{
+
+namespace fs
+{
+
+typedef struct DfsSource {
+	string 		host;
+	int 		port;
+	string 		etag;//of the file on this node, every chunk must carry it
+	int 		failures;
+
+	DfsSource() : host(""), port(0), etag(""), failures(0) {};
+	DfsSource(const string& h, int p) : host(h), port(p), etag(""), failures(0) {};
+} DfsSource;
+
+/**
+*@desc Downloads a file in chunks of chunk_size with HTTP range requests, at most max_transfers
+* at a time, spread over all the sources. A chunk that fails is fetched again from the next source.
+*
+* The file hash in the contract is the only trusted one and it covers the whole file, so chunks are
+* hashed in order as they come in; a chunk is only requested while it is less than 2*max_transfers
+* chunks ahead of the hashed ones, which bounds what waits in memory. The hash state is saved with the
+* partial file after each chunk, so a download that failed or was stopped resumes where it stopped.
+* A source that ignores the range is read as a single stream.
+*/
+class DfsChunkDownloader
+{
+public:
+	DfsChunkDownloader(size_t chunk_size = JZ_CHUNK_SIZE, int max_transfers = JZ_MAX_TRANSFERS);
+	~DfsChunkDownloader();
+
+public:
+	//download the file of task to its stored path, return 0 if it is complete and matches the file hash
+	int download(const DfsFileTask& task, vector<DfsSource>& sources);
+
+	//allow downloads again after stop
+	void start();
+
+	//make a running download return, it resumes next time
+	void stop();
+
+private:
+	struct Transfer;
+
+	//fetch [first, last] of the file from source, return the http status
+	//size and etag are those of the whole file; a 200 answer is streamed to transfer.fd if stream is set
+	int fetch(Transfer& transfer, const DfsSource& source, uint64_t first, uint64_t last, string& data,
+		uint64_t& size, string& etag, bool stream);
+
+	//fetch chunks until all are hashed or the transfer fails
+	void fetchChunks(Transfer& transfer);
+
+	//pick the source for an attempt on a chunk, the ones failing too often last
+	size_t pickSource(Transfer& transfer, uint64_t chunk, int attempt);
+
+	//hash the chunks following the hashed ones and save the state, transfer.mutex held
+	void hashReady(Transfer& transfer);
+
+	bool loadState(Transfer& transfer);
+	void saveState(Transfer& transfer);
+
+private:
+	size_t 						m_ChunkSize;
+	int 						m_MaxTransfers;
+	std::atomic<bool> 			m_Stop;
+};
+
+}
+}
+}
@@ -24,6 +24,15 @@
 
 #define 			JZ_FIX_BUFFER_SIZE			1024
 
+#define				JZ_DOWNLOAD_BLOCK_SIZE		(256 * 1024)
+
+//replication between nodes
+#define				JZ_CHUNK_SIZE				(4 * 1024 * 1024)
+#define				JZ_MAX_TRANSFERS			4
+#define				JZ_MAX_SOURCE_FAILURES		5
+#define				JZ_LOW_SPEED_LIMIT			1024//bytes per second
+#define				JZ_LOW_SPEED_TIME			30//seconds
+
 #define 			JZ_FIX_SLEEP_TIME			3000//milliseconds
 
 #define 			JZ_2000_FIRST_DAY_TIMESTAMP	946713600
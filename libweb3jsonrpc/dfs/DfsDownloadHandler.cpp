@@ -5,6 +5,9 @@
 #include <string.h>
 #include <microhttpd.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <libdevcore/Metrics.h>
 
 #include "DfsJsonUtils.h"
 #include "DfsCommon.h"
@@ -12,6 +15,7 @@
 #include "DfsFileServer.h"
 #include "DfsFileOperationManager.h"
 #include "DfsContractCaller.h"
+#include "DfsFileCache.h"
 
 
 
@@ -40,6 +44,13 @@ DfsDownloadHandler::~DfsDownloadHandler()
 }
 
 
+//file part sent by file_reader
+typedef struct DfsFileRange
+{
+    int         fd;
+    uint64_t    offset;
+} DfsFileRange;
+
 static ssize_t
 file_reader (void *cls,
              uint64_t pos,
@@ -49,11 +60,18 @@ file_reader (void *cls,
 
 static void free_callback (void *cls);
 
+static int parse_range (const char *range, uint64_t size, uint64_t &first, uint64_t &last);
+
+static bool match_etag (const char *etags, const string &etag);
+
 
 //handle request and setup download
 int DfsDownloadHandler::handle(DfsHttpInfo *http_info, DfsUrlInfo *url_info)
 {
+    static auto& sentBytes = metrics::counter("dfs_download_bytes_total", "Bytes of files queued for download");
+
     struct stat buf;
+    struct MHD_Connection *connection = http_info->connection;
 
     dfs_debug << "the url: " << http_info->url << "\n";
     if ((0 != strcmp(http_info->method, MHD_HTTP_METHOD_GET)) 
@@ -62,7 +80,7 @@ int DfsDownloadHandler::handle(DfsHttpInfo *http_info, DfsUrlInfo *url_info)
     {
         dfs_warn << "bad request method: " << http_info->method << "\n";
     	string strjson = DfsJsonUtils::createCommonRsp(MHD_HTTP_BAD_REQUEST, -1, "bad request, check url");
-		return IUrlHandler::send_page(http_info->connection, strjson.c_str(), MHD_HTTP_BAD_REQUEST);
+		return IUrlHandler::send_page(connection, strjson.c_str(), MHD_HTTP_BAD_REQUEST);
     }   
     
     if (*(http_info->ptr) == NULL)
@@ -72,93 +90,144 @@ int DfsDownloadHandler::handle(DfsHttpInfo *http_info, DfsUrlInfo *url_info)
     	con_info->version = JZ_MODULE_VERSION_V1;
 		con_info->fp = NULL;
 		con_info->fp_path = "";
-		con_info->data = (char*)http_info->connection;
+		con_info->file_id = url_info->file_id;
+		con_info->data = (char*)connection;
     	*(http_info->ptr) = con_info;
     }
 
-	DfsConnectionInfo *down_con_info = (DfsConnectionInfo*)(*(http_info->ptr));
+	string strFileDir;
+    string strFirst;
+    string strSecond;
+    DfsFileServer::getInstance()->createDirectoryStringByContainer(url_info->container_id, strFileDir, strFirst, strSecond);
+
+    //get short fileid_xxx as the filepath, the directory is scanned only if not cached
+	string strFullFileFound = "";
+	if (!DfsFileCache::getInstance()->find(strFileDir, url_info->file_id, strFullFileFound, buf))
+	{
+		dfs_warn << "download, cannot find fileid: " << url_info->file_id.c_str() << " corresponding file \n";
+		string strjson = DfsJsonUtils::createCommonRsp(MHD_HTTP_NOT_FOUND, -1, "file id not found");
+		return IUrlHandler::send_page(connection, strjson.c_str(), MHD_HTTP_NOT_FOUND);
+	}
+
+	//the same file keeps its etag until it is rewritten
+	char szETag[64] = {0};
+	snprintf(szETag, sizeof(szETag), "\"%llx-%llx\"", (unsigned long long)buf.st_size, (unsigned long long)buf.st_mtime);
+	string strETag = szETag;
+
+	const char *pszIfNoneMatch = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+	if (pszIfNoneMatch != NULL && match_etag(pszIfNoneMatch, strETag))
+	{
+		struct MHD_Response *response = MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+		if (NULL == response)
+		{
+			return MHD_NO;
+		}
+		MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, strETag.c_str());
+		int ret = MHD_queue_response(connection, MHD_HTTP_NOT_MODIFIED, response);
+		MHD_destroy_response(response);
+		return ret;
+	}
+
+	//a range of another version of the file is ignored, the whole file is sent
+	uint64_t size = (uint64_t)buf.st_size;
+	uint64_t first = 0;
+	uint64_t last = size == 0 ? 0 : size - 1;
 	int http_response_code = MHD_HTTP_OK;
-	if (NULL == down_con_info->fp)
-	{
-		string strFileDir;
-	    string strFirst;
-	    string strSecond;
-	    DfsFileServer::getInstance()->createDirectoryStringByContainer(url_info->container_id, strFileDir, strFirst, strSecond);
-
-	    if (url_info->file_id.empty())
-	    {
-	    	dfs_warn << "bad request, url: " << http_info->url << " without file_id\n";
-	    	string strjson = DfsJsonUtils::createCommonRsp(MHD_HTTP_BAD_REQUEST, -1, "bad request no fileid");
-			return IUrlHandler::send_page(http_info->connection, strjson.c_str(), MHD_HTTP_BAD_REQUEST);
-	    }
-		
-	    //get short fileid_xxx as the filepath
-	    //find the file
-		string strFullFileFound = "";
-		if (!findShortestAsFile(strFileDir, url_info->file_id, strFullFileFound))
+	const char *pszRange = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_RANGE);
+	const char *pszIfRange = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_RANGE);
+	if (pszRange != NULL && (pszIfRange == NULL || strETag == pszIfRange))
+	{
+		int result = parse_range(pszRange, size, first, last);
+		if (result < 0)
 		{
-			dfs_warn << "download, cannot find fileid: " << url_info->file_id.c_str() << " corresponding file \n";
-			string strjson = DfsJsonUtils::createCommonRsp(MHD_HTTP_NOT_FOUND, -1, "file id not found");
-			return IUrlHandler::send_page(http_info->connection, strjson.c_str(), MHD_HTTP_NOT_FOUND);
+			dfs_warn << "download, range: " << pszRange << " not satisfiable, size: " << size;
+			string strPage = DfsJsonUtils::createCommonRsp(MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE, -1, "range not satisfiable");
+			struct MHD_Response *response = MHD_create_response_from_buffer(strPage.size(), (void*)strPage.data(), MHD_RESPMEM_MUST_COPY);
+			if (NULL == response)
+			{
+				return MHD_NO;
+			}
+			char szContentRange[64] = {0};
+			snprintf(szContentRange, sizeof(szContentRange), "bytes */%llu", (unsigned long long)size);
+			MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, "application/json");
+			MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_RANGE, szContentRange);
+			int ret = MHD_queue_response(connection, MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE, response);
+			MHD_destroy_response(response);
+			return ret;
 		}
-	
-    	down_con_info->fp = fopen (strFullFileFound.c_str(), "rb");
-		if (down_con_info->fp == NULL)
+		else if (result > 0)
 		{
-			http_response_code = MHD_HTTP_NOT_FOUND;
-			
-			dfs_warn << "**** open file failed! file: " << strFullFileFound.data();
-			string strPage = DfsJsonUtils::createCommonRsp(MHD_HTTP_NOT_FOUND, -1, "file not found");
-			return IUrlHandler::send_page(http_info->connection, strPage.data(), http_response_code);
+			http_response_code = MHD_HTTP_PARTIAL_CONTENT;
 		}
 		else
 		{
-	        int fd = fileno (down_con_info->fp);
-			int result = 0;
-	        if (-1 == fd)
-	        {
-	        	result = -1;
-	        }
-
-			if ((result == 0) && ((0 != fstat (fd, &buf)) || (! S_ISREG (buf.st_mode))) )
-	        {
-	           result = -1;
-	        }
-
-			if (result != 0)
-			{
-				(void) fclose (down_con_info->fp);
-				down_con_info->fp = NULL;
-				http_response_code = MHD_HTTP_BAD_REQUEST;
-			
-				dfs_warn << "**** bad file cannot down, file: " << strFullFileFound.data();
-				string strPage = DfsJsonUtils::createCommonRsp(MHD_HTTP_BAD_REQUEST, -1, "bad file");
-				return IUrlHandler::send_page(http_info->connection, strPage.data(), http_response_code);
-			}
+			first = 0;
+			last = size == 0 ? 0 : size - 1;
 		}
-    }
+	}
+	uint64_t length = size == 0 ? 0 : last - first + 1;
+
+	int fd = open(strFullFileFound.c_str(), O_RDONLY);
+	if (-1 == fd)
+	{
+		DfsFileCache::getInstance()->invalidate(strFileDir, url_info->file_id);
+		dfs_warn << "**** open file failed! file: " << strFullFileFound.data();
+		string strPage = DfsJsonUtils::createCommonRsp(MHD_HTTP_NOT_FOUND, -1, "file not found");
+		return IUrlHandler::send_page(connection, strPage.data(), MHD_HTTP_NOT_FOUND);
+	}
+
+	//plain connections are served by sendfile from the page cache, TLS ones have to
+	//be read and encrypted, which is done in blocks of the configured size
+	struct MHD_Response *response = NULL;
+	if (NULL == MHD_get_connection_info(connection, MHD_CONNECTION_INFO_GNUTLS_SESSION))
+	{
+		response = MHD_create_response_from_fd_at_offset(length, fd, (off_t)first);
+		if (NULL == response)
+		{
+			close(fd);
+		}
+	}
+	else
+	{
+		DfsFileRange *range = new DfsFileRange;
+		range->fd = fd;
+		range->offset = first;
+		response = MHD_create_response_from_callback(length, DfsFileServer::getInstance()->m_BlockSize,
+	                   &file_reader,
+	                   range,
+	                   &free_callback);
+		if (NULL == response)
+		{
+			free_callback(range);
+		}
+	}
 
-	int ret = MHD_YES;
-	struct MHD_Response *response;
-	//do downloading...
-	response = MHD_create_response_from_callback (buf.st_size, 4 * 1024,     /* 32k page size */
-                   &file_reader,
-                   down_con_info,
-                   &free_callback);
     if (NULL == response)
     {
-        fclose (down_con_info->fp);
-		down_con_info->fp = NULL;
 		http_response_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
 			
-		dfs_warn << "**** download file, MHD_create_response_from_callback, url: " << http_info->url;
+		dfs_warn << "**** download file, create response failed, url: " << http_info->url;
 		string strPage = DfsJsonUtils::createCommonRsp(http_response_code, -1, "create reader failed");
-		return IUrlHandler::send_page(http_info->connection, strPage.data(), http_response_code);
+		return IUrlHandler::send_page(connection, strPage.data(), http_response_code);
     }
-	
-	dfs_debug << "download request commit ok! url: " << http_info->url << "\n";
-	ret = MHD_queue_response(http_info->connection, MHD_HTTP_OK, response);
+
+	MHD_add_response_header(response, MHD_HTTP_HEADER_ACCEPT_RANGES, "bytes");
+	MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, strETag.c_str());
+	if (http_response_code == MHD_HTTP_PARTIAL_CONTENT)
+	{
+		char szContentRange[128] = {0};
+		snprintf(szContentRange, sizeof(szContentRange), "bytes %llu-%llu/%llu",
+			(unsigned long long)first, (unsigned long long)last, (unsigned long long)size);
+		MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_RANGE, szContentRange);
+	}
+
+	dfs_debug << "download request commit ok! url: " << http_info->url << ", bytes: " << length << "\n";
+	int ret = MHD_queue_response(connection, http_response_code, response);
     MHD_destroy_response(response);
+	if (ret == MHD_YES)
+	{
+		sentBytes.inc(length);
+	}
     return ret;
 }
 
@@ -168,13 +237,18 @@ file_reader (void *cls,
              char *buf,
              size_t max)
 {
-	DfsConnectionInfo *down_con_info = (DfsConnectionInfo*)cls;
-
-    FILE *file = (FILE*)down_con_info->fp;
+	DfsFileRange *range = (DfsFileRange*)cls;
 
-    fseek (file, pos, SEEK_SET);
-    int ret = fread (buf, 1, max, file);
-    dfs_debug << "download, read " << ret << " bytes from file\n";
+    ssize_t ret = pread(range->fd, buf, max, (off_t)(range->offset + pos));
+    if (ret < 0)
+    {
+    	dfs_warn << "download, read file failed, errno: " << errno;
+    	return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    if (ret == 0)
+    {
+    	return MHD_CONTENT_READER_END_OF_STREAM;
+    }
     return ret;
 }
 
@@ -182,18 +256,92 @@ file_reader (void *cls,
 static void
 free_callback (void *cls)
 {
-    DfsConnectionInfo *down_con_info = (DfsConnectionInfo*)cls;
-
-    FILE *file = (FILE*)down_con_info->fp;
-	if (file)
-    {	
-	    fclose (down_con_info->fp);
-		down_con_info->fp = NULL;			
-		dfs_debug << "**** download down and free, url: " << down_con_info->file_id.data();
-		down_con_info->data = NULL;
-		down_con_info->fp_path = "";
-	}
-	
-    dfs_debug << "file read done, fileid: " << down_con_info->file_id.data() << "\n";
+    DfsFileRange *range = (DfsFileRange*)cls;
+
+    close(range->fd);
+    delete range;
+    dfs_debug << "file read done\n";
 }
 
+//a single range "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+//return 1 if satisfiable, -1 if not, 0 if the header is to be ignored (malformed or several ranges)
+static int parse_range (const char *range, uint64_t size, uint64_t &first, uint64_t &last)
+{
+	string strRange = range;
+	if (0 != strRange.find("bytes=") || string::npos != strRange.find(','))
+	{
+		return 0;
+	}
+
+	strRange = strRange.substr(strlen("bytes="));
+	size_t pos = strRange.find('-');
+	if (pos == string::npos)
+	{
+		return 0;
+	}
+
+	string strFirst = strRange.substr(0, pos);
+	string strLast = strRange.substr(pos + 1);
+	if ((strFirst.empty() && strLast.empty())
+		|| string::npos != strFirst.find_first_not_of("0123456789")
+		|| string::npos != strLast.find_first_not_of("0123456789")
+		|| strFirst.size() > 19 || strLast.size() > 19)
+	{
+		return 0;
+	}
+
+	if (strFirst.empty())
+	{
+		uint64_t suffix = strtoull(strLast.c_str(), NULL, 10);
+		if (suffix == 0 || size == 0)
+		{
+			return -1;
+		}
+		first = suffix >= size ? 0 : size - suffix;
+		last = size - 1;
+		return 1;
+	}
+
+	first = strtoull(strFirst.c_str(), NULL, 10);
+	last = strLast.empty() ? size - 1 : strtoull(strLast.c_str(), NULL, 10);
+	if (!strLast.empty() && last < first)
+	{
+		return 0;
+	}
+	if (first >= size)
+	{
+		return -1;
+	}
+	if (last >= size)
+	{
+		last = size - 1;
+	}
+	return 1;
+}
+
+//if-none-match holds "*" or a list of etags, weak ones included
+static bool match_etag (const char *etags, const string &etag)
+{
+	vector<string> vecTags;
+	SplitString(etags, ',', vecTags);
+	for (std::vector<string>::iterator tag = vecTags.begin(); tag != vecTags.end(); ++tag)
+	{
+		size_t begin = tag->find_first_not_of(" \t");
+		size_t end = tag->find_last_not_of(" \t");
+		if (begin == string::npos)
+		{
+			continue;
+		}
+
+		string strTag = tag->substr(begin, end - begin + 1);
+		if (0 == strTag.find("W/"))
+		{
+			strTag = strTag.substr(2);
+		}
+		if (strTag == "*" || strTag == etag)
+		{
+			return true;
+		}
+	}
+	return false;
+}
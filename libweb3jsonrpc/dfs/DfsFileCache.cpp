@@ -0,0 +1,77 @@
+#include "DfsFileCache.h"
+#include "IUrlHandler.h"
+
+
+using namespace dev::rpc::fs;
+
+
+DfsFileCache::DfsFileCache()
+{
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+DfsFileCache::~DfsFileCache()
+{
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+DfsFileCache* DfsFileCache::getInstance()
+{
+	static DfsFileCache sInstance;
+	return &sInstance;
+}
+
+bool DfsFileCache::find(const string& dir, const string& file_id, string& full_file, struct stat& st)
+{
+	string strKey = dir;
+	strKey += "/";
+	strKey += file_id;
+
+	string strCached;
+	pthread_mutex_lock(&m_Mutex);
+	map<string, string>::iterator iter = m_Files.find(strKey);
+	if (iter != m_Files.end())
+	{
+		strCached = iter->second;
+	}
+	pthread_mutex_unlock(&m_Mutex);
+
+	//a renamed or deleted file fails stat, so the cached path is never served stale
+	if (!strCached.empty() && 0 == stat(strCached.c_str(), &st) && S_ISREG(st.st_mode))
+	{
+		full_file = strCached;
+		return true;
+	}
+
+	if (!IUrlHandler::findShortestAsFile(dir, file_id, full_file))
+	{
+		invalidate(dir, file_id);
+		return false;
+	}
+
+	if (0 != stat(full_file.c_str(), &st) || !S_ISREG(st.st_mode))
+	{
+		invalidate(dir, file_id);
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	if (m_Files.size() >= MAX_FILES)
+	{
+		m_Files.clear();
+	}
+	m_Files[strKey] = full_file;
+	pthread_mutex_unlock(&m_Mutex);
+	return true;
+}
+
+void DfsFileCache::invalidate(const string& dir, const string& file_id)
+{
+	string strKey = dir;
+	strKey += "/";
+	strKey += file_id;
+
+	pthread_mutex_lock(&m_Mutex);
+	m_Files.erase(strKey);
+	pthread_mutex_unlock(&m_Mutex);
+}
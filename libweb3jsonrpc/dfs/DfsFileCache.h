@@ -0,0 +1,54 @@
+/**
+* @file DfsFileCache.h
+* @time 2018
+**@desc cache of the stored file path of each file id
+*/
+
+#pragma once
+
+#include <map>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "DfsBase.h"
+
+using std::string;
+using std::map;
+
+
+namespace dev
+{
+
+namespace rpc
+{
+
+namespace fs
+{
+
+class DfsFileCache
+{
+private:
+	DfsFileCache();
+	~DfsFileCache();
+
+public:
+	static DfsFileCache* getInstance();
+
+public:
+	//find the file of file_id in dir as findShortestAsFile does, but scan dir only if
+	//the cached file is gone; st is the stat of the file found
+	bool find(const string& dir, const string& file_id, string& full_file, struct stat& st);
+
+	//forget the file of file_id in dir, call after it is renamed, removed or (re)written
+	void invalidate(const string& dir, const string& file_id);
+
+private:
+	static const size_t			MAX_FILES = 100000;
+
+	pthread_mutex_t				m_Mutex;
+	map<string, string>			m_Files;//<dir/file_id, full file path>
+};
+
+}
+}
+}
@@ -9,7 +9,6 @@
 #include "DfsFileServer.h"
 #include "DfsFileOperationManager.h"
 #include "DfsConst.h"
-#include "DfsDownloadClient.h"
 #include "DfsCommonClient.h"
 #include "DfsFileRecorder.h"
 #include "libethereum/Client.h"
@@ -65,6 +64,7 @@ int DfsFileInfoScanner::init(const vector<string> &containers, void* client)
 	m_InitBlockNum = 0;
 	psClient = (Client*)client;
 
+	m_Downloader.start();
 	startWorking();
 
 	dfs_debug << "DfsFileInfoScanner (file sync module) has been inited !\n";
@@ -139,6 +139,7 @@ bool DfsFileInfoScanner::checkBlockInit()
 
 void DfsFileInfoScanner::stop()
 {
+	m_Downloader.stop();
 	stopWorking();
 }
 
@@ -159,9 +160,7 @@ void DfsFileInfoScanner::doTask()
 		}
 	}
 
-	//execute all the download tasks
-	DfsHttpClient* pClient = new DfsDownloadClient();
-
+	//execute all the download tasks, each file in chunks from all the nodes holding it
 	for(auto &file : m_DownloadFileInfos) 
 	{
 		if (m_SrcNode == file.second.src_node)
@@ -173,34 +172,20 @@ void DfsFileInfoScanner::doTask()
 		if (shouldStop())
 			return;
 
-		JzRequestInfo objReq;
-		objReq.method = JZ_HTTP_METHOD_GET;
-		objReq.host = file.second.host;
-		objReq.port = file.second.port;
-		objReq.module = JZ_MODULE_FS;
-		objReq.container_id = file.second.container;
-		objReq.version = JZ_MODULE_VERSION_V1;
-		objReq.file_id = file.second.id;
-		objReq.filename = file.second.filename;
-		objReq.filehash = file.second.filehash;
-		objReq.user_data = NULL;
-		objReq.curl = NULL;
-
-		dfs_debug << "to down file: " << file.first.c_str() << ", from src_node: " << file.second.src_node.c_str() <<"\n";
-		pClient->init(objReq);
-
-		DfsFileTask objTaskStart = file.second;
+		vector<DfsSource> sources;
+		getSourceNodes(file.second, sources);
+
+		dfs_debug << "to down file: " << file.first.c_str() << ", from src_node: " << file.second.src_node.c_str() << " and " << (int)sources.size() - 1 << " other nodes\n";
 		file.second.operation = DfsFileTask::DOWNLOAD_START;
 		if (0 != DfsFileRecorder::writeRecord(file.second))
 	    {
 	    	dfs_warn << "write down_start file update record failed !!";
 	    }
 
-		pClient->request("");
-		pClient->endRequest();
+		int ret = m_Downloader.download(file.second, sources);
 
 		dfs_debug << "down file done: " << file.first.c_str() << ", from src_node: " << file.second.src_node.c_str() <<"\n";
-		file.second.operation = pClient->getErrorCode() == 0 ? DfsFileTask::DOWNLOAD : DfsFileTask::DOWNLOAD_FAIL;
+		file.second.operation = ret == 0 ? DfsFileTask::DOWNLOAD : DfsFileTask::DOWNLOAD_FAIL;
 		if (0 != DfsFileRecorder::writeRecord(file.second))
 	    {
 	    	dfs_warn << "write down file update record failed !!";
@@ -208,7 +193,6 @@ void DfsFileInfoScanner::doTask()
 	}
 
 	m_DownloadFileInfos.clear();
-	delete pClient;
 
 	//dfs_debug << "**** to fetch info and generateTasks ...";
 	//2. get all file info from contract
@@ -406,39 +390,6 @@ int DfsFileInfoScanner::getLocalFileInfos(map<string, DfsFileInfo>& fileInfos)
 	return 0;
 }
 
-int DfsFileInfoScanner::md5(const string& filepath, string& md5)
-{
-	MD5_CTX ctx;
-	ms_MD5_Init(&ctx);
-
-	char szBuf[4096];
-	int bytes = 0;
-	FILE* fp = fopen(filepath.data(), "rb");
-	if (!fp)
-		return -1;
-
-	md5.clear();
-	while((bytes=fread(szBuf, 1, sizeof(szBuf), fp)) > 0)
-	{
-		ms_MD5_Update(&ctx, szBuf, bytes);
-	}
-	fclose(fp);
-
-	unsigned char szResult[16] = {0};
-    memset(szResult, 0, 16);
-	ms_MD5_Final(szResult, &ctx);
-
-	char szTmp[32];
-	memset(szTmp, 0, sizeof(szTmp));
-	for (size_t i = 0; i < 16; ++i)
-	{
-		snprintf(szTmp, sizeof(szTmp), "%02X", szResult[i]);
-		md5.append(szTmp, strlen(szTmp));
-	}
-
-	return 0;
-}
-
 int DfsFileInfoScanner::processFileinfoInit(map<string, DfsFileInfo>& localFileInfos, \
 	map<string, DfsFileInfo>& fileInfos)
 {
@@ -517,6 +468,44 @@ int DfsFileInfoScanner::generateTasks(map<string, DfsFileInfo>& fileInfos)
 	return 0;
 }
 
+void DfsFileInfoScanner::getSourceNodes(const DfsFileTask& task, vector<DfsSource>& sources)
+{
+	sources.clear();
+	sources.push_back(DfsSource(task.host, task.port));
+
+	string fileSeverJson;
+	if (0 != listServerInfo(fileSeverJson))
+	{
+		dfs_warn << "**** cannot list the file servers, download from the src node only\n";
+		return;
+	}
+
+	Json::Reader reader;
+	Json::Value root;
+	if (fileSeverJson.size() <= 0 || !reader.parse(fileSeverJson, root)
+		|| root["data"].isNull() || !root["data"]["items"].isArray())
+	{
+		dfs_warn << "bad json: " << fileSeverJson.c_str() << " of file servers\n";
+		return;
+	}
+
+	//a node that doesn't hold the file yet fails its chunks and is then asked last
+	Json::Value &items = root["data"]["items"];
+	for (Json::ArrayIndex i = 0; i < items.size(); ++i)
+	{
+		string id = items[i]["id"].asString();
+		if (id == m_SrcNode || id == task.src_node 
+			|| items[i]["group"].asString() != m_GroupId
+			|| items[i]["enable"].asInt() == 0
+			|| items[i]["host"].asString().empty())
+		{
+			continue;
+		}
+
+		sources.push_back(DfsSource(items[i]["host"].asString(), items[i]["port"].asInt()));
+	}
+}
+
 bool DfsFileInfoScanner::validateSourceNode(const string& src_node, string& fileHost, int& filePort)
 {
 	//fetch src node info
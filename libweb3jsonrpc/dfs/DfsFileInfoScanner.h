@@ -5,6 +5,7 @@
 #include <vector>
 #include <pthread.h>
 #include "DfsBase.h"
+#include "DfsChunkDownloader.h"
 #include <libdevcore/Worker.h>
 
 
@@ -64,14 +65,15 @@ private:
 
 	int getLocalFileInfos(map<string, DfsFileInfo>& fileInfos);
 
-	int md5(const string& filepath, string& md5);
-
 	int processFileinfoInit(map<string, DfsFileInfo>& localFileInfos, map<string, DfsFileInfo>& fileInfos);
 
 	int generateTasks(map<string, DfsFileInfo>& fileInfos);
 
 	bool validateSourceNode(const string& src_node, string& fileHost, int& filePort);
 
+	//the src node of the file first, then the other enabled nodes of the group that may hold it
+	void getSourceNodes(const DfsFileTask& task, vector<DfsSource>& sources);
+
 	bool checkBlockInit();
 
 	int queryGroupFileInfo(const std::string& group, vector<string>& result);
@@ -88,6 +90,7 @@ private:
 	pthread_mutex_t									m_Mutex;
 	map<string, DfsFileTask>						m_DownloadFileInfos;
 	map<string, DfsFileInfo>						m_CacheFileInfos;
+	DfsChunkDownloader								m_Downloader;
 	
 	int 											m_InitBlockNum;
 	int 											m_TimeLastCheck;
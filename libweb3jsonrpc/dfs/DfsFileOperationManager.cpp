@@ -2,6 +2,7 @@
 #include "DfsCommon.h"
 #include "DfsFileServer.h"
 #include "DfsConst.h"
+#include "DfsFileCache.h"
 #include "string.h"
 
 
@@ -49,6 +50,7 @@ int DfsFileOperationManager::delFile(const DfsFileInfo& fileinfo, string& delete
 	pthread_mutex_lock(&m_Mutex);
 	//rename the file
 	FileMv(deleteFilePath, strBakFile);
+	DfsFileCache::getInstance()->invalidate(strDir, fileinfo.id);
 	pthread_mutex_unlock(&m_Mutex);
 
 	dfs_debug << "delete file, use rename file " << deleteFilePath.data() << " to " << strBakFile.data() << "\n";
@@ -80,6 +82,7 @@ int DfsFileOperationManager::modifyFile(const DfsFileInfo& fileinfo)
 	pthread_mutex_lock(&m_Mutex);
 	//rename the file
 	FileMv(strFullFileFound, strNewFile);
+	DfsFileCache::getInstance()->invalidate(strDir, fileinfo.id);
 	pthread_mutex_unlock(&m_Mutex);
 
 	return 0;
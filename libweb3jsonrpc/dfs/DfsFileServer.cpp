@@ -21,6 +21,7 @@ DfsFileServer::DfsFileServer()
     m_StoreRootPath = "";
     m_NodeGroup = "";
     m_NodeId = "";
+    m_BlockSize = JZ_DOWNLOAD_BLOCK_SIZE;
     m_Inited = false;
 }
 
@@ -341,6 +342,9 @@ int DfsFileServer::init_storage(const string &store_root)
     m_TempStorePath = store_root;
     m_TempStorePath += "/";
     m_TempStorePath += "temp";
+    m_PartialStorePath = store_root;
+    m_PartialStorePath += "/";
+    m_PartialStorePath += "partial";
 
     if(!ChkDirExists(store_root.c_str()))
     {
@@ -382,6 +386,13 @@ int DfsFileServer::init_storage(const string &store_root)
         }
     }
 
+    //partially replicated files are resumed, not cleaned
+    if (!ChkDirExists(m_PartialStorePath) && !createFileDir(m_PartialStorePath))
+    {
+        LOG(ERROR) << "create partial file store directory: " << m_PartialStorePath.data() << " failed !\n";
+        return -1;
+    }
+
     //calculate the result of "files"
     for (std::vector<string>::const_iterator container = m_Containers.begin(); container != m_Containers.end(); ++container)
     {
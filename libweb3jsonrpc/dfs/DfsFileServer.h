@@ -84,10 +84,12 @@ private:
 public:
 	string 										m_StoreRootPath;
 	string 										m_TempStorePath;
+	string 										m_PartialStorePath;//files being replicated, kept across restarts
 	string 										m_NodeGroup;
 	string 										m_NodeId;
 	DfsFileInfoScanner						m_DfsFileInfoScanner;
 	vector<string>								m_Containers;
+	size_t										m_BlockSize;//read size of downloads not sent with sendfile
 	
 private:
 	map<string, map<string, IUrlHandler*> >		m_HandlerMap;//<version, <method, handler> >	
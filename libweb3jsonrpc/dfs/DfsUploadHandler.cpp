@@ -15,6 +15,7 @@
 #include "DfsJsonUtils.h"
 #include "DfsFileServer.h"
 #include "DfsFileRecorder.h"
+#include "DfsFileCache.h"
 #include "DfsMd5.h"
 
 
@@ -234,6 +235,7 @@ int DfsUploadHandler::handle(DfsHttpInfo *http_info, DfsUrlInfo *url_info)
   }
 
   dfs_debug << "upload file OK ! fileid: " << con_info->file_id << ", hash: " << strHash;
+  DfsFileCache::getInstance()->invalidate(strFileDir, con_info->file_id);
   strjson = DfsJsonUtils::createCommonRsp(MHD_HTTP_OK, 0, "the upload has been completed", strHash);
   return IUrlHandler::send_page(http_info->connection, strjson.data(), MHD_HTTP_OK);
 }
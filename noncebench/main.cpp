@@ -0,0 +1,169 @@
+/*
+	This file is part of FISCO-BCOS.
+
+	FISCO-BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO-BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO-BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * NonceCheck benchmark: rebuilds the replay window from a chain of signed blocks as startup does,
+ * then times ok() on transactions in the window and new ones, from one and from several threads,
+ * and addBlock as each new head comes in.
+ *
+ * usage: noncebench [blocks] [txsPerBlock] [threads]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libdevcore/easylog.h>
+#include <libdevcrypto/Common.h>
+#include <libethereum/NonceCheck.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// Signs @a _count transactions from a few senders with unique randomids.
+vector<bytes> makeBlock(vector<KeyPair> const& _keys, size_t _count, u256& io_randomid)
+{
+	vector<bytes> ret;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		bytes data(4 + 32 * 2, (byte)i);
+		Transaction tx(0, 1, 300000000, Address(i + 1), data, io_randomid++, _keys[i % _keys.size()].secret());
+		ret.push_back(tx.rlp());
+	}
+	return ret;
+}
+
+/// Decodes @a _rlp with the sender recovered, as transactions are by the time the queue checks them.
+Transactions decode(vector<bytes> const& _rlp)
+{
+	Transactions ret;
+	for (auto const& b : _rlp)
+	{
+		ret.push_back(Transaction(b, CheckTransaction::None));
+		ret.back().sender();
+	}
+	return ret;
+}
+
+/// Checks each of @a _txs on @a _threads threads at once and prints the time per check.
+void benchOk(string const& _name, NonceCheck& _nc, Transactions const& _txs, unsigned _threads, bool _expected)
+{
+	atomic<unsigned> waiting{_threads};
+	atomic<size_t> wrong{0};
+	vector<thread> threads;
+	auto start = chrono::steady_clock::now();
+	for (unsigned t = 0; t < _threads; ++t)
+		threads.emplace_back([&]() {
+			--waiting;
+			while (waiting)
+				this_thread::yield();
+			for (auto const& tx : _txs)
+				if (_nc.ok(tx) != _expected)
+					++wrong;
+		});
+	for (auto& t : threads)
+		t.join();
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+	if (wrong)
+	{
+		cerr << _name << ": " << wrong << " checks returned " << !_expected << endl;
+		exit(1);
+	}
+	cout << left << setw(36) << _name << right << setw(4) << _threads << " threads " << setw(10) << fixed << setprecision(1)
+		<< ns / _txs.size() << " ns/check per thread, " << setprecision(0) << _txs.size() * _threads / (ns / 1e9) << " checks/s" << endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	unsigned blocks = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+	size_t txsPerBlock = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100;
+	unsigned threads = argc > 3 ? strtoul(argv[3], nullptr, 10) : 16;
+	if (!blocks || !txsPerBlock)
+	{
+		cerr << "usage: noncebench [blocks] [txsPerBlock] [threads]" << endl;
+		return 1;
+	}
+
+	// updateCache logs at TRACE
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	NonceCheck::maxblocksize = blocks;
+	vector<KeyPair> keys;
+	for (unsigned i = 0; i < 16; ++i)
+		keys.push_back(KeyPair::create());
+
+	// blocks 1 to blocks fill the window, the next ones are the new heads
+	cout << blocks << " blocks of " << txsPerBlock << " transactions in the window" << endl;
+	u256 randomid = 1;
+	vector<vector<bytes>> chain(1);
+	for (unsigned i = 1; i <= blocks + 100; ++i)
+		chain.push_back(makeBlock(keys, txsPerBlock, randomid));
+	auto transactions = [&](unsigned _number) { return chain[_number]; };
+
+	NonceCheck nc;
+	auto start = chrono::steady_clock::now();
+	nc.updateCache(blocks, transactions, true);
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << fixed << setprecision(1) << "rebuild of " << blocks << " blocks: " << ms << " ms, "
+		<< setprecision(3) << ms / blocks << " ms/block, " << setprecision(0) << blocks * txsPerBlock / (ms / 1000) << " tx/s" << endl;
+
+	Transactions known;
+	for (unsigned i = 1; i <= blocks && known.size() < 100000; i += max(1u, blocks / 100))
+	{
+		Transactions block = decode(chain[i]);
+		known.insert(known.end(), block.begin(), block.end());
+	}
+	Transactions fresh = decode(makeBlock(keys, known.size(), randomid));
+
+	benchOk("ok() on transactions in the window", nc, known, 1, false);
+	benchOk("ok() on transactions in the window", nc, known, threads, false);
+	benchOk("ok() on new transactions", nc, fresh, 1, true);
+	benchOk("ok() on new transactions", nc, fresh, threads, true);
+
+	// new heads, each expiring the oldest block
+	vector<Transactions> heads;
+	for (unsigned i = blocks + 1; i < chain.size(); ++i)
+		heads.push_back(decode(chain[i]));
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < heads.size(); ++i)
+		nc.addBlock(blocks + 1 + i, heads[i]);
+	ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << setprecision(3) << "addBlock: " << ms / heads.size() << " ms/block" << endl;
+	return 0;
+}
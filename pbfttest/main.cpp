@@ -0,0 +1,308 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Compact prepare propagation test. A leader and five followers run the compact prepare
+ * handlers of PBFT over an in-process loopback that frames every packet the way PBFTPeer
+ * sends it. The followers hold different parts of the block's transactions in their queues:
+ * all of them, some, none, or get the prepare relayed, or get a corrupted transaction reply and
+ * have to fall back to the full prepare. Every follower must end up with the leader's block,
+ * byte for byte, having fetched exactly what it was missing. Exits with 1 on any failure.
+ *
+ * usage: pbfttest [txsPerBlock]
+ */
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <libdevcore/easylog.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libpbftseal/Common.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+unsigned g_failures = 0;
+
+void check(bool _ok, string const& _what)
+{
+	if (!_ok)
+	{
+		++g_failures;
+		cerr << "FAILED: " << _what << endl;
+	}
+}
+
+struct Packet
+{
+	unsigned from;
+	unsigned to;
+	unsigned id;
+	bytes data;
+};
+
+struct Node
+{
+	unsigned idx = 0;
+	map<h256, bytes> queue;			// the transaction queue, by hash
+	PrepareReq raw_prepare;			// the leader's raw prepare cache
+	CompactPrepareCollector compact;
+	unsigned compact_from = 0;
+	vector<unsigned> relay_to;		// peers it relays a compact prepare to
+
+	bool prepared = false;
+	PrepareReq prepare;				// what reached handlePrepareMsg
+	size_t asked_txs = 0;
+	unsigned asked_full = 0;
+};
+
+/// Delivers packets between nodes in order, framed as PBFTPeer::prep(ts, id, 1).append(data).
+class Loopback
+{
+public:
+	void send(unsigned _from, unsigned _to, unsigned _id, bytes const& _data)
+	{
+		RLPStream ts;
+		ts.appendList(1).append(_data);
+		m_packets.push_back(Packet{_from, _to, _id, ts.out()});
+		++m_sent[_id];
+	}
+
+	bool next(Packet& _p)
+	{
+		if (m_packets.empty())
+			return false;
+		_p = m_packets.front();
+		m_packets.pop_front();
+		return true;
+	}
+
+	unsigned sent(unsigned _id) const { auto it = m_sent.find(_id); return it == m_sent.end() ? 0 : it->second; }
+
+	/// Flips the last byte of every PrepareTxsPacket to @a _node: the last transaction no longer hashes right.
+	set<unsigned> corrupt;
+
+private:
+	deque<Packet> m_packets;
+	map<unsigned, unsigned> m_sent;
+};
+
+bytes body(PBFTMsg const& _msg)
+{
+	RLPStream ts;
+	_msg.streamRLPFields(ts);
+	return ts.out();
+}
+
+/// The compact prepare branches of PBFT::handleMsg, minus signatures and view checks.
+void handle(vector<Node>& _nodes, Loopback& _net, Packet const& _p)
+{
+	Node& n = _nodes[_p.to];
+	bytes data = RLP(_p.data)[0].data().toBytes();
+	if (_p.id == PrepareTxsPacket && _net.corrupt.count(_p.to))
+		data.back() ^= 1;
+	RLP r(data);
+
+	switch (_p.id)
+	{
+	case CompactPrepareReqPacket:
+	{
+		CompactPrepareReq req;
+		req.populate(r);
+		if (n.prepared || n.compact.req().block_hash == req.block_hash)
+			return;
+		for (auto to: n.relay_to)
+			_net.send(n.idx, to, CompactPrepareReqPacket, body(req));
+
+		vector<bytes> txs;
+		for (auto const& h: req.tx_hashes)
+			txs.push_back(n.queue.count(h) ? n.queue[h] : bytes());
+		n.compact_from = _p.from;
+		vector<size_t> missing = n.compact.reset(req, txs);
+		if (missing.empty())
+		{
+			n.prepare = n.compact.complete();
+			n.prepared = true;
+		}
+		else
+		{
+			n.asked_txs += missing.size();
+			_net.send(n.idx, (unsigned)req.idx, GetPrepareTxsPacket, getPrepareTxsRLP(req.block_hash, missing));
+		}
+		break;
+	}
+	case GetPrepareTxsPacket:
+	{
+		if (r[0].toHash<h256>(RLP::VeryStrict) != n.raw_prepare.block_hash)
+			return;
+		if (r[1].itemCount() == 0)
+			_net.send(n.idx, _p.from, PrepareReqPacket, body(n.raw_prepare));
+		else
+			_net.send(n.idx, _p.from, PrepareTxsPacket, prepareTxsRLP(n.raw_prepare, r));
+		break;
+	}
+	case PrepareTxsPacket:
+	{
+		if (!n.compact.fill(r))
+			return;
+		if (n.compact.missing() == 0)
+		{
+			n.prepare = n.compact.complete();
+			n.prepared = true;
+		}
+		else
+		{
+			++n.asked_full;
+			_net.send(n.idx, (unsigned)n.compact.req().idx, GetPrepareTxsPacket, getPrepareTxsRLP(n.compact.req().block_hash, vector<size_t>()));
+		}
+		break;
+	}
+	case PrepareReqPacket:
+	{
+		PrepareReq req;
+		req.populate(r);
+		if (req.block_hash == n.compact.req().block_hash)
+			n.compact.clear();
+		n.prepare = req;
+		n.prepared = true;
+		break;
+	}
+	}
+}
+
+/// Transactions shaped like signed ones: nonce, gas price, gas, to, value, data, v, r, s.
+vector<bytes> makeTransactions(size_t _count)
+{
+	vector<bytes> ret;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		RLPStream s;
+		s.appendList(9) << u256(i) << u256(1) << u256(300000000) << h160(sha3(toString(i)))
+			<< u256(i) << bytes(36 + i % 64, (byte)i) << byte(27) << u256(sha3("r" + toString(i))) << u256(sha3("s" + toString(i)));
+		ret.push_back(s.out());
+	}
+	return ret;
+}
+
+/// A block as Block::sealBlock writes it: header, transactions, uncles, hash and signatures.
+bytes makeBlock(vector<bytes> const& _txs)
+{
+	RLPStream s;
+	s.appendList(5);
+	s.appendList(3) << sha3("parent") << u256(42) << u256(1514764800000);
+	s.appendList(_txs.size());
+	for (auto const& tx: _txs)
+		s.appendRaw(tx);
+	s.appendRaw(RLPEmptyList);
+	s << sha3("block");
+	s.appendList(1).appendList(2) << u256(0) << h520(sha3("sig").asBytes() + sha3("sig2").asBytes() + bytes(1, 1));
+	return s.out();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	size_t txsPerBlock = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	vector<bytes> txs = makeTransactions(txsPerBlock);
+	PrepareReq prepare;
+	prepare.height = 42;
+	prepare.view = 3;
+	prepare.idx = 0;
+	prepare.timestamp = 1514764800000;
+	prepare.block = makeBlock(txs);
+	prepare.block_hash = sha3("header");
+	prepare.sig = Signature(sha3("sig").asBytes() + sha3("sig2").asBytes() + bytes(1, 1));
+	prepare.sig2 = Signature(sha3("sig3").asBytes() + sha3("sig4").asBytes() + bytes(1, 0));
+
+	// 0 leader, 1 has every tx, 2 lacks every third, 3 has none, 4 hears of it from 1 and lacks
+	// the first ten, 5 lacks five and gets a corrupted reply
+	vector<Node> nodes(6);
+	for (unsigned i = 0; i < nodes.size(); ++i)
+		nodes[i].idx = i;
+	nodes[0].raw_prepare = prepare;
+	nodes[1].relay_to = {4};
+	set<size_t> missing[6];
+	for (size_t i = 0; i < txs.size(); ++i)
+	{
+		if (i % 3 == 0)
+			missing[2].insert(i);
+		missing[3].insert(i);
+		if (i < 10)
+			missing[4].insert(i);
+		if (i >= txs.size() - 5)
+			missing[5].insert(i);
+	}
+	for (unsigned n = 0; n < nodes.size(); ++n)
+		for (size_t i = 0; i < txs.size(); ++i)
+			if (!missing[n].count(i))
+				nodes[n].queue[sha3(txs[i])] = txs[i];
+
+	Loopback net;
+	net.corrupt.insert(5);
+	CompactPrepareReq compact(prepare);
+	for (unsigned to: {1, 2, 3, 5})
+		net.send(0, to, CompactPrepareReqPacket, body(compact));
+	Packet p;
+	while (net.next(p))
+		handle(nodes, net, p);
+
+	bytes full = body(prepare);
+	cout << txs.size() << " transactions, block " << prepare.block.size() << " bytes, compact prepare " << body(compact).size() << " bytes" << endl;
+	for (unsigned n = 1; n < nodes.size(); ++n)
+	{
+		Node const& node = nodes[n];
+		string name = "node " + toString(n);
+		check(node.prepared, name + " got no prepare");
+		check(node.prepare.block == prepare.block, name + " rebuilt a different block");
+		check(body(node.prepare) == full, name + " rebuilt a different prepare");
+		check(node.asked_txs == missing[n].size(), name + " asked for " + toString(node.asked_txs) + " txs, missing " + toString(missing[n].size()));
+		check(node.compact.missing() == 0, name + " still collecting");
+		cout << name << ": missing " << missing[n].size() << ", fetched " << node.asked_txs << (node.asked_full ? ", fell back to the full prepare" : "") << endl;
+	}
+	check(nodes[4].compact_from == 1, "node 4 did not get the prepare relayed");
+	check(nodes[5].asked_full == 1, "node 5 did not fall back to the full prepare");
+	check(net.sent(GetPrepareTxsPacket) == 5, "expected 4 transaction fetches and 1 full prepare fetch");
+	check(net.sent(PrepareReqPacket) == 1, "expected the full prepare to be sent once");
+
+	cout << (g_failures ? "FAILED" : "OK") << endl;
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * RateLimiter benchmark: RPC threads check calls of 4 methods from 8 client IPs against one
+ * limiter, on one thread and on all of them at once, and print the checks per second.
+ *
+ * usage: ratelimitbench [threads] [checksPerThread]
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libdevcore/easylog.h>
+#include <libstatistics/RateLimiter.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Limits no check reaches, so every one of them goes through all three buckets.
+const char* c_open = R"({
+	"globalLimit": {"enable": true, "defaultLimit": 1000000000},
+	"ipLimit": {"enable": true, "defaultLimit": 1000000000},
+	"interfaceLimit": {"enable": true, "defaultLimit": 1000000000, "custom": {}}
+})";
+
+/// Limits that refuse most checks, at the interface, ip or global bucket.
+const char* c_tight = R"({
+	"globalLimit": {"enable": true, "defaultLimit": 20000},
+	"ipLimit": {"enable": true, "defaultLimit": 5000},
+	"interfaceLimit": {"enable": true, "defaultLimit": 1000, "custom": {"eth_sendRawTransaction": 200}}
+})";
+
+vector<string> const c_methods = { "eth_sendRawTransaction", "eth_call", "eth_getTransactionReceipt", "eth_blockNumber" };
+
+/// Runs @a _checks checks on each of @a _threads threads and prints the checks per second.
+void bench(string const& _name, string const& _config, unsigned _threads, size_t _checks)
+{
+	RateLimiter limiter(_config);
+	limiter.registerInterfaces(c_methods);
+
+	vector<uint32_t> ips;
+	for (unsigned i = 0; i < 8; ++i)
+		ips.push_back(htonl(0x0a000001 + i));
+
+	atomic<size_t> permitted{0};
+	atomic<unsigned> waiting{_threads};
+	vector<thread> threads;
+	auto start = chrono::steady_clock::now();
+	for (unsigned t = 0; t < _threads; ++t)
+		threads.emplace_back([&, t]() {
+			// start together, so the threads contend for the whole run
+			--waiting;
+			while (waiting)
+				this_thread::yield();
+			size_t ok = 0;
+			for (size_t i = 0; i < _checks; ++i)
+				ok += limiter.isPermitted(ips[(i + t) % ips.size()], c_methods[(i / ips.size() + t) % c_methods.size()]);
+			permitted += ok;
+		});
+	for (auto& t : threads)
+		t.join();
+	double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	size_t total = _checks * _threads;
+	cout << left << setw(24) << _name << right << setw(4) << _threads << " threads "
+		<< setw(12) << fixed << setprecision(0) << total / s << " checks/s "
+		<< setw(8) << setprecision(1) << s * 1e9 / _checks << " ns/check per thread, "
+		<< setprecision(1) << 100.0 * permitted / total << "% permitted" << endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	unsigned threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+	size_t checks = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	cout << checks << " checks per thread, " << thread::hardware_concurrency() << " CPUs" << endl;
+	bench("open limits", c_open, 1, checks);
+	bench("open limits", c_open, threads, checks);
+	bench("tight limits", c_tight, 1, checks);
+	bench("tight limits", c_tight, threads, checks);
+	return 0;
+}
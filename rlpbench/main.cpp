@@ -0,0 +1,362 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * RLP microbenchmark: encodes and decodes transactions, blocks, PBFT prepare requests and trie
+ * nodes the way the node does, and prints the time per operation of each case.
+ *
+ * usage: rlpbench [txsPerBlock] [rounds]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <libdevcore/easylog.h>
+#include <libdevcore/MemoryDB.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieDB.h>
+#include <libdevcore/TrieHash.h>
+#include <libdevcrypto/Common.h>
+#include <libethcore/BlockHeader.h>
+#include <libethcore/Transaction.h>
+#include <libpbftseal/Common.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// Keeps the optimiser from dropping a result.
+size_t g_sink = 0;
+
+/// Runs @a _f @a _rounds times, each handling @a _items items, and prints the time per item.
+template <class F> void bench(string const& _name, unsigned _rounds, size_t _items, F _f)
+{
+	_f();	// warm up
+	auto start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < _rounds; ++i)
+		_f();
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+	cout << left << setw(44) << _name << right << setw(12) << fixed << setprecision(1) << ns / _rounds / _items << " ns/item" << endl;
+}
+
+vector<bytes> makeTransactions(size_t _count)
+{
+	KeyPair key = KeyPair::create();
+	vector<bytes> ret;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		// a typical contract call: a few hundred bytes of calldata
+		bytes data(4 + 32 * (i % 8 + 1));
+		for (size_t j = 0; j < data.size(); ++j)
+			data[j] = (byte)(i + j);
+		TransactionBase tx(0, 1, 300000000, Address(i + 1), data, u256(i) << 64, key.secret());
+		ret.push_back(tx.rlp());
+	}
+	return ret;
+}
+
+/// Transactions whose calldata is a JSON object, as old-style CNS calls send it.
+vector<bytes> makeJsonTransactions(size_t _count)
+{
+	KeyPair key = KeyPair::create();
+	vector<bytes> ret;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		string json = "{\"contract\":\"HelloWorld\",\"version\":\"\",\"func\":\"set\",\"params\":[\"" + toString(i) + "\"]}";
+		TransactionBase tx(0, 1, 300000000, Address(i + 1), asBytes(json), u256(i) << 64, key.secret());
+		ret.push_back(tx.rlp());
+	}
+	return ret;
+}
+
+bytes makeHeader(size_t _number)
+{
+	BlockHeader h;
+	h.setParentHash(sha3(toString(_number)));
+	h.setRoots(sha3("txs"), sha3("receipts"), EmptyListSHA3, sha3("state"));
+	h.setNumber(_number);
+	h.setGasLimit(2000000000);
+	h.setGasUsed(1000000);
+	h.setTimestamp(1514764800000 + _number);
+	h.setIndex(1);
+	h.setNodeList(h512s(4, h512(sha3("node").asBytes() + sha3("id").asBytes())));
+	RLPStream s;
+	h.streamRLP(s);
+	return s.out();
+}
+
+/// A block as Block::sealBlock writes it: header, transactions, uncles, hash and signatures.
+bytes makeBlock(bytes const& _header, vector<bytes> const& _txs)
+{
+	RLPStream s;
+	s.appendList(5);
+	s.appendRaw(_header);
+	s.appendList(_txs.size());
+	for (auto const& t: _txs)
+		s.appendRaw(t);
+	s.appendList(0);
+	s << sha3(_header);
+	s.appendList(0);
+	return s.out();
+}
+
+PrepareReq makePrepare(bytes const& _block)
+{
+	PrepareReq req;
+	req.height = 1;
+	req.view = 0;
+	req.idx = 1;
+	req.timestamp = 1514764800000;
+	req.block_hash = sha3(_block);
+	req.block = _block;
+	return req;
+}
+
+template <class M> bytes encodeMsg(M const& _m, size_t _fields)
+{
+	RLPStream s;
+	s.appendList(_fields);
+	_m.streamRLPFields(s);
+	return s.out();
+}
+
+void benchTransactions(vector<bytes> const& _txs, unsigned _rounds)
+{
+	vector<bytes> jsonTxs = makeJsonTransactions(_txs.size());
+	bench("tx: decode, no signature check", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+			g_sink += TransactionBase(&t, CheckTransaction::None).data().size();
+	});
+	bench("tx: decode JSON calldata, no signature check", _rounds, _txs.size(), [&]() {
+		for (auto const& t: jsonTxs)
+			g_sink += TransactionBase(&t, CheckTransaction::None).data().size();
+	});
+	bench("tx: decode and recover sender", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+			g_sink += TransactionBase(&t, CheckTransaction::Everything).sender()[0];
+	});
+	bench("tx: fields by RLP::operator[], backwards", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+		{
+			RLP r(t);
+			for (size_t i = r.itemCount(); i-- > 0;)
+				g_sink += r[i].size();
+		}
+	});
+	bench("tx: fields by RLPView, backwards", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+		{
+			RLPView r{RLP(t)};
+			for (size_t i = r.size(); i-- > 0;)
+				g_sink += r[i].size();
+		}
+	});
+	bench("tx: encode, appendList(n)", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+		{
+			RLPStream s;
+			s.appendList(RLP(t).itemCount());
+			for (auto const& f: RLP(t))
+				s.appendRaw(f.data());
+			g_sink += s.out().size();
+		}
+	});
+	bench("tx: encode, appendList(n, size)", _rounds, _txs.size(), [&]() {
+		for (auto const& t: _txs)
+		{
+			RLP r(t);
+			RLPStream s;
+			s.reserve(t.size());
+			s.appendList(r.itemCount(), r.payload().size());
+			for (auto const& f: r)
+				s.appendRaw(f.data());
+			g_sink += s.out().size();
+		}
+	});
+}
+
+void benchBlocks(vector<bytes> const& _txs, unsigned _rounds)
+{
+	bytes header = makeHeader(1);
+	bytes block = makeBlock(header, _txs);
+
+	bench("block: header populate", _rounds, 1, [&]() {
+		BlockHeader h(block, BlockData);
+		g_sink += (size_t)h.number();
+	});
+	bench("block: txs by blockRLP[1][i] (per tx)", _rounds, _txs.size(), [&]() {
+		RLP r(block);
+		for (size_t i = 0; i < r[1].itemCount(); ++i)
+			g_sink += r[1][i].data().size();
+	});
+	bench("block: txs by iteration (per tx)", _rounds, _txs.size(), [&]() {
+		RLP r(block);
+		for (auto const& t: r[1])
+			g_sink += t.data().size();
+	});
+	bench("block: txs root over RLPView (per tx)", _rounds, _txs.size(), [&]() {
+		RLPView txs{RLP(block)[1]};
+		g_sink += (size_t)trieRootOver(txs.size(), [&](unsigned i) { return rlp(i); }, [&](unsigned i) { return txs[i].data().toBytes(); })[0];
+	});
+	bench("block: encode, appendList(n) (per tx)", _rounds, _txs.size(), [&]() {
+		g_sink += makeBlock(header, _txs).size();
+	});
+	bench("block: encode, appendList(n, size) (per tx)", _rounds, _txs.size(), [&]() {
+		size_t txsSize = 0;
+		for (auto const& t: _txs)
+			txsSize += t.size();
+		RLPStream txs;
+		txs.reserve(txsSize + 9);
+		txs.appendList(_txs.size(), txsSize);
+		for (auto const& t: _txs)
+			txs.appendRaw(t);
+		size_t blockSize = header.size() + txs.out().size() + 36;
+		RLPStream s;
+		s.reserve(blockSize + 9);
+		s.appendList(5, blockSize);
+		s.appendRaw(header);
+		s.appendRaw(txs.out());
+		s.appendList(0);
+		s << sha3(header);
+		s.appendList(0);
+		g_sink += s.out().size();
+	});
+}
+
+void benchPBFT(vector<bytes> const& _txs, unsigned _rounds)
+{
+	bytes block = makeBlock(makeHeader(1), _txs);
+	PrepareReq req = makePrepare(block);
+	bytes prepare = encodeMsg(req, 8);
+	CompactPrepareReq compact(req);
+	bytes compactRLP = encodeMsg(compact, 10);
+
+	bench("pbft: prepare populate", _rounds, 1, [&]() {
+		PrepareReq r;
+		r.populate(RLP(prepare));
+		g_sink += r.block.size();
+	});
+	bench("pbft: compact prepare populate", _rounds, 1, [&]() {
+		CompactPrepareReq r;
+		r.populate(RLP(compactRLP));
+		g_sink += r.tx_hashes.size();
+	});
+	bench("pbft: compact from prepare (per tx)", _rounds, _txs.size(), [&]() {
+		CompactPrepareReq c(req);
+		g_sink += c.tail.size();
+	});
+	bench("pbft: prepare from compact (per tx)", _rounds, _txs.size(), [&]() {
+		g_sink += compact.toPrepareReq(_txs).block.size();
+	});
+}
+
+void benchTrie(size_t _items, unsigned _rounds)
+{
+	vector<pair<bytes, bytes>> kv;
+	for (size_t i = 0; i < _items; ++i)
+		kv.emplace_back(sha3(toString(i)).asBytes(), rlp(u256(i) * 1000000007));
+
+	MemoryDB db;
+	GenericTrieDB<MemoryDB> trie(&db);
+	trie.init();
+	bench("trie: insert", _rounds, _items, [&]() {
+		MemoryDB d;
+		GenericTrieDB<MemoryDB> t(&d);
+		t.init();
+		for (auto const& i: kv)
+			t.insert(&i.first, &i.second);
+		g_sink += t.root()[0];
+	});
+	for (auto const& i: kv)
+		trie.insert(&i.first, &i.second);
+	bench("trie: lookup", _rounds, _items, [&]() {
+		for (auto const& i: kv)
+			g_sink += trie.at(&i.first).size();
+	});
+	bench("trie: insert then remove", _rounds, _items, [&]() {
+		MemoryDB d;
+		GenericTrieDB<MemoryDB> t(&d);
+		t.init();
+		for (auto const& i: kv)
+			t.insert(&i.first, &i.second);
+		for (auto const& i: kv)
+			t.remove(&i.first);
+		g_sink += t.root()[0];
+	});
+
+	// the branch nodes of the trie, read child by child as lookups and deletes do
+	vector<bytes> branches;
+	for (auto const& i: db.get())
+		if (RLP(i.second).itemCount() == 17)
+			branches.push_back(bytes(i.second.begin(), i.second.end()));
+	bench("trie node: children by RLP::operator[]", _rounds, branches.size() ? branches.size() : 1, [&]() {
+		for (auto const& b: branches)
+		{
+			RLP r(b);
+			g_sink += r[16].size();
+			for (unsigned i = 0; i < 16; ++i)
+				g_sink += r[i].isEmpty();
+		}
+	});
+	bench("trie node: children by RLPView", _rounds, branches.size() ? branches.size() : 1, [&]() {
+		for (auto const& b: branches)
+		{
+			RLPView r{RLP(b)};
+			g_sink += r[16].size();
+			for (unsigned i = 0; i < 16; ++i)
+				g_sink += r[i].isEmpty();
+		}
+	});
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	size_t txsPerBlock = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+	unsigned rounds = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+
+	// the trie and block code log at TRACE
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	cout << txsPerBlock << " transactions per block, " << rounds << " rounds" << endl;
+	vector<bytes> txs = makeTransactions(txsPerBlock);
+	benchTransactions(txs, rounds);
+	benchBlocks(txs, rounds);
+	benchPBFT(txs, rounds);
+	benchTrie(txsPerBlock, rounds);
+	return g_sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+pragma solidity ^0.4.2;
+
+contract AbiBench {
+    function transfer(address to, uint256 value) public constant returns (bool) {
+        return to != address(0) && value > 0;
+    }
+
+    function setName(string name, uint256 id) public constant returns (uint256) {
+        return bytes(name).length + id;
+    }
+
+    function sum(uint256[] values, bytes32 tag) public constant returns (uint256) {
+        uint256 s = uint256(tag);
+        for (uint256 i = 0; i < values.length; ++i) {
+            s += values[i];
+        }
+        return s;
+    }
+}
@@ -0,0 +1,14 @@
+pragma solidity ^0.4.2;
+
+contract LogBench {
+    event Bench(address indexed sender, uint indexed seq, uint indexed group, uint value);
+
+    uint seq;
+
+    function emitLogs(uint n, uint groups) public {
+        for (uint i = 0; i < n; ++i) {
+            Bench(msg.sender, seq, seq % groups, i);
+            ++seq;
+        }
+    }
+}
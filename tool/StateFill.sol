@@ -0,0 +1,13 @@
+pragma solidity ^0.4.2;
+
+contract StateFill {
+    mapping(uint => uint) public slots;
+    uint public filled;
+
+    function fill(uint n) public {
+        for (uint i = 0; i < n; ++i) {
+            slots[filled] = uint(sha3(filled)) | 1;
+            ++filled;
+        }
+    }
+}
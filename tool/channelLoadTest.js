@@ -0,0 +1,154 @@
+/**
+ * @file: channelLoadTest.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Measure submitted transactions per second through a channel (AMOP) connection.
+ * Signed eth_sendRawTransaction calls are sent as JSON-RPC batch arrays, with
+ * several batches in flight at once.
+ *
+ * usage: babel-node channelLoadTest.js <host> <channelPort> <certDir> <contractAddress> [total] [batchSize] [inflight]
+ *   certDir holds ca.crt, client.crt and client.key
+ */
+
+var tls = require('tls');
+var fs = require('fs');
+var crypto = require('crypto');
+var config = require('../web3lib/config');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var HEADER_LENGTH = 42;
+var TYPE_ETHEREUM = 0x12;
+
+var args = process.argv.slice(2);
+if (args.length < 4) {
+	console.log('usage: babel-node channelLoadTest.js <host> <channelPort> <certDir> <contractAddress> [total] [batchSize] [inflight]');
+	process.exit(1);
+}
+
+var host = args[0];
+var port = parseInt(args[1]);
+var certDir = args[2];
+var to = args[3];
+var total = parseInt(args[4] || '10000');
+var batchSize = parseInt(args[5] || '100');
+var inflight = parseInt(args[6] || '8');
+
+function newSeq() {
+	return crypto.randomBytes(16).toString('hex');
+}
+
+function encode(type, seq, data) {
+	var body = Buffer.from(data);
+	var buffer = Buffer.alloc(HEADER_LENGTH + body.length);
+	buffer.writeUInt32BE(HEADER_LENGTH + body.length, 0);
+	buffer.writeUInt16BE(type, 4);
+	buffer.write(seq, 6, 32, 'ascii');
+	buffer.writeInt32BE(0, 38);
+	body.copy(buffer, HEADER_LENGTH);
+	return buffer;
+}
+
+var socket = tls.connect({
+	host: host,
+	port: port,
+	ca: fs.readFileSync(certDir + '/ca.crt'),
+	cert: fs.readFileSync(certDir + '/client.crt'),
+	key: fs.readFileSync(certDir + '/client.key'),
+	rejectUnauthorized: false
+});
+
+var pending = {};
+var received = Buffer.alloc(0);
+
+socket.on('data', function(chunk) {
+	received = Buffer.concat([received, chunk]);
+	while (received.length >= HEADER_LENGTH) {
+		var length = received.readUInt32BE(0);
+		if (received.length < length)
+			break;
+
+		var type = received.readUInt16BE(4);
+		var seq = received.toString('ascii', 6, 38);
+		var data = received.toString('utf8', HEADER_LENGTH, length);
+		received = received.slice(length);
+
+		if (type == TYPE_ETHEREUM && pending[seq]) {
+			var resolve = pending[seq];
+			delete pending[seq];
+			resolve(JSON.parse(data));
+		}
+	}
+});
+
+function request(body) {
+	var seq = newSeq();
+	return new Promise((resolve, reject) => {
+		pending[seq] = resolve;
+		socket.write(encode(TYPE_ETHEREUM, seq, JSON.stringify(body)));
+	});
+}
+
+async function blockNumber() {
+	var resp = await request({jsonrpc: '2.0', method: 'eth_blockNumber', params: [], id: 1});
+	return parseInt(resp.result, 16);
+}
+
+function signedTransactions(count, blockLimit) {
+	var txs = [];
+	var data = coder.codeTxData('trans(uint256)', ['uint256'], [1]);
+	for (var i = 0; i < count; ++i) {
+		txs.push(web3sync.signTransaction({
+			data: data,
+			from: config.account,
+			to: to,
+			gas: 1000000,
+			randomid: Math.ceil(Math.random() * 100000000000),
+			blockLimit: blockLimit
+		}, config.privKey, null));
+	}
+	return txs;
+}
+
+(async function() {
+	await new Promise((resolve) => socket.once('secureConnect', resolve));
+
+	var limit = await blockNumber() + 1000;
+	console.log('signing ' + total + ' transactions');
+	var txs = signedTransactions(total, limit);
+
+	var batches = [];
+	for (var i = 0; i < txs.length; i += batchSize) {
+		batches.push(txs.slice(i, i + batchSize).map((tx, k) => {
+			return {jsonrpc: '2.0', method: 'eth_sendRawTransaction', params: [tx], id: i + k};
+		}));
+	}
+
+	var ok = 0;
+	var failed = 0;
+	var next = 0;
+	var start = Date.now();
+
+	async function worker() {
+		while (next < batches.length) {
+			var resp = await request(batches[next++]);
+			for (var r of (Array.isArray(resp) ? resp : [resp])) {
+				if (r.error)
+					++failed;
+				else
+					++ok;
+			}
+		}
+	}
+
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+
+	var seconds = (Date.now() - start) / 1000;
+	console.log('submitted ' + ok + ' ok, ' + failed + ' failed in ' + seconds + 's: ' + Math.round((ok + failed) / seconds) + ' tx/s');
+	socket.end();
+})();
@@ -0,0 +1,173 @@
+/**
+ * @file: channelSubscribeTest.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Measure how long transactions take from submission to their receipt being pushed over a
+ * channel (AMOP) connection, using receipt subscriptions instead of polling
+ * eth_getTransactionReceipt. New block headers are subscribed too and counted.
+ *
+ * usage: babel-node channelSubscribeTest.js <host> <channelPort> <certDir> <contractAddress> [total] [inflight]
+ *   certDir holds ca.crt, client.crt and client.key
+ */
+
+var tls = require('tls');
+var fs = require('fs');
+var crypto = require('crypto');
+var config = require('../web3lib/config');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+var sha3 = require('../web3lib/utils').sha3;
+
+var HEADER_LENGTH = 42;
+var TYPE_ETHEREUM = 0x12;
+var TYPE_SUBSCRIBE = 0x40;
+var TYPE_PUSH = 0x41;
+
+var args = process.argv.slice(2);
+if (args.length < 4) {
+	console.log('usage: babel-node channelSubscribeTest.js <host> <channelPort> <certDir> <contractAddress> [total] [inflight]');
+	process.exit(1);
+}
+
+var host = args[0];
+var port = parseInt(args[1]);
+var certDir = args[2];
+var to = args[3];
+var total = parseInt(args[4] || '1000');
+var inflight = parseInt(args[5] || '50');
+
+function newSeq() {
+	return crypto.randomBytes(16).toString('hex');
+}
+
+function encode(type, seq, data) {
+	var body = Buffer.from(data);
+	var buffer = Buffer.alloc(HEADER_LENGTH + body.length);
+	buffer.writeUInt32BE(HEADER_LENGTH + body.length, 0);
+	buffer.writeUInt16BE(type, 4);
+	buffer.write(seq, 6, 32, 'ascii');
+	buffer.writeInt32BE(0, 38);
+	body.copy(buffer, HEADER_LENGTH);
+	return buffer;
+}
+
+var socket = tls.connect({
+	host: host,
+	port: port,
+	ca: fs.readFileSync(certDir + '/ca.crt'),
+	cert: fs.readFileSync(certDir + '/client.crt'),
+	key: fs.readFileSync(certDir + '/client.key'),
+	rejectUnauthorized: false
+});
+
+var pending = {};
+var subscriptions = {};
+var received = Buffer.alloc(0);
+var heads = 0;
+var dropped = 0;
+
+socket.on('data', function(chunk) {
+	received = Buffer.concat([received, chunk]);
+	while (received.length >= HEADER_LENGTH) {
+		var length = received.readUInt32BE(0);
+		if (received.length < length)
+			break;
+
+		var type = received.readUInt16BE(4);
+		var seq = received.toString('ascii', 6, 38);
+		var data = received.toString('utf8', HEADER_LENGTH, length);
+		received = received.slice(length);
+
+		if (type == TYPE_PUSH) {
+			var event = JSON.parse(data);
+			dropped += event.dropped || 0;
+			if (subscriptions[event.subscription])
+				subscriptions[event.subscription](event.result);
+		}
+		else if ((type == TYPE_ETHEREUM || type == TYPE_SUBSCRIBE) && pending[seq]) {
+			var resolve = pending[seq];
+			delete pending[seq];
+			resolve(JSON.parse(data));
+		}
+	}
+});
+
+function request(type, body) {
+	var seq = newSeq();
+	return new Promise((resolve, reject) => {
+		pending[seq] = resolve;
+		socket.write(encode(type, seq, JSON.stringify(body)));
+	});
+}
+
+async function subscribe(params, onEvent) {
+	var resp = await request(TYPE_SUBSCRIBE, Object.assign({method: 'subscribe'}, params));
+	if (resp.error)
+		throw new Error(resp.error);
+	subscriptions[resp.result] = onEvent;
+	return resp.result;
+}
+
+async function blockNumber() {
+	var resp = await request(TYPE_ETHEREUM, {jsonrpc: '2.0', method: 'eth_blockNumber', params: [], id: 1});
+	return parseInt(resp.result, 16);
+}
+
+function percentile(sorted, q) {
+	return sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))];
+}
+
+(async function() {
+	await new Promise((resolve) => socket.once('secureConnect', resolve));
+
+	await subscribe({type: 'newHeads'}, () => ++heads);
+
+	var limit = await blockNumber() + 1000;
+	var data = coder.codeTxData('trans(uint256)', ['uint256'], [1]);
+	var latencies = [];
+	var failed = 0;
+	var next = 0;
+	var start = Date.now();
+
+	async function worker() {
+		while (next < total) {
+			++next;
+			var tx = web3sync.signTransaction({
+				data: data,
+				from: config.account,
+				to: to,
+				gas: 1000000,
+				randomid: Math.ceil(Math.random() * 100000000000),
+				blockLimit: limit
+			}, config.privKey, null);
+			var hash = '0x' + sha3(Buffer.from(tx.replace(/^0x/, ''), 'hex')).toString('hex');
+
+			// subscribed before sending, so the receipt can't slip through
+			var delivered;
+			var receipt = new Promise((resolve) => delivered = resolve);
+			await subscribe({type: 'receipt', hash: hash}, delivered);
+			var sent = Date.now();
+			var resp = await request(TYPE_ETHEREUM, {jsonrpc: '2.0', method: 'eth_sendRawTransaction', params: [tx], id: next});
+			if (resp.error) {
+				++failed;
+				continue;
+			}
+			await receipt;
+			latencies.push(Date.now() - sent);
+		}
+	}
+
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+
+	var seconds = (Date.now() - start) / 1000;
+	latencies.sort((a, b) => a - b);
+	console.log(latencies.length + ' receipts pushed, ' + failed + ' failed in ' + seconds + 's, ' + heads + ' block headers, ' + dropped + ' events dropped');
+	if (latencies.length)
+		console.log('submit to receipt ms: p50 ' + percentile(latencies, 0.5) + ' p90 ' + percentile(latencies, 0.9) + ' p99 ' + percentile(latencies, 0.99) + ' max ' + latencies[latencies.length - 1]);
+	socket.end();
+})();
@@ -0,0 +1,65 @@
+/**
+ * @file: cnsCallBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Time eth_call by contract name (CNS) against eth_call of the same functions with the call data
+ * encoded by the client, for a few common signatures of AbiBench.sol. The difference per call is
+ * what the node spends looking the abi up, encoding the parameters and decoding the result.
+ * The encoder alone, in process and checked against SolidityCoder, is timed by abibench.
+ * Deploy AbiBench.sol with deploy.js and register it with: babel-node cns_manager.js add AbiBench
+ *
+ * usage: babel-node cnsCallBench.js [count] [inflight]
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+
+var count = parseInt(process.argv[2] || '20000');
+var inflight = parseInt(process.argv[3] || '16');
+
+var address = fs.readFileSync(config.Ouputpath + 'AbiBench.address', 'utf-8').trim();
+jsonrpc.setMaxSockets(inflight);
+
+var rpc = jsonrpc.client(config.HttpProvider);
+
+/// @returns calls per second of <count> calls of call.params, <inflight> at a time
+async function rate(params) {
+	var next = 0;
+	var start = Date.now();
+	async function worker() {
+		while (next++ < count)
+			await rpc('eth_call', params);
+	}
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+	return count / ((Date.now() - start) / 1000);
+}
+
+var calls = [
+	{func: 'transfer', sig: 'transfer(address,uint256)', types: ['address', 'uint256'], params: ['0x00000000000000000000000000000000000000ff', 1000]},
+	{func: 'setName', sig: 'setName(string,uint256)', types: ['string', 'uint256'], params: ['hello, abi', 42]},
+	{func: 'sum', sig: 'sum(uint256[],bytes32)', types: ['uint256[]', 'bytes32'], params: [[1, 2, 3, 4, 5, 6, 7, 8], '0x' + '0'.repeat(64)]}
+];
+
+(async function() {
+	for (var c of calls) {
+		var byName = [{to: '', data: {contract: 'AbiBench', func: c.func, version: '', params: c.params}}, 'latest'];
+		var byData = [{to: address, data: coder.codeTxData(c.sig, c.types, c.params)}, 'latest'];
+		console.log(c.sig + ' by name: ' + await rpc('eth_call', byName));
+
+		var named = await rate(byName);
+		var encoded = await rate(byData);
+		console.log('  ' + named.toFixed(0) + ' calls/s by name, ' + encoded.toFixed(0) + ' calls/s encoded by the client, ' +
+			((1e6 / named - 1e6 / encoded) * inflight).toFixed(1) + 'us more per call by name');
+	}
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
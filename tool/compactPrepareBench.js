@@ -0,0 +1,141 @@
+/**
+ * @file: compactPrepareBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Measure the prepare bytes a PBFT leader broadcasts per block, with and without "compactPrepare",
+ * on a local multi-node chain. Deploy HelloWorld.sol with deploy.js first.
+ *
+ * For each burst size, <size> HelloWorld.set transactions are sent to the nodes in turn, <inflight>
+ * requests at a time, and the burst is timed until every one is mined. The pbft_prepare_* counters
+ * of admin_metrics are read from every node before and after, so whichever node led, and report:
+ *   prepares                     prepare requests broadcast
+ *   bytes/block                  prepare bytes broadcast per block (compact or full)
+ *   block bytes/block            size of the blocks those prepares carried
+ *   tx fetches, full fetches     followers asking for transactions missing from their queue,
+ *                                and falling back to the full prepare
+ * and check that all nodes end up with the same head.
+ *
+ * Run it once with "compactPrepare": "ON" in every node's config.json and once without.
+ *
+ * usage: babel-node compactPrepareBench.js <nodeUrl,nodeUrl,...> [sizes] [inflight]
+ *   e.g. babel-node compactPrepareBench.js http://127.0.0.1:8545,http://127.0.0.1:8546,http://127.0.0.1:8547,http://127.0.0.1:8548 1000,5000
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var args = process.argv.slice(2);
+if (!args[0]) {
+	console.log('usage: babel-node compactPrepareBench.js <nodeUrl,nodeUrl,...> [sizes] [inflight]');
+	process.exit(1);
+}
+
+var nodes = args[0].split(',');
+var sizes = (args[1] || '1000,5000').split(',').map((s) => parseInt(s));
+var inflight = parseInt(args[2] || '64');
+var address = fs.readFileSync(config.Ouputpath + 'HelloWorld.address', 'utf-8').trim();
+
+var rpc = jsonrpc.call;
+
+// pbft_prepare_* samples of every node, summed
+async function prepareCounters() {
+	var ret = {};
+	for (var n of nodes) {
+		var text = await rpc(n, 'admin_metrics', []);
+		for (var line of text.split('\n')) {
+			var m = /^(pbft_prepare\w*)(\{[^}]*\})?\s+(\S+)$/.exec(line);
+			if (m)
+				ret[m[1] + (m[2] || '')] = (ret[m[1] + (m[2] || '')] || 0) + parseFloat(m[3]);
+		}
+	}
+	return ret;
+}
+
+function delta(after, before, key) {
+	return (after[key] || 0) - (before[key] || 0);
+}
+
+async function burst(size) {
+	var limit = parseInt(await rpc(nodes[0], 'eth_blockNumber', []), 16) + 1000;
+	var hashes = [];
+	var next = 0;
+	var failed = 0;
+
+	async function sender() {
+		while (next < size) {
+			var i = next++;
+			var tx = web3sync.signTransaction({
+				data: coder.codeTxData('set(string)', ['string'], ['burst ' + size + ' tx ' + i]),
+				from: config.account,
+				to: address,
+				gas: 1000000,
+				randomid: Math.ceil(Math.random() * 100000000000),
+				blockLimit: limit
+			}, config.privKey, null);
+			try {
+				hashes.push(await rpc(nodes[i % nodes.length], 'eth_sendRawTransaction', [tx]));
+			} catch (e) {
+				++failed;
+			}
+		}
+	}
+
+	async function waiter() {
+		while (hashes.length) {
+			var h = hashes.pop();
+			while (!(await rpc(nodes[0], 'eth_getTransactionReceipt', [h])))
+				await new Promise((resolve) => setTimeout(resolve, 100));
+		}
+	}
+
+	var start = Date.now();
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(sender());
+	await Promise.all(workers);
+	workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(waiter());
+	await Promise.all(workers);
+	return {failed: failed, seconds: (Date.now() - start) / 1000};
+}
+
+(async function() {
+	for (var size of sizes) {
+		var before = await prepareCounters();
+		var r = await burst(size);
+		var after = await prepareCounters();
+
+		var prepares = delta(after, before, 'pbft_prepares_total');
+		var sent = delta(after, before, 'pbft_prepare_bytes_total{kind="compact"}') + delta(after, before, 'pbft_prepare_bytes_total{kind="full"}');
+		var blocks = delta(after, before, 'pbft_prepare_bytes_total{kind="block"}');
+		console.log(size + ' txs (' + r.failed + ' rejected) mined in ' + r.seconds + 's');
+		console.log('  prepares ' + prepares + ', bytes/block ' + Math.round(sent / (prepares || 1)) + ', block bytes/block ' + Math.round(blocks / (prepares || 1))
+			+ ', saved ' + (blocks ? Math.round(100 * (1 - sent / blocks)) : 0) + '%');
+		console.log('  tx fetches ' + delta(after, before, 'pbft_prepare_fetch_total{what="txs"}') + ' for ' + delta(after, before, 'pbft_prepare_missing_txs_total') + ' txs'
+			+ ', full fetches ' + delta(after, before, 'pbft_prepare_fetch_total{what="full"}'));
+
+		// every node must have committed the same blocks, whichever way it got the prepares
+		var head = parseInt(await rpc(nodes[0], 'eth_blockNumber', []), 16);
+		var hash = (await rpc(nodes[0], 'eth_getBlockByNumber', ['0x' + head.toString(16), false])).hash;
+		for (var n of nodes.slice(1)) {
+			var b = null;
+			for (var t = 0; t < 100 && !b; ++t) {
+				b = await rpc(n, 'eth_getBlockByNumber', ['0x' + head.toString(16), false]);
+				if (!b)
+					await new Promise((resolve) => setTimeout(resolve, 100));
+			}
+			if (!b || b.hash != hash)
+				throw new Error(n + ' has ' + (b ? b.hash : 'no block') + ' at #' + head + ', expected ' + hash);
+		}
+	}
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
@@ -0,0 +1,91 @@
+/**
+ * @file: dfsDownloadBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Download a stored DFS file <count> times, <inflight> at a time, from the node's RPC port
+ * (GET /fs/v1/files/<fileId>) and report the throughput. Given the pid of a node running on
+ * this host, the CPU time it spent per GB sent is read from /proc as well.
+ *
+ * Before that it checks that a range of the file and a revalidation with If-None-Match are
+ * answered with 206 and 304.
+ *
+ * usage: babel-node dfsDownloadBench.js <fileId> [count] [inflight] [nodePid]
+ */
+
+var http = require('http');
+var url = require('url');
+var fs = require('fs');
+var config = require('../web3lib/config');
+
+var args = process.argv.slice(2);
+if (args.length < 1) {
+	console.log('usage: babel-node dfsDownloadBench.js <fileId> [count] [inflight] [nodePid]');
+	process.exit(1);
+}
+
+var fileId = args[0];
+var count = parseInt(args[1] || '20');
+var inflight = parseInt(args[2] || '4');
+var pid = args[3];
+var endpoint = url.parse(config.HttpProvider);
+var agent = new http.Agent({keepAlive: true, maxSockets: inflight});
+
+function get(headers) {
+	return new Promise((resolve, reject) => {
+		var req = http.get({
+			hostname: endpoint.hostname,
+			port: endpoint.port,
+			path: '/fs/v1/files/' + fileId,
+			headers: headers || {},
+			agent: agent
+		}, (res) => {
+			var bytes = 0;
+			res.on('data', (chunk) => bytes += chunk.length);
+			res.on('end', () => resolve({status: res.statusCode, headers: res.headers, bytes: bytes}));
+		});
+		req.on('error', reject);
+	});
+}
+
+// user plus system time of the node in seconds
+function cpuSeconds() {
+	var fields = fs.readFileSync('/proc/' + pid + '/stat', 'utf-8').split(') ')[1].split(' ');
+	return (parseInt(fields[11]) + parseInt(fields[12])) / 100;
+}
+
+(async function() {
+	var full = await get();
+	if (full.status != 200) {
+		console.log('download failed with ' + full.status);
+		process.exit(1);
+	}
+	console.log('file ' + fileId + ': ' + full.bytes + ' bytes, etag ' + full.headers['etag']);
+
+	var half = Math.floor(full.bytes / 2);
+	var range = await get({Range: 'bytes=' + half + '-'});
+	console.log('range from ' + half + ': ' + range.status + ' ' + range.headers['content-range'] + ', ' + range.bytes + ' bytes');
+	var cached = await get({'If-None-Match': full.headers['etag']});
+	console.log('if-none-match: ' + cached.status);
+
+	var cpuStart = pid ? cpuSeconds() : 0;
+	var start = Date.now();
+	var total = 0;
+	var next = 0;
+	async function worker() {
+		while (next++ < count)
+			total += (await get()).bytes;
+	}
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+
+	var seconds = (Date.now() - start) / 1000;
+	var gb = total / (1024 * 1024 * 1024);
+	console.log(count + ' downloads, ' + total + ' bytes in ' + seconds + 's, ' + (total / (1024 * 1024) / seconds).toFixed(1) + ' MB/s');
+	if (pid)
+		console.log('node cpu: ' + ((cpuSeconds() - cpuStart) / gb).toFixed(2) + ' s per GB');
+	agent.destroy();
+})();
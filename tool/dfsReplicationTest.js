@@ -0,0 +1,125 @@
+/**
+ * @file: dfsReplicationTest.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Serve a file to a replicating node from several local processes behind simulated slow links,
+ * and time how long the node takes to hold a verified copy.
+ *
+ * Each source is a child process answering GET /fs/v1/files/<fileId> with range support, like a
+ * node's file service, sending at most <kbps> KB per second. Every <failEvery>th response of a
+ * source is cut after half of it was sent, so retries and resumption get exercised. Register the
+ * printed host:port pairs as enabled file servers of the node's group (FileServerManager) and the
+ * file with its md5 (FileInfoManager), then start the node; the test polls the node's own copy
+ * until it can be downloaded with the expected md5.
+ *
+ * usage: babel-node dfsReplicationTest.js <file> <fileId> <nodeHost:port> [sources] [kbps] [failEvery] [basePort]
+ */
+
+var http = require('http');
+var fs = require('fs');
+var crypto = require('crypto');
+var child_process = require('child_process');
+
+function serve(file, fileId, port, kbps, failEvery) {
+	var data = fs.readFileSync(file);
+	var etag = '"' + data.length.toString(16) + '-' + port.toString(16) + '"';
+	var responses = 0;
+
+	http.createServer((req, res) => {
+		if (req.url != '/fs/v1/files/' + fileId) {
+			res.writeHead(404, {'Content-Type': 'application/json'});
+			return res.end('{"ret":404,"code":-1,"info":"file id not found"}');
+		}
+
+		var first = 0;
+		var last = data.length - 1;
+		var status = 200;
+		var headers = {'Accept-Ranges': 'bytes', 'ETag': etag};
+		var range = /^bytes=(\d*)-(\d*)$/.exec(req.headers['range'] || '');
+		if (range && (range[1] || range[2])) {
+			first = range[1] ? parseInt(range[1]) : Math.max(0, data.length - parseInt(range[2]));
+			last = range[1] && range[2] ? Math.min(parseInt(range[2]), data.length - 1) : data.length - 1;
+			if (first >= data.length) {
+				res.writeHead(416, {'Content-Range': 'bytes */' + data.length});
+				return res.end();
+			}
+			status = 206;
+			headers['Content-Range'] = 'bytes ' + first + '-' + last + '/' + data.length;
+		}
+		headers['Content-Length'] = last - first + 1;
+		res.writeHead(status, headers);
+
+		var body = data.slice(first, last + 1);
+		var cut = failEvery > 0 && ++responses % failEvery == 0 ? Math.floor(body.length / 2) : -1;
+		var perTick = Math.max(1, Math.floor(kbps * 1024 / 10));
+		var sent = 0;
+		var timer = setInterval(() => {
+			var end = Math.min(body.length, sent + perTick);
+			if (cut >= 0 && end >= cut) {
+				clearInterval(timer);
+				return req.socket.destroy();
+			}
+			res.write(body.slice(sent, end));
+			sent = end;
+			if (sent >= body.length) {
+				clearInterval(timer);
+				res.end();
+			}
+		}, 100);
+		req.on('close', () => clearInterval(timer));
+	}).listen(port, () => process.send({port: port}));
+}
+
+function md5Of(host, fileId) {
+	return new Promise((resolve) => {
+		var parts = host.split(':');
+		http.get({hostname: parts[0], port: parseInt(parts[1]), path: '/fs/v1/files/' + fileId}, (res) => {
+			var hash = crypto.createHash('md5');
+			res.on('data', (chunk) => hash.update(chunk));
+			res.on('end', () => resolve(res.statusCode == 200 ? hash.digest('hex') : null));
+		}).on('error', () => resolve(null));
+	});
+}
+
+if (process.argv[2] == '--source') {
+	var a = process.argv.slice(3);
+	serve(a[0], a[1], parseInt(a[2]), parseInt(a[3]), parseInt(a[4]));
+}
+else {
+	var args = process.argv.slice(2);
+	if (args.length < 3) {
+		console.log('usage: babel-node dfsReplicationTest.js <file> <fileId> <nodeHost:port> [sources] [kbps] [failEvery] [basePort]');
+		process.exit(1);
+	}
+
+	var file = args[0];
+	var fileId = args[1];
+	var node = args[2];
+	var sources = parseInt(args[3] || '3');
+	var kbps = parseInt(args[4] || '1024');
+	var failEvery = parseInt(args[5] || '0');
+	var basePort = parseInt(args[6] || '18080');
+	var expected = crypto.createHash('md5').update(fs.readFileSync(file)).digest('hex');
+	var children = [];
+
+	(async function() {
+		for (var i = 0; i < sources; ++i) {
+			var child = child_process.fork(__filename, ['--source', file, fileId, basePort + i, kbps, failEvery]);
+			children.push(child);
+			await new Promise((resolve) => child.once('message', resolve));
+			console.log('source 127.0.0.1:' + (basePort + i) + ' at ' + kbps + ' KB/s' + (failEvery ? ', cutting one response in ' + failEvery : ''));
+		}
+		console.log('file ' + fileId + ' md5 ' + expected + ', waiting for ' + node + ' to replicate it');
+
+		var start = Date.now();
+		while ((await md5Of(node, fileId)) != expected)
+			await new Promise((resolve) => setTimeout(resolve, 1000));
+
+		var seconds = (Date.now() - start) / 1000;
+		var size = fs.statSync(file).size;
+		console.log('replicated ' + size + ' bytes in ' + seconds + 's, ' + (size / 1024 / seconds).toFixed(1) + ' KB/s over ' + sources + ' sources');
+		children.forEach((child) => child.kill());
+	})();
+}
@@ -0,0 +1,78 @@
+/**
+ * @file: ethCallLoadTest.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Load eth_call for a fixed time at a few concurrency levels and report calls per second with
+ * the p50, p99 and max latency. Calls on "latest" run on the node's cached state snapshots
+ * (callSnapshots in config.json), calls on "pending" copy the block being sealed for every call,
+ * so running both shows what the snapshots save. Run it while the chain takes transactions too,
+ * to see the calls next to block execution.
+ * Deploy AbiBench.sol with deploy.js first.
+ *
+ * usage: babel-node ethCallLoadTest.js [seconds] [inflight,...] [block,...]
+ * e.g.:  babel-node ethCallLoadTest.js 30 1,8,32,128 latest,pending
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+
+var seconds = parseInt(process.argv[2] || '30');
+var levels = (process.argv[3] || '1,8,32,128').split(',').map((n) => parseInt(n));
+var blocks = (process.argv[4] || 'latest,pending').split(',');
+
+var address = fs.readFileSync(config.Ouputpath + 'AbiBench.address', 'utf-8').trim();
+var data = coder.codeTxData('sum(uint256[],bytes32)', ['uint256[]', 'bytes32'], [[1, 2, 3, 4, 5, 6, 7, 8], '0x' + '0'.repeat(64)]);
+jsonrpc.setMaxSockets(Math.max.apply(null, levels));
+
+var rpc = jsonrpc.client(config.HttpProvider);
+
+function percentile(sorted, p) {
+	return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+/// runs <inflight> callers on <block> for <seconds>, @returns {qps, p50, p99, max} in ms
+async function load(block, inflight) {
+	var params = [{to: address, data: data}, block];
+	var latencies = [];
+	var start = Date.now();
+	var end = start + seconds * 1000;
+	async function caller() {
+		while (Date.now() < end) {
+			var t = process.hrtime();
+			await rpc('eth_call', params);
+			var d = process.hrtime(t);
+			latencies.push(d[0] * 1e3 + d[1] / 1e6);
+		}
+	}
+	var callers = [];
+	for (var c = 0; c < inflight; ++c)
+		callers.push(caller());
+	await Promise.all(callers);
+
+	latencies.sort((a, b) => a - b);
+	return {
+		qps: latencies.length / ((Date.now() - start) / 1000),
+		p50: percentile(latencies, 0.5),
+		p99: percentile(latencies, 0.99),
+		max: latencies[latencies.length - 1]
+	};
+}
+
+(async function() {
+	console.log('sum(uint256[],bytes32) at ' + address + ': ' + await rpc('eth_call', [{to: address, data: data}, 'latest']));
+	for (var block of blocks) {
+		for (var inflight of levels) {
+			var r = await load(block, inflight);
+			console.log(block + ', ' + inflight + ' in flight: ' + r.qps.toFixed(0) + ' calls/s, p50 ' + r.p50.toFixed(2) +
+				'ms, p99 ' + r.p99.toFixed(2) + 'ms, max ' + r.max.toFixed(2) + 'ms');
+		}
+	}
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
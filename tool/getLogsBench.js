@@ -0,0 +1,118 @@
+/**
+ * @file: getLogsBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Build a synthetic chain of LogBench events and time eth_getLogs and eth_getLogsPage over it.
+ * Deploy LogBench.sol with deploy.js first.
+ *
+ *   populate: sends <txs> transactions emitting <logsPerTx> Bench events each, spread over
+ *             <groups> values of the third topic, <inflight> requests at a time
+ *   query:    times eth_getLogs by address, by a single group topic and by a block range,
+ *             then walks the address query with eth_getLogsPage in pages of <pageSize>
+ *
+ * usage: babel-node getLogsBench.js populate [txs] [logsPerTx] [groups] [inflight]
+ *        babel-node getLogsBench.js query [fromBlock] [toBlock] [pageSize]
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var args = process.argv.slice(2);
+if (args[0] != 'populate' && args[0] != 'query') {
+	console.log('usage: babel-node getLogsBench.js populate [txs] [logsPerTx] [groups] [inflight]');
+	console.log('       babel-node getLogsBench.js query [fromBlock] [toBlock] [pageSize]');
+	process.exit(1);
+}
+
+var address = fs.readFileSync(config.Ouputpath + 'LogBench.address', 'utf-8').trim();
+
+var rpc = jsonrpc.client(config.HttpProvider);
+
+async function blockNumber() {
+	return parseInt(await rpc('eth_blockNumber', []), 16);
+}
+
+async function populate(txs, logsPerTx, groups, inflight) {
+	var limit = await blockNumber() + 1000;
+	var data = coder.codeTxData('emitLogs(uint256,uint256)', ['uint256', 'uint256'], [logsPerTx, groups]);
+	var next = 0;
+	var failed = 0;
+	var start = Date.now();
+
+	async function worker() {
+		while (next < txs) {
+			++next;
+			var tx = web3sync.signTransaction({
+				data: data,
+				from: config.account,
+				to: address,
+				gas: 100000000,
+				randomid: Math.ceil(Math.random() * 100000000000),
+				blockLimit: limit
+			}, config.privKey, null);
+			try {
+				await rpc('eth_sendRawTransaction', [tx]);
+			} catch (e) {
+				++failed;
+			}
+			if (next % 1000 == 0) {
+				limit = await blockNumber() + 1000;
+				console.log('sent ' + next + ' transactions');
+			}
+		}
+	}
+
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+	console.log('sent ' + txs + ' transactions (' + failed + ' rejected), up to ' + txs * logsPerTx + ' logs, in ' + (Date.now() - start) / 1000 + 's');
+}
+
+async function timed(name, method, filter) {
+	var start = Date.now();
+	var result = await rpc(method, [filter]);
+	var count = Array.isArray(result) ? result.length : result.logs.length;
+	console.log(name + ': ' + count + ' logs in ' + (Date.now() - start) + 'ms');
+	return result;
+}
+
+async function query(fromBlock, toBlock, pageSize) {
+	var range = {fromBlock: '0x' + fromBlock.toString(16), toBlock: '0x' + toBlock.toString(16)};
+	var group = '0x' + '0'.repeat(64);
+
+	await timed('by address', 'eth_getLogs', Object.assign({address: address}, range));
+	await timed('by group topic', 'eth_getLogs', Object.assign({address: address, topics: [null, null, null, group]}, range));
+	await timed('whole range', 'eth_getLogs', range);
+
+	var start = Date.now();
+	var total = 0;
+	var pages = 0;
+	var cursor = null;
+	do {
+		var filter = Object.assign({address: address, limit: pageSize}, range);
+		if (cursor)
+			filter.cursor = cursor;
+		var page = await rpc('eth_getLogsPage', [filter]);
+		total += page.logs.length;
+		cursor = page.cursor;
+		++pages;
+	} while (cursor);
+	console.log('paged by address: ' + total + ' logs in ' + pages + ' pages, ' + (Date.now() - start) + 'ms');
+}
+
+(async function() {
+	if (args[0] == 'populate')
+		await populate(parseInt(args[1] || '10000'), parseInt(args[2] || '200'), parseInt(args[3] || '1000'), parseInt(args[4] || '16'));
+	else
+		await query(parseInt(args[1] || '1'), args[2] ? parseInt(args[2]) : await blockNumber(), parseInt(args[3] || '10000'));
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
@@ -0,0 +1,86 @@
+/**
+ * @file: logBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Report how long the node takes to execute blocks and transactions, read from the
+ * block_enact_duration_us and tx_exec_duration_us histograms of the metrics endpoint
+ * (metricsPort in config.json), to compare logging setups under the same load.
+ *
+ * Set TRACE and DEBUG to ENABLED = false in the node's log.conf so it logs at INFO, generate
+ * load meanwhile, e.g. with: babel-node getLogsBench.js populate 100000 10 1000 64
+ * and run once per build: before the level check in LOG, with it, and with cmake -DDEBUG_LOGS=OFF.
+ * Given the pid of a node running on this host, its CPU time per block is read from /proc too.
+ *
+ * usage: babel-node logBench.js <metricsPort> [seconds] [nodePid]
+ */
+
+var http = require('http');
+var fs = require('fs');
+
+var args = process.argv.slice(2);
+if (args.length < 1) {
+	console.log('usage: babel-node logBench.js <metricsPort> [seconds] [nodePid]');
+	process.exit(1);
+}
+
+var metricsPort = parseInt(args[0]);
+var seconds = parseInt(args[1] || '120');
+var pid = args[2];
+
+function get(path) {
+	return new Promise((resolve, reject) => {
+		http.get({hostname: '127.0.0.1', port: metricsPort, path: path}, (res) => {
+			var chunks = [];
+			res.on('data', (c) => chunks.push(c));
+			res.on('end', () => resolve(Buffer.concat(chunks).toString()));
+		}).on('error', reject);
+	});
+}
+
+/// @returns {block: {count, sum}, tx: {count, sum}} of the execution histograms
+async function execTime() {
+	var text = await get('/metrics');
+	var ret = {block: {count: 0, sum: 0}, tx: {count: 0, sum: 0}};
+	for (var line of text.split('\n')) {
+		var m = line.match(/^(block_enact|tx_exec)_duration_us_(count|sum) (\d+)/);
+		if (m)
+			ret[m[1] == 'block_enact' ? 'block' : 'tx'][m[2]] = parseInt(m[3]);
+	}
+	return ret;
+}
+
+// user plus system time of the node in seconds
+function cpuSeconds() {
+	var fields = fs.readFileSync('/proc/' + pid + '/stat', 'utf-8').split(') ')[1].split(' ');
+	return (parseInt(fields[11]) + parseInt(fields[12])) / 100;
+}
+
+function average(after, before) {
+	var count = after.count - before.count;
+	return count ? Math.round((after.sum - before.sum) / count) : 0;
+}
+
+(async function() {
+	var first = await execTime();
+	var cpuFirst = pid ? cpuSeconds() : 0;
+	var before = first;
+	var end = Date.now() + seconds * 1000;
+	while (Date.now() < end) {
+		await new Promise((resolve) => setTimeout(resolve, 5000));
+		var after = await execTime();
+		console.log((after.block.count - before.block.count) + ' blocks, ' + average(after.block, before.block) + 'us per block, ' +
+			(after.tx.count - before.tx.count) + ' txs, ' + average(after.tx, before.tx) + 'us per tx');
+		before = after;
+	}
+
+	var blocks = before.block.count - first.block.count;
+	console.log('total: ' + blocks + ' blocks, ' + average(before.block, first.block) + 'us per block, ' +
+		(before.tx.count - first.tx.count) + ' txs, ' + average(before.tx, first.tx) + 'us per tx');
+	if (pid && blocks)
+		console.log('node cpu: ' + ((cpuSeconds() - cpuFirst) * 1000 / blocks).toFixed(1) + 'ms per block');
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
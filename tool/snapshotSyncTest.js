@@ -0,0 +1,133 @@
+/**
+ * @file: snapshotSyncTest.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Build a large synthetic state on a local chain, then time how long a new node takes to catch
+ * up from a state snapshot and check that it holds the same state as the chain it joined.
+ *
+ *   populate: sends <txs> transactions each writing <slotsPerTx> new storage slots of StateFill,
+ *             <inflight> requests at a time, to the node in config.HttpProvider
+ *   check:    polls the new node at <nodeUrl> until it has executed blocks past the snapshot it
+ *             started from, then compares <samples> random slots with config.HttpProvider
+ *
+ * Run the chain on four nodes with "snapshotInterval" set in config.json, e.g. 100, deploy
+ * StateFill.sol with deploy.js and populate. Start a fifth node with an empty data directory and
+ * "snapshotSync": 2, and run check against its RPC port at once.
+ *
+ * usage: babel-node snapshotSyncTest.js populate [txs] [slotsPerTx] [inflight]
+ *        babel-node snapshotSyncTest.js check <nodeUrl> [samples] [timeoutSeconds]
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var args = process.argv.slice(2);
+if (args[0] != 'populate' && !(args[0] == 'check' && args[1])) {
+	console.log('usage: babel-node snapshotSyncTest.js populate [txs] [slotsPerTx] [inflight]');
+	console.log('       babel-node snapshotSyncTest.js check <nodeUrl> [samples] [timeoutSeconds]');
+	process.exit(1);
+}
+
+var address = fs.readFileSync(config.Ouputpath + 'StateFill.address', 'utf-8').trim();
+
+var rpc = jsonrpc.call;
+
+async function blockNumber(nodeUrl) {
+	return parseInt(await rpc(nodeUrl, 'eth_blockNumber', []), 16);
+}
+
+function call(nodeUrl, sig, types, params, block) {
+	return rpc(nodeUrl, 'eth_call', [{to: address, data: coder.codeTxData(sig, types, params)}, '0x' + block.toString(16)]);
+}
+
+async function populate(txs, slotsPerTx, inflight) {
+	var limit = await blockNumber(config.HttpProvider) + 1000;
+	var data = coder.codeTxData('fill(uint256)', ['uint256'], [slotsPerTx]);
+	var next = 0;
+	var failed = 0;
+	var start = Date.now();
+
+	async function worker() {
+		while (next < txs) {
+			++next;
+			var tx = web3sync.signTransaction({
+				data: data,
+				from: config.account,
+				to: address,
+				gas: 1000000000,
+				randomid: Math.ceil(Math.random() * 100000000000),
+				blockLimit: limit
+			}, config.privKey, null);
+			try {
+				await rpc(config.HttpProvider, 'eth_sendRawTransaction', [tx]);
+			} catch (e) {
+				++failed;
+			}
+			if (next % 1000 == 0) {
+				limit = await blockNumber(config.HttpProvider) + 1000;
+				console.log('sent ' + next + ' transactions');
+			}
+		}
+	}
+
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+	console.log('sent ' + txs + ' transactions (' + failed + ' rejected), up to ' + txs * slotsPerTx + ' slots, in ' + (Date.now() - start) / 1000 + 's');
+}
+
+async function check(nodeUrl, samples, timeout) {
+	var start = Date.now();
+	var snapshot = null;
+	var head = 0;
+	for (;;) {
+		if (Date.now() - start > timeout * 1000)
+			throw new Error('node at ' + nodeUrl + ' still at #' + head + ' after ' + timeout + 's');
+		await new Promise((resolve) => setTimeout(resolve, 1000));
+		try {
+			head = await blockNumber(nodeUrl);
+		} catch (e) {
+			continue;	// not listening yet
+		}
+		// the blocks before the snapshot a node starts from are never downloaded
+		if (snapshot === null && head > 0 && !(await rpc(nodeUrl, 'eth_getBlockByNumber', ['0x1', false]))) {
+			snapshot = head;
+			console.log('started from snapshot #' + snapshot + ' after ' + (Date.now() - start) / 1000 + 's');
+		}
+		if (snapshot !== null && head > snapshot)
+			break;
+	}
+	var chainHead = await blockNumber(config.HttpProvider);
+	console.log('executing blocks past the snapshot after ' + (Date.now() - start) / 1000 + 's, at #' + head + ' of #' + chainHead);
+
+	// both nodes executed block <head>, its state must be the same on both
+	var filled = parseInt(await call(config.HttpProvider, 'filled()', [], [], head), 16);
+	var theirs = parseInt(await call(nodeUrl, 'filled()', [], [], head), 16);
+	if (filled != theirs)
+		throw new Error('filled() at #' + head + ' is ' + theirs + ', expected ' + filled);
+	for (var i = 0; i < samples && filled; ++i) {
+		var slot = Math.floor(Math.random() * filled);
+		var expected = await call(config.HttpProvider, 'slots(uint256)', ['uint256'], [slot], head);
+		var got = await call(nodeUrl, 'slots(uint256)', ['uint256'], [slot], head);
+		if (got != expected)
+			throw new Error('slots(' + slot + ') at #' + head + ' is ' + got + ', expected ' + expected);
+	}
+	console.log(filled + ' slots at #' + head + ', ' + samples + ' samples match');
+}
+
+(async function() {
+	if (args[0] == 'populate')
+		await populate(parseInt(args[1] || '10000'), parseInt(args[2] || '100'), parseInt(args[3] || '16'));
+	else
+		await check(args[1], parseInt(args[2] || '1000'), parseInt(args[3] || '3600'));
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
@@ -0,0 +1,135 @@
+/**
+ * @file: systemContractBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Drive large blocks through a node and report how long it spends refreshing the system contract
+ * caches after each one, read from the system_contract_update_duration_us histogram of the metrics
+ * endpoint (metricsPort in config.json) next to block_enact_duration_us.
+ *
+ * Deploy Ok.sol with deploy.js first, and raise the block size so blocks fill up to 10k txs,
+ * from the systemcontract directory: babel-node tool.js ConfigAction set maxBlockTranscations 10000
+ * Sends <txs> Ok.trans calls, <inflight> requests at a time, waits until no block has been
+ * sealed for 10s, then prints the transactions of each block and the average time per block.
+ *
+ * usage: babel-node systemContractBench.js <metricsPort> [txs] [inflight]
+ */
+
+var http = require('http');
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var args = process.argv.slice(2);
+if (args.length < 1) {
+	console.log('usage: babel-node systemContractBench.js <metricsPort> [txs] [inflight]');
+	process.exit(1);
+}
+
+var metricsPort = parseInt(args[0]);
+var txs = parseInt(args[1] || '100000');
+var inflight = parseInt(args[2] || '64');
+
+var address = fs.readFileSync(config.Ouputpath + 'Ok.address', 'utf-8').trim();
+
+var rpc = jsonrpc.client(config.HttpProvider);
+
+function getMetrics() {
+	return new Promise((resolve, reject) => {
+		http.get({hostname: '127.0.0.1', port: metricsPort, path: '/metrics'}, (res) => {
+			var chunks = [];
+			res.on('data', (c) => chunks.push(c));
+			res.on('end', () => resolve(Buffer.concat(chunks).toString()));
+		}).on('error', reject);
+	});
+}
+
+/// @returns {update: {count, sum}, enact: {count, sum}} of the per-block histograms
+async function blockTime() {
+	var text = await getMetrics();
+	var ret = {update: {count: 0, sum: 0}, enact: {count: 0, sum: 0}};
+	for (var line of text.split('\n')) {
+		var m = line.match(/^(system_contract_update|block_enact)_duration_us_(count|sum) (\d+)/);
+		if (m)
+			ret[m[1] == 'block_enact' ? 'enact' : 'update'][m[2]] = parseInt(m[3]);
+	}
+	return ret;
+}
+
+async function blockNumber() {
+	return parseInt(await rpc('eth_blockNumber', []), 16);
+}
+
+function average(after, before) {
+	var count = after.count - before.count;
+	return count ? Math.round((after.sum - before.sum) / count) : 0;
+}
+
+async function send() {
+	var limit = await blockNumber() + 1000;
+	var data = coder.codeTxData('trans(uint256)', ['uint256'], [1]);
+	var next = 0;
+	var failed = 0;
+	var start = Date.now();
+
+	async function worker() {
+		while (next < txs) {
+			++next;
+			var tx = web3sync.signTransaction({
+				data: data,
+				from: config.account,
+				to: address,
+				gas: 100000000,
+				randomid: Math.ceil(Math.random() * 100000000000),
+				blockLimit: limit
+			}, config.privKey, null);
+			try {
+				await rpc('eth_sendRawTransaction', [tx]);
+			} catch (e) {
+				++failed;
+			}
+			if (next % 10000 == 0) {
+				limit = await blockNumber() + 1000;
+				console.log('sent ' + next + ' transactions');
+			}
+		}
+	}
+
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(worker());
+	await Promise.all(workers);
+	console.log('sent ' + txs + ' transactions (' + failed + ' rejected) in ' + (Date.now() - start) / 1000 + 's');
+}
+
+(async function() {
+	var before = await blockTime();
+	var first = await blockNumber() + 1;
+
+	await send();
+
+	var last = await blockNumber();
+	for (var idle = 0; idle < 10; ++idle) {
+		await new Promise((resolve) => setTimeout(resolve, 1000));
+		var number = await blockNumber();
+		if (number != last) {
+			last = number;
+			idle = -1;
+		}
+	}
+	var after = await blockTime();
+
+	var blockTxs = [];
+	for (var n = first; n <= last; ++n)
+		blockTxs.push(parseInt(await rpc('eth_getBlockTransactionCountByNumber', ['0x' + n.toString(16)]), 16));
+	console.log('txs per block: ' + blockTxs.join(' '));
+	console.log((after.update.count - before.update.count) + ' blocks, ' + average(after.update, before.update) + 'us per block in updateSystemContract, ' +
+		average(after.enact, before.enact) + 'us per block enacting');
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
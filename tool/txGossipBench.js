@@ -0,0 +1,182 @@
+/**
+ * @file: txGossipBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Measure the bandwidth and latency of transaction gossip on a local chain of many nodes, e.g. 16.
+ * Deploy HelloWorld.sol with deploy.js first.
+ *
+ *   bandwidth: <txs> HelloWorld.set transactions are sent to the nodes in turn, <inflight> requests
+ *              at a time, and mined. The eth_tx_gossip_* counters of admin_metrics are read from
+ *              every node before and after, and reported per transaction:
+ *                push, announce, request, reply   bytes sent in full pushes, hash announcements,
+ *                                                 requests for announced transactions and replies
+ *                received new/known               transactions received from peers that were new
+ *                                                 to the node, or duplicates
+ *   latency:   <probes> transactions are sent one at a time, each to the next node, and every node
+ *              is polled until it holds the transaction, queued or mined. Reports how long the
+ *              median and the last node took to get it.
+ *
+ * Run it once on the current build and once on a build without hash announcements to compare.
+ *
+ * usage: babel-node txGossipBench.js <nodeUrl,nodeUrl,...> [txs] [probes] [inflight]
+ *   e.g. babel-node txGossipBench.js http://127.0.0.1:8545,http://127.0.0.1:8546,...,http://127.0.0.1:8560 5000 50
+ */
+
+var fs = require('fs');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+var coder = require('../web3lib/codeUtils');
+var web3sync = require('../web3lib/web3sync');
+
+var args = process.argv.slice(2);
+if (!args[0]) {
+	console.log('usage: babel-node txGossipBench.js <nodeUrl,nodeUrl,...> [txs] [probes] [inflight]');
+	process.exit(1);
+}
+
+var nodes = args[0].split(',');
+var txs = parseInt(args[1] || '5000');
+var probes = parseInt(args[2] || '50');
+var inflight = parseInt(args[3] || '64');
+var address = fs.readFileSync(config.Ouputpath + 'HelloWorld.address', 'utf-8').trim();
+
+var rpc = jsonrpc.call;
+
+function sleep(ms) {
+	return new Promise((resolve) => setTimeout(resolve, ms));
+}
+
+// eth_tx_gossip_* samples of every node, summed
+async function gossipCounters() {
+	var ret = {};
+	for (var n of nodes) {
+		var text = await rpc(n, 'admin_metrics', []);
+		for (var line of text.split('\n')) {
+			var m = /^(eth_tx_gossip\w*)(\{[^}]*\})?\s+(\S+)$/.exec(line);
+			if (m)
+				ret[m[1] + (m[2] || '')] = (ret[m[1] + (m[2] || '')] || 0) + parseFloat(m[3]);
+		}
+	}
+	return ret;
+}
+
+function delta(after, before, key) {
+	return (after[key] || 0) - (before[key] || 0);
+}
+
+var limit = 0;
+var sent = 0;
+
+function signedTx() {
+	return web3sync.signTransaction({
+		data: coder.codeTxData('set(string)', ['string'], ['gossip tx ' + sent++]),
+		from: config.account,
+		to: address,
+		gas: 1000000,
+		randomid: Math.ceil(Math.random() * 100000000000),
+		blockLimit: limit
+	}, config.privKey, null);
+}
+
+async function waitMined(hashes) {
+	async function waiter() {
+		while (hashes.length) {
+			var h = hashes.pop();
+			while (!(await rpc(nodes[0], 'eth_getTransactionReceipt', [h])))
+				await sleep(100);
+		}
+	}
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(waiter());
+	await Promise.all(workers);
+}
+
+async function bandwidth() {
+	var hashes = [];
+	var next = 0;
+	var failed = 0;
+
+	async function sender() {
+		while (next < txs) {
+			var i = next++;
+			try {
+				hashes.push(await rpc(nodes[i % nodes.length], 'eth_sendRawTransaction', [signedTx()]));
+			} catch (e) {
+				++failed;
+			}
+		}
+	}
+
+	var before = await gossipCounters();
+	var start = Date.now();
+	var workers = [];
+	for (var w = 0; w < inflight; ++w)
+		workers.push(sender());
+	await Promise.all(workers);
+	var accepted = hashes.length;
+	await waitMined(hashes);
+	var seconds = (Date.now() - start) / 1000;
+	var after = await gossipCounters();
+
+	var per = (packet) => Math.round(delta(after, before, 'eth_tx_gossip_bytes_total{packet="' + packet + '"}') / (accepted || 1));
+	var total = ['push', 'announce', 'request', 'reply'].reduce((sum, p) => sum + delta(after, before, 'eth_tx_gossip_bytes_total{packet="' + p + '"}'), 0);
+	console.log(accepted + ' txs (' + failed + ' rejected) on ' + nodes.length + ' nodes mined in ' + seconds + 's');
+	console.log('  gossip bytes/tx ' + Math.round(total / (accepted || 1)) + ': push ' + per('push') + ', announce ' + per('announce')
+		+ ', request ' + per('request') + ', reply ' + per('reply'));
+	console.log('  received from peers: new ' + delta(after, before, 'eth_tx_gossip_received_total{result="new"}')
+		+ ', known ' + delta(after, before, 'eth_tx_gossip_received_total{result="known"}')
+		+ ', rejected ' + delta(after, before, 'eth_tx_gossip_received_total{result="rejected"}'));
+}
+
+// does the node hold the transaction, queued, in the block being sealed or mined?
+async function holds(nodeUrl, hash) {
+	var p = await rpc(nodeUrl, 'eth_pendingTransactions', []);
+	for (var t of (p.current || []).concat(p.pending || []))
+		if (t.hash == hash)
+			return true;
+	return !!(await rpc(nodeUrl, 'eth_getTransactionReceipt', [hash]));
+}
+
+function percentile(sorted, p) {
+	return sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))] : 0;
+}
+
+async function latency() {
+	var medians = [];
+	var lasts = [];
+	for (var i = 0; i < probes; ++i) {
+		var origin = nodes[i % nodes.length];
+		var start = Date.now();
+		var hash = await rpc(origin, 'eth_sendRawTransaction', [signedTx()]);
+		var arrival = await Promise.all(nodes.filter((n) => n != origin).map(async (n) => {
+			while (!(await holds(n, hash))) {
+				if (Date.now() - start > 60000)
+					throw new Error(n + ' still lacks ' + hash + ' after 60s');
+				await sleep(10);
+			}
+			return Date.now() - start;
+		}));
+		arrival.sort((a, b) => a - b);
+		medians.push(percentile(arrival, 0.5));
+		lasts.push(arrival[arrival.length - 1] || 0);
+		await waitMined([hash]);
+	}
+	medians.sort((a, b) => a - b);
+	lasts.sort((a, b) => a - b);
+	console.log(probes + ' probes, ms to reach the median node p50 ' + percentile(medians, 0.5) + ' p90 ' + percentile(medians, 0.9)
+		+ ', the last node p50 ' + percentile(lasts, 0.5) + ' p90 ' + percentile(lasts, 0.9) + ' max ' + (lasts[lasts.length - 1] || 0));
+}
+
+(async function() {
+	limit = parseInt(await rpc(nodes[0], 'eth_blockNumber', []), 16) + 1000;
+	await bandwidth();
+	limit = parseInt(await rpc(nodes[0], 'eth_blockNumber', []), 16) + 1000;
+	await latency();
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
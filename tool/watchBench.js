@@ -0,0 +1,90 @@
+/**
+ * @file: watchBench.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Install many log watches (eth_newFilter), keep them alive and report how long the node spends
+ * matching each block's logs against them, read from the watch_match_duration_us histogram of
+ * the metrics endpoint (metricsPort in config.json).
+ *
+ * Most watches name random addresses and never fire; <matching> of them follow the LogBench
+ * contract by address or by its group topic. Generate load meanwhile, e.g. 5000 transactions
+ * per block with: babel-node getLogsBench.js populate 100000 10 1000 64
+ *
+ * usage: babel-node watchBench.js <metricsPort> [watches] [matching] [seconds]
+ */
+
+var fs = require('fs');
+var crypto = require('crypto');
+var config = require('../web3lib/config');
+var jsonrpc = require('../web3lib/jsonrpc');
+
+var args = process.argv.slice(2);
+if (args.length < 1) {
+	console.log('usage: babel-node watchBench.js <metricsPort> [watches] [matching] [seconds]');
+	process.exit(1);
+}
+
+var metricsPort = parseInt(args[0]);
+var watches = parseInt(args[1] || '10000');
+var matching = parseInt(args[2] || '100');
+var seconds = parseInt(args[3] || '120');
+
+var address = fs.readFileSync(config.Ouputpath + 'LogBench.address', 'utf-8').trim();
+
+var rpc = jsonrpc.client(config.HttpProvider);
+
+/// @returns {count, sum} of the block source of watch_match_duration_us
+async function matchTime() {
+	var text = await jsonrpc.request({hostname: '127.0.0.1', port: metricsPort, path: '/metrics', method: 'GET'});
+	var ret = {count: 0, sum: 0};
+	for (var line of text.split('\n')) {
+		var m = line.match(/^watch_match_duration_us_(count|sum)\{source="block"\} (\d+)/);
+		if (m)
+			ret[m[1]] = parseInt(m[2]);
+	}
+	return ret;
+}
+
+function randomHex(bytes) {
+	return '0x' + crypto.randomBytes(bytes).toString('hex');
+}
+
+(async function() {
+	console.log('installing ' + watches + ' watches, ' + matching + ' of them matching ' + address);
+	var ids = [];
+	for (var i = 0; i < watches; ++i) {
+		var filter;
+		if (i < matching)
+			filter = i % 2 ? {address: address} : {topics: [null, null, null, '0x' + ('0'.repeat(63) + (i % 10))]};
+		else
+			filter = i % 2 ? {address: randomHex(20)} : {topics: [randomHex(32)]};
+		ids.push(await rpc('eth_newFilter', [filter]));
+	}
+
+	// watches are dropped after 20s without a poll
+	var polled = 0;
+	async function pollAll() {
+		for (var id of ids)
+			polled += (await rpc('eth_getFilterChanges', [id])).length;
+	}
+
+	var before = await matchTime();
+	var end = Date.now() + seconds * 1000;
+	while (Date.now() < end) {
+		var start = Date.now();
+		await pollAll();
+		var after = await matchTime();
+		var blocks = after.count - before.count;
+		console.log(blocks + ' blocks matched, ' + (blocks ? Math.round((after.sum - before.sum) / blocks) : 0) + 'us per block, ' + polled + ' changes delivered');
+		await new Promise((resolve) => setTimeout(resolve, Math.max(0, 5000 - (Date.now() - start))));
+	}
+
+	for (var id of ids)
+		await rpc('eth_uninstallFilter', [id]);
+	jsonrpc.close();
+})().catch((e) => {
+	console.log(e.message);
+	process.exit(1);
+});
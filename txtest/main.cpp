@@ -0,0 +1,244 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * Transaction data decoding test. A transaction whose data is a JSON object is an old CNS call
+ * or a UTXO transaction, and decoding skips the JSON parse for data that cannot be one. Every
+ * node must classify the same data the same way, so the data of each case below, and of every
+ * short prefix of whitespace, comments and junk before a few bodies, is decoded and checked
+ * against what Json::Reader alone makes of it. Exits with 1 on any failure.
+ *
+ * usage: txtest [prefixLength]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+#include <libdevcore/easylog.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libethereum/Transaction.h>
+#include <libweb3jsonrpc/JsonHelper.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+unsigned g_failures = 0;
+
+void check(bool _ok, string const& _what)
+{
+	if (!_ok)
+	{
+		++g_failures;
+		cerr << "FAILED: " << _what << endl;
+	}
+}
+
+string const c_cns = "{\"contract\":\"Hello\",\"func\":\"get\",\"version\":\"\",\"params\":[]}";
+string const c_utxo = "{\"utxotype\":2}";
+
+/// Data bodies the prefixes go in front of.
+vector<string> const c_bodies = {
+	c_cns,
+	c_utxo,
+	"{\"x\":1}",
+	"[1]",
+	"",
+	string("\x12\x34\x56\x78", 4),
+};
+
+/// Characters the prefixes are made of.
+string const c_prefixChars = " \r\n/*a{";
+
+struct Case
+{
+	string data;
+	string expected;
+};
+
+vector<Case> const c_cases = {
+	{c_cns, "cns Hello"},
+	{" \t\r\n" + c_utxo, "utxo 2"},
+	{"// note\n" + c_cns, "cns Hello"},
+	{"// note\r" + c_utxo, "utxo 2"},
+	{"/* note */" + c_cns, "cns Hello"},
+	{"/**/ /* a */\n// b\n" + c_utxo, "utxo 2"},
+	{"/*/" + c_cns, "default"},
+	{"/* unterminated " + c_cns, "default"},
+	{"// " + c_cns, "default"},
+	{"/ " + c_cns, "default"},
+	{"{\"x\":1}", "throws"},
+	{string("\xcd\xcf\xa7\x7a", 4) + c_cns, "default"},
+};
+
+/// A transaction as Transaction::streamRLP writes it, carrying @a _data; the signature is not checked.
+bytes transactionWith(string const& _data)
+{
+	RLPStream s;
+	s.appendList(10) << u256(1) << u256(1) << u256(300000000) << u256(100) << Address(1) << u256(0)
+		<< bytesConstRef(&_data) << byte(27) << u256(sha3("r")) << u256(sha3("s"));
+	return s.out();
+}
+
+string describe(Transaction const& _tx)
+{
+	if (_tx.isCNSOldTransaction())
+		return "cns " + _tx.cnsParams().strContractName;
+	if (_tx.getUTXOType() != InValid)
+		return "utxo " + toString((int)_tx.getUTXOType());
+	return "default";
+}
+
+/// @returns how decoding classifies a transaction carrying @a _data.
+string decoded(string const& _data)
+{
+	try
+	{
+		return describe(Transaction(transactionWith(_data), CheckTransaction::None));
+	}
+	catch (...)
+	{
+		return "throws";
+	}
+}
+
+/// @returns how decoding should classify @a _data, from what Json::Reader makes of it.
+string expected(string const& _data)
+{
+	Json::Value json;
+	try
+	{
+		if (!Json::Reader().parse(_data, json, false) || !json.isObject())
+			return "default";
+	}
+	catch (...)
+	{
+		return "default";
+	}
+	if (json.isMember("utxotype") && json["utxotype"].isInt())
+		return json["utxotype"].asInt() == InValid ? "default" : "utxo " + toString(json["utxotype"].asInt());
+	try
+	{
+		CnsParams params;
+		fromJsonGetParams(json, params);
+		return "cns " + params.strContractName;
+	}
+	catch (...)
+	{
+		return "throws";
+	}
+}
+
+/// @returns whether Json::Reader alone takes @a _data for UTXO transaction JSON.
+bool expectedUTXO(string const& _data)
+{
+	try
+	{
+		Json::Value json;
+		return Json::Reader().parse(_data, json, false) && json.isMember("utxotype") && json["utxotype"].isInt();
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+string quoted(string const& _data)
+{
+	string ret = "\"";
+	for (char c: _data)
+		if (c == '\n')
+			ret += "\\n";
+		else if (c == '\r')
+			ret += "\\r";
+		else if (c == '\t')
+			ret += "\\t";
+		else if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7f)
+			ret += "\\x" + toHex(bytes(1, (byte)c));
+		else
+			ret += c;
+	return ret + "\"";
+}
+
+/// Decodes @a _data and checks it against Json::Reader; @returns the decoded classification.
+string checkData(string const& _data)
+{
+	string actual = decoded(_data);
+	string want = expected(_data);
+	check(actual == want, quoted(_data) + " decoded as " + actual + ", Json::Reader makes it " + want);
+
+	Json::Value json;
+	bool utxo = Transaction().isUTXOTx(_data, json);
+	check(utxo == expectedUTXO(_data), quoted(_data) + (utxo ? " taken" : " not taken") + " for UTXO JSON");
+	return actual;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	unsigned prefixLength = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5;
+
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	for (auto const& c: c_cases)
+	{
+		string actual = checkData(c.data);
+		check(actual == c.expected, quoted(c.data) + " decoded as " + actual + ", expected " + c.expected);
+	}
+
+	// every prefix up to prefixLength characters long, in front of every body
+	size_t checked = c_cases.size();
+	vector<unsigned> digits;
+	while (digits.size() <= prefixLength)
+	{
+		string prefix;
+		for (auto d: digits)
+			prefix += c_prefixChars[d];
+		for (auto const& body: c_bodies)
+			checkData(prefix + body);
+		checked += c_bodies.size();
+
+		size_t i = 0;
+		for (; i < digits.size() && ++digits[i] == c_prefixChars.size(); ++i)
+			digits[i] = 0;
+		if (i == digits.size())
+			digits.push_back(0);
+	}
+
+	cout << checked << " transaction data checked" << endl;
+	cout << (g_failures ? "FAILED" : "OK") << endl;
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,417 @@
+/*
+	This file is part of FISCO BCOS.
+
+	FISCO BCOS is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FISCO BCOS is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FISCO BCOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file: main.cpp
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * UTXO benchmark: mints the tokens over the accounts in a scratch UTXO DB, then runs blocks of
+ * SendSelectedTokens transactions the way Block does, partitioned and through UTXOTxQueue, and
+ * prints the UTXO tx/s. The same blocks in a single partition, on one thread, are the baseline.
+ * Before that it times the UTXO hash of a block of 10k writes, as getHash takes it now and as it
+ * did when it encoded the records itself.
+ *
+ * usage: utxobench [accounts] [tokens] [txsPerBlock] [blocks] [dependent%]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <libdevcore/CommonJS.h>
+#include <libdevcore/easylog.h>
+#include <libdevcore/TrieHash.h>
+#include <libdevcrypto/Common.h>
+#include <libethereum/Block.h>
+#include <libethereum/Transaction.h>
+#include <UTXO/UTXODBMgr.h>
+#include <UTXO/UTXOIndex.h>
+#include <UTXO/UTXOMgr.h>
+#include <UTXO/UTXOSharedData.h>
+#include <UTXO/UTXOTxQueue.h>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace UTXOModel;
+
+namespace
+{
+
+/// Outputs of one minting transaction, the most a UTXO transaction may have.
+const unsigned c_mintOuts = 1000;
+/// Value of every minted token.
+const u256 c_mintValue = 1000000;
+/// Writes in the block whose UTXO hash is timed.
+const size_t c_hashWrites = 10000;
+
+struct Spendable
+{
+	string tokenKey;
+	size_t owner;
+	u256 value;
+};
+
+/// Accounts, and the minted tokens not yet spent in the order they get spent.
+struct World
+{
+	vector<Address> accounts;
+	vector<Spendable> minted;
+	size_t nextMinted = 0;
+	u256 nextId = 1;
+	KeyPair key = KeyPair::create();
+	mt19937 rng{ 42 };
+};
+
+string to(World const& _w, size_t _account)
+{
+	return toJS(_w.accounts[_account]);
+}
+
+Transaction makeTx(World& _w, string const& _json, size_t _sender)
+{
+	// decoded again, as the block's transactions are, so that the UTXO fields are parsed
+	Transaction signedTx(0, 1, 300000000, Address(), asBytes(_json), _w.nextId++, _w.key.secret());
+	Transaction ret(signedTx.rlp(), CheckTransaction::None);
+	// ownership is checked against the sender; skip recovering it from the signature
+	ret.forceSender(_w.accounts[_sender]);
+	return ret;
+}
+
+/// Registers the accounts and mints the tokens round robin over them, committing them to the DB.
+void mint(World& _w, UTXOMgr& _mgr, size_t _accounts, size_t _tokens)
+{
+	for (size_t i = 0; i < _accounts; ++i)
+	{
+		_w.accounts.push_back(Address(i + 1));
+		UTXOSharedData::getInstance()->pushAcccountToList(sha3(to(_w, i)));
+	}
+
+	UTXOSharedData::getInstance()->setBlockNum(1);
+	size_t token = 0;
+	unsigned txs = 0;
+	while (token < _tokens)
+	{
+		vector<UTXOTxOut> outs;
+		for (unsigned i = 0; i < c_mintOuts && token + i < _tokens; ++i)
+		{
+			UTXOTxOut out;
+			out.to = to(_w, (token + i) % _accounts);
+			out.value = c_mintValue;
+			out.checkType = UTXO_OWNERSHIP_CHECK_TYPE_P2PK;
+			outs.push_back(out);
+		}
+		h256 txHash = sha3(toString(_w.nextId++));
+		_mgr.initTokens(txHash, Address(), outs);
+		for (unsigned i = 0; i < outs.size(); ++i)
+			_w.minted.push_back(Spendable{ toJS(txHash) + "_" + toString(i), (token + i) % _accounts, c_mintValue });
+		token += outs.size();
+
+		if (++txs % 100 == 0 || token >= _tokens)
+		{
+			_mgr.commitDB();
+			_mgr.clearDBRecord();
+			cout << "\rminted " << token << " tokens" << flush;
+		}
+	}
+	cout << endl;
+	// spend them in a different order than they were minted, as the DB would see them
+	shuffle(_w.minted.begin(), _w.minted.end(), _w.rng);
+}
+
+/// A block of transfers: each sends half a token to another account and the rest back to its
+/// owner. @a _dependent percent of them spend the change of an earlier one in the block.
+Transactions makeBlock(World& _w, size_t _txs, unsigned _dependent)
+{
+	Transactions ret;
+	vector<Spendable> change;
+	uniform_int_distribution<size_t> account(0, _w.accounts.size() - 1);
+	for (size_t i = 0; i < _txs; ++i)
+	{
+		Spendable in;
+		if (!change.empty() && _w.rng() % 100 < _dependent)
+		{
+			size_t pick = _w.rng() % change.size();
+			in = change[pick];
+			change[pick] = change.back();
+			change.pop_back();
+		}
+		else
+		{
+			if (_w.nextMinted == _w.minted.size())
+				break;
+			in = _w.minted[_w.nextMinted++];
+		}
+
+		size_t recipient = account(_w.rng);
+		u256 sent = in.value / 2;
+		string json = "{\"utxotype\":2,\"txin\":[{\"tokenkey\":\"" + in.tokenKey + "\"}],\"txout\":["
+			"{\"to\":\"" + to(_w, recipient) + "\",\"value\":\"" + toString(sent) + "\",\"checktype\":\"P2PK\"},"
+			"{\"to\":\"" + to(_w, in.owner) + "\",\"value\":\"" + toString(in.value - sent) + "\",\"checktype\":\"P2PK\"}]}";
+		ret.push_back(makeTx(_w, json, in.owner));
+		if (in.value - sent >= 2)
+			change.push_back(Spendable{ toJS(ret.back().sha3()) + "_1", in.owner, in.value - sent });
+	}
+	return ret;
+}
+
+/// The records of a block as UTXODBMgr cached them before the hash leaves were encoded on write.
+struct OldRecords
+{
+	ShardedIndex<string, UTXODBCache, std::hash<string>> writes;
+	ShardedIndex<TokenID, Token> tokens;
+	ShardedIndex<TokenID, TokenExtOnBlockNum> tokenBlockNums;
+
+	/// UTXODBMgr::addToken of a new token, without the encoding.
+	void addToken(string const& _key, TokenBase const& _base, TokenExt const& _ext, u256 const& _number)
+	{
+		string baseKey = GET_TOKEN_BASE_KEY(_key);
+		writes.set(baseKey, UTXODBCache(baseKey, toJS(_base.rlp())));
+		string extKey = GET_TOKEN_EXT_KEY(_key, toJS(_number));
+		writes.set(extKey, UTXODBCache(extKey, toJS(_ext.rlp())));
+		TokenExtOnBlockNum tokenIdx;
+		tokenIdx.addUpdatedBlockNum(_number);
+		string numKey = GET_TOKEN_NUM_KEY(_key);
+		writes.set(numKey, UTXODBCache(numKey, toJS(tokenIdx.rlp())));
+		TokenID id;
+		if (toTokenID(_key, id))
+		{
+			tokenBlockNums.set(id, tokenIdx);
+			tokens.set(id, Token(_base, _ext));
+		}
+	}
+
+	/// UTXODBMgr::getHash as it encoded every record.
+	h256 hash() const
+	{
+		BytesMap recordsMap;
+		writes.forEach([&](string const& key, UTXODBCache const& record) {
+			if (key.substr(0,2) == VAULT_KEY_PERFIX)
+				return;
+			RLPStream k;
+			k << key;
+			RLPStream rlp;
+			record.streamRLP(rlp);
+			recordsMap.insert(make_pair(k.out(), rlp.out()));
+		});
+		return hash256(recordsMap);
+	}
+};
+
+/// Times the writes and the UTXO hash of blocks of @a _writes records, new tokens as the outputs
+/// of transfers write them, the way UTXODBMgr does now and the way it did before.
+void benchHash(size_t _writes, unsigned _rounds)
+{
+	// a new token writes its base, its state at the block and the blocks it changed in
+	vector<pair<string, Token>> tokens;
+	for (size_t i = 0; i < _writes / 3; ++i)
+	{
+		h256 txHash = sha3(toString(i));
+		TokenBase base(txHash, 0, c_mintValue, toJS(Address(i + 1)), UTXO_OWNERSHIP_CHECK_TYPE_P2PK, Address(), "");
+		tokens.push_back(make_pair(toJS(txHash) + "_0", Token(base, TokenExt(TokenStateInit, ""))));
+	}
+
+	double oldWrite = 0;
+	double oldHash = 0;
+	double newWrite = 0;
+	double newHash = 0;
+	for (unsigned r = 0; r < _rounds; ++r)
+	{
+		u256 number = r + 2;
+		OldRecords old;
+		auto start = chrono::steady_clock::now();
+		for (auto const& t : tokens)
+			old.addToken(t.first, t.second.m_tokenBase, t.second.m_tokenExt, number);
+		auto oldWritten = chrono::steady_clock::now();
+		h256 before = old.hash();
+		auto oldHashed = chrono::steady_clock::now();
+
+		UTXODBMgr mgr;
+		mgr.setBlockNum(number);
+		auto newStart = chrono::steady_clock::now();
+		for (auto const& t : tokens)
+			mgr.addToken(t.first, t.second.m_tokenBase, t.second.m_tokenExt, true);
+		auto newWritten = chrono::steady_clock::now();
+		h256 after = mgr.getHash();
+		auto newHashed = chrono::steady_clock::now();
+
+		if (before != after)
+		{
+			cerr << "UTXO hash " << after << " differs from " << before << " the old way" << endl;
+			exit(1);
+		}
+		oldWrite += chrono::duration<double, milli>(oldWritten - start).count();
+		oldHash += chrono::duration<double, milli>(oldHashed - oldWritten).count();
+		newWrite += chrono::duration<double, milli>(newWritten - newStart).count();
+		newHash += chrono::duration<double, milli>(newHashed - newWritten).count();
+	}
+
+	cout << fixed << setprecision(2);
+	cout << "UTXO hash of " << tokens.size() * 3 << " writes per block, ms per block:" << endl;
+	cout << "  encoded by getHash:  write " << oldWrite / _rounds << ", hash " << oldHash / _rounds << endl;
+	cout << "  encoded on write:    write " << newWrite / _rounds << ", hash " << newHash / _rounds << endl;
+}
+
+struct BlockTimes
+{
+	double partition = 0;
+	double execute = 0;
+	double hash = 0;
+	double commit = 0;
+	size_t txs = 0;
+	size_t partitions = 0;
+};
+
+/// Runs @a _txs as Block::execUTXOInBlock does, then hashes and commits the block's records.
+void runBlock(UTXOMgr& _mgr, Transactions const& _txs, bool _partitioned, BlockTimes& o_times)
+{
+	auto start = chrono::steady_clock::now();
+	map<h256, bool> parallel;
+	size_t parallelCnt = 0;
+	map<h256, unsigned> partitions;
+	Block::getParallelUTXOTx(_txs, parallel, parallelCnt, partitions);
+	auto partitioned = chrono::steady_clock::now();
+
+	if (parallelCnt)
+	{
+		Mutex x_done;
+		condition_variable done;
+		bool ready = false;
+		UTXOTxQueue queue(parallelCnt, &_mgr);
+		auto onReady = queue.onReady([&]() {
+			Guard l(x_done);
+			ready = true;
+			done.notify_all();
+		});
+		set<unsigned> used;
+		for (Transaction const& t : _txs)
+			if (parallel[t.sha3()])
+			{
+				unsigned p = _partitioned ? partitions[t.sha3()] : 0;
+				used.insert(p);
+				queue.enqueue(t, p);
+			}
+		unique_lock<Mutex> l(x_done);
+		done.wait(l, [&]() { return ready; });
+		l.unlock();
+
+		// a transaction that threw has no result
+		map<h256, UTXOExecuteState> results = queue.getTxResult();
+		if (results.size() != parallelCnt)
+		{
+			cerr << parallelCnt - results.size() << " transactions failed" << endl;
+			exit(1);
+		}
+		for (auto const& r : results)
+			if (r.second != UTXOExecuteState::Success)
+			{
+				cerr << "transaction " << r.first << " failed: " << getMsgByCode(r.second) << endl;
+				exit(1);
+			}
+		o_times.partitions += used.size();
+	}
+	auto executed = chrono::steady_clock::now();
+
+	_mgr.getHash();
+	auto hashed = chrono::steady_clock::now();
+
+	_mgr.commitDB();
+	_mgr.clearDBRecord();
+	auto committed = chrono::steady_clock::now();
+
+	o_times.partition += chrono::duration<double, milli>(partitioned - start).count();
+	o_times.execute += chrono::duration<double, milli>(executed - partitioned).count();
+	o_times.hash += chrono::duration<double, milli>(hashed - executed).count();
+	o_times.commit += chrono::duration<double, milli>(committed - hashed).count();
+	o_times.txs += parallelCnt;
+}
+
+void report(string const& _name, BlockTimes const& _t, unsigned _blocks)
+{
+	double total = _t.partition + _t.execute + _t.hash + _t.commit;
+	cout << _name << ": " << _t.txs << " parallel txs in " << _blocks << " blocks, " << _t.partitions / _blocks << " partitions per block" << endl;
+	cout << fixed << setprecision(2);
+	cout << "  per block ms: partition " << _t.partition / _blocks << ", execute " << _t.execute / _blocks << ", hash " << _t.hash / _blocks << ", commit " << _t.commit / _blocks << endl;
+	cout << setprecision(0);
+	cout << "  execute " << _t.txs / (_t.execute / 1000) << " tx/s, with partition, hash and commit " << _t.txs / (total / 1000) << " tx/s" << endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	size_t accounts = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+	size_t tokens = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+	size_t txsPerBlock = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000;
+	unsigned blocks = argc > 4 ? strtoul(argv[4], nullptr, 10) : 10;
+	unsigned dependent = argc > 5 ? strtoul(argv[5], nullptr, 10) : 10;
+	if (!accounts || tokens < 2 * txsPerBlock * blocks)
+	{
+		cerr << "usage: utxobench [accounts] [tokens] [txsPerBlock] [blocks] [dependent%]; tokens must cover 2 * txsPerBlock * blocks" << endl;
+		return 1;
+	}
+
+	// the UTXO code logs every token at TRACE
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureLogger("default", conf);
+	el::Loggers::reconfigureLogger("fileLogger", conf);
+	updateLogLevels();
+
+	boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("utxobench-%%%%-%%%%");
+	UTXOSharedData::getInstance()->initialize(dir.string());
+	cout << accounts << " accounts, " << tokens << " tokens, " << txsPerBlock << " txs per block, " << dependent << "% spending a token of the same block, DB in " << dir.string() << endl;
+
+	benchHash(c_hashWrites, 20);
+
+	World w;
+	UTXOMgr mgr;
+	mint(w, mgr, accounts, tokens);
+
+	// alternate, so that both see the DB at the same size
+	BlockTimes partitioned;
+	BlockTimes single;
+	u256 number = 2;
+	for (unsigned i = 0; i < blocks; ++i)
+	{
+		UTXOSharedData::getInstance()->setBlockNum(number++);
+		runBlock(mgr, makeBlock(w, txsPerBlock, dependent), true, partitioned);
+		UTXOSharedData::getInstance()->setBlockNum(number++);
+		runBlock(mgr, makeBlock(w, txsPerBlock, dependent), false, single);
+	}
+	report("partitioned, " + toString(max(thread::hardware_concurrency(), 3U) - 2U) + " executer threads", partitioned, blocks);
+	report("one partition", single, blocks);
+
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(dir, ec);
+	return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file: jsonrpc.js
+ * @author: fisco-dev
+ *
+ * @date: 2018
+ *
+ * JSON-RPC over keep-alive HTTP for the benchmarks and tests in tool/. All calls share one
+ * agent, so connections to every node are reused; call close() before exiting.
+ */
+
+var http = require('http');
+var url = require('url');
+
+var agent = new http.Agent({keepAlive: true, maxSockets: 64});
+
+/// sends body, if any, with the http options and @returns a promise of the response text
+function request(options, body) {
+	return new Promise((resolve, reject) => {
+		var req = http.request(Object.assign({agent: agent}, options), (res) => {
+			var chunks = [];
+			res.on('data', (c) => chunks.push(c));
+			res.on('end', () => resolve(Buffer.concat(chunks).toString()));
+		});
+		req.on('error', reject);
+		if (body)
+			req.write(body);
+		req.end();
+	});
+}
+
+/// @returns a promise of the result of method(params) on the node at nodeUrl; rejects on an rpc error
+async function call(nodeUrl, method, params) {
+	var endpoint = url.parse(nodeUrl);
+	var body = JSON.stringify({jsonrpc: '2.0', method: method, params: params, id: 1});
+	var resp = JSON.parse(await request({
+		hostname: endpoint.hostname,
+		port: endpoint.port,
+		path: endpoint.path,
+		method: 'POST',
+		headers: {'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body)}
+	}, body));
+	if (resp.error)
+		throw new Error(method + ': ' + JSON.stringify(resp.error));
+	return resp.result;
+}
+
+/// @returns rpc(method, params) bound to the node at nodeUrl
+function client(nodeUrl) {
+	return (method, params) => call(nodeUrl, method, params);
+}
+
+/// caps the connections kept open to each node, 64 by default
+function setMaxSockets(n) {
+	agent.maxSockets = n;
+}
+
+function close() {
+	agent.destroy();
+}
+
+exports.request = request;
+exports.call = call;
+exports.client = client;
+exports.setMaxSockets = setMaxSockets;
+exports.close = close;